@@ -0,0 +1,518 @@
+
+//
+// NOTE: Worker Thread
+//
+
+ASSET_STREAM_LOAD(AssetStreamLoadCopy)
+{
+    Copy((u8*)Data + Offset, Dst, Size);
+}
+
+DWORD WINAPI AssetStreamWorkerThread(LPVOID Param)
+{
+    asset_stream* Stream = (asset_stream*)Param;
+
+    u32 RequestId = 0;
+    while (true)
+    {
+        // NOTE: Every request releases the semaphore once, quitting releases it one more time
+        WaitForSingleObject(Stream->WorkSemaphore, INFINITE);
+        if (Stream->Quit)
+        {
+            break;
+        }
+
+        asset_stream_request* Request = Stream->Requests + (RequestId % ASSET_STREAM_MAX_REQUESTS);
+
+        // NOTE: A request never straddles the end of the ring, we skip the rest of the ring instead
+        u64 RingSize = ASSET_STREAM_RING_SIZE;
+        u64 Offset = (u64(Stream->RingHead) + ASSET_STREAM_RING_ALIGNMENT - 1) & ~u64(ASSET_STREAM_RING_ALIGNMENT - 1);
+        if ((Offset % RingSize) + Request->Size > RingSize)
+        {
+            Offset += RingSize - (Offset % RingSize);
+        }
+
+        // NOTE: Ring space only comes back once the GPU finished a batch, that takes a frame or two so polling is fine
+        while (Offset + Request->Size - u64(Stream->RingTail) > RingSize)
+        {
+            if (Stream->Quit)
+            {
+                return 0;
+            }
+            Sleep(1);
+        }
+
+        Request->Load(Request->LoadData, Request->LoadOffset, Stream->RingBase + (Offset % RingSize), Request->Size);
+        Request->RingOffset = Offset % RingSize;
+        Request->RingEnd = Offset + Request->Size;
+        Stream->RingHead = LONG64(Request->RingEnd);
+
+        // NOTE: Publishes the data and the request writes above to the main thread
+        InterlockedIncrement(&Stream->NumLoaded);
+        RequestId += 1;
+    }
+
+    return 0;
+}
+
+//
+// NOTE: Asset Streaming
+//
+
+inline void AssetStreamCreate(u32 GraphicsFamilyId, asset_stream* Result)
+{
+    *Result = {};
+    Result->GraphicsFamilyId = GraphicsFamilyId;
+
+    // NOTE: The transfer only family got requested at device creation (DemoDeviceCreate), it maps to the copy engines
+    Result->TransferFamilyId = DemoState->DeviceSetup.TransferFamilyId;
+    Result->Dedicated = Result->TransferFamilyId != 0xFFFFFFFF && DemoState->DeviceCaps.TransferQueue;
+    Result->UseTimeline = DemoState->DeviceCaps.TimelineSemaphore;
+
+    if (Result->Dedicated)
+    {
+        vkGetDeviceQueue(RenderState->Device, Result->TransferFamilyId, 0, &Result->Queue);
+    }
+    else
+    {
+        Result->TransferFamilyId = GraphicsFamilyId;
+        Result->Queue = RenderState->GraphicsQueue;
+    }
+
+    // NOTE: Command buffers
+    {
+        VkCommandPoolCreateInfo PoolCreateInfo = {};
+        PoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        PoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        PoolCreateInfo.queueFamilyIndex = Result->TransferFamilyId;
+        VkCheckResult(vkCreateCommandPool(RenderState->Device, &PoolCreateInfo, 0, &Result->CmdPool));
+
+        VkCommandBufferAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        AllocateInfo.commandPool = Result->CmdPool;
+        AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        AllocateInfo.commandBufferCount = 1;
+        for (u32 BatchId = 0; BatchId < ASSET_STREAM_MAX_BATCHES; ++BatchId)
+        {
+            VkCheckResult(vkAllocateCommandBuffers(RenderState->Device, &AllocateInfo, &Result->Batches[BatchId].CmdBuffer));
+        }
+    }
+
+    // NOTE: Batches signal increasing values of one timeline semaphore, without timelineSemaphore each batch gets a fence
+    if (Result->UseTimeline)
+    {
+        VkSemaphoreTypeCreateInfo TypeCreateInfo = {};
+        TypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        TypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        TypeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo CreateInfo = {};
+        CreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        CreateInfo.pNext = &TypeCreateInfo;
+        VkCheckResult(vkCreateSemaphore(RenderState->Device, &CreateInfo, 0, &Result->Timeline));
+    }
+    else
+    {
+        VkFenceCreateInfo CreateInfo = {};
+        CreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        for (u32 BatchId = 0; BatchId < ASSET_STREAM_MAX_BATCHES; ++BatchId)
+        {
+            VkCheckResult(vkCreateFence(RenderState->Device, &CreateInfo, 0, &Result->Batches[BatchId].Fence));
+        }
+    }
+
+    // NOTE: Staging ring, host visible and persistently mapped so the worker can write it without touching Vulkan
+    {
+        VkBufferCreateInfo BufferCreateInfo = {};
+        BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        BufferCreateInfo.size = ASSET_STREAM_RING_SIZE;
+        BufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkCheckResult(vkCreateBuffer(RenderState->Device, &BufferCreateInfo, 0, &Result->RingBuffer));
+
+        VkMemoryRequirements Requirements;
+        vkGetBufferMemoryRequirements(RenderState->Device, Result->RingBuffer, &Requirements);
+
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = Requirements.size;
+        AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Result->RingMemory));
+        VkCheckResult(vkBindBufferMemory(RenderState->Device, Result->RingBuffer, Result->RingMemory, 0));
+        VkCheckResult(vkMapMemory(RenderState->Device, Result->RingMemory, 0, VK_WHOLE_SIZE, 0, (void**)&Result->RingBase));
+    }
+
+    Result->Requests = PushArray(&DemoState->Arena, asset_stream_request, ASSET_STREAM_MAX_REQUESTS);
+    Result->MaxNumTickets = GrowableCapacityGet(0, 1);
+    Result->TicketsPending = GrowableArrayResizeType(&DemoState->Growable, Result->TicketsPending, u32, 0, Result->MaxNumTickets);
+    Result->TicketsPending[0] = 0;
+    Result->NumTickets = 1;
+
+    Result->WorkSemaphore = CreateSemaphoreA(0, 0, ASSET_STREAM_MAX_REQUESTS + 1, 0);
+    Assert(Result->WorkSemaphore);
+    Result->Thread = CreateThread(0, 0, AssetStreamWorkerThread, Result, 0, 0);
+    Assert(Result->Thread);
+}
+
+inline void AssetStreamDestroy(asset_stream* Stream)
+{
+    // NOTE: The worker reads from memory we don't own (mapped scene files), so it has to be gone before that gets released
+    if (Stream->Thread)
+    {
+        InterlockedExchange(&Stream->Quit, 1);
+        ReleaseSemaphore(Stream->WorkSemaphore, 1, 0);
+        WaitForSingleObject(Stream->Thread, INFINITE);
+        CloseHandle(Stream->Thread);
+        CloseHandle(Stream->WorkSemaphore);
+        Stream->Thread = 0;
+    }
+}
+
+inline u32 AssetStreamTicketCreate(asset_stream* Stream)
+{
+    if (Stream->NumTickets == Stream->MaxNumTickets)
+    {
+        u32 NewMaxNumTickets = GrowableCapacityGet(Stream->MaxNumTickets, Stream->NumTickets + 1);
+        Stream->TicketsPending = GrowableArrayResizeType(&DemoState->Growable, Stream->TicketsPending, u32, Stream->MaxNumTickets,
+                                                         NewMaxNumTickets);
+        Stream->MaxNumTickets = NewMaxNumTickets;
+        DemoState->Growable.NumGrows += 1;
+    }
+
+    u32 TicketId = Stream->NumTickets++;
+    Stream->TicketsPending[TicketId] = 0;
+    return TicketId;
+}
+
+inline b32 AssetStreamTicketResident(asset_stream* Stream, u32 TicketId)
+{
+    Assert(TicketId < Stream->NumTickets);
+    b32 Result = Stream->TicketsPending[TicketId] == 0;
+    return Result;
+}
+
+inline b32 AssetStreamIdle(asset_stream* Stream)
+{
+    b32 Result = Stream->NumQueued == 0 && Stream->NumResident == u32(Stream->NumRequested);
+    return Result;
+}
+
+inline b32 AssetStreamRingFull(asset_stream* Stream)
+{
+    b32 Result = u32(Stream->NumRequested) - Stream->NumResident == ASSET_STREAM_MAX_REQUESTS;
+    return Result;
+}
+
+inline void AssetStreamRingPush(asset_stream* Stream, asset_stream_request* Request)
+{
+    Assert(!AssetStreamRingFull(Stream));
+    Stream->Requests[u32(Stream->NumRequested) % ASSET_STREAM_MAX_REQUESTS] = *Request;
+    InterlockedIncrement(&Stream->NumRequested);
+    ReleaseSemaphore(Stream->WorkSemaphore, 1, 0);
+}
+
+inline void AssetStreamQueuedFlush(asset_stream* Stream)
+{
+    // NOTE: Hand queued requests to the worker as the ring frees up
+    while (Stream->NumQueued > 0 && !AssetStreamRingFull(Stream))
+    {
+        AssetStreamRingPush(Stream, Stream->Queued + Stream->FirstQueued);
+        Stream->FirstQueued += 1;
+        Stream->NumQueued -= 1;
+    }
+
+    if (Stream->NumQueued == 0)
+    {
+        Stream->FirstQueued = 0;
+    }
+}
+
+inline void AssetStreamPush(asset_stream* Stream, asset_stream_request* Request)
+{
+    Assert(Request->TicketId > 0 && Request->TicketId < Stream->NumTickets);
+    Assert(Request->Size > 0 && Request->Size <= ASSET_STREAM_CHUNK_SIZE);
+
+    Stream->TicketsPending[Request->TicketId] += 1;
+    if (Stream->NumQueued == 0 && !AssetStreamRingFull(Stream))
+    {
+        AssetStreamRingPush(Stream, Request);
+        return;
+    }
+
+    // NOTE: The ring is full, wait on the CPU behind whatever is already waiting so requests stay in order
+    if (Stream->FirstQueued + Stream->NumQueued == Stream->MaxNumQueued)
+    {
+        for (u32 QueuedId = 0; QueuedId < Stream->NumQueued; ++QueuedId)
+        {
+            Stream->Queued[QueuedId] = Stream->Queued[Stream->FirstQueued + QueuedId];
+        }
+        Stream->FirstQueued = 0;
+
+        if (Stream->NumQueued == Stream->MaxNumQueued)
+        {
+            u32 NewMaxNumQueued = GrowableCapacityGet(Stream->MaxNumQueued, Stream->NumQueued + 1);
+            Stream->Queued = GrowableArrayResizeType(&DemoState->Growable, Stream->Queued, asset_stream_request, Stream->MaxNumQueued,
+                                                     NewMaxNumQueued);
+            Stream->MaxNumQueued = NewMaxNumQueued;
+            DemoState->Growable.NumGrows += 1;
+        }
+    }
+
+    Stream->Queued[Stream->FirstQueued + Stream->NumQueued++] = *Request;
+}
+
+inline void AssetStreamBufferRequest(asset_stream* Stream, u32 TicketId, VkBuffer Buffer, u64 BufferOffset, u64 Size,
+                                     asset_stream_load* Load, void* LoadData, VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    // NOTE: Split so that big streams still fit into the ring
+    for (u64 ChunkOffset = 0; ChunkOffset < Size; ChunkOffset += ASSET_STREAM_CHUNK_SIZE)
+    {
+        asset_stream_request Request = {};
+        Request.Type = AssetStreamType_Buffer;
+        Request.TicketId = TicketId;
+        Request.Size = Size - ChunkOffset < ASSET_STREAM_CHUNK_SIZE ? Size - ChunkOffset : ASSET_STREAM_CHUNK_SIZE;
+        Request.Load = Load;
+        Request.LoadData = LoadData;
+        Request.LoadOffset = ChunkOffset;
+        Request.Buffer = Buffer;
+        Request.BufferOffset = BufferOffset + ChunkOffset;
+        Request.DstStage = DstStage;
+        Request.DstAccess = DstAccess;
+        AssetStreamPush(Stream, &Request);
+    }
+}
+
+inline void AssetStreamImageRequest(asset_stream* Stream, u32 TicketId, VkImage Image, VkImageAspectFlags Aspect, u32 MipLevel,
+                                    u32 Width, u32 Height, u32 BlockDim, u32 BlockBytes, asset_stream_load* Load, void* LoadData,
+                                    u64 LoadOffset, VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    // NOTE: The source is tightly packed rows of blocks (uncompressed formats have 1x1 blocks). Mips that don't fit a chunk get split
+    // into bands of whole block rows
+    u32 NumBlockRows = (Height + BlockDim - 1) / BlockDim;
+    u64 RowSize = u64((Width + BlockDim - 1) / BlockDim)*u64(BlockBytes);
+    Assert(RowSize <= ASSET_STREAM_CHUNK_SIZE);
+    u32 RowsPerBand = u32(ASSET_STREAM_CHUNK_SIZE / RowSize);
+    
+    for (u32 FirstRow = 0; FirstRow < NumBlockRows; FirstRow += RowsPerBand)
+    {
+        u32 NumRows = Min(RowsPerBand, NumBlockRows - FirstRow);
+        
+        asset_stream_request Request = {};
+        Request.Type = AssetStreamType_Image;
+        Request.TicketId = TicketId;
+        Request.Size = RowSize*NumRows;
+        Request.Load = Load;
+        Request.LoadData = LoadData;
+        Request.LoadOffset = LoadOffset + RowSize*FirstRow;
+        Request.Image = Image;
+        Request.Aspect = Aspect;
+        Request.MipLevel = MipLevel;
+        Request.Width = Width;
+        Request.OffsetY = FirstRow*BlockDim;
+        Request.Height = Min(NumRows*BlockDim, Height - Request.OffsetY);
+        Request.MipBegin = FirstRow == 0;
+        Request.MipEnd = FirstRow + NumRows == NumBlockRows;
+        Request.DstStage = DstStage;
+        Request.DstAccess = DstAccess;
+        AssetStreamPush(Stream, &Request);
+    }
+}
+
+inline void AssetStreamBarrier(VkCommandBuffer CmdBuffer, asset_stream_request* Request, VkImageLayout OldLayout, VkImageLayout NewLayout,
+                               u32 SrcFamilyId, u32 DstFamilyId, VkPipelineStageFlags SrcStage, VkAccessFlags SrcAccess,
+                               VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    u32 SrcQueueFamily = SrcFamilyId == DstFamilyId ? VK_QUEUE_FAMILY_IGNORED : SrcFamilyId;
+    u32 DstQueueFamily = SrcFamilyId == DstFamilyId ? VK_QUEUE_FAMILY_IGNORED : DstFamilyId;
+    if (Request->Type == AssetStreamType_Buffer)
+    {
+        VkBufferMemoryBarrier Barrier = {};
+        Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        Barrier.srcAccessMask = SrcAccess;
+        Barrier.dstAccessMask = DstAccess;
+        Barrier.srcQueueFamilyIndex = SrcQueueFamily;
+        Barrier.dstQueueFamilyIndex = DstQueueFamily;
+        Barrier.buffer = Request->Buffer;
+        Barrier.offset = Request->BufferOffset;
+        Barrier.size = Request->Size;
+        vkCmdPipelineBarrier(CmdBuffer, SrcStage, DstStage, 0, 0, 0, 1, &Barrier, 0, 0);
+    }
+    else
+    {
+        VkImageMemoryBarrier Barrier = {};
+        Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        Barrier.srcAccessMask = SrcAccess;
+        Barrier.dstAccessMask = DstAccess;
+        Barrier.oldLayout = OldLayout;
+        Barrier.newLayout = NewLayout;
+        Barrier.srcQueueFamilyIndex = SrcQueueFamily;
+        Barrier.dstQueueFamilyIndex = DstQueueFamily;
+        Barrier.image = Request->Image;
+        Barrier.subresourceRange.aspectMask = Request->Aspect;
+        Barrier.subresourceRange.baseMipLevel = Request->MipLevel;
+        Barrier.subresourceRange.levelCount = 1;
+        Barrier.subresourceRange.baseArrayLayer = 0;
+        Barrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(CmdBuffer, SrcStage, DstStage, 0, 0, 0, 0, 0, 1, &Barrier);
+    }
+}
+
+inline void AssetStreamBatchRecord(asset_stream* Stream, asset_stream_batch* Batch)
+{
+    VkCommandBufferBeginInfo BeginInfo = {};
+    BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkCheckResult(vkBeginCommandBuffer(Batch->CmdBuffer, &BeginInfo));
+
+    for (u32 Id = 0; Id < Batch->NumRequests; ++Id)
+    {
+        asset_stream_request* Request = Stream->Requests + ((Batch->FirstRequest + Id) % ASSET_STREAM_MAX_REQUESTS);
+        if (Request->Type == AssetStreamType_Buffer)
+        {
+            VkBufferCopy Region = {};
+            Region.srcOffset = Request->RingOffset;
+            Region.dstOffset = Request->BufferOffset;
+            Region.size = Request->Size;
+            vkCmdCopyBuffer(Batch->CmdBuffer, Stream->RingBuffer, Request->Buffer, 1, &Region);
+        }
+        else
+        {
+            // NOTE: Nothing samples the image before it is resident, so its old contents can be discarded
+            if (Request->MipBegin)
+            {
+                AssetStreamBarrier(Batch->CmdBuffer, Request, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   Stream->TransferFamilyId, Stream->TransferFamilyId, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+            }
+
+            VkBufferImageCopy Region = {};
+            Region.bufferOffset = Request->RingOffset;
+            Region.imageSubresource.aspectMask = Request->Aspect;
+            Region.imageSubresource.mipLevel = Request->MipLevel;
+            Region.imageSubresource.baseArrayLayer = 0;
+            Region.imageSubresource.layerCount = 1;
+            Region.imageOffset = { 0, i32(Request->OffsetY), 0 };
+            Region.imageExtent = { Request->Width, Request->Height, 1 };
+            vkCmdCopyBufferToImage(Batch->CmdBuffer, Stream->RingBuffer, Request->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Region);
+
+            // NOTE: Bands of the same mip write disjoint rows, the mip gets released with its last band
+            if (!Request->MipEnd)
+            {
+                continue;
+            }
+        }
+
+        // NOTE: Release to the graphics family. Same family means there is no acquire, so this has to be the whole barrier
+        VkImageLayout NewLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (Stream->Dedicated)
+        {
+            AssetStreamBarrier(Batch->CmdBuffer, Request, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, NewLayout, Stream->TransferFamilyId,
+                               Stream->GraphicsFamilyId, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        }
+        else
+        {
+            AssetStreamBarrier(Batch->CmdBuffer, Request, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, NewLayout, Stream->TransferFamilyId,
+                               Stream->GraphicsFamilyId, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                               Request->DstStage, Request->DstAccess);
+        }
+    }
+
+    VkCheckResult(vkEndCommandBuffer(Batch->CmdBuffer));
+}
+
+inline b32 AssetStreamBatchDone(asset_stream* Stream, asset_stream_batch* Batch, u64 CompletedValue)
+{
+    b32 Result = false;
+    if (Stream->UseTimeline)
+    {
+        Result = CompletedValue >= Batch->TimelineValue;
+    }
+    else
+    {
+        VkResult FenceResult = vkGetFenceStatus(RenderState->Device, Batch->Fence);
+        if (FenceResult != VK_NOT_READY)
+        {
+            VkCheckResult(FenceResult);
+            VkCheckResult(vkResetFences(RenderState->Device, 1, &Batch->Fence));
+            Result = true;
+        }
+    }
+
+    return Result;
+}
+
+inline void AssetStreamUpdate(asset_stream* Stream, VkCommandBuffer GraphicsCmdBuffer)
+{
+    // NOTE: Batches signal in submission order, one read of the counter covers all of them
+    u64 CompletedValue = 0;
+    if (Stream->UseTimeline)
+    {
+        VkCheckResult(vkGetSemaphoreCounterValue(RenderState->Device, Stream->Timeline, &CompletedValue));
+    }
+
+    // NOTE: Retire finished batches, their acquires go at the start of this frames graphics work so everything after sees the data
+    while (Stream->NumBatchesInFlight > 0)
+    {
+        u32 BatchId = (Stream->NextBatch + ASSET_STREAM_MAX_BATCHES - Stream->NumBatchesInFlight) % ASSET_STREAM_MAX_BATCHES;
+        asset_stream_batch* Batch = Stream->Batches + BatchId;
+        if (!AssetStreamBatchDone(Stream, Batch, CompletedValue))
+        {
+            break;
+        }
+
+        for (u32 Id = 0; Id < Batch->NumRequests; ++Id)
+        {
+            asset_stream_request* Request = Stream->Requests + ((Batch->FirstRequest + Id) % ASSET_STREAM_MAX_REQUESTS);
+            if (Stream->Dedicated && (Request->Type == AssetStreamType_Buffer || Request->MipEnd))
+            {
+                AssetStreamBarrier(GraphicsCmdBuffer, Request, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   Stream->TransferFamilyId, Stream->GraphicsFamilyId, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                   Request->DstStage, Request->DstAccess);
+            }
+
+            Stream->TicketsPending[Request->TicketId] -= 1;
+            Stream->NumBytesStreamed += Request->Size;
+            Stream->RingTail = LONG64(Request->RingEnd);
+        }
+
+        Stream->NumResident += Batch->NumRequests;
+        Stream->NumBatchesInFlight -= 1;
+    }
+
+    AssetStreamQueuedFlush(Stream);
+
+    // NOTE: Submit everything the worker loaded since last frame as one batch
+    u32 NumLoaded = u32(Stream->NumLoaded);
+    if (NumLoaded != Stream->NumSubmitted && Stream->NumBatchesInFlight < ASSET_STREAM_MAX_BATCHES)
+    {
+        asset_stream_batch* Batch = Stream->Batches + Stream->NextBatch;
+        Batch->FirstRequest = Stream->NumSubmitted;
+        Batch->NumRequests = NumLoaded - Stream->NumSubmitted;
+        AssetStreamBatchRecord(Stream, Batch);
+
+        VkSubmitInfo SubmitInfo = {};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &Batch->CmdBuffer;
+
+        VkTimelineSemaphoreSubmitInfo TimelineInfo = {};
+        if (Stream->UseTimeline)
+        {
+            Batch->TimelineValue = ++Stream->TimelineValue;
+
+            TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            TimelineInfo.signalSemaphoreValueCount = 1;
+            TimelineInfo.pSignalSemaphoreValues = &Batch->TimelineValue;
+            SubmitInfo.pNext = &TimelineInfo;
+            SubmitInfo.signalSemaphoreCount = 1;
+            SubmitInfo.pSignalSemaphores = &Stream->Timeline;
+        }
+        VkCheckResult(vkQueueSubmit(Stream->Queue, 1, &SubmitInfo, Batch->Fence));
+
+        Stream->NumSubmitted = NumLoaded;
+        Stream->NextBatch = (Stream->NextBatch + 1) % ASSET_STREAM_MAX_BATCHES;
+        Stream->NumBatchesInFlight += 1;
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+
+  NOTE: Asset Streaming
+
+    Textures and file meshes don't get uploaded while Init blocks anymore, they get requested and show up a few frames later:
+
+      - A worker thread takes requests in order, loads/decodes them straight into a persistently mapped staging ring and publishes
+        them. When the ring is full the worker waits for the GPU to drain it, so the ring size bounds the memory we stage, not the
+        size of the scene
+      - Once per frame the main thread records everything the worker published into a command buffer for the dedicated transfer
+        queue (a family with transfer but no graphics/compute, requested by DemoDeviceCreate) and submits it. Each batch signals the
+        next value of a timeline semaphore
+      - Resources are exclusive, so the transfer queue releases every range/mip it wrote to the graphics family. Once the timeline
+        reached a batches value we record the matching acquires into the frames graphics command buffer, give the batches ring
+        space back and mark its requests resident
+      - Until then textures sample a placeholder and meshes don't get drawn
+
+    Requests that belong together (the streams of a mesh, the mips of a texture) share a ticket. A ticket counts its requests that
+    aren't resident yet, ticket 0 is always resident so CPU side uploads can use it. Buffer requests get split into chunks so they
+    always fit the ring, image requests get split per mip and big mips into bands of block rows. The worker only sees the last
+    ASSET_STREAM_MAX_REQUESTS requests, anything past that waits in a growable queue on the main thread and moves over as requests
+    become resident, so big scenes just take longer to stream in.
+
+    On devices without a transfer only family the batches go to the graphics queue, ownership transfers become plain barriers and
+    the acquire is a no op (same as async compute).
+
+    The dedicated path needs DeviceCaps.TransferQueue (see device_setup.h). Without DeviceCaps.TimelineSemaphore every batch gets its
+    own fence instead, the rest stays the same.
+
+ */
+
+#define ASSET_STREAM_RING_SIZE MegaBytes(64)
+#define ASSET_STREAM_CHUNK_SIZE MegaBytes(16)
+// NOTE: Covers texel block sizes and the 4 byte alignment vkCmdCopyBuffer(ToImage) wants
+#define ASSET_STREAM_RING_ALIGNMENT 16
+#define ASSET_STREAM_MAX_REQUESTS (1 << 14)
+#define ASSET_STREAM_MAX_BATCHES 4
+
+#define ASSET_STREAM_LOAD(name) void name(void* Data, u64 Offset, u8* Dst, u64 Size)
+typedef ASSET_STREAM_LOAD(asset_stream_load);
+
+enum asset_stream_type
+{
+    AssetStreamType_Buffer,
+    AssetStreamType_Image,
+};
+
+struct asset_stream_request
+{
+    asset_stream_type Type;
+    u32 TicketId;
+    u64 Size;
+    asset_stream_load* Load;
+    void* LoadData;
+    u64 LoadOffset;
+
+    // NOTE: Buffer destination
+    VkBuffer Buffer;
+    u64 BufferOffset;
+
+    // NOTE: Image destination, a band of block rows of one mip. Only the first band transitions the mip and only the last releases it
+    VkImage Image;
+    VkImageAspectFlags Aspect;
+    u32 MipLevel;
+    u32 Width;
+    u32 Height;
+    u32 OffsetY;
+    b32 MipBegin;
+    b32 MipEnd;
+
+    // NOTE: Where the graphics queue uses the resource, the acquire makes it visible there
+    VkPipelineStageFlags DstStage;
+    VkAccessFlags DstAccess;
+
+    // NOTE: Written by the worker, RingEnd counts bytes ever allocated so it never wraps
+    u64 RingOffset;
+    u64 RingEnd;
+};
+
+struct asset_stream_batch
+{
+    VkCommandBuffer CmdBuffer;
+    // NOTE: Value the batch signals on the timeline, or its fence without timelineSemaphore
+    u64 TimelineValue;
+    VkFence Fence;
+    u32 FirstRequest;
+    u32 NumRequests;
+};
+
+struct asset_stream
+{
+    b32 Dedicated;
+    u32 GraphicsFamilyId;
+    u32 TransferFamilyId;
+    VkQueue Queue;
+    VkCommandPool CmdPool;
+
+    b32 UseTimeline;
+    VkSemaphore Timeline;
+    u64 TimelineValue;
+
+    // NOTE: Batches retire in the order they got submitted
+    u32 NextBatch;
+    u32 NumBatchesInFlight;
+    asset_stream_batch Batches[ASSET_STREAM_MAX_BATCHES];
+
+    VkBuffer RingBuffer;
+    VkDeviceMemory RingMemory;
+    u8* RingBase;
+    // NOTE: Head is owned by the worker, tail by the main thread once the GPU is done with the bytes
+    volatile LONG64 RingHead;
+    volatile LONG64 RingTail;
+
+    // NOTE: Requests are a ring too. Requested > Loaded (worker) > Submitted > Resident
+    asset_stream_request* Requests;
+    volatile LONG NumRequested;
+    volatile LONG NumLoaded;
+    u32 NumSubmitted;
+    u32 NumResident;
+
+    // NOTE: Requests that didn't fit the ring yet, in order. Only the main thread touches these
+    u32 MaxNumQueued;
+    u32 FirstQueued;
+    u32 NumQueued;
+    asset_stream_request* Queued;
+
+    u32 MaxNumTickets;
+    u32 NumTickets;
+    u32* TicketsPending;
+
+    HANDLE Thread;
+    HANDLE WorkSemaphore;
+    volatile LONG Quit;
+
+    // NOTE: Stats
+    u64 NumBytesStreamed;
+};
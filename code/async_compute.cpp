@@ -0,0 +1,284 @@
+
+//
+// NOTE: Async Compute
+//
+
+inline void AsyncComputeCreate(async_compute* Result)
+{
+    *Result = {};
+
+    // NOTE: Find our queue families, the compute one got requested at device creation (DemoDeviceCreate)
+    {
+        u32 NumFamilies = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(RenderState->PhysicalDevice, &NumFamilies, 0);
+        VkQueueFamilyProperties* Families = PushArray(&DemoState->TempArena, VkQueueFamilyProperties, NumFamilies);
+        vkGetPhysicalDeviceQueueFamilyProperties(RenderState->PhysicalDevice, &NumFamilies, Families);
+
+        Result->GraphicsFamilyId = DemoQueueFamilyFind(Families, NumFamilies, VK_QUEUE_GRAPHICS_BIT, 0);
+        Result->ComputeFamilyId = DemoState->DeviceSetup.ComputeFamilyId;
+
+        // NOTE: The device only has a queue of that family if DemoDeviceCreate requested it (see device_setup.h)
+        Assert(Result->GraphicsFamilyId != 0xFFFFFFFF);
+        Result->Dedicated = (Result->ComputeFamilyId != 0xFFFFFFFF && DemoState->DeviceCaps.AsyncCompute &&
+                             DemoState->DeviceCaps.TimelineSemaphore);
+    }
+
+    if (!Result->Dedicated)
+    {
+        // NOTE: Single queue device, compute gets recorded inline with graphics
+        Result->ComputeFamilyId = Result->GraphicsFamilyId;
+        Result->Queue = RenderState->GraphicsQueue;
+        return;
+    }
+
+    vkGetDeviceQueue(RenderState->Device, Result->ComputeFamilyId, 0, &Result->Queue);
+
+    // NOTE: Command buffers
+    {
+        VkCommandPoolCreateInfo PoolCreateInfo = {};
+        PoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        PoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        PoolCreateInfo.queueFamilyIndex = Result->ComputeFamilyId;
+        VkCheckResult(vkCreateCommandPool(RenderState->Device, &PoolCreateInfo, 0, &Result->ComputePool));
+
+        PoolCreateInfo.queueFamilyIndex = Result->GraphicsFamilyId;
+        VkCheckResult(vkCreateCommandPool(RenderState->Device, &PoolCreateInfo, 0, &Result->GraphicsPool));
+
+        VkCommandBufferAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        AllocateInfo.commandBufferCount = 1;
+
+        AllocateInfo.commandPool = Result->ComputePool;
+        VkCheckResult(vkAllocateCommandBuffers(RenderState->Device, &AllocateInfo, &Result->ComputeBuffer));
+
+        AllocateInfo.commandPool = Result->GraphicsPool;
+        VkCheckResult(vkAllocateCommandBuffers(RenderState->Device, &AllocateInfo, &Result->GraphicsPostBuffer));
+        VkCheckResult(vkAllocateCommandBuffers(RenderState->Device, &AllocateInfo, &Result->GraphicsJoinBuffer));
+    }
+
+    // NOTE: Timeline semaphore
+    {
+        VkSemaphoreTypeCreateInfo TypeCreateInfo = {};
+        TypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        TypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        TypeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo CreateInfo = {};
+        CreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        CreateInfo.pNext = &TypeCreateInfo;
+        VkCheckResult(vkCreateSemaphore(RenderState->Device, &CreateInfo, 0, &Result->Timeline));
+    }
+}
+
+inline void AsyncComputeImageBarrier(VkCommandBuffer CmdBuffer, VkImage Image, VkImageAspectFlags Aspect,
+                                     VkImageLayout OldLayout, VkImageLayout NewLayout, u32 SrcFamilyId, u32 DstFamilyId,
+                                     VkPipelineStageFlags SrcStage, VkAccessFlags SrcAccess,
+                                     VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    VkImageMemoryBarrier Barrier = {};
+    Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    Barrier.srcAccessMask = SrcAccess;
+    Barrier.dstAccessMask = DstAccess;
+    Barrier.oldLayout = OldLayout;
+    Barrier.newLayout = NewLayout;
+    Barrier.srcQueueFamilyIndex = SrcFamilyId == DstFamilyId ? VK_QUEUE_FAMILY_IGNORED : SrcFamilyId;
+    Barrier.dstQueueFamilyIndex = SrcFamilyId == DstFamilyId ? VK_QUEUE_FAMILY_IGNORED : DstFamilyId;
+    Barrier.image = Image;
+    Barrier.subresourceRange.aspectMask = Aspect;
+    Barrier.subresourceRange.baseMipLevel = 0;
+    Barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    Barrier.subresourceRange.baseArrayLayer = 0;
+    Barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    vkCmdPipelineBarrier(CmdBuffer, SrcStage, DstStage, 0, 0, 0, 0, 0, 1, &Barrier);
+}
+
+inline void AsyncComputeFrameBegin(async_compute* AsyncCompute)
+{
+    AsyncCompute->PendingJoin = false;
+    AsyncCompute->PendingWait = false;
+    AsyncCompute->WaitValue = 0;
+}
+
+inline VkCommandBuffer AsyncComputeBegin(async_compute* AsyncCompute, vk_commands Commands)
+{
+    VkCommandBuffer Result = Commands.Buffer;
+    if (AsyncCompute->Dedicated)
+    {
+        VkCommandBufferBeginInfo BeginInfo = {};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VkCheckResult(vkBeginCommandBuffer(AsyncCompute->ComputeBuffer, &BeginInfo));
+        Result = AsyncCompute->ComputeBuffer;
+    }
+
+    return Result;
+}
+
+inline void AsyncComputeEnd(async_compute* AsyncCompute, vk_commands* Commands, VkPipelineStageFlags WaitStages)
+{
+    if (!AsyncCompute->Dedicated)
+    {
+        return;
+    }
+
+    u64 PreValue = ++AsyncCompute->TimelineValue;
+    u64 ComputeValue = ++AsyncCompute->TimelineValue;
+
+    // NOTE: Submit the graphics work that the compute work depends on
+    {
+        VkCheckResult(vkEndCommandBuffer(Commands->Buffer));
+
+        VkTimelineSemaphoreSubmitInfo TimelineInfo = {};
+        TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineInfo.signalSemaphoreValueCount = 1;
+        TimelineInfo.pSignalSemaphoreValues = &PreValue;
+
+        VkSubmitInfo SubmitInfo = {};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext = &TimelineInfo;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &Commands->Buffer;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores = &AsyncCompute->Timeline;
+        VkCheckResult(vkQueueSubmit(RenderState->GraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE));
+    }
+
+    // NOTE: Submit the compute work
+    {
+        VkCheckResult(vkEndCommandBuffer(AsyncCompute->ComputeBuffer));
+
+        VkTimelineSemaphoreSubmitInfo TimelineInfo = {};
+        TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineInfo.waitSemaphoreValueCount = 1;
+        TimelineInfo.pWaitSemaphoreValues = &PreValue;
+        TimelineInfo.signalSemaphoreValueCount = 1;
+        TimelineInfo.pSignalSemaphoreValues = &ComputeValue;
+
+        VkPipelineStageFlags WaitDstMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        VkSubmitInfo SubmitInfo = {};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext = &TimelineInfo;
+        SubmitInfo.waitSemaphoreCount = 1;
+        SubmitInfo.pWaitSemaphores = &AsyncCompute->Timeline;
+        SubmitInfo.pWaitDstStageMask = &WaitDstMask;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &AsyncCompute->ComputeBuffer;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores = &AsyncCompute->Timeline;
+        VkCheckResult(vkQueueSubmit(AsyncCompute->Queue, 1, &SubmitInfo, VK_NULL_HANDLE));
+    }
+
+    // NOTE: Keep recording the graphics work that runs next to the compute work into the post buffer
+    {
+        VkCommandBufferBeginInfo BeginInfo = {};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VkCheckResult(vkBeginCommandBuffer(AsyncCompute->GraphicsPostBuffer, &BeginInfo));
+        Commands->Buffer = AsyncCompute->GraphicsPostBuffer;
+    }
+
+    AsyncCompute->PendingJoin = true;
+    AsyncCompute->WaitValue = ComputeValue;
+    AsyncCompute->WaitStages = WaitStages;
+}
+
+inline void AsyncComputeJoin(async_compute* AsyncCompute, vk_commands* Commands)
+{
+    if (!AsyncCompute->PendingJoin)
+    {
+        return;
+    }
+
+    // NOTE: Submit the post buffer without waiting, this is the work that overlaps with the compute queue
+    {
+        VkCheckResult(vkEndCommandBuffer(Commands->Buffer));
+
+        VkSubmitInfo SubmitInfo = {};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &Commands->Buffer;
+        VkCheckResult(vkQueueSubmit(RenderState->GraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE));
+    }
+
+    // NOTE: The rest of the frame waits on the compute queue in AsyncComputeGraphicsSubmit. The frame fence only signals after it
+    // finishes, which covers everything submitted before it on the graphics queue and transitively the compute submit, so reusing
+    // these buffers next frame is safe
+    {
+        VkCommandBufferBeginInfo BeginInfo = {};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VkCheckResult(vkBeginCommandBuffer(AsyncCompute->GraphicsJoinBuffer, &BeginInfo));
+        Commands->Buffer = AsyncCompute->GraphicsJoinBuffer;
+    }
+
+    AsyncCompute->PendingJoin = false;
+    AsyncCompute->PendingWait = true;
+}
+
+inline void AsyncComputeGraphicsSubmit(async_compute* AsyncCompute, vk_commands Commands, VkSemaphore WaitSemaphore,
+                                       VkPipelineStageFlags WaitStage, VkSemaphore SignalSemaphore)
+{
+    // NOTE: Nothing consumed the compute results, so the join never happened
+    Assert(!AsyncCompute->PendingJoin);
+
+    VkSemaphore WaitSemaphores[2] = { WaitSemaphore, AsyncCompute->Timeline };
+    VkPipelineStageFlags WaitDstMasks[2] = { WaitStage, AsyncCompute->WaitStages };
+    // NOTE: Binary semaphores ignore their value
+    u64 WaitValues[2] = { 0, AsyncCompute->WaitValue };
+    u64 SignalValue = 0;
+
+    VkTimelineSemaphoreSubmitInfo TimelineInfo = {};
+    TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineInfo.waitSemaphoreValueCount = 2;
+    TimelineInfo.pWaitSemaphoreValues = WaitValues;
+    TimelineInfo.signalSemaphoreValueCount = 1;
+    TimelineInfo.pSignalSemaphoreValues = &SignalValue;
+
+    VkSubmitInfo SubmitInfo = {};
+    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.pNext = AsyncCompute->PendingWait ? &TimelineInfo : 0;
+    SubmitInfo.waitSemaphoreCount = AsyncCompute->PendingWait ? 2 : 1;
+    SubmitInfo.pWaitSemaphores = WaitSemaphores;
+    SubmitInfo.pWaitDstStageMask = WaitDstMasks;
+    SubmitInfo.commandBufferCount = 1;
+    SubmitInfo.pCommandBuffers = &Commands.Buffer;
+    SubmitInfo.signalSemaphoreCount = 1;
+    SubmitInfo.pSignalSemaphores = &SignalSemaphore;
+    VkCheckResult(vkQueueSubmit(RenderState->GraphicsQueue, 1, &SubmitInfo, Commands.Fence));
+}
+
+/*
+
+   NOTE: Ownership transfers need a release barrier on the source queue and a matching acquire barrier on the destination queue. When
+   both families match (single queue devices), the release does the whole barrier and the acquire is a no op.
+  
+ */
+
+inline void AsyncComputeImageRelease(VkCommandBuffer CmdBuffer, VkImage Image, VkImageAspectFlags Aspect, VkImageLayout OldLayout,
+                                     VkImageLayout NewLayout, u32 SrcFamilyId, u32 DstFamilyId, VkPipelineStageFlags SrcStage,
+                                     VkAccessFlags SrcAccess, VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    if (SrcFamilyId == DstFamilyId)
+    {
+        AsyncComputeImageBarrier(CmdBuffer, Image, Aspect, OldLayout, NewLayout, SrcFamilyId, DstFamilyId, SrcStage, SrcAccess,
+                                 DstStage, DstAccess);
+    }
+    else
+    {
+        AsyncComputeImageBarrier(CmdBuffer, Image, Aspect, OldLayout, NewLayout, SrcFamilyId, DstFamilyId, SrcStage, SrcAccess,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    }
+}
+
+inline void AsyncComputeImageAcquire(VkCommandBuffer CmdBuffer, VkImage Image, VkImageAspectFlags Aspect, VkImageLayout OldLayout,
+                                     VkImageLayout NewLayout, u32 SrcFamilyId, u32 DstFamilyId, VkPipelineStageFlags SrcStage,
+                                     VkAccessFlags SrcAccess, VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    if (SrcFamilyId != DstFamilyId)
+    {
+        AsyncComputeImageBarrier(CmdBuffer, Image, Aspect, OldLayout, NewLayout, SrcFamilyId, DstFamilyId,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, DstStage, DstAccess);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+
+  NOTE: Async Compute
+
+    Compute shaped work (shadow map blurs/filtering, mip generation, light culling) gets recorded into its own command buffer and
+    submitted to a dedicated compute queue when the device exposes a queue family that has compute but no graphics. The frame is then
+    split into 4 submissions that are chained with a single timeline semaphore:
+
+      Graphics (pre)   -> signals Value + 1
+      Compute          -> waits Value + 1, signals Value + 2
+      Graphics (post)  -> no wait, the graphics work that doesn't read the compute results (depth prepass, occlusion culling)
+      Graphics (join)  -> waits Value + 2 (+ the swap chain image), signals the frame fence
+
+    The post submit is what overlaps with the compute queue. AsyncComputeJoin splits it from the join submit and has to be called
+    before the first graphics work that consumes the compute results, the render graph does that with its AsyncComputeJoin pass.
+
+    Resources touched by both queues are exclusive, so we release/acquire them with queue family ownership barriers. The acquire has
+    to be recorded after the join, since it can't execute before the matching release. On devices with a single queue, Dedicated is
+    false and everything gets recorded inline into the graphics command buffer with regular barriers.
+
+    The dedicated path needs a queue from the compute family and timelineSemaphore, both get enabled in DemoDeviceCreate when the
+    device supports them (DeviceCaps.AsyncCompute/TimelineSemaphore, see device_setup.h).
+
+ */
+
+struct async_compute
+{
+    b32 Dedicated;
+    u32 GraphicsFamilyId;
+    u32 ComputeFamilyId;
+    VkQueue Queue;
+
+    VkCommandPool ComputePool;
+    VkCommandBuffer ComputeBuffer;
+
+    // NOTE: Graphics work recorded after the compute work has been handed off, before and after the join
+    VkCommandPool GraphicsPool;
+    VkCommandBuffer GraphicsPostBuffer;
+    VkCommandBuffer GraphicsJoinBuffer;
+
+    VkSemaphore Timeline;
+    u64 TimelineValue;
+
+    // NOTE: Set when the compute work got submitted and the post buffer still has to be split off
+    b32 PendingJoin;
+    // NOTE: Set when the current frame was split and the final graphics submit has to wait on the compute queue
+    b32 PendingWait;
+    u64 WaitValue;
+    // NOTE: First graphics stages that consume the compute results (fragment for the forward pass, compute for the shadow mask)
+    VkPipelineStageFlags WaitStages;
+};
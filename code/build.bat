@@ -7,34 +7,57 @@ set OutputDir=..\build_win32
 set VulkanIncludeDir="C:\VulkanSDK\1.2.135.0\Include\vulkan"
 set VulkanBinDir="C:\VulkanSDK\1.2.135.0\Bin"
 set AssimpDir=%LibsDir%\framework_vulkan
+REM Software ICD the regression run goes through (lavapipe or SwiftShader), goldens are only stable on the same ICD. Point
+REM SHADOW_SOFTWARE_ICD at its json manifest, e.g. set "SHADOW_SOFTWARE_ICD=C:\Tools\mesa\lvp_icd.x86_64.json"
+set "SoftwareIcd=%SHADOW_SOFTWARE_ICD%"
 
 set CommonCompilerFlags=-Od -MTd -nologo -fp:fast -fp:except- -EHsc -Gm- -GR- -EHa- -Zo -Oi -WX -W4 -wd4127 -wd4201 -wd4100 -wd4189 -wd4505 -Z7 -FC
 set CommonCompilerFlags=-I %VulkanIncludeDir% %CommonCompilerFlags%
 set CommonCompilerFlags=-I %LibsDir% -I %AssimpDir% %CommonCompilerFlags%
+REM build.bat regression builds the regression mode and runs it, see regression.h
+IF "%1"=="regression" set CommonCompilerFlags=-DSHADOW_REGRESSION=1 %CommonCompilerFlags%
+REM build.bat regression record overwrites the goldens and timing baselines instead of comparing against them
+IF "%2"=="record" set CommonCompilerFlags=-DSHADOW_REGRESSION_RECORD=1 %CommonCompilerFlags%
 REM Check the DLLs here
 set CommonLinkerFlags=-incremental:no -opt:ref user32.lib gdi32.lib Winmm.lib opengl32.lib DbgHelp.lib d3d12.lib dxgi.lib d3dcompiler.lib %AssimpDir%\assimp\libs\assimp-vc142-mt.lib
 
+REM The regression run needs the ICD, and goldens unless it records them. None are checked in since they depend on the ICD and the
+REM timings on the machine, build.bat regression record has to run once first
+IF "%1"=="regression" (
+    IF "%SoftwareIcd%"=="" (
+        echo ERROR: SHADOW_SOFTWARE_ICD is not set, point it at the json manifest of lavapipe or SwiftShader
+        exit /b 1
+    )
+    IF NOT EXIST "%SoftwareIcd%" (
+        echo ERROR: SHADOW_SOFTWARE_ICD points at "%SoftwareIcd%" which doesn't exist
+        exit /b 1
+    )
+    IF NOT "%2"=="record" IF NOT EXIST %DataDir%\regression\*.golden (
+        echo ERROR: No goldens in %DataDir%\regression, run build.bat regression record once with this ICD first
+        exit /b 1
+    )
+)
+
 IF NOT EXIST %OutputDir% mkdir %OutputDir%
+REM Shaders only get built here, none of the spv files are checked in
+IF NOT EXIST %DataDir% mkdir %DataDir%
 
 pushd %OutputDir%
 
 del *.pdb > NUL 2> NUL
 
-REM USING GLSL IN VK USING GLSLANGVALIDATOR
-call glslangValidator -DSHADOW_VERTEX=1 -S vert -e main -g -V -o %DataDir%\shader_shadow_vert.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DSHADOW_VARIANCE_FRAGMENT=1 -S frag -e main -g -V -o %DataDir%\shader_shadow_variance_frag.spv %CodeDir%\shader_forward.cpp
-
-call glslangValidator -DFORWARD_VERTEX=1 -DSTANDARD=1 -S vert -e main -g -V -o %DataDir%\shader_forward_standard_vert.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DFORWARD_FRAGMENT=1 -DSTANDARD=1 -S frag -e main -g -V -o %DataDir%\shader_forward_standard_frag.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DFORWARD_VERTEX=1 -DPCF=1 -S vert -e main -g -V -o %DataDir%\shader_forward_pcf_vert.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DFORWARD_FRAGMENT=1 -DPCF=1 -S frag -e main -g -V -o %DataDir%\shader_forward_pcf_frag.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DFORWARD_VERTEX=1 -DVARIANCE=1 -S vert -e main -g -V -o %DataDir%\shader_forward_variance_vert.spv %CodeDir%\shader_forward.cpp
-call glslangValidator -DFORWARD_FRAGMENT=1 -DVARIANCE=1 -S frag -e main -g -V -o %DataDir%\shader_forward_variance_frag.spv %CodeDir%\shader_forward.cpp
+REM build.bat converter only builds the offline OBJ to scene file converter, see scene_file.h
+IF "%1"=="converter" (
+    call cl %CommonCompilerFlags% %CodeDir%\scene_converter.cpp -Fescene_converter.exe /link %CommonLinkerFlags%
+    popd
+    exit /b
+)
 
-call glslangValidator -DGAUSSIAN_BLUR_X=1 -S frag -e main -g -V -o %DataDir%\shader_gaussian_x_frag.spv %CodeDir%\shader_gaussian_blur.cpp
-call glslangValidator -DGAUSSIAN_BLUR_Y=1 -S frag -e main -g -V -o %DataDir%\shader_gaussian_y_frag.spv %CodeDir%\shader_gaussian_blur.cpp
-
-call glslangValidator -DFRAGMENT_SHADER=1 -S frag -e main -g -V -o %DataDir%\shader_copy_to_swap_frag.spv %CodeDir%\shader_copy_to_swap.cpp
+REM USING GLSL IN VK USING GLSLANGVALIDATOR
+REM Every permutation is a line of shader_permutations.txt (source|defines|stage|output), shader hot reload compiles from the same list
+for /f "usebackq eol=# tokens=1-4 delims=|" %%A in ("%CodeDir%\shader_permutations.txt") do (
+    call glslangValidator %%B -S %%C -e main -g -V -o %DataDir%\%%D %CodeDir%\%%A
+)
 
 REM USING HLSL IN VK USING DXC
 REM set DxcDir=C:\Tools\DirectXShaderCompiler\build\Debug\bin
@@ -49,4 +72,13 @@ cl %CommonCompilerFlags% %CodeDir%\shadow_demo.cpp -Fmshadow_demo.map -LD /link
 del lock.tmp
 call cl %CommonCompilerFlags% -DDLL_NAME=shadow_demo -Feshadow_demo.exe %LibsDir%\framework_vulkan\win32_main.cpp -Fmshadow_demo.map /link %CommonLinkerFlags%
 
+REM REGRESSION RUN, exit code is the number of failed cases
+IF "%1"=="regression" (
+    set "VK_ICD_FILENAMES=%SoftwareIcd%"
+    pushd %DataDir%
+    call %OutputDir%\shadow_demo.exe
+    IF ERRORLEVEL 1 (echo REGRESSION FAILED, see %DataDir%\regression_report.txt) ELSE (echo REGRESSION PASSED)
+    popd
+)
+
 popd
@@ -0,0 +1,762 @@
+
+//
+// NOTE: CPU Reference Rasterizer
+//
+
+inline b32 CpuRasterAvx2Supported()
+{
+    int Info[4];
+    __cpuid(Info, 0);
+    if (Info[0] < 7)
+    {
+        return false;
+    }
+
+    // NOTE: The OS has to save the ymm registers on context switches too
+    __cpuid(Info, 1);
+    b32 OsXSave = (Info[2] & (1 << 27)) != 0;
+    b32 Avx = (Info[2] & (1 << 28)) != 0;
+    if (!OsXSave || !Avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(Info, 7, 0);
+    return (Info[1] & (1 << 5)) != 0;
+}
+
+inline f32 CpuRasterMsGet(LARGE_INTEGER Start, LARGE_INTEGER End)
+{
+    LARGE_INTEGER Frequency;
+    QueryPerformanceFrequency(&Frequency);
+    f32 Result = f32(f64(End.QuadPart - Start.QuadPart) * 1000.0 / f64(Frequency.QuadPart));
+    return Result;
+}
+
+inline void CpuRasterMemoryReserve(cpu_raster* Raster, u64 Size)
+{
+    // NOTE: Only called while nothing lives in the arena. Sizes double so that a scene that keeps growing rarely reallocates
+    if (Size <= Raster->MemorySize)
+    {
+        return;
+    }
+
+    u64 NewSize = Max(Raster->MemorySize, u64(CPU_RASTER_MIN_MEMORY_SIZE));
+    while (NewSize < Size)
+    {
+        NewSize *= 2;
+    }
+
+    if (Raster->Memory)
+    {
+        VirtualFree(Raster->Memory, 0, MEM_RELEASE);
+    }
+    Raster->Memory = VirtualAlloc(0, NewSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    Assert(Raster->Memory);
+    Raster->MemorySize = NewSize;
+    Raster->Arena = LinearArenaCreate(Raster->Memory, NewSize);
+}
+
+inline u64 CpuRasterRunSizeGet(cpu_raster* Raster, u32 Width, u32 Height, u32 NumTiles, u32 NumSlots, u64 NumTileEntries)
+{
+    u64 Result = sizeof(f32)*u64(Width)*u64(Height);
+    Result += sizeof(cpu_raster_triangle)*u64(NumSlots);
+    Result += sizeof(v4)*u64(Raster->MaxNumMeshVertices)*u64(Raster->NumThreads);
+    Result += sizeof(u32)*(2*u64(NumTiles) + 1);
+    Result += sizeof(u32)*NumTileEntries;
+    // NOTE: Alignment padding, one per array we push
+    Result += u64(Raster->NumThreads + 8)*CPU_RASTER_MEMORY_SLACK;
+
+    return Result;
+}
+
+inline void CpuRasterCreate(cpu_raster* Result)
+{
+    *Result = {};
+
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    Result->NumThreads = Min(u32(SystemInfo.dwNumberOfProcessors), u32(CPU_RASTER_MAX_THREADS));
+    Result->Avx2 = CpuRasterAvx2Supported();
+
+    // NOTE: Starts small, CpuRasterRender grows it to fit the scene
+    CpuRasterMemoryReserve(Result, CPU_RASTER_MIN_MEMORY_SIZE);
+}
+
+//
+// NOTE: Setup
+//
+
+inline f32 CpuRasterClipDistance(v4 Vertex, u32 PlaneId)
+{
+    f32 Result = 0.0f;
+    switch (PlaneId)
+    {
+        case 0: Result = Vertex.z; break;
+        case 1: Result = Vertex.w - Vertex.z; break;
+        case 2: Result = CPU_RASTER_GUARD_BAND*Vertex.w - Vertex.x; break;
+        case 3: Result = CPU_RASTER_GUARD_BAND*Vertex.w + Vertex.x; break;
+        case 4: Result = CPU_RASTER_GUARD_BAND*Vertex.w - Vertex.y; break;
+        case 5: Result = CPU_RASTER_GUARD_BAND*Vertex.w + Vertex.y; break;
+    }
+
+    return Result;
+}
+
+inline b32 CpuRasterTriangleSetup(cpu_raster* Raster, v4 V0, v4 V1, v4 V2, cpu_raster_triangle* Result)
+{
+    v4 Vertices[3] = { V0, V1, V2 };
+    i64 FixedX[3];
+    i64 FixedY[3];
+    f32 PixelX[3];
+    f32 PixelY[3];
+    f32 Depth[3];
+    for (u32 VertexId = 0; VertexId < 3; ++VertexId)
+    {
+        // NOTE: Viewport transform, the shadow pass uses a viewport covering the whole image with depth range [0, 1]
+        f64 InvW = 1.0 / f64(Vertices[VertexId].w);
+        f64 WindowX = (0.5*f64(Vertices[VertexId].x)*InvW + 0.5) * f64(Raster->Width);
+        f64 WindowY = (0.5*f64(Vertices[VertexId].y)*InvW + 0.5) * f64(Raster->Height);
+        FixedX[VertexId] = i64(floor(WindowX*f64(CPU_RASTER_SUBPIXEL) + 0.5));
+        FixedY[VertexId] = i64(floor(WindowY*f64(CPU_RASTER_SUBPIXEL) + 0.5));
+        PixelX[VertexId] = f32(FixedX[VertexId]) / f32(CPU_RASTER_SUBPIXEL);
+        PixelY[VertexId] = f32(FixedY[VertexId]) / f32(CPU_RASTER_SUBPIXEL);
+        Depth[VertexId] = f32(f64(Vertices[VertexId].z)*InvW);
+    }
+
+    // NOTE: Nothing gets culled, we just flip the winding so that the inside is positive
+    i64 Area = (FixedX[1] - FixedX[0])*(FixedY[2] - FixedY[0]) - (FixedY[1] - FixedY[0])*(FixedX[2] - FixedX[0]);
+    if (Area == 0)
+    {
+        return false;
+    }
+    u32 Order[3] = { 0, 1, 2 };
+    if (Area < 0)
+    {
+        Order[1] = 2;
+        Order[2] = 1;
+    }
+
+    i64 MinFixedX = FixedX[0];
+    i64 MinFixedY = FixedY[0];
+    i64 MaxFixedX = FixedX[0];
+    i64 MaxFixedY = FixedY[0];
+    for (u32 VertexId = 1; VertexId < 3; ++VertexId)
+    {
+        MinFixedX = FixedX[VertexId] < MinFixedX ? FixedX[VertexId] : MinFixedX;
+        MinFixedY = FixedY[VertexId] < MinFixedY ? FixedY[VertexId] : MinFixedY;
+        MaxFixedX = FixedX[VertexId] > MaxFixedX ? FixedX[VertexId] : MaxFixedX;
+        MaxFixedY = FixedY[VertexId] > MaxFixedY ? FixedY[VertexId] : MaxFixedY;
+    }
+
+    // NOTE: Pixels whose center lies in the bounds, clamped to the image
+    i64 HalfPixel = CPU_RASTER_SUBPIXEL / 2;
+    i64 MinX = (MinFixedX - HalfPixel + CPU_RASTER_SUBPIXEL - 1) >> CPU_RASTER_SUBPIXEL_BITS;
+    i64 MinY = (MinFixedY - HalfPixel + CPU_RASTER_SUBPIXEL - 1) >> CPU_RASTER_SUBPIXEL_BITS;
+    i64 MaxX = (MaxFixedX - HalfPixel) >> CPU_RASTER_SUBPIXEL_BITS;
+    i64 MaxY = (MaxFixedY - HalfPixel) >> CPU_RASTER_SUBPIXEL_BITS;
+    Result->MinX = MinX < 0 ? 0 : i32(MinX);
+    Result->MinY = MinY < 0 ? 0 : i32(MinY);
+    Result->MaxX = MaxX >= i64(Raster->Width) ? i32(Raster->Width) - 1 : i32(MaxX);
+    Result->MaxY = MaxY >= i64(Raster->Height) ? i32(Raster->Height) - 1 : i32(MaxY);
+    if (Result->MinX > Result->MaxX || Result->MinY > Result->MaxY)
+    {
+        return false;
+    }
+
+    for (u32 EdgeId = 0; EdgeId < 3; ++EdgeId)
+    {
+        u32 From = Order[EdgeId];
+        u32 To = Order[(EdgeId + 1) % 3];
+        i64 A = FixedY[From] - FixedY[To];
+        i64 B = FixedX[To] - FixedX[From];
+        i64 C = -(A*FixedX[From] + B*FixedY[From]);
+
+        // NOTE: Top-left rule, with y pointing down and a positive area top edges have A == 0 && B > 0 and left edges A > 0.
+        // Everything else must not own samples that land exactly on it
+        b32 TopLeft = A > 0 || (A == 0 && B > 0);
+        if (!TopLeft)
+        {
+            C -= 1;
+        }
+
+        Result->EdgeA[EdgeId] = A;
+        Result->EdgeB[EdgeId] = B;
+        Result->EdgeC[EdgeId] = C;
+    }
+
+    // NOTE: Depth plane through the snapped positions
+    {
+        f64 Dx1 = f64(PixelX[1]) - f64(PixelX[0]);
+        f64 Dy1 = f64(PixelY[1]) - f64(PixelY[0]);
+        f64 Dz1 = f64(Depth[1]) - f64(Depth[0]);
+        f64 Dx2 = f64(PixelX[2]) - f64(PixelX[0]);
+        f64 Dy2 = f64(PixelY[2]) - f64(PixelY[0]);
+        f64 Dz2 = f64(Depth[2]) - f64(Depth[0]);
+        f64 Det = Dx1*Dy2 - Dx2*Dy1;
+
+        Result->Z0 = Depth[0];
+        Result->X0 = PixelX[0];
+        Result->Y0 = PixelY[0];
+        Result->DzDx = f32((Dz1*Dy2 - Dz2*Dy1) / Det);
+        Result->DzDy = f32((Dx1*Dz2 - Dx2*Dz1) / Det);
+    }
+
+    return true;
+}
+
+inline void CpuRasterTriangleEmit(cpu_raster* Raster, u32* SlotId, u32* SlotEnd, v4 V0, v4 V1, v4 V2)
+{
+    if (*SlotId == *SlotEnd)
+    {
+        u32 First = u32(InterlockedExchangeAdd(&Raster->NextTriangleSlot, CPU_RASTER_TRIANGLE_BATCH));
+        *SlotId = First;
+        *SlotEnd = First + CPU_RASTER_TRIANGLE_BATCH;
+    }
+
+    if (*SlotId >= Raster->MaxNumTriangleSlots)
+    {
+        // NOTE: Clipping split more triangles than we reserved slots for. Keep counting the slots we would have used so that the
+        // run can retry with enough of them
+        *SlotId += 1;
+    }
+    else if (CpuRasterTriangleSetup(Raster, V0, V1, V2, Raster->Triangles + *SlotId))
+    {
+        *SlotId += 1;
+    }
+}
+
+inline void CpuRasterTriangleClip(cpu_raster* Raster, u32* SlotId, u32* SlotEnd, v4 V0, v4 V1, v4 V2)
+{
+    // NOTE: Sutherland-Hodgman, every plane adds at most one vertex
+    v4 Polygons[2][9];
+    u32 NumVertices = 3;
+    Polygons[0][0] = V0;
+    Polygons[0][1] = V1;
+    Polygons[0][2] = V2;
+
+    u32 Input = 0;
+    for (u32 PlaneId = 0; PlaneId < 6 && NumVertices > 0; ++PlaneId)
+    {
+        v4* In = Polygons[Input];
+        v4* Out = Polygons[Input ^ 1];
+        u32 NumOut = 0;
+        for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+        {
+            v4 Curr = In[VertexId];
+            v4 Next = In[(VertexId + 1) % NumVertices];
+            f32 CurrDist = CpuRasterClipDistance(Curr, PlaneId);
+            f32 NextDist = CpuRasterClipDistance(Next, PlaneId);
+            if (CurrDist >= 0.0f)
+            {
+                Out[NumOut++] = Curr;
+            }
+            if ((CurrDist >= 0.0f) != (NextDist >= 0.0f))
+            {
+                f32 T = CurrDist / (CurrDist - NextDist);
+                Out[NumOut++] = Curr + T*(Next - Curr);
+            }
+        }
+
+        NumVertices = NumOut;
+        Input ^= 1;
+    }
+
+    for (u32 VertexId = 2; VertexId < NumVertices; ++VertexId)
+    {
+        CpuRasterTriangleEmit(Raster, SlotId, SlotEnd, Polygons[Input][0], Polygons[Input][VertexId - 1], Polygons[Input][VertexId]);
+    }
+}
+
+DWORD WINAPI CpuRasterSetupThread(LPVOID Param)
+{
+    cpu_raster_thread_data* ThreadData = (cpu_raster_thread_data*)Param;
+    cpu_raster* Raster = ThreadData->Raster;
+    render_scene* Scene = Raster->Scene;
+    v4* Transformed = Raster->ThreadVertices[ThreadData->ThreadId];
+
+    u32 SlotId = 0;
+    u32 SlotEnd = 0;
+    while (true)
+    {
+        u32 VisibleId = u32(InterlockedIncrement(&Raster->NextJob) - 1);
+        if (VisibleId >= Scene->NumShadowVisible)
+        {
+            break;
+        }
+
+        instance_entry* Instance = Scene->OpaqueInstances + Scene->ShadowVisible[VisibleId];
+        render_mesh* Mesh = Scene->RenderMeshes + Instance->MeshId;
+        mesh_lod* Lod = Mesh->Lods + Instance->ShadowLod;
+
+        for (u32 VertexId = 0; VertexId < Mesh->NumVertices; ++VertexId)
+        {
+            v3 Pos = *(v3*)(Mesh->CpuPositions + u64(VertexId)*Mesh->CpuPositionStride);
+            Transformed[VertexId] = Instance->ShadowWVP * V4(Pos, 1.0f);
+        }
+
+        u16* Indices16 = (u16*)Mesh->CpuIndices + Lod->FirstIndex;
+        u32* Indices32 = (u32*)Mesh->CpuIndices + Lod->FirstIndex;
+        for (u32 IndexId = 0; IndexId < Lod->NumIndices; IndexId += 3)
+        {
+            v4 V0 = Transformed[Mesh->CpuIndices16 ? Indices16[IndexId + 0] : Indices32[IndexId + 0]];
+            v4 V1 = Transformed[Mesh->CpuIndices16 ? Indices16[IndexId + 1] : Indices32[IndexId + 1]];
+            v4 V2 = Transformed[Mesh->CpuIndices16 ? Indices16[IndexId + 2] : Indices32[IndexId + 2]];
+
+            b32 Outside = false;
+            b32 NeedsClip = false;
+            for (u32 PlaneId = 0; PlaneId < 6 && !Outside; ++PlaneId)
+            {
+                f32 D0 = CpuRasterClipDistance(V0, PlaneId);
+                f32 D1 = CpuRasterClipDistance(V1, PlaneId);
+                f32 D2 = CpuRasterClipDistance(V2, PlaneId);
+                Outside = D0 < 0.0f && D1 < 0.0f && D2 < 0.0f;
+                NeedsClip = NeedsClip || D0 < 0.0f || D1 < 0.0f || D2 < 0.0f;
+            }
+
+            if (Outside)
+            {
+                continue;
+            }
+            else if (NeedsClip)
+            {
+                CpuRasterTriangleClip(Raster, &SlotId, &SlotEnd, V0, V1, V2);
+            }
+            else
+            {
+                CpuRasterTriangleEmit(Raster, &SlotId, &SlotEnd, V0, V1, V2);
+            }
+        }
+    }
+
+    // NOTE: Mark what is left of our batch as empty
+    for (; SlotId < Min(SlotEnd, Raster->MaxNumTriangleSlots); ++SlotId)
+    {
+        Raster->Triangles[SlotId].MinX = 1;
+        Raster->Triangles[SlotId].MaxX = 0;
+    }
+
+    return 0;
+}
+
+//
+// NOTE: Raster
+//
+
+inline void CpuRasterTriangleRasterScalar(cpu_raster* Raster, cpu_raster_triangle* Triangle, i32 MinX, i32 MinY, i32 MaxX, i32 MaxY)
+{
+    for (i32 Y = MinY; Y <= MaxY; ++Y)
+    {
+        i64 SampleY = i64(Y)*CPU_RASTER_SUBPIXEL + CPU_RASTER_SUBPIXEL / 2;
+        f32* Row = Raster->Depth + u64(Y)*Raster->Width;
+        for (i32 SpanX = MinX; SpanX <= MaxX; SpanX += 8)
+        {
+            // NOTE: Same order of operations as the AVX2 path so that both produce identical depth
+            f32 SpanZ = Triangle->Z0 + Triangle->DzDx*((f32(SpanX) + 0.5f) - Triangle->X0) + Triangle->DzDy*((f32(Y) + 0.5f) - Triangle->Y0);
+            i32 SpanEnd = Min(SpanX + 7, MaxX);
+            for (i32 X = SpanX; X <= SpanEnd; ++X)
+            {
+                i64 SampleX = i64(X)*CPU_RASTER_SUBPIXEL + CPU_RASTER_SUBPIXEL / 2;
+                b32 Covered = true;
+                for (u32 EdgeId = 0; EdgeId < 3; ++EdgeId)
+                {
+                    i64 Edge = Triangle->EdgeA[EdgeId]*SampleX + Triangle->EdgeB[EdgeId]*SampleY + Triangle->EdgeC[EdgeId];
+                    Covered = Covered && Edge >= 0;
+                }
+
+                f32 Z = SpanZ + Triangle->DzDx*f32(X - SpanX);
+                Z = Min(Max(Z, 0.0f), 1.0f);
+                if (Covered && Z > Row[X])
+                {
+                    Row[X] = Z;
+                }
+            }
+        }
+    }
+}
+
+inline void CpuRasterTriangleRasterAvx2(cpu_raster* Raster, cpu_raster_triangle* Triangle, i32 MinX, i32 MinY, i32 MaxX, i32 MaxY)
+{
+    __m256i LaneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256 LaneOffsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i LaneIds = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i MinusOne = _mm256_set1_epi64x(-1);
+    __m256 DzDx = _mm256_set1_ps(Triangle->DzDx);
+    __m256 Zero = _mm256_setzero_ps();
+    __m256 One = _mm256_set1_ps(1.0f);
+
+    // NOTE: Per lane offsets of the edge functions and the step to the next 8 pixels
+    __m256i LaneStepLo[3];
+    __m256i LaneStepHi[3];
+    i64 SpanStep[3];
+    for (u32 EdgeId = 0; EdgeId < 3; ++EdgeId)
+    {
+        i64 StepX = Triangle->EdgeA[EdgeId]*CPU_RASTER_SUBPIXEL;
+        LaneStepLo[EdgeId] = _mm256_setr_epi64x(0, StepX, 2*StepX, 3*StepX);
+        LaneStepHi[EdgeId] = _mm256_setr_epi64x(4*StepX, 5*StepX, 6*StepX, 7*StepX);
+        SpanStep[EdgeId] = 8*StepX;
+    }
+
+    for (i32 Y = MinY; Y <= MaxY; ++Y)
+    {
+        i64 SampleY = i64(Y)*CPU_RASTER_SUBPIXEL + CPU_RASTER_SUBPIXEL / 2;
+        i64 SampleX = i64(MinX)*CPU_RASTER_SUBPIXEL + CPU_RASTER_SUBPIXEL / 2;
+        i64 RowEdge[3];
+        for (u32 EdgeId = 0; EdgeId < 3; ++EdgeId)
+        {
+            RowEdge[EdgeId] = Triangle->EdgeA[EdgeId]*SampleX + Triangle->EdgeB[EdgeId]*SampleY + Triangle->EdgeC[EdgeId];
+        }
+
+        f32* Row = Raster->Depth + u64(Y)*Raster->Width;
+        for (i32 SpanX = MinX; SpanX <= MaxX; SpanX += 8)
+        {
+            __m256i CoveredLo = MinusOne;
+            __m256i CoveredHi = MinusOne;
+            for (u32 EdgeId = 0; EdgeId < 3; ++EdgeId)
+            {
+                __m256i Base = _mm256_set1_epi64x(RowEdge[EdgeId]);
+                __m256i EdgeLo = _mm256_add_epi64(Base, LaneStepLo[EdgeId]);
+                __m256i EdgeHi = _mm256_add_epi64(Base, LaneStepHi[EdgeId]);
+                CoveredLo = _mm256_and_si256(CoveredLo, _mm256_cmpgt_epi64(EdgeLo, MinusOne));
+                CoveredHi = _mm256_and_si256(CoveredHi, _mm256_cmpgt_epi64(EdgeHi, MinusOne));
+                RowEdge[EdgeId] += SpanStep[EdgeId];
+            }
+
+            u32 CoveredBits = (u32(_mm256_movemask_pd(_mm256_castsi256_pd(CoveredLo))) |
+                               (u32(_mm256_movemask_pd(_mm256_castsi256_pd(CoveredHi))) << 4));
+            if (CoveredBits == 0)
+            {
+                continue;
+            }
+
+            // NOTE: Don't touch pixels past the span, they might belong to a tile another thread is working on
+            __m256i InSpan = _mm256_cmpgt_epi32(_mm256_set1_epi32(MaxX - SpanX + 1), LaneIds);
+            __m256i Covered = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(i32(CoveredBits)), LaneBits), LaneBits);
+            __m256i Mask = _mm256_and_si256(Covered, InSpan);
+
+            f32 SpanZ = Triangle->Z0 + Triangle->DzDx*((f32(SpanX) + 0.5f) - Triangle->X0) + Triangle->DzDy*((f32(Y) + 0.5f) - Triangle->Y0);
+            __m256 Z = _mm256_add_ps(_mm256_set1_ps(SpanZ), _mm256_mul_ps(DzDx, LaneOffsets));
+            Z = _mm256_min_ps(_mm256_max_ps(Z, Zero), One);
+
+            __m256 Stored = _mm256_maskload_ps(Row + SpanX, InSpan);
+            __m256i Greater = _mm256_castps_si256(_mm256_cmp_ps(Z, Stored, _CMP_GT_OQ));
+            _mm256_maskstore_ps(Row + SpanX, _mm256_and_si256(Mask, Greater), Z);
+        }
+    }
+}
+
+DWORD WINAPI CpuRasterTileThread(LPVOID Param)
+{
+    cpu_raster_thread_data* ThreadData = (cpu_raster_thread_data*)Param;
+    cpu_raster* Raster = ThreadData->Raster;
+    u32 NumTiles = Raster->NumTilesX*Raster->NumTilesY;
+
+    while (true)
+    {
+        u32 TileId = u32(InterlockedIncrement(&Raster->NextJob) - 1);
+        if (TileId >= NumTiles)
+        {
+            break;
+        }
+
+        i32 TileMinX = i32((TileId % Raster->NumTilesX)*CPU_RASTER_TILE_SIZE);
+        i32 TileMinY = i32((TileId / Raster->NumTilesX)*CPU_RASTER_TILE_SIZE);
+        i32 TileMaxX = Min(TileMinX + CPU_RASTER_TILE_SIZE, i32(Raster->Width)) - 1;
+        i32 TileMaxY = Min(TileMinY + CPU_RASTER_TILE_SIZE, i32(Raster->Height)) - 1;
+
+        for (u32 EntryId = Raster->TileOffsets[TileId]; EntryId < Raster->TileOffsets[TileId + 1]; ++EntryId)
+        {
+            cpu_raster_triangle* Triangle = Raster->Triangles + Raster->TileTriangles[EntryId];
+            i32 MinX = Max(Triangle->MinX, TileMinX);
+            i32 MinY = Max(Triangle->MinY, TileMinY);
+            i32 MaxX = Min(Triangle->MaxX, TileMaxX);
+            i32 MaxY = Min(Triangle->MaxY, TileMaxY);
+
+            if (Raster->Avx2)
+            {
+                CpuRasterTriangleRasterAvx2(Raster, Triangle, MinX, MinY, MaxX, MaxY);
+            }
+            else
+            {
+                CpuRasterTriangleRasterScalar(Raster, Triangle, MinX, MinY, MaxX, MaxY);
+            }
+        }
+    }
+
+    return 0;
+}
+
+inline void CpuRasterThreadsRun(cpu_raster* Raster, LPTHREAD_START_ROUTINE Proc)
+{
+    Raster->NextJob = 0;
+
+    HANDLE Threads[CPU_RASTER_MAX_THREADS];
+    cpu_raster_thread_data ThreadData[CPU_RASTER_MAX_THREADS];
+    for (u32 ThreadId = 0; ThreadId < Raster->NumThreads; ++ThreadId)
+    {
+        ThreadData[ThreadId].Raster = Raster;
+        ThreadData[ThreadId].ThreadId = ThreadId;
+        Threads[ThreadId] = CreateThread(0, 0, Proc, ThreadData + ThreadId, 0, 0);
+        Assert(Threads[ThreadId]);
+    }
+
+    WaitForMultipleObjects(Raster->NumThreads, Threads, TRUE, INFINITE);
+    for (u32 ThreadId = 0; ThreadId < Raster->NumThreads; ++ThreadId)
+    {
+        CloseHandle(Threads[ThreadId]);
+    }
+}
+
+inline void CpuRasterRender(cpu_raster* Raster, render_scene* Scene, u32 Width, u32 Height)
+{
+    if (Raster->RunMemActive)
+    {
+        EndTempMem(Raster->RunMem);
+        Raster->RunMemActive = false;
+    }
+
+    Raster->Scene = Scene;
+    Raster->Width = Width;
+    Raster->Height = Height;
+    Raster->NumTilesX = (Width + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    Raster->NumTilesY = (Height + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    u32 NumTiles = Raster->NumTilesX*Raster->NumTilesY;
+
+    // NOTE: Size the scratch memory
+    u32 NumTriangles = 0;
+    Raster->MaxNumMeshVertices = 0;
+    for (u32 VisibleId = 0; VisibleId < Scene->NumShadowVisible; ++VisibleId)
+    {
+        instance_entry* Instance = Scene->OpaqueInstances + Scene->ShadowVisible[VisibleId];
+        render_mesh* Mesh = Scene->RenderMeshes + Instance->MeshId;
+        NumTriangles += Mesh->Lods[Instance->ShadowLod].NumIndices / 3;
+        Raster->MaxNumMeshVertices = Max(Raster->MaxNumMeshVertices, Mesh->NumVertices);
+    }
+
+    /*
+       NOTE: Everything of a run lives in the arena, it gets sized from the triangle count up front. How many slots clipping needs
+       and how many tiles the triangles touch only shows up while running. If either doesn't fit, the run counted what it needed,
+       so we grow the arena and run again. The arena keeps its size, so the next run of a similar scene fits right away
+     */
+    Raster->MaxNumTriangleSlots = 2*NumTriangles + (Raster->NumThreads + 1)*CPU_RASTER_TRIANGLE_BATCH;
+    u64 RunSize = CpuRasterRunSizeGet(Raster, Width, Height, NumTiles, Raster->MaxNumTriangleSlots,
+                                      CPU_RASTER_TILE_ENTRIES_PER_SLOT*u64(Raster->MaxNumTriangleSlots));
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER SetupTime;
+    u32 NumSlots = 0;
+    u32 NumSetupTriangles = 0;
+    while (true)
+    {
+        CpuRasterMemoryReserve(Raster, RunSize);
+        Raster->RunMem = BeginTempMem(&Raster->Arena);
+        QueryPerformanceCounter(&StartTime);
+
+        Raster->Depth = PushArray(&Raster->Arena, f32, Width*Height);
+        ZeroMem(Raster->Depth, sizeof(f32)*Width*Height);
+
+        Raster->NextTriangleSlot = 0;
+        Raster->Triangles = PushArray(&Raster->Arena, cpu_raster_triangle, Raster->MaxNumTriangleSlots);
+        for (u32 ThreadId = 0; ThreadId < Raster->NumThreads; ++ThreadId)
+        {
+            Raster->ThreadVertices[ThreadId] = PushArray(&Raster->Arena, v4, Raster->MaxNumMeshVertices);
+        }
+
+        CpuRasterThreadsRun(Raster, CpuRasterSetupThread);
+        if (u32(Raster->NextTriangleSlot) > Raster->MaxNumTriangleSlots)
+        {
+            // NOTE: Clipping overflowed the slots, the run counted every slot it needed. Threads pick up instances in a different
+            // order next time, so leave room for each of them to end on a partial batch
+            Raster->MaxNumTriangleSlots = u32(Raster->NextTriangleSlot) + Raster->NumThreads*CPU_RASTER_TRIANGLE_BATCH;
+            RunSize = CpuRasterRunSizeGet(Raster, Width, Height, NumTiles, Raster->MaxNumTriangleSlots,
+                                          CPU_RASTER_TILE_ENTRIES_PER_SLOT*u64(Raster->MaxNumTriangleSlots));
+            EndTempMem(Raster->RunMem);
+            continue;
+        }
+        NumSlots = u32(Raster->NextTriangleSlot);
+
+        QueryPerformanceCounter(&SetupTime);
+
+        // NOTE: Bin by counting sort, tile offsets get one extra entry so that every tile is [Offsets[i], Offsets[i + 1])
+        Raster->TileOffsets = PushArray(&Raster->Arena, u32, NumTiles + 1);
+        ZeroMem(Raster->TileOffsets, sizeof(u32)*(NumTiles + 1));
+
+        u64 NumEntries = 0;
+        NumSetupTriangles = 0;
+        for (u32 SlotId = 0; SlotId < NumSlots; ++SlotId)
+        {
+            cpu_raster_triangle* Triangle = Raster->Triangles + SlotId;
+            if (Triangle->MinX > Triangle->MaxX)
+            {
+                continue;
+            }
+
+            NumSetupTriangles += 1;
+            for (i32 TileY = Triangle->MinY / CPU_RASTER_TILE_SIZE; TileY <= Triangle->MaxY / CPU_RASTER_TILE_SIZE; ++TileY)
+            {
+                for (i32 TileX = Triangle->MinX / CPU_RASTER_TILE_SIZE; TileX <= Triangle->MaxX / CPU_RASTER_TILE_SIZE; ++TileX)
+                {
+                    Raster->TileOffsets[TileY*Raster->NumTilesX + TileX + 1] += 1;
+                    NumEntries += 1;
+                }
+            }
+        }
+
+        // NOTE: Big triangles touch more tiles than we estimated, the entries and the cursors have to fit what is left
+        Assert(NumEntries <= 0xFFFFFFFF);
+        if (Raster->Arena.Used + sizeof(u32)*(NumEntries + NumTiles) + 2*CPU_RASTER_MEMORY_SLACK > Raster->MemorySize)
+        {
+            RunSize = CpuRasterRunSizeGet(Raster, Width, Height, NumTiles, Raster->MaxNumTriangleSlots, NumEntries);
+            EndTempMem(Raster->RunMem);
+            continue;
+        }
+
+        for (u32 TileId = 0; TileId < NumTiles; ++TileId)
+        {
+            Raster->TileOffsets[TileId + 1] += Raster->TileOffsets[TileId];
+        }
+
+        Raster->TileTriangles = PushArray(&Raster->Arena, u32, NumEntries);
+        temp_mem TempMem = BeginTempMem(&Raster->Arena);
+        u32* TileCursors = PushArray(&Raster->Arena, u32, NumTiles);
+        Copy(Raster->TileOffsets, TileCursors, sizeof(u32)*NumTiles);
+        for (u32 SlotId = 0; SlotId < NumSlots; ++SlotId)
+        {
+            cpu_raster_triangle* Triangle = Raster->Triangles + SlotId;
+            if (Triangle->MinX > Triangle->MaxX)
+            {
+                continue;
+            }
+
+            for (i32 TileY = Triangle->MinY / CPU_RASTER_TILE_SIZE; TileY <= Triangle->MaxY / CPU_RASTER_TILE_SIZE; ++TileY)
+            {
+                for (i32 TileX = Triangle->MinX / CPU_RASTER_TILE_SIZE; TileX <= Triangle->MaxX / CPU_RASTER_TILE_SIZE; ++TileX)
+                {
+                    Raster->TileTriangles[TileCursors[TileY*Raster->NumTilesX + TileX]++] = SlotId;
+                }
+            }
+        }
+
+        EndTempMem(TempMem);
+        break;
+    }
+    Raster->RunMemActive = true;
+
+    LARGE_INTEGER BinTime;
+    QueryPerformanceCounter(&BinTime);
+
+    CpuRasterThreadsRun(Raster, CpuRasterTileThread);
+
+    LARGE_INTEGER EndTime;
+    QueryPerformanceCounter(&EndTime);
+
+    cpu_raster_stats* Stats = &Raster->Stats;
+    Stats->NumThreads = Raster->NumThreads;
+    Stats->Avx2 = Raster->Avx2;
+    Stats->NumTriangles = NumTriangles;
+    Stats->NumSetupTriangles = NumSetupTriangles;
+    Stats->SetupMs = CpuRasterMsGet(StartTime, SetupTime);
+    Stats->BinMs = CpuRasterMsGet(SetupTime, BinTime);
+    Stats->RasterMs = CpuRasterMsGet(BinTime, EndTime);
+    Stats->TotalMs = CpuRasterMsGet(StartTime, EndTime);
+    Stats->TrianglesPerSecond = Stats->TotalMs > 0.0f ? f32(NumTriangles) / (0.001f*Stats->TotalMs) : 0.0f;
+}
+
+//
+// NOTE: GPU Diff
+//
+
+inline void ReadbackBufferReCreate(u64 Size, VkBuffer* Buffer, VkDeviceMemory* Memory, void** MappedPtr)
+{
+    if (*Buffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(RenderState->Device, *Buffer, 0);
+        vkFreeMemory(RenderState->Device, *Memory, 0);
+    }
+
+    VkBufferCreateInfo BufferCreateInfo = {};
+    BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    BufferCreateInfo.size = Size;
+    BufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkCheckResult(vkCreateBuffer(RenderState->Device, &BufferCreateInfo, 0, Buffer));
+
+    VkMemoryRequirements Requirements;
+    vkGetBufferMemoryRequirements(RenderState->Device, *Buffer, &Requirements);
+
+    // NOTE: The framework arenas are device local, readback needs its own host visible allocation
+    VkMemoryPropertyFlags Flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = Requirements.size;
+    AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(Requirements.memoryTypeBits, Flags);
+    VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, Memory));
+    VkCheckResult(vkBindBufferMemory(RenderState->Device, *Buffer, *Memory, 0));
+    VkCheckResult(vkMapMemory(RenderState->Device, *Memory, 0, Size, 0, MappedPtr));
+}
+
+RENDER_GRAPH_PASS_RECORD(CpuRasterReadbackRecord)
+{
+    cpu_raster* Raster = (cpu_raster*)Data;
+    u32 Width = Raster->ReadbackWidth;
+    u32 Height = Raster->ReadbackHeight;
+    u64 Size = sizeof(f32)*Width*Height;
+    if (Raster->ReadbackSize < Size)
+    {
+        ReadbackBufferReCreate(Size, &Raster->ReadbackBuffer, &Raster->ReadbackMemory, &Raster->ReadbackPtr);
+        Raster->ReadbackSize = Size;
+    }
+
+    // NOTE: The graph moved the shadow map to transfer src after its last reader
+    VkBufferImageCopy Region = {};
+    Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    Region.imageSubresource.layerCount = 1;
+    Region.imageExtent = { Width, Height, 1 };
+    vkCmdCopyImageToBuffer(Commands->Buffer, Raster->ReadbackImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Raster->ReadbackBuffer, 1, &Region);
+
+    Raster->ReadbackPending = true;
+}
+
+inline void CpuRasterReadbackAdd(render_graph* Graph, cpu_raster* Raster, u32 ShadowImageId, VkImage ShadowImage, u32 Width, u32 Height)
+{
+    // NOTE: The readback buffer isn't tracked by the graph
+    Raster->ReadbackImage = ShadowImage;
+    Raster->ReadbackWidth = Width;
+    Raster->ReadbackHeight = Height;
+    RenderGraphPassAdd(Graph, RenderGraphPass_CpuRasterReadback, RenderGraphPassFlag_SideEffect, CpuRasterReadbackRecord, Raster);
+    RenderGraphAccessAdd(Graph, ShadowImageId, RenderGraphUsage_TransferSrc, RenderGraphUsage_TransferSrc, false);
+}
+
+inline void CpuRasterDiff(cpu_raster* Raster)
+{
+    Assert(Raster->ReadbackPending);
+    Assert(Raster->ReadbackWidth == Raster->Width && Raster->ReadbackHeight == Raster->Height);
+
+    // NOTE: Debug path, we don't track which frame the copy landed in
+    VkCheckResult(vkDeviceWaitIdle(RenderState->Device));
+    Raster->ReadbackPending = false;
+
+    cpu_raster_diff* Diff = &Raster->Diff;
+    *Diff = {};
+    Diff->Valid = true;
+    Diff->NumTexels = Raster->Width*Raster->Height;
+
+    f32* GpuDepth = (f32*)Raster->ReadbackPtr;
+    for (u32 TexelId = 0; TexelId < Diff->NumTexels; ++TexelId)
+    {
+        f32 Gpu = GpuDepth[TexelId];
+        f32 Cpu = Raster->Depth[TexelId];
+        if (*(u32*)&Gpu == *(u32*)&Cpu)
+        {
+            Diff->NumExact += 1;
+        }
+        else if ((Gpu > 0.0f) != (Cpu > 0.0f))
+        {
+            Diff->NumCoverageMismatches += 1;
+        }
+        else
+        {
+            Diff->MaxDepthError = Max(Diff->MaxDepthError, Abs(Gpu - Cpu));
+        }
+    }
+}
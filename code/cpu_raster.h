@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+
+  NOTE: CPU Reference Rasterizer
+
+    Renders the directional shadow map on the CPU from the same scene data the standard shadow pass consumes (shadow visible
+    instances, their shadow LOD and ShadowWVP) so that we can benchmark shadow generation without a GPU and cross check what the
+    driver produced. It follows the rules the GPU has to follow for the standard pass:
+
+      - Clip space clipping against 0 <= z <= w (no depth clamp), x/y only get clipped against a large guard band
+      - Viewport transform + snapping to CPU_RASTER_SUBPIXEL_BITS of sub pixel precision, coverage is sampled at pixel centers
+        with exact 64bit edge functions and the top-left fill rule
+      - No culling (the shadow PSO doesn't set a cull mode), reversed depth cleared to 0 with VK_COMPARE_OP_GREATER and depth
+        clamped to the viewport range
+
+    Coverage is bit exact as long as the driver uses the same sub pixel precision (8 bits is what most desktop GPUs report in
+    subPixelPrecisionBits). Depth is a float plane equation evaluated at the pixel center, the spec only bounds the interpolation
+    error so the diff reports exact matches and the max error separately.
+
+    Work gets split in 3 phases:
+
+      - Setup: threads grab instances, transform, clip and set up triangles into batches of slots they reserve atomically
+      - Binning: single threaded counting sort of the triangles into CPU_RASTER_TILE_SIZE tiles
+      - Raster: threads grab tiles, so no two threads ever touch the same texels. Depth only ever grows, so the result doesn't
+        depend on the order triangles get drawn in
+
+    The inner loop evaluates the edge functions for 8 pixels as 2x4 64bit lanes with AVX2 and the depth test in 8 float lanes. If
+    the CPU doesn't have AVX2 we run the same math one pixel at a time.
+
+    The diff copies the GPU shadow map into a host visible buffer the frame we rasterize, and compares the next frame after waiting
+    for the device to go idle.
+
+ */
+
+#include <immintrin.h>
+#include <intrin.h>
+
+#define CPU_RASTER_SUBPIXEL_BITS 8
+#define CPU_RASTER_SUBPIXEL (1 << CPU_RASTER_SUBPIXEL_BITS)
+#define CPU_RASTER_TILE_SIZE 64
+#define CPU_RASTER_MAX_THREADS 16
+#define CPU_RASTER_TRIANGLE_BATCH 256
+// NOTE: In multiples of w, keeps the fixed point coordinates far away from overflowing the 64bit edge functions
+#define CPU_RASTER_GUARD_BAND 64.0f
+// NOTE: The arena starts here and grows with the triangle count, see CpuRasterRender
+#define CPU_RASTER_MIN_MEMORY_SIZE MegaBytes(16)
+#define CPU_RASTER_MEMORY_SLACK 64
+// NOTE: Estimate of the tiles a triangle touches, runs where big triangles touch more get rerun with a bigger arena
+#define CPU_RASTER_TILE_ENTRIES_PER_SLOT 2
+
+struct cpu_raster_triangle
+{
+    // NOTE: E = A*x + B*y + C in sub pixels, the fill rule is folded into C so covered means E >= 0 for all 3 edges
+    i64 EdgeA[3];
+    i64 EdgeB[3];
+    i64 EdgeC[3];
+
+    // NOTE: Depth plane in pixels, relative to the first vertex
+    f32 Z0;
+    f32 X0;
+    f32 Y0;
+    f32 DzDx;
+    f32 DzDy;
+
+    // NOTE: Inclusive pixel bounds, MinX > MaxX marks a slot that holds no triangle
+    i32 MinX;
+    i32 MinY;
+    i32 MaxX;
+    i32 MaxY;
+};
+
+struct cpu_raster_stats
+{
+    u32 NumThreads;
+    b32 Avx2;
+    u32 NumTriangles;
+    u32 NumSetupTriangles;
+    f32 SetupMs;
+    f32 BinMs;
+    f32 RasterMs;
+    f32 TotalMs;
+    f32 TrianglesPerSecond;
+};
+
+struct cpu_raster_diff
+{
+    b32 Valid;
+    u32 NumTexels;
+    // NOTE: Bit identical depth
+    u32 NumExact;
+    // NOTE: One side wrote the texel and the other didn't
+    u32 NumCoverageMismatches;
+    f32 MaxDepthError;
+};
+
+struct cpu_raster
+{
+    u32 NumThreads;
+    b32 Avx2;
+    void* Memory;
+    u64 MemorySize;
+    linear_arena Arena;
+    // NOTE: Everything of the last run lives here, it stays around until the next run so that the diff can read the depth
+    temp_mem RunMem;
+    b32 RunMemActive;
+
+    // NOTE: Shared with the worker threads while a run is going on
+    render_scene* Scene;
+    u32 Width;
+    u32 Height;
+    f32* Depth;
+    volatile LONG NextJob;
+    volatile LONG NextTriangleSlot;
+    u32 MaxNumTriangleSlots;
+    cpu_raster_triangle* Triangles;
+    u32 MaxNumMeshVertices;
+    v4* ThreadVertices[CPU_RASTER_MAX_THREADS];
+    u32 NumTilesX;
+    u32 NumTilesY;
+    u32* TileOffsets;
+    u32* TileTriangles;
+
+    cpu_raster_stats Stats;
+
+    // NOTE: GPU readback for the diff
+    b32 DiffRequested;
+    b32 ReadbackPending;
+    VkImage ReadbackImage;
+    u32 ReadbackWidth;
+    u32 ReadbackHeight;
+    u64 ReadbackSize;
+    VkBuffer ReadbackBuffer;
+    VkDeviceMemory ReadbackMemory;
+    void* ReadbackPtr;
+    cpu_raster_diff Diff;
+};
+
+struct cpu_raster_thread_data
+{
+    cpu_raster* Raster;
+    u32 ThreadId;
+};
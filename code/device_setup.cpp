@@ -0,0 +1,235 @@
+
+//
+// NOTE: Device Creation
+//
+
+inline u32 DemoQueueFamilyFind(VkQueueFamilyProperties* Families, u32 NumFamilies, VkQueueFlags Required, VkQueueFlags Excluded)
+{
+    u32 Result = 0xFFFFFFFF;
+    for (u32 FamilyId = 0; FamilyId < NumFamilies; ++FamilyId)
+    {
+        VkQueueFlags Flags = Families[FamilyId].queueFlags;
+        if ((Flags & Required) == Required && !(Flags & Excluded))
+        {
+            Result = FamilyId;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+inline void DemoDeviceSupportGet(VkPhysicalDevice PhysicalDevice, u32* ApiVersion, demo_device_support* Result)
+{
+    *Result = {};
+
+    VkPhysicalDeviceProperties Properties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+    *ApiVersion = Properties.apiVersion;
+
+    // NOTE: Queues
+    {
+        u32 NumFamilies = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, 0);
+        VkQueueFamilyProperties* Families = PushArray(&DemoState->TempArena, VkQueueFamilyProperties, NumFamilies);
+        vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, Families);
+
+        Result->ComputeFamily = DemoQueueFamilyFind(Families, NumFamilies, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT) != 0xFFFFFFFF;
+        Result->TransferFamily = DemoQueueFamilyFind(Families, NumFamilies, VK_QUEUE_TRANSFER_BIT,
+                                                     VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) != 0xFFFFFFFF;
+    }
+
+    // NOTE: Features
+    {
+        VkPhysicalDeviceFeatures Supported;
+        vkGetPhysicalDeviceFeatures(PhysicalDevice, &Supported);
+
+        Result->MultiDrawIndirect = Supported.multiDrawIndirect;
+        Result->DrawIndirectFirstInstance = Supported.drawIndirectFirstInstance;
+        Result->TextureCompressionBC = Supported.textureCompressionBC;
+    }
+
+    // NOTE: VkPhysicalDeviceVulkan12Features is only valid to chain on a 1.2 device
+    if (*ApiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceVulkan12Features Supported12 = {};
+        Supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 Supported = {};
+        Supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        Supported.pNext = &Supported12;
+        vkGetPhysicalDeviceFeatures2(PhysicalDevice, &Supported);
+
+        Result->TimelineSemaphore = Supported12.timelineSemaphore;
+        Result->Bindless = (Supported12.descriptorBindingPartiallyBound && Supported12.descriptorBindingSampledImageUpdateAfterBind &&
+                            Supported12.shaderSampledImageArrayNonUniformIndexing);
+        Result->DrawIndirectCount = Supported12.drawIndirectCount;
+    }
+}
+
+inline void DemoQueueRequest(demo_device_setup* Setup, u32 FamilyId)
+{
+    // NOTE: One queue per family is all we use, skip families VkInit already asked for
+    for (u32 InfoId = 0; InfoId < Setup->NumQueueCreateInfos; ++InfoId)
+    {
+        if (Setup->QueueCreateInfos[InfoId].queueFamilyIndex == FamilyId)
+        {
+            return;
+        }
+    }
+
+    Assert(Setup->NumQueueCreateInfos < DEMO_MAX_QUEUE_CREATE_INFOS);
+    VkDeviceQueueCreateInfo* Info = Setup->QueueCreateInfos + Setup->NumQueueCreateInfos++;
+    *Info = {};
+    Info->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    Info->queueFamilyIndex = FamilyId;
+    Info->queueCount = 1;
+    Info->pQueuePriorities = &Setup->QueuePriority;
+}
+
+inline VkDeviceCreateInfo* DemoDeviceCreate(VkPhysicalDevice PhysicalDevice, const VkDeviceCreateInfo* FrameworkCreateInfo)
+{
+    // NOTE: Everything we chain into CreateInfo has to outlive vkCreateDevice, so it lives in DemoState
+    demo_device_setup* Setup = &DemoState->DeviceSetup;
+    *Setup = {};
+    Setup->QueuePriority = 1.0f;
+    Setup->CreateInfo = *FrameworkCreateInfo;
+    VkDeviceCreateInfo* CreateInfo = &Setup->CreateInfo;
+
+    u32 ApiVersion = 0;
+    demo_device_support Supported = {};
+    DemoDeviceSupportGet(PhysicalDevice, &ApiVersion, &Supported);
+    demo_device_support* Enabled = &Setup->Enabled;
+
+    // NOTE: Queues
+    {
+        u32 NumFamilies = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, 0);
+        VkQueueFamilyProperties* Families = PushArray(&DemoState->TempArena, VkQueueFamilyProperties, NumFamilies);
+        vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, Families);
+
+        Assert(CreateInfo->queueCreateInfoCount <= DEMO_MAX_QUEUE_CREATE_INFOS);
+        for (u32 InfoId = 0; InfoId < CreateInfo->queueCreateInfoCount; ++InfoId)
+        {
+            Setup->QueueCreateInfos[Setup->NumQueueCreateInfos++] = CreateInfo->pQueueCreateInfos[InfoId];
+        }
+
+        Setup->ComputeFamilyId = DemoQueueFamilyFind(Families, NumFamilies, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+        if (Setup->ComputeFamilyId != 0xFFFFFFFF)
+        {
+            DemoQueueRequest(Setup, Setup->ComputeFamilyId);
+            Enabled->ComputeFamily = true;
+        }
+
+        Setup->TransferFamilyId = DemoQueueFamilyFind(Families, NumFamilies, VK_QUEUE_TRANSFER_BIT,
+                                                      VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+        if (Setup->TransferFamilyId != 0xFFFFFFFF)
+        {
+            DemoQueueRequest(Setup, Setup->TransferFamilyId);
+            Enabled->TransferFamily = true;
+        }
+
+        CreateInfo->queueCreateInfoCount = Setup->NumQueueCreateInfos;
+        CreateInfo->pQueueCreateInfos = Setup->QueueCreateInfos;
+    }
+
+    // NOTE: Features, the core ones move into Features2 since pEnabledFeatures and a chained Features2 are exclusive
+    {
+        Setup->Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        if (CreateInfo->pEnabledFeatures)
+        {
+            Setup->Features.features = *CreateInfo->pEnabledFeatures;
+        }
+
+        // NOTE: Indirect draws carry the instance id in firstInstance and get merged per batch with multi draw indirect, the
+        // geometry buffer falls back to direct draws and single indirect draws (see geometry_buffer.h)
+        Setup->Features.features.drawIndirectFirstInstance = Supported.DrawIndirectFirstInstance;
+        Setup->Features.features.multiDrawIndirect = Supported.MultiDrawIndirect;
+        Enabled->DrawIndirectFirstInstance = Supported.DrawIndirectFirstInstance;
+        Enabled->MultiDrawIndirect = Supported.MultiDrawIndirect;
+
+        // NOTE: BC texture files, without it they get rejected at load (see texture_file.h)
+        Setup->Features.features.textureCompressionBC = Supported.TextureCompressionBC;
+        Enabled->TextureCompressionBC = Supported.TextureCompressionBC;
+
+        // NOTE: Only chain the 1.2 features on a device that knows them
+        if (ApiVersion >= VK_API_VERSION_1_2)
+        {
+            Setup->Features.pNext = &Setup->Vulkan12Features;
+            Setup->Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            Setup->Vulkan12Features.pNext = (void*)CreateInfo->pNext;
+
+            // NOTE: Async compute chains its submissions with a timeline semaphore, asset streaming retires its batches with one
+            Setup->Vulkan12Features.timelineSemaphore = Supported.TimelineSemaphore;
+            Enabled->TimelineSemaphore = Supported.TimelineSemaphore;
+
+            // NOTE: Bindless materials, a partially bound texture array that is updated after bind and indexed per material. These
+            // are the VkPhysicalDeviceDescriptorIndexingFeatures bits, which can't be chained next to Vulkan12Features
+            Setup->Vulkan12Features.descriptorBindingPartiallyBound = Supported.Bindless;
+            Setup->Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = Supported.Bindless;
+            Setup->Vulkan12Features.shaderSampledImageArrayNonUniformIndexing = Supported.Bindless;
+            Enabled->Bindless = Supported.Bindless;
+
+            // NOTE: Occlusion culling compacts its draws and takes the count from a buffer, without it the culled commands stay in
+            // place and get drawn with a fixed count (see occlusion.h)
+            Setup->Vulkan12Features.drawIndirectCount = Supported.DrawIndirectCount;
+            Enabled->DrawIndirectCount = Supported.DrawIndirectCount;
+        }
+        else
+        {
+            Setup->Features.pNext = (void*)CreateInfo->pNext;
+        }
+
+        CreateInfo->pEnabledFeatures = 0;
+        CreateInfo->pNext = &Setup->Features;
+    }
+
+    return CreateInfo;
+}
+
+// NOTE: Declared in shadow_demo.h above the framework include, it's a template there since the vulkan types aren't declared yet
+template <typename physical_device, typename create_info> create_info DemoDeviceCreateInfoGet(physical_device PhysicalDevice,
+                                                                                             create_info CreateInfo)
+{
+    return DemoDeviceCreate(PhysicalDevice, CreateInfo);
+}
+
+inline void DemoDeviceCapsGet(VkPhysicalDevice PhysicalDevice, demo_device_caps* Result)
+{
+    *Result = {};
+    DemoDeviceSupportGet(PhysicalDevice, &Result->ApiVersion, &Result->Supported);
+
+    demo_device_support* Supported = &Result->Supported;
+    demo_device_support* Enabled = &DemoState->DeviceSetup.Enabled;
+    Result->AsyncCompute = Supported->ComputeFamily && Enabled->ComputeFamily;
+    Result->TransferQueue = Supported->TransferFamily && Enabled->TransferFamily;
+    Result->TimelineSemaphore = Supported->TimelineSemaphore && Enabled->TimelineSemaphore;
+    Result->MultiDrawIndirect = Supported->MultiDrawIndirect && Enabled->MultiDrawIndirect;
+    Result->DrawIndirectFirstInstance = Supported->DrawIndirectFirstInstance && Enabled->DrawIndirectFirstInstance;
+    Result->Bindless = Supported->Bindless && Enabled->Bindless;
+    Result->DrawIndirectCount = Supported->DrawIndirectCount && Enabled->DrawIndirectCount;
+    Result->TextureCompressionBC = Supported->TextureCompressionBC && Enabled->TextureCompressionBC;
+}
+
+//
+// NOTE: Device Memory
+//
+
+// NOTE: For everything that allocates its own memory instead of going through the framework arenas
+inline u32 DemoMemoryTypeGet(u32 MemoryTypeBits, VkMemoryPropertyFlags Flags)
+{
+    VkPhysicalDeviceMemoryProperties MemoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(RenderState->PhysicalDevice, &MemoryProperties);
+
+    u32 Result = 0xFFFFFFFF;
+    for (u32 TypeId = 0; TypeId < MemoryProperties.memoryTypeCount; ++TypeId)
+    {
+        if ((MemoryTypeBits & (1u << TypeId)) && (MemoryProperties.memoryTypes[TypeId].propertyFlags & Flags) == Flags)
+        {
+            Result = TypeId;
+            break;
+        }
+    }
+
+    Assert(Result != 0xFFFFFFFF);
+    return Result;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+/*
+
+  NOTE: Device Creation
+
+    VkInit creates the device with the graphics/present queue, the extensions we pass in and whatever core features it needs itself.
+    The framework gets compiled into this translation unit, so shadow_demo.h defines vkCreateDevice as a function like macro before
+    including it. VkInit's call then passes its create info through DemoDeviceCreate, which copies it, adds our queues and moves the
+    features into a Features2/Vulkan12Features chain. The macro only matches calls, the framework's function pointer declaration and
+    loading stay untouched (it builds with VK_NO_PROTOTYPES, a vulkan prototype would get mangled). We only ever enable what the
+    device supports, everything else is a capability flag here and the code that uses it has a fallback that runs on any device:
+
+      - AsyncCompute: needs a queue from a compute only family, otherwise the blurs record inline into the graphics command buffer
+      - TimelineSemaphore: chains the async compute submissions and retires asset stream batches, off means no dedicated async
+        compute and a fence per asset stream batch
+      - TransferQueue: needs a queue from a transfer only family, otherwise asset streaming submits to the graphics queue
+      - MultiDrawIndirect: one vkCmdDrawIndexedIndirect per command instead of one per batch
+      - DrawIndirectFirstInstance: the instance id lives in firstInstance, off means direct draws out of the CPU copy of the commands
+      - Bindless: descriptor indexing for the material texture array, off means every material gets its own sets and the forward
+        pass rebinds them per draw (see shadow_demo.h)
+      - DrawIndirectCount: the Hi-Z occlusion culling compacts its draws and draws with a GPU written count, off means the culled
+        commands stay in place with no instances and get drawn with a fixed count
+      - TextureCompressionBC: off means BC texture files get rejected and their materials fall back to another texture
+
+    DemoDeviceCapsGet runs right after VkInit. A capability is only on when the device supports it AND DemoDeviceCreate enabled it,
+    the UI shows what the device could do next to what is used. The 1.2 features only get queried and chained on a 1.2 device.
+
+ */
+
+#define DEMO_MAX_QUEUE_CREATE_INFOS 8
+
+struct demo_device_support
+{
+    b32 ComputeFamily;
+    b32 TransferFamily;
+    b32 TimelineSemaphore;
+    b32 MultiDrawIndirect;
+    b32 DrawIndirectFirstInstance;
+    b32 Bindless;
+    b32 DrawIndirectCount;
+    b32 TextureCompressionBC;
+};
+
+struct demo_device_setup
+{
+    VkPhysicalDeviceFeatures2 Features;
+    VkPhysicalDeviceVulkan12Features Vulkan12Features;
+
+    f32 QueuePriority;
+    u32 NumQueueCreateInfos;
+    VkDeviceQueueCreateInfo QueueCreateInfos[DEMO_MAX_QUEUE_CREATE_INFOS];
+
+    // NOTE: Family with compute but no graphics, for async compute
+    u32 ComputeFamilyId;
+    // NOTE: Family with transfer but no graphics/compute, those map to the copy engines the asset stream uses
+    u32 TransferFamilyId;
+
+    // NOTE: What VkInit's vkCreateDevice call actually gets, the queues and the features chain point into this struct
+    VkDeviceCreateInfo CreateInfo;
+    demo_device_support Enabled;
+};
+
+struct demo_device_caps
+{
+    u32 ApiVersion;
+    demo_device_support Supported;
+
+    b32 AsyncCompute;
+    b32 TransferQueue;
+    b32 TimelineSemaphore;
+    b32 MultiDrawIndirect;
+    b32 DrawIndirectFirstInstance;
+    b32 Bindless;
+    b32 DrawIndirectCount;
+    b32 TextureCompressionBC;
+};
@@ -53,26 +53,37 @@
   
  */
 
-inline vk_pipeline* ForwardPipelineCreate(char* VertFileName, char* FragFileName, renderer_create_info CreateInfo,
-                                          render_target RenderTarget, VkDescriptorSetLayout ShadowDescLayout)
+inline vk_pipeline* ForwardPipelineCreate(char* VertFileName, char* FragFileName, char* BoundFragFileName, renderer_create_info CreateInfo,
+                                          render_target RenderTarget, VkDescriptorSetLayout ShadowDescLayout, b32 DepthPrepass)
 {
     vk_pipeline* Result = 0;
     
     vk_pipeline_builder Builder = VkPipelineBuilderBegin(&DemoState->TempArena);
 
-    // NOTE: Shaders
+    // NOTE: Shaders, without bindless the fragment shader samples the texture of the bound material set
     VkPipelineShaderAdd(&Builder, VertFileName, "main", VK_SHADER_STAGE_VERTEX_BIT);
-    VkPipelineShaderAdd(&Builder, FragFileName, "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+    VkPipelineShaderAdd(&Builder, CreateInfo.Scene->MaterialBindless ? FragFileName : BoundFragFileName, "main", VK_SHADER_STAGE_FRAGMENT_BIT);
 
-    // NOTE: Specify input vertex data format
+    // NOTE: Specify input vertex data format (position stream + quantized attribute stream)
     VkPipelineVertexBindingBegin(&Builder);
     VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
-    VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
-    VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32_SFLOAT, sizeof(v2));
+    VkPipelineVertexBindingEnd(&Builder);
+
+    VkPipelineVertexBindingBegin(&Builder);
+    VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R16G16_SNORM, 2*sizeof(i16));
+    VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R16G16_SFLOAT, 2*sizeof(u16));
     VkPipelineVertexBindingEnd(&Builder);
 
     VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
-    VkPipelineDepthStateAdd(&Builder, VK_TRUE, VK_TRUE, VK_COMPARE_OP_GREATER);
+    if (DepthPrepass)
+    {
+        // NOTE: Depth is already resolved, only the visible surface passes
+        VkPipelineDepthStateAdd(&Builder, VK_TRUE, VK_FALSE, VK_COMPARE_OP_EQUAL);
+    }
+    else
+    {
+        VkPipelineDepthStateAdd(&Builder, VK_TRUE, VK_TRUE, VK_COMPARE_OP_GREATER);
+    }
                 
     // NOTE: Set the blending state
     VkPipelineColorAttachmentAdd(&Builder, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO,
@@ -91,6 +102,126 @@ inline vk_pipeline* ForwardPipelineCreate(char* VertFileName, char* FragFileName
     return Result;
 }
 
+//
+// NOTE: Bounds
+//
+
+inline void BoundsTransform(m4 Transform, v3 BoundsMin, v3 BoundsMax, v3* ResultMin, v3* ResultMax)
+{
+    for (u32 CornerId = 0; CornerId < 8; ++CornerId)
+    {
+        v3 Corner = V3((CornerId & 1) ? BoundsMax.x : BoundsMin.x, (CornerId & 2) ? BoundsMax.y : BoundsMin.y,
+                       (CornerId & 4) ? BoundsMax.z : BoundsMin.z);
+        v3 Transformed = (Transform * V4(Corner, 1.0f)).xyz;
+        if (CornerId == 0)
+        {
+            *ResultMin = Transformed;
+            *ResultMax = Transformed;
+        }
+        else
+        {
+            *ResultMin = V3(Min(ResultMin->x, Transformed.x), Min(ResultMin->y, Transformed.y), Min(ResultMin->z, Transformed.z));
+            *ResultMax = V3(Max(ResultMax->x, Transformed.x), Max(ResultMax->y, Transformed.y), Max(ResultMax->z, Transformed.z));
+        }
+    }
+}
+
+//
+// NOTE: Shadow Cache
+//
+
+inline u64 ShadowCacheHash(u64 Hash, void* Data, u64 Size)
+{
+    // NOTE: FNV-1a
+    u8* Bytes = (u8*)Data;
+    for (u64 ByteId = 0; ByteId < Size; ++ByteId)
+    {
+        Hash ^= Bytes[ByteId];
+        Hash *= 1099511628211ull;
+    }
+
+    return Hash;
+}
+
+inline u64 ShadowCacheKeyGet(render_scene* Scene, u32 Width, u32 Height)
+{
+    u64 Result = 14695981039346656037ull;
+    // NOTE: The snapped fit instead of the transform, so this only changes once the light volume moved a texel
+    Result = ShadowCacheHash(Result, &Scene->DirectionalLight.Fit, sizeof(shadow_fit));
+    Result = ShadowCacheHash(Result, &Width, sizeof(u32));
+    Result = ShadowCacheHash(Result, &Height, sizeof(u32));
+    // NOTE: Static instances keep their ids (and so their shadow transform slots) until the generation changes
+    Result = ShadowCacheHash(Result, &Scene->StaticGeneration, sizeof(u32));
+
+    return Result;
+}
+
+inline b32 ShadowCacheRebuildCheck(shadow_cache* Cache, render_scene* Scene, u32 Width, u32 Height)
+{
+    u64 Key = ShadowCacheKeyGet(Scene, Width, Height);
+    b32 Result = !Cache->Valid || Cache->Key != Key;
+    if (Result)
+    {
+        Cache->Valid = true;
+        Cache->Key = Key;
+        Cache->OutputMatchesCache = false;
+    }
+
+    return Result;
+}
+
+inline void ShadowImageBarrier(VkCommandBuffer CmdBuffer, VkImage Image, VkImageAspectFlags Aspect, VkImageLayout OldLayout,
+                               VkImageLayout NewLayout, VkPipelineStageFlags SrcStage, VkAccessFlags SrcAccess,
+                               VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    AsyncComputeImageBarrier(CmdBuffer, Image, Aspect, OldLayout, NewLayout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                             SrcStage, SrcAccess, DstStage, DstAccess);
+}
+
+inline void ShadowCacheCopy(VkCommandBuffer CmdBuffer, VkImage SrcImage, VkImage DstImage, VkImageAspectFlags Aspect, u32 Width, u32 Height)
+{
+    // NOTE: The graph moved Src to transfer src and discarded Dst into transfer dst
+    VkImageCopy Region = {};
+    Region.srcSubresource.aspectMask = Aspect;
+    Region.srcSubresource.layerCount = 1;
+    Region.dstSubresource.aspectMask = Aspect;
+    Region.dstSubresource.layerCount = 1;
+    Region.extent.width = Width;
+    Region.extent.height = Height;
+    Region.extent.depth = 1;
+    vkCmdCopyImage(CmdBuffer, SrcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, DstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Region);
+
+    // NOTE: The composite render pass loads the copied data, the pass leaves the image in attachment layout for the graph
+    VkImageLayout AttachmentLayout = (Aspect == VK_IMAGE_ASPECT_DEPTH_BIT ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL :
+                                      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkPipelineStageFlags AttachmentStages = (Aspect == VK_IMAGE_ASPECT_DEPTH_BIT ?
+                                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT :
+                                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    VkAccessFlags AttachmentAccess = (Aspect == VK_IMAGE_ASPECT_DEPTH_BIT ?
+                                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT :
+                                      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    ShadowImageBarrier(CmdBuffer, DstImage, Aspect, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, AttachmentLayout,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, AttachmentStages, AttachmentAccess);
+}
+
+inline void ShadowCastersDraw(VkCommandBuffer CmdBuffer, render_scene* Scene, vk_pipeline* Pipeline, b32 Static)
+{
+    vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->Handle);
+    {
+        VkDescriptorSet DescriptorSets[] =
+            {
+                Scene->SceneDescriptor,
+            };
+        vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->Layout, 1,
+                                ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+    }
+
+
+    GeometryBind(CmdBuffer, &Scene->Geometry, false);
+    geometry_draw_list* DrawList = Static ? &Scene->ShadowStaticDraws : &Scene->ShadowDynamicDraws;
+    GeometryDrawListRender(CmdBuffer, &Scene->Geometry, DrawList);
+}
+
 //
 // NOTE: Standard Shadow Data
 //
@@ -103,12 +234,20 @@ inline void StandardShadowResize(standard_shadow_data* ShadowData, u32 Width, u3
     ShadowData->Width = Width;
     ShadowData->Height = Height;
     
-    RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_D32_SFLOAT,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                               VK_IMAGE_ASPECT_DEPTH_BIT, &ShadowData->ShadowImage, &ShadowData->ShadowEntry);
+    RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_D32_SFLOAT,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                              VK_IMAGE_ASPECT_DEPTH_BIT, &ShadowData->Cache.DepthImage, &ShadowData->Cache.DepthEntry);
+    RenderGraphImageImport(&DemoState->RenderGraph, &ShadowData->ShadowImageId, ShadowData->ShadowImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+    RenderGraphImageImport(&DemoState->RenderGraph, &ShadowData->Cache.DepthImageId, ShadowData->Cache.DepthImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+    ShadowData->Cache.Valid = false;
 
     if (ReCreate)
     {
         RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->RenderTarget);
+        RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->Cache.RenderTarget);
     }
 
     VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->ShadowDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
@@ -149,6 +288,25 @@ inline void StandardShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
     Result->ShadowDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, ShadowDescLayout);
     StandardShadowResize(Result, Width, Height);
 
+    // NOTE: Shadow Cache RT
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
+        RenderTargetAddTarget(&Builder, &Result->Cache.DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        // NOTE: The render graph transitions the attachment around the pass
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->Cache.DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+                
+        Result->Cache.RenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+    
     // NOTE: Shadow RT
     {
         render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
@@ -156,16 +314,13 @@ inline void StandardShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
                             
         vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
 
-        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->ShadowEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->ShadowEntry.Format, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
         VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
         VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
         VkRenderPassSubPassEnd(&RpBuilder);
-
-        VkRenderPassDependency(&RpBuilder, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                               VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_DEPENDENCY_BY_REGION_BIT);
                 
         Result->RenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
     }
@@ -177,11 +332,9 @@ inline void StandardShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
         // NOTE: Shaders
         VkPipelineShaderAdd(&Builder, "shader_shadow_vert.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
                 
-        // NOTE: Specify input vertex data format
+        // NOTE: Specify input vertex data format, depth only so we just read the position stream
         VkPipelineVertexBindingBegin(&Builder);
         VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
-        VkPipelineVertexAttributeAddOffset(&Builder, sizeof(v3));
-        VkPipelineVertexAttributeAddOffset(&Builder, sizeof(v2));
         VkPipelineVertexBindingEnd(&Builder);
 
         VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
@@ -200,20 +353,142 @@ inline void StandardShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
 
     if (Pcf)
     {
-        Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_pcf_vert.spv", "shader_forward_pcf_frag.spv", CreateInfo,
-                                                        ForwardRenderTarget, ShadowDescLayout);
+        Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_pcf_vert.spv", "shader_forward_pcf_frag.spv",
+                                                        "shader_forward_pcf_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, false);
+        Result->ForwardPrepassPipeline = ForwardPipelineCreate("shader_forward_pcf_vert.spv", "shader_forward_pcf_frag.spv",
+                                                               "shader_forward_pcf_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, true);
     }
     else
     {
         Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_standard_vert.spv", "shader_forward_standard_frag.spv",
-                                                        CreateInfo, ForwardRenderTarget, ShadowDescLayout);
+                                                        "shader_forward_standard_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, false);
+        Result->ForwardPrepassPipeline = ForwardPipelineCreate("shader_forward_standard_vert.spv", "shader_forward_standard_frag.spv",
+                                                               "shader_forward_standard_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, true);
+    }
+}
+
+RENDER_GRAPH_PASS_RECORD(StandardShadowCacheRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    standard_shadow_data* ShadowData = State->Frame.StandardShadow;
+    
+    RenderTargetPassBegin(&ShadowData->Cache.RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, true);
+    RenderTargetPassEnd(*Commands);
+}
+
+RENDER_GRAPH_PASS_RECORD(StandardShadowRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    standard_shadow_data* ShadowData = State->Frame.StandardShadow;
+
+    ShadowCacheCopy(Commands->Buffer, ShadowData->Cache.DepthImage, ShadowData->ShadowImage, VK_IMAGE_ASPECT_DEPTH_BIT, ShadowData->Width,
+                    ShadowData->Height);
+    RenderTargetPassBegin(&ShadowData->RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, false);
+    RenderTargetPassEnd(*Commands);
+}
+
+inline void StandardShadowPassesAdd(render_graph* Graph, forward_state* State, standard_shadow_data* ShadowData, render_scene* Scene)
+{
+    State->Frame.StandardShadow = ShadowData;
+    
+    shadow_cache* Cache = &ShadowData->Cache;
+    if (ShadowCacheRebuildCheck(Cache, Scene, ShadowData->Width, ShadowData->Height))
+    {
+        RenderGraphPassAdd(Graph, RenderGraphPass_ShadowCache, 0, StandardShadowCacheRecord, State);
+        RenderGraphAccessAdd(Graph, Cache->DepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, true);
+    }
+
+    if (Cache->OutputMatchesCache && Scene->NumDynamicOpaqueInstances == 0)
+    {
+        // NOTE: Last frames shadow map is still correct
+        return;
     }
+
+    RenderGraphPassAdd(Graph, RenderGraphPass_Shadow, 0, StandardShadowRecord, State);
+    RenderGraphAccessAdd(Graph, Cache->DepthImageId, RenderGraphUsage_TransferSrc, RenderGraphUsage_TransferSrc, false);
+    RenderGraphAccessAdd(Graph, ShadowData->ShadowImageId, RenderGraphUsage_TransferDst, RenderGraphUsage_DepthAttachment, true);
+
+    Cache->OutputMatchesCache = Scene->NumDynamicOpaqueInstances == 0;
 }
 
 //
 // NOTE: Variance Shadow Data
 //
 
+inline render_target VarianceShadowTargetBuild(u32 Width, u32 Height, render_target_entry* MomentEntry, render_target_entry* DepthEntry,
+                                               VkAttachmentLoadOp LoadOp)
+{
+    render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
+    RenderTargetAddTarget(&Builder, MomentEntry, VkClearColorCreate(1, 1, 0, 0));
+    RenderTargetAddTarget(&Builder, DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+    vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+    // NOTE: The render graph transitions the attachments around the pass
+    u32 MomentId = VkRenderPassAttachmentAdd(&RpBuilder, MomentEntry->Format, LoadOp, VK_ATTACHMENT_STORE_OP_STORE,
+                                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, DepthEntry->Format, LoadOp, VK_ATTACHMENT_STORE_OP_STORE,
+                                            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+    VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    VkRenderPassColorRefAdd(&RpBuilder, MomentId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    VkRenderPassSubPassEnd(&RpBuilder);
+                
+    render_target Result = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    return Result;
+}
+
+inline void VarianceSupersampleTargetsCreate(variance_supersample* Supersample, u32 Width, u32 Height, render_graph_pass_id BlurLastPass)
+{
+    render_graph* Graph = &DemoState->RenderGraph;
+    u32 SampleWidth = Width*Supersample->ScaleX;
+    u32 SampleHeight = Height*Supersample->ScaleY;
+
+    // NOTE: The cache gets its own arena the first time supersampling is on, 8 samples at full resolution don't fit next to
+    // everything else in the shadow arena
+    b32 ReCreate = Supersample->Created;
+    if (!ReCreate)
+    {
+        Supersample->Arena = VkLinearArenaCreate(RenderState->Device, RenderState->LocalMemoryId, VARIANCE_SUPERSAMPLE_ARENA_SIZE);
+        Supersample->Created = true;
+    }
+    VkArenaClear(&Supersample->Arena);
+
+    RenderTargetEntryReCreate(&Supersample->Arena, SampleWidth, SampleHeight, VK_FORMAT_R32G32_SFLOAT,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                              &Supersample->CacheMomentImage, &Supersample->CacheMomentEntry);
+    RenderTargetEntryReCreate(&Supersample->Arena, SampleWidth, SampleHeight, VK_FORMAT_D32_SFLOAT,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                              &Supersample->CacheDepthImage, &Supersample->CacheDepthEntry);
+    RenderGraphImageImport(Graph, &Supersample->CacheMomentImageId, Supersample->CacheMomentImage, VK_IMAGE_ASPECT_COLOR_BIT);
+    RenderGraphImageImport(Graph, &Supersample->CacheDepthImageId, Supersample->CacheDepthImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    RenderGraphTransientCreate(Graph, &Supersample->DepthImageId, SampleWidth, SampleHeight, VK_FORMAT_D32_SFLOAT,
+                               VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                               RenderGraphPass_Shadow, RenderGraphPass_Shadow, &Supersample->DepthImage, &Supersample->DepthEntry);
+    RenderGraphTransientCreate(Graph, &Supersample->MomentImageId, SampleWidth, SampleHeight, VK_FORMAT_R32G32_SFLOAT,
+                               VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                               VK_IMAGE_ASPECT_COLOR_BIT, RenderGraphPass_Shadow, BlurLastPass, &Supersample->MomentImage,
+                               &Supersample->MomentEntry);
+
+    // NOTE: Same formats and sample count as the single sample targets, so the shadow pipeline works with both
+    if (ReCreate)
+    {
+        RenderTargetUpdateEntries(&DemoState->TempArena, &Supersample->CacheRenderTarget);
+        RenderTargetUpdateEntries(&DemoState->TempArena, &Supersample->RenderTarget);
+    }
+    else
+    {
+        Supersample->CacheRenderTarget = VarianceShadowTargetBuild(SampleWidth, SampleHeight, &Supersample->CacheMomentEntry,
+                                                                   &Supersample->CacheDepthEntry, VK_ATTACHMENT_LOAD_OP_CLEAR);
+        Supersample->RenderTarget = VarianceShadowTargetBuild(SampleWidth, SampleHeight, &Supersample->MomentEntry, &Supersample->DepthEntry,
+                                                              VK_ATTACHMENT_LOAD_OP_LOAD);
+    }
+}
+
 inline void VarianceShadowResize(variance_shadow_data* ShadowData, u32 Width, u32 Height)
 {
     b32 ReCreate = ShadowData->Arena.Used != 0;
@@ -222,25 +497,86 @@ inline void VarianceShadowResize(variance_shadow_data* ShadowData, u32 Width, u3
     ShadowData->Width = Width;
     ShadowData->Height = Height;
 
+    // NOTE: With supersampling the casters only go into the supersampled cache and targets, the single sample ones would just take up
+    // memory. Their render targets keep pointing at the old views and don't get used until we switch back, which re-creates them
+    variance_supersample* Supersample = &ShadowData->Supersample;
+    b32 SupersampleEnabled = Supersample->Samples > 1;
+    
     RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_R32G32_SFLOAT,
-                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                               VK_IMAGE_ASPECT_COLOR_BIT, &ShadowData->VarianceImage, &ShadowData->VarianceEntry);
-    RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_R32G32_SFLOAT,
-                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                              VK_IMAGE_ASPECT_COLOR_BIT, &ShadowData->VarianceImage2, &ShadowData->VarianceEntry2);
-    RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_D32_SFLOAT,
-                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                              VK_IMAGE_ASPECT_DEPTH_BIT, &ShadowData->DepthImage, &ShadowData->DepthEntry);
+    if (!SupersampleEnabled)
+    {
+        RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_R32G32_SFLOAT,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                  VK_IMAGE_ASPECT_COLOR_BIT, &ShadowData->Cache.MomentImage, &ShadowData->Cache.MomentEntry);
+        RenderTargetEntryReCreate(&ShadowData->Arena, Width, Height, VK_FORMAT_D32_SFLOAT,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                  VK_IMAGE_ASPECT_DEPTH_BIT, &ShadowData->Cache.DepthImage, &ShadowData->Cache.DepthEntry);
+    }
+    ShadowData->Cache.Valid = false;
 
-    if (ReCreate)
+    render_graph* Graph = &DemoState->RenderGraph;
+    RenderGraphImageImport(Graph, &ShadowData->VarianceImageId, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT);
+    if (!SupersampleEnabled)
+    {
+        RenderGraphImageImport(Graph, &ShadowData->Cache.MomentImageId, ShadowData->Cache.MomentImage, VK_IMAGE_ASPECT_COLOR_BIT);
+        RenderGraphImageImport(Graph, &ShadowData->Cache.DepthImageId, ShadowData->Cache.DepthImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+
+    // NOTE: The depth only matters while the dynamic casters get drawn. On a dedicated compute queue the ping pong image is still in
+    // use while graphics moves on, so it has to stay alive until graphics joins the blurs
+    render_graph_pass_id BlurLastPass = Graph->AsyncDedicated ? RenderGraphPass_AsyncComputeJoin : RenderGraphPass_ShadowBlur;
+    if (SupersampleEnabled)
+    {
+        RenderGraphTransientDestroy(Graph, ShadowData->DepthImageId);
+    }
+    else
+    {
+        RenderGraphTransientCreate(Graph, &ShadowData->DepthImageId, Width, Height, VK_FORMAT_D32_SFLOAT,
+                                   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                                   RenderGraphPass_Shadow, RenderGraphPass_Shadow, &ShadowData->DepthImage, &ShadowData->DepthEntry);
+    }
+    RenderGraphTransientCreate(Graph, &ShadowData->VarianceImageId2, Width, Height, VK_FORMAT_R32G32_SFLOAT,
+                               VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                               RenderGraphPass_ShadowBlur, BlurLastPass, &ShadowData->VarianceImage2, &ShadowData->VarianceEntry2);
+
+    if (SupersampleEnabled)
+    {
+        VarianceSupersampleTargetsCreate(Supersample, Width, Height, BlurLastPass);
+
+        // NOTE: Blur X resolves the samples while it blurs, so it reads the supersampled moments instead
+        VkDescriptorImageWrite(&RenderState->DescriptorManager, Supersample->BlurXDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                               Supersample->MomentEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        VkDescriptorImageWrite(&RenderState->DescriptorManager, Supersample->BlurXDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                               ShadowData->VarianceEntry2.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    else
+    {
+        RenderGraphTransientDestroy(Graph, Supersample->DepthImageId);
+        RenderGraphTransientDestroy(Graph, Supersample->MomentImageId);
+    }
+
+    if (ReCreate && !SupersampleEnabled)
     {
         RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->RenderTarget);
-        RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->BlurXTarget);
-        RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->BlurYTarget);
+        RenderTargetUpdateEntries(&DemoState->TempArena, &ShadowData->Cache.RenderTarget);
     }
 
     VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->ShadowDescriptor, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                            ShadowData->VarianceEntry.View, ShadowData->Sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // NOTE: Blur X reads the moments and writes to the ping pong image, Blur Y writes the result back into the moments. The moments
+    // stay in general for both blurs
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->BlurXDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           ShadowData->VarianceEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->BlurXDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                           ShadowData->VarianceEntry2.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->BlurYDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           ShadowData->VarianceEntry2.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, ShadowData->BlurYDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                           ShadowData->VarianceEntry.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+    
     VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
 }
 
@@ -248,40 +584,36 @@ inline void VarianceShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
                                  VkDescriptorSetLayout ShadowDescLayout, variance_shadow_data* Result)
 {
     *Result = {};
+    Result->Supersample.Samples = 1;
+    Result->Supersample.ScaleX = 1;
+    Result->Supersample.ScaleY = 1;
 
-    u64 HeapSize = MegaBytes(64);
+    // NOTE: Only the moments and the cache live here, the depth and ping pong image are graph transients. 20 bytes a texel covers
+    // the 1024x1024 the UI goes up to
+    u64 HeapSize = MegaBytes(32);
     Result->Arena = VkLinearArenaCreate(RenderState->Device, RenderState->LocalMemoryId, HeapSize);
 
     Result->Sampler = VkSamplerCreate(RenderState->Device, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK, 16.0f);
     Result->ShadowDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, ShadowDescLayout);
 
+    {
+        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->BlurDescLayout);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+    }
+    Result->BlurXDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->BlurDescLayout);
+    Result->BlurYDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->BlurDescLayout);
+    Result->Supersample.BlurXDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->BlurDescLayout);
+    
     VarianceShadowResize(Result, Width, Height);
     
-    // NOTE: Shadow RT
-    {
-        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
-        RenderTargetAddTarget(&Builder, &Result->VarianceEntry, VkClearColorCreate(1, 1, 0, 0));
-        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
-                            
-        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
-
-        u32 VarianceId = VkRenderPassAttachmentAdd(&RpBuilder, Result->VarianceEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
-        VkRenderPassColorRefAdd(&RpBuilder, VarianceId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-        VkRenderPassSubPassEnd(&RpBuilder);
+    // NOTE: Shadow Cache RT
+    Result->Cache.RenderTarget = VarianceShadowTargetBuild(Width, Height, &Result->Cache.MomentEntry, &Result->Cache.DepthEntry,
+                                                           VK_ATTACHMENT_LOAD_OP_CLEAR);
 
-        VkRenderPassDependency(&RpBuilder, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                               VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_DEPENDENCY_BY_REGION_BIT);
-                
-        Result->RenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
-    }
+    // NOTE: Shadow RT
+    Result->RenderTarget = VarianceShadowTargetBuild(Width, Height, &Result->VarianceEntry, &Result->DepthEntry, VK_ATTACHMENT_LOAD_OP_LOAD);
     
     // NOTE: Shadow PSO
     {
@@ -291,11 +623,9 @@ inline void VarianceShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
         VkPipelineShaderAdd(&Builder, "shader_shadow_vert.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
         VkPipelineShaderAdd(&Builder, "shader_shadow_variance_frag.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
                 
-        // NOTE: Specify input vertex data format
+        // NOTE: Specify input vertex data format, depth only so we just read the position stream
         VkPipelineVertexBindingBegin(&Builder);
         VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
-        VkPipelineVertexAttributeAddOffset(&Builder, sizeof(v3));
-        VkPipelineVertexAttributeAddOffset(&Builder, sizeof(v2));
         VkPipelineVertexBindingEnd(&Builder);
 
         VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
@@ -315,250 +645,1199 @@ inline void VarianceShadowCreate(u32 Width, u32 Height, renderer_create_info Cre
                                                       Result->RenderTarget.RenderPass, 0, DescriptorLayouts, ArrayCount(DescriptorLayouts));
     }
     
-    Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_variance_vert.spv", "shader_forward_variance_frag.spv", CreateInfo,
-                                                    ForwardRenderTarget, ShadowDescLayout);
+    Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_variance_vert.spv", "shader_forward_variance_frag.spv",
+                                                    "shader_forward_variance_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, false);
+    Result->ForwardPrepassPipeline = ForwardPipelineCreate("shader_forward_variance_vert.spv", "shader_forward_variance_frag.spv",
+                                                           "shader_forward_variance_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, true);
 
     // NOTE: Blur Passes
     {
-        {
-            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->BlurDescLayout);
-            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
-        }
-        
-        // NOTE: Blur Render Target
-        {
-            vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
-
-            u32 OutputId = VkRenderPassAttachmentAdd(&RpBuilder, Result->VarianceEntry.Format, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                                                     VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-            VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
-            VkRenderPassColorRefAdd(&RpBuilder, OutputId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-            VkRenderPassSubPassEnd(&RpBuilder);
-
-            VkRenderPassDependency(&RpBuilder, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_DEPENDENCY_BY_REGION_BIT);
-
-            VkRenderPass RenderPass = VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device);
-
-            // NOTE: Blur X Target
-            {
-                render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
-                RenderTargetAddTarget(&Builder, &Result->VarianceEntry2, VkClearColorCreate(0, 0, 0, 0));
-                Result->BlurXTarget = RenderTargetBuilderEnd(&Builder, RenderPass);
-
-                Result->BlurXDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->BlurDescLayout);
-                VkDescriptorImageWrite(&RenderState->DescriptorManager, Result->BlurXDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                       Result->VarianceEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
-            
-            // NOTE: Blur Y Target
-            {
-                render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
-                RenderTargetAddTarget(&Builder, &Result->VarianceEntry, VkClearColorCreate(0, 0, 0, 0));
-                Result->BlurYTarget = RenderTargetBuilderEnd(&Builder, RenderPass);
-
-                Result->BlurYDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->BlurDescLayout);
-                VkDescriptorImageWrite(&RenderState->DescriptorManager, Result->BlurYDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                       Result->VarianceEntry2.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
-        }
-        
         VkDescriptorSetLayout Layouts[] =
         {
             Result->BlurDescLayout,
         };
-        Result->BlurXPipeline = FullScreenPipelineCreate("shader_gaussian_x_frag.spv", "main", Result->BlurXTarget.RenderPass, 0,
-                                                         ArrayCount(Layouts), Layouts);
-        Result->BlurYPipeline = FullScreenPipelineCreate("shader_gaussian_y_frag.spv", "main", Result->BlurYTarget.RenderPass, 0,
-                                                         ArrayCount(Layouts), Layouts);
+        Result->BlurXPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                        "shader_gaussian_x_comp.spv", "main", Layouts, ArrayCount(Layouts));
+        Result->BlurYPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                        "shader_gaussian_y_comp.spv", "main", Layouts, ArrayCount(Layouts));
+        Result->Supersample.BlurXPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                    "shader_gaussian_x_supersample_comp.spv", "main", Layouts,
+                                                                    ArrayCount(Layouts));
     }
 }
 
-//
-// NOTE: Forward Render Data
-//
+inline void VarianceShadowSamplesSet(variance_shadow_data* ShadowData, u32 Samples)
+{
+    // NOTE: 4 samples are 2x2 texels, 8 are 4x2. A 1024 wide map at 8 samples is 4096 wide, which every device supports
+    Assert(Samples == 1 || Samples == 4 || Samples == 8);
+    variance_supersample* Supersample = &ShadowData->Supersample;
+    if (Samples == Supersample->Samples)
+    {
+        return;
+    }
+
+    Supersample->Samples = Samples;
+    Supersample->ScaleX = Samples == 8 ? 4 : (Samples == 4 ? 2 : 1);
+    Supersample->ScaleY = Samples > 1 ? 2 : 1;
+
+    // NOTE: Re-creates the targets for the new sample count and invalidates the cache
+    VarianceShadowResize(ShadowData, ShadowData->Width, ShadowData->Height);
+}
 
-inline void ForwardSwapChainChange(forward_state* State, u32 Width, u32 Height, VkFormat ColorFormat, render_scene* Scene,
-                                   VkDescriptorSet* OutputRtSet)
+inline void VarianceShadowBlurDispatch(VkCommandBuffer CmdBuffer, vk_pipeline* Pipeline, VkDescriptorSet Descriptor, u32 Width, u32 Height)
 {
-    b32 ReCreate = State->RenderTargetArena.Used != 0;
-    VkArenaClear(&State->RenderTargetArena);
+    vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+    vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, 1, &Descriptor, 0, 0);
+    vkCmdDispatch(CmdBuffer, (Width + 7) / 8, (Height + 7) / 8, 1);
+}
 
-    // NOTE: Render Target Data
+inline void VarianceShadowBlur(vk_commands* Commands, async_compute* AsyncCompute, variance_shadow_data* ShadowData,
+                               VkPipelineStageFlags ConsumerStages)
+{
+    u32 GraphicsFamilyId = AsyncCompute->GraphicsFamilyId;
+    u32 ComputeFamilyId = AsyncCompute->ComputeFamilyId;
+    variance_supersample* Supersample = &ShadowData->Supersample;
+    b32 SupersampleEnabled = Supersample->Samples > 1;
+
+    // NOTE: The graph already moved the moments to general for compute, on a single queue that is all the synchronization we need
+    if (AsyncCompute->Dedicated)
     {
-        RenderTargetEntryReCreate(&State->RenderTargetArena, Width, Height, ColorFormat,
-                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
-                                  &State->ColorImage, &State->ColorEntry);
-        RenderTargetEntryReCreate(&State->RenderTargetArena, Width, Height, VK_FORMAT_D32_SFLOAT,
-                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
-                                  &State->DepthImage, &State->DepthEntry);
+        // NOTE: Hand the moments over to compute
+        AsyncComputeImageRelease(Commands->Buffer, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                 VK_IMAGE_LAYOUT_GENERAL, GraphicsFamilyId, ComputeFamilyId, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 
-        if (ReCreate)
+        // NOTE: The supersampled moments are a transient, so the graph left them as the shadow pass wrote them
+        if (SupersampleEnabled)
         {
-            RenderTargetUpdateEntries(&DemoState->TempArena, &State->ForwardRenderTarget);
+            AsyncComputeImageRelease(Commands->Buffer, Supersample->MomentImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GraphicsFamilyId, ComputeFamilyId,
+                                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
         }
+    }
 
-        VkDescriptorImageWrite(&RenderState->DescriptorManager, *OutputRtSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                               State->ColorEntry.View, DemoState->LinearSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkCommandBuffer ComputeBuffer = AsyncComputeBegin(AsyncCompute, *Commands);
+    AsyncComputeImageAcquire(ComputeBuffer, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_GENERAL, GraphicsFamilyId, ComputeFamilyId, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    if (AsyncCompute->Dedicated && SupersampleEnabled)
+    {
+        AsyncComputeImageAcquire(ComputeBuffer, Supersample->MomentImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, GraphicsFamilyId, ComputeFamilyId,
+                                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
     }
-        
-    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+    
+    // NOTE: Blur X. The graph can't record on the compute queue, so there the ping pong image gets discarded here
+    if (AsyncCompute->Dedicated)
+    {
+        AsyncComputeImageBarrier(ComputeBuffer, ShadowData->VarianceImage2, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_GENERAL, ComputeFamilyId, ComputeFamilyId, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    if (SupersampleEnabled)
+    {
+        // NOTE: Resolves the samples while it blurs, the single sample moments are only written by Blur Y
+        VarianceShadowBlurDispatch(ComputeBuffer, Supersample->BlurXPipeline, Supersample->BlurXDescriptor, ShadowData->Width, ShadowData->Height);
+    }
+    else
+    {
+        VarianceShadowBlurDispatch(ComputeBuffer, ShadowData->BlurXPipeline, ShadowData->BlurXDescriptor, ShadowData->Width, ShadowData->Height);
+    }
+
+    // NOTE: Blur Y
+    AsyncComputeImageBarrier(ComputeBuffer, ShadowData->VarianceImage2, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_GENERAL, ComputeFamilyId, ComputeFamilyId, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    AsyncComputeImageBarrier(ComputeBuffer, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_GENERAL, ComputeFamilyId, ComputeFamilyId, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    VarianceShadowBlurDispatch(ComputeBuffer, ShadowData->BlurYPipeline, ShadowData->BlurYDescriptor, ShadowData->Width, ShadowData->Height);
+
+    // NOTE: Hand the blurred moments back to graphics for whoever samples them (forward pass or shadow mask)
+    AsyncComputeImageRelease(ComputeBuffer, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, ComputeFamilyId, GraphicsFamilyId,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, ConsumerStages, VK_ACCESS_SHADER_READ_BIT);
+    AsyncComputeEnd(AsyncCompute, Commands, ConsumerStages);
 }
 
-inline void ForwardCreate(renderer_create_info CreateInfo, VkDescriptorSet* OutputRtSet, u32 ShadowWidth, u32 ShadowHeight,
-                          forward_state* Result)
+inline void VarianceShadowBlurJoin(vk_commands* Commands, async_compute* AsyncCompute, variance_shadow_data* ShadowData,
+                                   VkPipelineStageFlags ConsumerStages)
 {
-    *Result = {};
+    // NOTE: The acquire has to come after the wait on the compute queue, so it goes into the join buffer
+    AsyncComputeJoin(AsyncCompute, Commands);
+    AsyncComputeImageAcquire(Commands->Buffer, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, AsyncCompute->ComputeFamilyId, AsyncCompute->GraphicsFamilyId,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, ConsumerStages, VK_ACCESS_SHADER_READ_BIT);
+}
 
-    u64 HeapSize = MegaBytes(256);
-    Result->RenderTargetArena = VkLinearArenaCreate(RenderState->Device, RenderState->LocalMemoryId, HeapSize);
-    
-    ForwardSwapChainChange(Result, CreateInfo.Width, CreateInfo.Height, CreateInfo.ColorFormat, CreateInfo.Scene, OutputRtSet);
+RENDER_GRAPH_PASS_RECORD(VarianceShadowCacheRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    variance_shadow_data* ShadowData = &State->VarianceShadow;
+    variance_supersample* Supersample = &ShadowData->Supersample;
 
+    if (Supersample->Samples > 1)
     {
-        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->ShadowDescLayout);
-        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
-        VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+        RenderTargetPassBegin(&Supersample->CacheRenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+        ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, true);
+        RenderTargetPassEnd(*Commands);
     }
-    
-    // NOTE: Forward RT
+    else
     {
-        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, CreateInfo.Width, CreateInfo.Height);
-        RenderTargetAddTarget(&Builder, &Result->ColorEntry, VkClearColorCreate(0, 0, 0, 1));
-        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
-                            
-        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
-
-        u32 ColorId = VkRenderPassAttachmentAdd(&RpBuilder, Result->ColorEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        RenderTargetPassBegin(&ShadowData->Cache.RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+        ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, true);
+        RenderTargetPassEnd(*Commands);
+    }
+}
 
-        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
-        VkRenderPassColorRefAdd(&RpBuilder, ColorId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-        VkRenderPassSubPassEnd(&RpBuilder);
+RENDER_GRAPH_PASS_RECORD(VarianceShadowRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    variance_shadow_data* ShadowData = &State->VarianceShadow;
+    shadow_cache* Cache = &ShadowData->Cache;
+    variance_supersample* Supersample = &ShadowData->Supersample;
 
-        Result->ForwardRenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    if (Supersample->Samples > 1)
+    {
+        u32 SampleWidth = ShadowData->Width*Supersample->ScaleX;
+        u32 SampleHeight = ShadowData->Height*Supersample->ScaleY;
+        ShadowCacheCopy(Commands->Buffer, Supersample->CacheMomentImage, Supersample->MomentImage, VK_IMAGE_ASPECT_COLOR_BIT, SampleWidth, SampleHeight);
+        ShadowCacheCopy(Commands->Buffer, Supersample->CacheDepthImage, Supersample->DepthImage, VK_IMAGE_ASPECT_DEPTH_BIT, SampleWidth, SampleHeight);
+        RenderTargetPassBegin(&Supersample->RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+        ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, false);
+        RenderTargetPassEnd(*Commands);
+    }
+    else
+    {
+        ShadowCacheCopy(Commands->Buffer, Cache->MomentImage, ShadowData->VarianceImage, VK_IMAGE_ASPECT_COLOR_BIT, ShadowData->Width, ShadowData->Height);
+        ShadowCacheCopy(Commands->Buffer, Cache->DepthImage, ShadowData->DepthImage, VK_IMAGE_ASPECT_DEPTH_BIT, ShadowData->Width, ShadowData->Height);
+        RenderTargetPassBegin(&ShadowData->RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+        ShadowCastersDraw(Commands->Buffer, State->Frame.Scene, ShadowData->ShadowPipeline, false);
+        RenderTargetPassEnd(*Commands);
     }
-    
-    StandardShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, false, &Result->StandardShadow);
-    StandardShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, true, &Result->PcfShadow);
-    VarianceShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, &Result->VarianceShadow);
-    
-    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
 }
 
-inline void ForwardRender(vk_commands Commands, forward_state* State, render_scene* Scene, shadow_mode ShadowMode)
+RENDER_GRAPH_PASS_RECORD(VarianceShadowBlurRecord)
 {
-    render_target ShadowRenderTarget = {};
-    vk_pipeline* ShadowPipeline = {};
-    vk_pipeline* ForwardPipeline = {};
-    VkDescriptorSet ShadowDescriptor = {};
+    // NOTE: This might switch Commands over to a new command buffer if the blur went to the async compute queue
+    forward_state* State = (forward_state*)Data;
+    VarianceShadowBlur(Commands, State->Frame.AsyncCompute, &State->VarianceShadow, State->Frame.BlurConsumerStages);
+}
 
-    switch (ShadowMode)
+RENDER_GRAPH_PASS_RECORD(VarianceShadowBlurJoinRecord)
+{
+    // NOTE: Switches Commands over to the join buffer, everything recorded from here on waits on the blurs
+    forward_state* State = (forward_state*)Data;
+    VarianceShadowBlurJoin(Commands, State->Frame.AsyncCompute, &State->VarianceShadow, State->Frame.BlurConsumerStages);
+}
+
+inline void VarianceShadowPassesAdd(render_graph* Graph, forward_state* State, render_scene* Scene, render_graph_usage ConsumerUsage)
+{
+    variance_shadow_data* ShadowData = &State->VarianceShadow;
+    shadow_cache* Cache = &ShadowData->Cache;
+    variance_supersample* Supersample = &ShadowData->Supersample;
+    b32 SupersampleEnabled = Supersample->Samples > 1;
+
+    // NOTE: With supersampling the casters go into the supersampled cache/targets and the single sample moments only hold the blurred
+    // result
+    u32 CacheMomentImageId = SupersampleEnabled ? Supersample->CacheMomentImageId : Cache->MomentImageId;
+    u32 CacheDepthImageId = SupersampleEnabled ? Supersample->CacheDepthImageId : Cache->DepthImageId;
+    u32 MomentImageId = SupersampleEnabled ? Supersample->MomentImageId : ShadowData->VarianceImageId;
+    u32 DepthImageId = SupersampleEnabled ? Supersample->DepthImageId : ShadowData->DepthImageId;
+    
+    if (ShadowCacheRebuildCheck(Cache, Scene, ShadowData->Width, ShadowData->Height))
     {
-        case ShadowMode_Standard:
-        {
-            ShadowRenderTarget = State->StandardShadow.RenderTarget;
-            ShadowPipeline = State->StandardShadow.ShadowPipeline;
-            ForwardPipeline = State->StandardShadow.ForwardPipeline;
-            ShadowDescriptor = State->StandardShadow.ShadowDescriptor;
-        } break;
+        RenderGraphPassAdd(Graph, RenderGraphPass_ShadowCache, 0, VarianceShadowCacheRecord, State);
+        RenderGraphAccessAdd(Graph, CacheMomentImageId, RenderGraphUsage_ColorAttachment, RenderGraphUsage_ColorAttachment, true);
+        RenderGraphAccessAdd(Graph, CacheDepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, true);
+    }
 
-        case ShadowMode_Pcf:
-        {
-            ShadowRenderTarget = State->PcfShadow.RenderTarget;
-            ShadowPipeline = State->PcfShadow.ShadowPipeline;
-            ForwardPipeline = State->PcfShadow.ForwardPipeline;
-            ShadowDescriptor = State->PcfShadow.ShadowDescriptor;
-        } break;
+    if (Cache->OutputMatchesCache && Scene->NumDynamicOpaqueInstances == 0)
+    {
+        // NOTE: Last frames blurred moments are still correct
+        return;
+    }
 
-        case ShadowMode_Variance:
+    RenderGraphPassAdd(Graph, RenderGraphPass_Shadow, 0, VarianceShadowRecord, State);
+    RenderGraphAccessAdd(Graph, CacheMomentImageId, RenderGraphUsage_TransferSrc, RenderGraphUsage_TransferSrc, false);
+    RenderGraphAccessAdd(Graph, CacheDepthImageId, RenderGraphUsage_TransferSrc, RenderGraphUsage_TransferSrc, false);
+    RenderGraphAccessAdd(Graph, MomentImageId, RenderGraphUsage_TransferDst, RenderGraphUsage_ColorAttachment, true);
+    RenderGraphAccessAdd(Graph, DepthImageId, RenderGraphUsage_TransferDst, RenderGraphUsage_DepthAttachment, true);
+
+    // NOTE: The blurs release the moments straight to their consumer
+    State->Frame.BlurConsumerStages = RenderGraphUsageInfos[ConsumerUsage].Stages;
+    State->Frame.BlurAsync = State->Frame.AsyncCompute->Dedicated;
+    RenderGraphPassAdd(Graph, RenderGraphPass_ShadowBlur, RenderGraphPassFlag_AsyncCompute, VarianceShadowBlurRecord, State);
+    RenderGraphAccessAdd(Graph, ShadowData->VarianceImageId, RenderGraphUsage_StorageCompute, ConsumerUsage, SupersampleEnabled);
+    RenderGraphAccessAdd(Graph, ShadowData->VarianceImageId2, RenderGraphUsage_StorageCompute, RenderGraphUsage_GeneralReadCompute, true);
+    if (SupersampleEnabled)
+    {
+        RenderGraphAccessAdd(Graph, Supersample->MomentImageId, RenderGraphUsage_SampledCompute, RenderGraphUsage_SampledCompute, false);
+    }
+    
+    Cache->OutputMatchesCache = Scene->NumDynamicOpaqueInstances == 0;
+}
+
+//
+// NOTE: Clipmap Shadow Data
+//
+
+inline m4 DirectionalLightViewGet(v3 LightDir)
+{
+    v3 Up = V3(0, 1, 0);
+    f32 DotValue = Abs(Dot(Up, LightDir));
+    if (DotValue > 0.99f && DotValue < 1.01f)
+    {
+        Up = V3(1, 0, 0);
+    }
+
+    m4 Result = LookAtM4(LightDir, Up, V3(0, 0, 0));
+    return Result;
+}
+
+inline i32 ClipmapWrap(i32 Value, i32 Resolution)
+{
+    i32 Result = Value % Resolution;
+    Result = Result < 0 ? Result + Resolution : Result;
+    return Result;
+}
+
+inline clipmap_rect ClipmapRectIntersect(clipmap_rect A, clipmap_rect B)
+{
+    clipmap_rect Result = {};
+    Result.MinX = Max(A.MinX, B.MinX);
+    Result.MinY = Max(A.MinY, B.MinY);
+    Result.MaxX = Min(A.MaxX, B.MaxX);
+    Result.MaxY = Min(A.MaxY, B.MaxY);
+    return Result;
+}
+
+inline b32 ClipmapRectEmpty(clipmap_rect Rect)
+{
+    b32 Result = Rect.MinX >= Rect.MaxX || Rect.MinY >= Rect.MaxY;
+    return Result;
+}
+
+inline clipmap_rect ClipmapBoundsToRect(clipmap_bounds Bounds, f32 TexelSize)
+{
+    // NOTE: Pad by a texel so that rasterization rules never leave part of a caster behind
+    clipmap_rect Result = {};
+    Result.MinX = i32(floorf(Bounds.Min.x / TexelSize)) - 1;
+    Result.MinY = i32(floorf(Bounds.Min.y / TexelSize)) - 1;
+    Result.MaxX = i32(ceilf(Bounds.Max.x / TexelSize)) + 1;
+    Result.MaxY = i32(ceilf(Bounds.Max.y / TexelSize)) + 1;
+    return Result;
+}
+
+inline clipmap_bounds ClipmapInstanceBoundsGet(m4 LightView, m4 WTransform, render_mesh* Mesh)
+{
+    v3 LightMin = {};
+    v3 LightMax = {};
+    BoundsTransform(LightView * WTransform, Mesh->BoundsMin, Mesh->BoundsMax, &LightMin, &LightMax);
+
+    clipmap_bounds Result = {};
+    Result.Min = LightMin.xy;
+    Result.Max = LightMax.xy;
+    return Result;
+}
+
+inline void ClipmapDirtyRectAdd(clipmap_level* Level, clipmap_rect Window, clipmap_rect Rect)
+{
+    Rect = ClipmapRectIntersect(Rect, Window);
+    if (!ClipmapRectEmpty(Rect))
+    {
+        Level->DirtyRects[Level->NumDirtyRects++] = Rect;
+    }
+}
+
+inline void ClipmapCapacityResize(growable_state* Growable, clipmap_shadow_data* Clipmap, u32 MaxNumInstances)
+{
+    // NOTE: The previous dynamic rects carry over to the next frame, growing keeps them
+    u32 OldMax = Clipmap->MaxNumInstances;
+    Clipmap->InstanceBounds = GrowableArrayResizeType(Growable, Clipmap->InstanceBounds, clipmap_bounds, OldMax, MaxNumInstances);
+    Clipmap->RectInstances = GrowableArrayResizeType(Growable, Clipmap->RectInstances, u32, OldMax, MaxNumInstances);
+    for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
+    {
+        clipmap_level* Level = Clipmap->Levels + LevelId;
+
+        // NOTE: Worst case is every dynamic caster last frame + this frame + 2 exposed strips
+        u32 OldNumDirtyRects = OldMax > 0 ? 2*OldMax + 2 : 0;
+        Level->DirtyRects = GrowableArrayResizeType(Growable, Level->DirtyRects, clipmap_rect, OldNumDirtyRects, 2*MaxNumInstances + 2);
+        Level->PrevDynamicRects = GrowableArrayResizeType(Growable, Level->PrevDynamicRects, clipmap_rect, OldMax, MaxNumInstances);
+    }
+    Clipmap->MaxNumInstances = MaxNumInstances;
+}
+
+inline void ClipmapShadowCreate(u32 Resolution, f32 BaseWorldDim, f32 DepthRadius, renderer_create_info CreateInfo,
+                                render_target ForwardRenderTarget, VkDescriptorSetLayout ShadowDescLayout, clipmap_shadow_data* Result)
+{
+    *Result = {};
+
+    u64 HeapSize = MegaBytes(64);
+    Result->Arena = VkLinearArenaCreate(RenderState->Device, RenderState->LocalMemoryId, HeapSize);
+    Result->Resolution = Resolution;
+    Result->BaseWorldDim = BaseWorldDim;
+    Result->DepthRadius = DepthRadius;
+
+    // NOTE: Repeat so that lookups wrap around the toroidal window
+    Result->Sampler = VkSamplerCreate(RenderState->Device, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE, 0.0f);
+    Result->ShadowDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, ShadowDescLayout);
+    Result->GlobalsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                           VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           sizeof(clipmap_globals_gpu));
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Result->ShadowDescriptor, 2 + CLIPMAP_NUM_LEVELS,
+                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Result->GlobalsBuffer);
+
+    {
+        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->LevelDescLayout);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT);
+        VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+    }
+
+    ClipmapCapacityResize(&DemoState->Growable, Result, CreateInfo.Scene->GpuMaxNumOpaqueInstances);
+    
+    for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
+    {
+        clipmap_level* Level = Result->Levels + LevelId;
+
+        RenderTargetEntryReCreate(&Result->Arena, Resolution, Resolution, VK_FORMAT_D32_SFLOAT,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_IMAGE_ASPECT_DEPTH_BIT, &Level->ShadowImage, &Level->ShadowEntry);
+        VkDescriptorImageWrite(&RenderState->DescriptorManager, Result->ShadowDescriptor, 2 + LevelId, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                               Level->ShadowEntry.View, Result->Sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        RenderGraphImageImport(&DemoState->RenderGraph, &Level->ShadowImageId, Level->ShadowImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+        Level->UniformBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                              VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(m4));
+        Level->Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->LevelDescLayout);
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Level->Descriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Level->UniformBuffer);
+        
+        // NOTE: Level RT, only the dirty rects get cleared so we load everything else
         {
-            ShadowRenderTarget = State->VarianceShadow.RenderTarget;
-            ShadowPipeline = State->VarianceShadow.ShadowPipeline;
-            ForwardPipeline = State->VarianceShadow.ForwardPipeline;
-            ShadowDescriptor = State->VarianceShadow.ShadowDescriptor;
-        } break;
+            render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Resolution, Resolution);
+            RenderTargetAddTarget(&Builder, &Level->ShadowEntry, VkClearDepthStencilCreate(0, 0));
+                            
+            vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+            u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Level->ShadowEntry.Format, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                                    VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+            VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+            VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            VkRenderPassSubPassEnd(&RpBuilder);
+                
+            Level->RenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+        }
     }
     
-    // NOTE: Generate Directional Shadow Map
-    RenderTargetPassBegin(&ShadowRenderTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    // NOTE: Shadow PSO
+    {
+        vk_pipeline_builder Builder = VkPipelineBuilderBegin(&DemoState->TempArena);
+
+        // NOTE: Shaders
+        VkPipelineShaderAdd(&Builder, "shader_shadow_clipmap_vert.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
+                
+        // NOTE: Specify input vertex data format, depth only so we just read the position stream
+        VkPipelineVertexBindingBegin(&Builder);
+        VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
+        VkPipelineVertexBindingEnd(&Builder);
+
+        VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+        VkPipelineDepthStateAdd(&Builder, VK_TRUE, VK_TRUE, VK_COMPARE_OP_GREATER);
+
+        VkDescriptorSetLayout DescriptorLayouts[] =
+            {
+                CreateInfo.MaterialDescLayout,
+                CreateInfo.SceneDescLayout,
+                ShadowDescLayout,
+                Result->LevelDescLayout,
+            };
+            
+        Result->ShadowPipeline = VkPipelineBuilderEnd(&Builder, RenderState->Device, &RenderState->PipelineManager,
+                                                      Result->Levels[0].RenderTarget.RenderPass, 0, DescriptorLayouts,
+                                                      ArrayCount(DescriptorLayouts));
+    }
+
+    Result->ForwardPipeline = ForwardPipelineCreate("shader_forward_clipmap_vert.spv", "shader_forward_clipmap_frag.spv",
+                                                    "shader_forward_clipmap_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, false);
+    Result->ForwardPrepassPipeline = ForwardPipelineCreate("shader_forward_clipmap_vert.spv", "shader_forward_clipmap_frag.spv",
+                                                           "shader_forward_clipmap_bound_frag.spv", CreateInfo, ForwardRenderTarget, ShadowDescLayout, true);
+}
+
+inline void ClipmapShadowUpdate(clipmap_shadow_data* Clipmap, render_scene* Scene)
+{
+    Assert(Scene->NumOpaqueInstances <= Clipmap->MaxNumInstances);
+    
+    i32 Resolution = i32(Clipmap->Resolution);
+    v3 LightDir = Scene->DirectionalLight.GpuData.Dir;
+    m4 LightView = DirectionalLightViewGet(LightDir);
+    v3 CameraLightPos = (LightView * V4(Scene->Camera.Pos, 1.0f)).xyz;
+
+    // NOTE: The depth slab moves in big steps since moving it changes every stored depth value
+    f32 DepthStep = 0.5f*Clipmap->DepthRadius;
+    f32 DepthCenter = DepthStep*floorf(CameraLightPos.z / DepthStep + 0.5f);
+
+    u64 StaticKey = Scene->StaticGeneration;
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+    {
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        Clipmap->InstanceBounds[InstanceId] = ClipmapInstanceBoundsGet(LightView, CurrInstance->WTransform,
+                                                                       Scene->RenderMeshes + CurrInstance->MeshId);
+    }
+
+    b32 Invalidate = (Clipmap->LightDir.x != LightDir.x || Clipmap->LightDir.y != LightDir.y || Clipmap->LightDir.z != LightDir.z ||
+                      Clipmap->DepthCenter != DepthCenter || Clipmap->StaticKey != StaticKey);
+    Clipmap->LightDir = LightDir;
+    Clipmap->DepthCenter = DepthCenter;
+    Clipmap->StaticKey = StaticKey;
+
+    clipmap_globals_gpu* Globals = VkTransferPushWriteStruct(&RenderState->TransferManager, Clipmap->GlobalsBuffer, clipmap_globals_gpu,
+                                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                             BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    *Globals = {};
+    Globals->InvResolution = 1.0f / f32(Resolution);
+    
+    for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
     {
-        vkCmdBindPipeline(Commands.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowPipeline->Handle);
+        clipmap_level* Level = Clipmap->Levels + LevelId;
+
+        // NOTE: Snap the window to whole texels so that static shadows never shimmer
+        f32 TexelSize = Clipmap->BaseWorldDim * f32(1 << LevelId) / f32(Resolution);
+        i32 WindowX = i32(floorf(CameraLightPos.x / TexelSize)) - Resolution / 2;
+        i32 WindowY = i32(floorf(CameraLightPos.y / TexelSize)) - Resolution / 2;
+        clipmap_rect Window = { WindowX, WindowY, WindowX + Resolution, WindowY + Resolution };
+
+        Level->NumDirtyRects = 0;
+        if (Invalidate || !Level->Valid || Abs(WindowX - Level->WindowX) >= Resolution || Abs(WindowY - Level->WindowY) >= Resolution)
         {
-            VkDescriptorSet DescriptorSets[] =
+            Level->DirtyRects[Level->NumDirtyRects++] = Window;
+        }
+        else
+        {
+            // NOTE: Newly exposed columns and rows, the two strips overlap in the corner which is fine
+            if (WindowX > Level->WindowX)
+            {
+                ClipmapDirtyRectAdd(Level, Window, { Level->WindowX + Resolution, WindowY, WindowX + Resolution, WindowY + Resolution });
+            }
+            else if (WindowX < Level->WindowX)
+            {
+                ClipmapDirtyRectAdd(Level, Window, { WindowX, WindowY, Level->WindowX, WindowY + Resolution });
+            }
+            
+            if (WindowY > Level->WindowY)
+            {
+                ClipmapDirtyRectAdd(Level, Window, { WindowX, Level->WindowY + Resolution, WindowX + Resolution, WindowY + Resolution });
+            }
+            else if (WindowY < Level->WindowY)
+            {
+                ClipmapDirtyRectAdd(Level, Window, { WindowX, WindowY, WindowX + Resolution, Level->WindowY });
+            }
+
+            // NOTE: Erase dynamic casters from where they were last frame and draw them where they are now
+            for (u32 RectId = 0; RectId < Level->NumPrevDynamicRects; ++RectId)
+            {
+                ClipmapDirtyRectAdd(Level, Window, Level->PrevDynamicRects[RectId]);
+            }
+            for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+            {
+                if (!Scene->OpaqueInstances[InstanceId].Static)
                 {
-                    Scene->SceneDescriptor,
-                };
-            vkCmdBindDescriptorSets(Commands.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowPipeline->Layout, 1,
-                                    ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+                    ClipmapDirtyRectAdd(Level, Window, ClipmapBoundsToRect(Clipmap->InstanceBounds[InstanceId], TexelSize));
+                }
+            }
         }
-        
+
+        Level->NumPrevDynamicRects = 0;
         for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
         {
-            instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
-            render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+            if (!Scene->OpaqueInstances[InstanceId].Static)
+            {
+                Level->PrevDynamicRects[Level->NumPrevDynamicRects++] = ClipmapBoundsToRect(Clipmap->InstanceBounds[InstanceId], TexelSize);
+            }
+        }
+        
+        Level->Valid = true;
+        Level->TexelSize = TexelSize;
+        Level->WindowX = WindowX;
+        Level->WindowY = WindowY;
+
+        v2 WindowMin = V2(f32(WindowX), f32(WindowY)) * TexelSize;
+        v2 WindowMax = V2(f32(WindowX + Resolution), f32(WindowY + Resolution)) * TexelSize;
+        m4 Projection = VkOrthoProjM4(WindowMin.x, WindowMax.x, WindowMax.y, WindowMin.y, DepthCenter - Clipmap->DepthRadius,
+                                      DepthCenter + Clipmap->DepthRadius);
+        Level->VPTransform = Projection * LightView;
+
+        // NOTE: Figure out which way the projection maps light space onto pixels so that a absolute texel always lands in the same
+        // spot in the image
+        v4 NdcMin = Projection * V4(WindowMin, DepthCenter, 1.0f);
+        v4 NdcMax = Projection * V4(WindowMax, DepthCenter, 1.0f);
+        Level->FlipX = NdcMin.x > NdcMax.x;
+        Level->FlipY = NdcMin.y > NdcMax.y;
+        Level->OffsetX = ClipmapWrap(Level->FlipX ? -(WindowX + Resolution - 1) : WindowX, Resolution);
+        Level->OffsetY = ClipmapWrap(Level->FlipY ? -(WindowY + Resolution - 1) : WindowY, Resolution);
+
+        Globals->Levels[LevelId].VPTransform = Level->VPTransform;
+        Globals->Levels[LevelId].UvOffset = V2(f32(Level->OffsetX), f32(Level->OffsetY)) / f32(Resolution);
+
+        m4* GpuData = VkTransferPushWriteStruct(&RenderState->TransferManager, Level->UniformBuffer, m4,
+                                                BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+        *GpuData = Level->VPTransform;
+    }
+}
+
+inline void ClipmapRectRender(VkCommandBuffer CmdBuffer, clipmap_shadow_data* Clipmap, clipmap_level* Level, render_scene* Scene,
+                              clipmap_rect Rect)
+{
+    i32 Resolution = i32(Clipmap->Resolution);
+    
+    // NOTE: Convert to window pixels
+    clipmap_rect Pixels = {};
+    Pixels.MinX = Level->FlipX ? Level->WindowX + Resolution - Rect.MaxX : Rect.MinX - Level->WindowX;
+    Pixels.MaxX = Level->FlipX ? Level->WindowX + Resolution - Rect.MinX : Rect.MaxX - Level->WindowX;
+    Pixels.MinY = Level->FlipY ? Level->WindowY + Resolution - Rect.MaxY : Rect.MinY - Level->WindowY;
+    Pixels.MaxY = Level->FlipY ? Level->WindowY + Resolution - Rect.MinY : Rect.MaxY - Level->WindowY;
+
+    // NOTE: Casters under the rect come out of the BVH instead of a walk over every instance. It works in world space, so we cull with
+    // a ortho projection that covers the rect (padded by a texel, same as ClipmapBoundsToRect) and the depth slab. Done once per rect,
+    // every piece below draws the same casters
+    u32 NumInstances = 0;
+    {
+        v2 RectMin = V2(f32(Rect.MinX - 1), f32(Rect.MinY - 1)) * Level->TexelSize;
+        v2 RectMax = V2(f32(Rect.MaxX + 1), f32(Rect.MaxY + 1)) * Level->TexelSize;
+        m4 RectVP = (VkOrthoProjM4(RectMin.x, RectMax.x, RectMax.y, RectMin.y, Clipmap->DepthCenter - Clipmap->DepthRadius,
+                                   Clipmap->DepthCenter + Clipmap->DepthRadius) * DirectionalLightViewGet(Clipmap->LightDir));
+        NumInstances = SceneBvhCull(&Scene->Bvh, RectVP, Clipmap->RectInstances);
+    }
+
+    // NOTE: The window is offset into the image and wraps around, so a rect can get split into up to 4 pieces. Each piece is drawn
+    // with the viewport shifted by the offset and a scissor that keeps it inside the image
+    for (i32 WrapY = 0; WrapY < 2; ++WrapY)
+    {
+        for (i32 WrapX = 0; WrapX < 2; ++WrapX)
+        {
+            i32 ViewportX = Level->OffsetX - WrapX*Resolution;
+            i32 ViewportY = Level->OffsetY - WrapY*Resolution;
+            clipmap_rect Image = { 0, 0, Resolution, Resolution };
+            clipmap_rect Piece = { Pixels.MinX + ViewportX, Pixels.MinY + ViewportY, Pixels.MaxX + ViewportX, Pixels.MaxY + ViewportY };
+            Piece = ClipmapRectIntersect(Piece, Image);
+            if (ClipmapRectEmpty(Piece))
+            {
+                continue;
+            }
+
+            VkViewport Viewport = {};
+            Viewport.x = f32(ViewportX);
+            Viewport.y = f32(ViewportY);
+            Viewport.width = f32(Resolution);
+            Viewport.height = f32(Resolution);
+            Viewport.minDepth = 0.0f;
+            Viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(CmdBuffer, 0, 1, &Viewport);
+
+            VkRect2D Scissor = {};
+            Scissor.offset.x = Piece.MinX;
+            Scissor.offset.y = Piece.MinY;
+            Scissor.extent.width = u32(Piece.MaxX - Piece.MinX);
+            Scissor.extent.height = u32(Piece.MaxY - Piece.MinY);
+            vkCmdSetScissor(CmdBuffer, 0, 1, &Scissor);
+
+            // NOTE: Throw away what was stored here before, everything outside of the piece is kept
+            {
+                VkClearAttachment ClearAttachment = {};
+                ClearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+                ClearAttachment.clearValue.depthStencil = { 0.0f, 0 };
+
+                VkClearRect ClearRect = {};
+                ClearRect.rect = Scissor;
+                ClearRect.baseArrayLayer = 0;
+                ClearRect.layerCount = 1;
+                vkCmdClearAttachments(CmdBuffer, 1, &ClearAttachment, 1, &ClearRect);
+            }
             
-            VkDeviceSize Offset = 0;
-            vkCmdBindVertexBuffers(Commands.Buffer, 0, 1, &CurrMesh->VertexBuffer, &Offset);
-            vkCmdBindIndexBuffer(Commands.Buffer, CurrMesh->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdDrawIndexed(Commands.Buffer, CurrMesh->NumIndices, 1, 0, 0, InstanceId);
+            b32 IndexBound = false;
+            VkIndexType BoundIndexType = VK_INDEX_TYPE_UINT32;
+            for (u32 Id = 0; Id < NumInstances; ++Id)
+            {
+                u32 InstanceId = Clipmap->RectInstances[Id];
+                instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+                render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+                if (!IndexBound || CurrMesh->IndexType != BoundIndexType)
+                {
+                    GeometryIndexBufferBind(CmdBuffer, &Scene->Geometry, CurrMesh->IndexType);
+                    IndexBound = true;
+                    BoundIndexType = CurrMesh->IndexType;
+                }
+                
+                // NOTE: Each level has its own texel size so we can't use the instances shadow LOD
+                u32 LodId = MeshLodSelect(CurrMesh->Lods, CurrMesh->NumLods, MESH_LOD_SHADOW_TEXELS*Level->TexelSize / CurrInstance->Scale);
+                mesh_lod* Lod = CurrMesh->Lods + LodId;
+                vkCmdDrawIndexed(CmdBuffer, Lod->NumIndices, 1, CurrMesh->IndexOffset + Lod->FirstIndex, i32(CurrMesh->VertexOffset), InstanceId);
+            }
         }
     }
-    RenderTargetPassEnd(Commands);        
+}
 
-    if (ShadowMode == ShadowMode_Variance)
+RENDER_GRAPH_PASS_RECORD(ClipmapLevelRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    clipmap_shadow_data* Clipmap = &State->ClipmapShadow;
+    clipmap_level* Level = Clipmap->Levels + Param;
+    render_scene* Scene = State->Frame.Scene;
+    
+    // NOTE: We set the viewport and scissor per rect
+    RenderTargetPassBegin(&Level->RenderTarget, *Commands, 0);
+        
+    vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Clipmap->ShadowPipeline->Handle);
+    vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Clipmap->ShadowPipeline->Layout, 1, 1,
+                            &Scene->SceneDescriptor, 0, 0);
+    vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Clipmap->ShadowPipeline->Layout, 3, 1,
+                            &Level->Descriptor, 0, 0);
+    GeometryBind(Commands->Buffer, &Scene->Geometry, false);
+
+    for (u32 RectId = 0; RectId < Level->NumDirtyRects; ++RectId)
     {
-        RenderTargetPassBegin(&State->VarianceShadow.BlurXTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
-        FullScreenPassRender(Commands, State->VarianceShadow.BlurXPipeline, 1, &State->VarianceShadow.BlurXDescriptor);
-        RenderTargetPassEnd(Commands);
+        ClipmapRectRender(Commands->Buffer, Clipmap, Level, Scene, Level->DirtyRects[RectId]);
+    }
+        
+    RenderTargetPassEnd(*Commands);
+}
+
+inline void ClipmapShadowPassesAdd(render_graph* Graph, forward_state* State)
+{
+    // NOTE: Levels keep everything outside of their dirty rects, so the passes load. The whole window is dirty on the first frame
+    // so starting out from undefined is fine
+    clipmap_shadow_data* Clipmap = &State->ClipmapShadow;
+    for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
+    {
+        clipmap_level* Level = Clipmap->Levels + LevelId;
+        if (Level->NumDirtyRects == 0)
+        {
+            continue;
+        }
+
+        RenderGraphPassAdd(Graph, render_graph_pass_id(RenderGraphPass_ClipmapLevel0 + LevelId), 0, ClipmapLevelRecord, State, LevelId);
+        RenderGraphAccessAdd(Graph, Level->ShadowImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, false);
+    }
+}
+
+//
+// NOTE: Forward Render Data
+//
+
+inline void ForwardTransientsCreate(forward_state* State, u32 Width, u32 Height)
+{
+    // NOTE: (Re-)creates the screen sized transients, on swap chain changes and whenever the graph moved its heap. Everything here is
+    // a graph transient or owns its memory, the depth id is only zero on the first call
+    b32 ReCreate = State->DepthImageId != 0;
+    State->Width = Width;
+    State->Height = Height;
+
+    // NOTE: Render Target Data
+    {
+        // NOTE: Sampled since the occlusion pyramid gets built from it
+        RenderGraphTransientCreate(&DemoState->RenderGraph, &State->DepthImageId, Width, Height, VK_FORMAT_D32_SFLOAT,
+                                   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT,
+                                   RenderGraphPass_DepthPrepass, RenderGraphPass_Forward, &State->DepthImage, &State->DepthEntry);
+        OcclusionResize(&State->Occlusion, &DemoState->RenderGraph, Width, Height, &State->DepthEntry);
+        ShadowMaskResize(&State->ShadowMask, &DemoState->RenderGraph, Width, Height, &State->DepthEntry);
+
+        if (ReCreate)
+        {
+            RenderTargetUpdateEntries(&DemoState->TempArena, &State->ForwardRenderTarget);
+            RenderTargetUpdateEntries(&DemoState->TempArena, &State->DepthPrepassRenderTarget);
+            RenderTargetUpdateEntries(&DemoState->TempArena, &State->DepthPrepassLoadRenderTarget);
+            RenderTargetUpdateEntries(&DemoState->TempArena, &State->ForwardPrepassRenderTarget);
+        }
+    }
+        
+    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+}
+
+inline void ForwardTransientsFit(forward_state* State)
+{
+    // NOTE: Called after anything re-created transients. If the graph had to move its heap, every owner creates its transients again
+    // so that they land in the new one
+    if (RenderGraphTransientHeapFit(&DemoState->RenderGraph))
+    {
+        ForwardTransientsCreate(State, State->Width, State->Height);
+        VarianceShadowResize(&State->VarianceShadow, State->VarianceShadow.Width, State->VarianceShadow.Height);
+    }
+}
+
+inline void ForwardCreate(renderer_create_info CreateInfo, u32 ShadowWidth, u32 ShadowHeight, forward_state* Result)
+{
+    *Result = {};
+
+    Result->ColorEntry = CreateInfo.ColorEntry;
+    Result->DepthPrepassMode = DepthPrepassMode_Auto;
+    OcclusionCreate(&DemoState->Growable, &CreateInfo.Scene->Geometry, CreateInfo.Scene->GpuMaxNumOpaqueInstances,
+                    CreateInfo.Scene->MaterialBindless, &Result->Occlusion);
+
+    {
+        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->ShadowDescLayout);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+        // NOTE: Clipmap levels + clipmap globals
+        for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
+        {
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+        }
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+    }
+
+    ShadowMaskCreate(CreateInfo, Result->ShadowDescLayout, &Result->ShadowMask);
+    ForwardTransientsCreate(Result, CreateInfo.Width, CreateInfo.Height);
     
-        RenderTargetPassBegin(&State->VarianceShadow.BlurYTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
-        FullScreenPassRender(Commands, State->VarianceShadow.BlurYPipeline, 1, &State->VarianceShadow.BlurYDescriptor);
-        RenderTargetPassEnd(Commands);        
+    // NOTE: Forward RT
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, CreateInfo.Width, CreateInfo.Height);
+        RenderTargetAddTarget(&Builder, Result->ColorEntry, VkClearColorCreate(0, 0, 0, 1));
+        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        // NOTE: The color target is the swap chain image. The float -> swap chain format conversion happens on the attachment write
+        // so we don't pay for a separate copy pass. It stays in attachment layout since the UI renders on top afterwards
+        u32 ColorId = VkRenderPassAttachmentAdd(&RpBuilder, CreateInfo.ColorFormat, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassColorRefAdd(&RpBuilder, ColorId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+
+        Result->ForwardRenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+
+    // NOTE: Depth Prepass RT
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, CreateInfo.Width, CreateInfo.Height);
+        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        // NOTE: The render graph synchronizes the depth with whoever reads it next
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+        
+        Result->DepthPrepassRenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+
+    // NOTE: Depth Prepass Load RT
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, CreateInfo.Width, CreateInfo.Height);
+        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+        
+        Result->DepthPrepassLoadRenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+
+    // NOTE: Forward RT after the prepass, compatible with the forward RT so the pipelines work with both
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, CreateInfo.Width, CreateInfo.Height);
+        RenderTargetAddTarget(&Builder, Result->ColorEntry, VkClearColorCreate(0, 0, 0, 1));
+        RenderTargetAddTarget(&Builder, &Result->DepthEntry, VkClearDepthStencilCreate(0, 0));
+                            
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        u32 ColorId = VkRenderPassAttachmentAdd(&RpBuilder, CreateInfo.ColorFormat, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        u32 DepthId = VkRenderPassAttachmentAdd(&RpBuilder, Result->DepthEntry.Format, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassColorRefAdd(&RpBuilder, ColorId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderPassDepthRefAdd(&RpBuilder, DepthId, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+
+        Result->ForwardPrepassRenderTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+
+    // NOTE: Depth Prepass Pipeline
+    {
+        vk_pipeline_builder Builder = VkPipelineBuilderBegin(&DemoState->TempArena);
+
+        // NOTE: Shaders
+        VkPipelineShaderAdd(&Builder, "shader_depth_prepass_vert.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
+                
+        // NOTE: Specify input vertex data format, same position only path as the shadow pipelines
+        VkPipelineVertexBindingBegin(&Builder);
+        VkPipelineVertexAttributeAdd(&Builder, VK_FORMAT_R32G32B32_SFLOAT, sizeof(v3));
+        VkPipelineVertexBindingEnd(&Builder);
+
+        VkPipelineInputAssemblyAdd(&Builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+        VkPipelineDepthStateAdd(&Builder, VK_TRUE, VK_TRUE, VK_COMPARE_OP_GREATER);
+
+        VkDescriptorSetLayout DescriptorLayouts[] =
+            {
+                CreateInfo.MaterialDescLayout,
+                CreateInfo.SceneDescLayout,
+            };
+            
+        Result->DepthPrepassPipeline = VkPipelineBuilderEnd(&Builder, RenderState->Device, &RenderState->PipelineManager,
+                                                            Result->DepthPrepassRenderTarget.RenderPass, 0, DescriptorLayouts,
+                                                            ArrayCount(DescriptorLayouts));
+    }
+    
+    StandardShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, false, &Result->StandardShadow);
+    StandardShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, true, &Result->PcfShadow);
+    VarianceShadowCreate(ShadowWidth, ShadowHeight, CreateInfo, Result->ForwardRenderTarget, Result->ShadowDescLayout, &Result->VarianceShadow);
+    ClipmapShadowCreate(CLIPMAP_RESOLUTION, CLIPMAP_BASE_WORLD_DIM, CLIPMAP_DEPTH_RADIUS, CreateInfo, Result->ForwardRenderTarget,
+                        Result->ShadowDescLayout, &Result->ClipmapShadow);
+    Result->ShadowMask.ForwardPipeline = ForwardPipelineCreate("shader_forward_mask_vert.spv", "shader_forward_mask_frag.spv",
+                                                               "shader_forward_mask_bound_frag.spv", CreateInfo, Result->ForwardRenderTarget,
+                                                               Result->ShadowMask.ForwardDescLayout, true);
+    ForwardTransientsFit(Result);
+    
+    VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+}
+
+inline b32 ForwardDepthPrepassCheck(forward_state* State, render_scene* Scene)
+{
+    b32 Result = false;
+    switch (State->DepthPrepassMode)
+    {
+        case DepthPrepassMode_On:
+        {
+            Result = true;
+        } break;
+
+        case DepthPrepassMode_Auto:
+        {
+            Result = Scene->ForwardOverdraw >= FORWARD_PREPASS_MIN_OVERDRAW;
+        } break;
+    }
+
+    return Result;
+}
+
+inline void ForwardDrawsMaterialRender(VkCommandBuffer CmdBuffer, VkPipelineLayout Layout, render_scene* Scene, VkBuffer CommandBuffer)
+{
+    // NOTE: Not bindless, every material is its own set so draws go one at a time and rebind set 0 when the material changes. The
+    // materials come from the CPU commands, so CommandBuffer has to keep them in place (the indirect buffer or uncompacted culling)
+    geometry_buffer* Geometry = &Scene->Geometry;
+    geometry_draw_list* List = &Scene->ForwardDraws;
+    u32 BoundMaterialId = 0xFFFFFFFF;
+    b32 IndexBound = false;
+    VkIndexType BoundIndexType = VK_INDEX_TYPE_UINT32;
+    for (u32 BatchId = List->FirstBatch; BatchId < List->FirstBatch + List->NumBatches; ++BatchId)
+    {
+        geometry_draw_batch* Batch = Geometry->Batches + BatchId;
+        if (!IndexBound || Batch->IndexType != BoundIndexType)
+        {
+            GeometryIndexBufferBind(CmdBuffer, Geometry, Batch->IndexType);
+            IndexBound = true;
+            BoundIndexType = Batch->IndexType;
+        }
+
+        for (u32 CommandId = Batch->FirstCommand; CommandId < Batch->FirstCommand + Batch->NumCommands; ++CommandId)
+        {
+            u32 MaterialId = Scene->OpaqueInstances[Geometry->Commands[CommandId].firstInstance].MaterialId;
+            if (MaterialId != BoundMaterialId)
+            {
+                vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout, 0, 1, Scene->MaterialDescriptors + MaterialId, 0, 0);
+                BoundMaterialId = MaterialId;
+            }
+            GeometryCommandDraw(CmdBuffer, Geometry, CommandBuffer, CommandId);
+        }
+    }
+}
+
+inline void ForwardDrawsRender(VkCommandBuffer CmdBuffer, forward_state* State, render_scene* Scene, b32 Occlusion, occlusion_list List,
+                               VkPipelineLayout MaterialLayout = VK_NULL_HANDLE)
+{
+    // NOTE: MaterialLayout is only set when the pass samples materials and they aren't bindless. Uncompacted culling leaves every
+    // command where it was (culled ones have no instances), so those lists draw like the unculled one
+    VkBuffer CommandBuffer = Occlusion ? State->Occlusion.CommandBuffers[List].Buffer : Scene->Geometry.IndirectBuffer.Buffer;
+    if (Occlusion && State->Occlusion.Compact)
+    {
+        GeometryDrawListRenderCount(CmdBuffer, &Scene->Geometry, &Scene->ForwardDraws, CommandBuffer, State->Occlusion.CountBuffer,
+                                    sizeof(u32)*OCCLUSION_MAX_BATCHES*List);
+    }
+    else if (MaterialLayout != VK_NULL_HANDLE)
+    {
+        ForwardDrawsMaterialRender(CmdBuffer, MaterialLayout, Scene, CommandBuffer);
     }
+    else
+    {
+        GeometryDrawListRender(CmdBuffer, &Scene->Geometry, &Scene->ForwardDraws, CommandBuffer);
+    }
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardOcclusionCullRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    OcclusionCull(Commands->Buffer, &State->Occlusion, &State->Frame.Scene->ForwardDraws, b32(Param));
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardDepthPrepassRecord)
+{
+    // NOTE: The late occlusion phase loads the depth of the early phase
+    forward_state* State = (forward_state*)Data;
+    render_scene* Scene = State->Frame.Scene;
+    occlusion_list List = occlusion_list(Param);
+    render_target* RenderTarget = List == OcclusionList_Late ? &State->DepthPrepassLoadRenderTarget : &State->DepthPrepassRenderTarget;
     
-    // NOTE: Draw Meshes
-    RenderTargetPassBegin(&State->ForwardRenderTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    RenderTargetPassBegin(RenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
     {
-        vkCmdBindPipeline(Commands.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ForwardPipeline->Handle);
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, State->DepthPrepassPipeline->Handle);
         {
             VkDescriptorSet DescriptorSets[] =
                 {
                     Scene->SceneDescriptor,
-                    ShadowDescriptor,
                 };
-            vkCmdBindDescriptorSets(Commands.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ForwardPipeline->Layout, 1,
+            vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, State->DepthPrepassPipeline->Layout, 1,
                                     ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
         }
-        
-        for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+
+        GeometryBind(Commands->Buffer, &Scene->Geometry, false);
+        ForwardDrawsRender(Commands->Buffer, State, Scene, State->Frame.Occlusion, List);
+    }
+    RenderTargetPassEnd(*Commands);
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardOcclusionPyramidRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    OcclusionPyramidBuild(Commands->Buffer, &State->Occlusion);
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardShadowMaskRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    ShadowMaskRender(Commands->Buffer, &State->ShadowMask, State->Frame.Scene, State->Frame.ShadowMode, State->Frame.ShadowDescriptor);
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardRecord)
+{
+    forward_state* State = (forward_state*)Data;
+    forward_frame* Frame = &State->Frame;
+    render_scene* Scene = Frame->Scene;
+    
+    RenderTargetPassBegin(Frame->ForwardRenderTarget, *Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    {
+        vkCmdBindPipeline(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Frame->ForwardPipeline->Handle);
         {
-            instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
-            render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+            VkDescriptorSet DescriptorSets[] =
+                {
+                    Scene->MaterialDescriptor,
+                    Scene->SceneDescriptor,
+                    Frame->ForwardDescriptor,
+                };
+            // NOTE: Per material sets get bound by the draws
+            u32 FirstSet = Scene->MaterialBindless ? 0 : 1;
+            vkCmdBindDescriptorSets(Commands->Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Frame->ForwardPipeline->Layout, FirstSet,
+                                    ArrayCount(DescriptorSets) - FirstSet, DescriptorSets + FirstSet, 0, 0);
+        }
+
+        GeometryBind(Commands->Buffer, &Scene->Geometry, true);
+        ForwardDrawsRender(Commands->Buffer, State, Scene, Frame->Occlusion, OcclusionList_Final,
+                           Scene->MaterialBindless ? VK_NULL_HANDLE : Frame->ForwardPipeline->Layout);
+    }
+    RenderTargetPassEnd(*Commands);
+}
+
+RENDER_GRAPH_PASS_RECORD(ForwardTimestampRecord)
+{
+    REGRESSION_TIMESTAMP(Commands->Buffer, regression_timestamp(Param));
+}
 
+inline void ForwardTimestampAdd(render_graph* Graph, render_graph_pass_id Id, regression_timestamp Timestamp)
+{
+#if SHADOW_REGRESSION
+    RenderGraphPassAdd(Graph, Id, RenderGraphPassFlag_SideEffect, ForwardTimestampRecord, 0, Timestamp);
+#endif
+}
+
+inline void ForwardShadowReadsAdd(render_graph* Graph, forward_state* State, shadow_mode ShadowMode, render_graph_usage Usage)
+{
+    switch (ShadowMode)
+    {
+        case ShadowMode_Standard:
+        {
+            RenderGraphAccessAdd(Graph, State->StandardShadow.ShadowImageId, Usage, Usage, false);
+        } break;
+
+        case ShadowMode_Pcf:
+        {
+            RenderGraphAccessAdd(Graph, State->PcfShadow.ShadowImageId, Usage, Usage, false);
+        } break;
+
+        case ShadowMode_Variance:
+        {
+            RenderGraphAccessAdd(Graph, State->VarianceShadow.VarianceImageId, Usage, Usage, false);
+        } break;
+
+        case ShadowMode_Clipmap:
+        {
+            for (u32 LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
             {
-                VkDescriptorSet DescriptorSets[] =
-                    {
-                        CurrMesh->MaterialDescriptor,
-                    };
-                vkCmdBindDescriptorSets(Commands.Buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ForwardPipeline->Layout, 0,
-                                        ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+                RenderGraphAccessAdd(Graph, State->ClipmapShadow.Levels[LevelId].ShadowImageId, Usage, Usage, false);
             }
-            
-            VkDeviceSize Offset = 0;
-            vkCmdBindVertexBuffers(Commands.Buffer, 0, 1, &CurrMesh->VertexBuffer, &Offset);
-            vkCmdBindIndexBuffer(Commands.Buffer, CurrMesh->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdDrawIndexed(Commands.Buffer, CurrMesh->NumIndices, 1, 0, 0, InstanceId);
+        } break;
+    }
+}
+
+inline void ForwardRender(render_graph* Graph, async_compute* AsyncCompute, forward_state* State, render_scene* Scene,
+                          shadow_mode ShadowMode)
+{
+    forward_frame* Frame = &State->Frame;
+    *Frame = {};
+    Frame->Scene = Scene;
+    Frame->AsyncCompute = AsyncCompute;
+    Frame->ShadowMode = ShadowMode;
+    Frame->Occlusion = State->Occlusion.Supported && State->Occlusion.Enabled;
+    Frame->ForwardRenderTarget = &State->ForwardRenderTarget;
+    
+    // NOTE: The shadow mask is resolved from the prepass depth
+    b32 ShadowMask = State->ShadowMask.Mode != ShadowMaskMode_Off && ShadowMode != ShadowMode_None;
+    State->DepthPrepassActive = Frame->Occlusion || ShadowMask || ForwardDepthPrepassCheck(State, Scene);
+    render_graph_usage ShadowUsage = ShadowMask ? RenderGraphUsage_SampledCompute : RenderGraphUsage_SampledFragment;
+
+    // NOTE: Generate Directional Shadow Map
+    vk_pipeline* ForwardPrepassPipeline = {};
+    switch (ShadowMode)
+    {
+        case ShadowMode_Standard:
+        {
+            StandardShadowPassesAdd(Graph, State, &State->StandardShadow, Scene);
+            Frame->ForwardPipeline = State->StandardShadow.ForwardPipeline;
+            ForwardPrepassPipeline = State->StandardShadow.ForwardPrepassPipeline;
+            Frame->ShadowDescriptor = State->StandardShadow.ShadowDescriptor;
+        } break;
+
+        case ShadowMode_Pcf:
+        {
+            StandardShadowPassesAdd(Graph, State, &State->PcfShadow, Scene);
+            Frame->ForwardPipeline = State->PcfShadow.ForwardPipeline;
+            ForwardPrepassPipeline = State->PcfShadow.ForwardPrepassPipeline;
+            Frame->ShadowDescriptor = State->PcfShadow.ShadowDescriptor;
+        } break;
+
+        case ShadowMode_Variance:
+        {
+            VarianceShadowPassesAdd(Graph, State, Scene, ShadowUsage);
+            Frame->ForwardPipeline = State->VarianceShadow.ForwardPipeline;
+            ForwardPrepassPipeline = State->VarianceShadow.ForwardPrepassPipeline;
+            Frame->ShadowDescriptor = State->VarianceShadow.ShadowDescriptor;
+        } break;
+
+        case ShadowMode_Clipmap:
+        {
+            ClipmapShadowPassesAdd(Graph, State);
+            Frame->ForwardPipeline = State->ClipmapShadow.ForwardPipeline;
+            ForwardPrepassPipeline = State->ClipmapShadow.ForwardPrepassPipeline;
+            Frame->ShadowDescriptor = State->ClipmapShadow.ShadowDescriptor;
+        } break;
+    }
+    Frame->ForwardDescriptor = Frame->ShadowDescriptor;
+    ForwardTimestampAdd(Graph, RenderGraphPass_ShadowTimestamp, RegressionTimestamp_ShadowEnd);
+
+    // NOTE: Occlusion culling writes untracked buffers (draw commands, visibility), so the culls are side effects
+    occlusion_culling* Occlusion = &State->Occlusion;
+    if (Frame->Occlusion)
+    {
+        // NOTE: Early phase draws last frames visible set, the late phase adds what became visible against its pyramid
+        RenderGraphPassAdd(Graph, RenderGraphPass_OcclusionCullEarly, RenderGraphPassFlag_SideEffect, ForwardOcclusionCullRecord, State, false);
+
+        RenderGraphPassAdd(Graph, RenderGraphPass_DepthPrepass, 0, ForwardDepthPrepassRecord, State, OcclusionList_Early);
+        RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, true);
+
+        RenderGraphPassAdd(Graph, RenderGraphPass_OcclusionPyramid, 0, ForwardOcclusionPyramidRecord, State);
+        RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthReadCompute, RenderGraphUsage_DepthReadCompute, false);
+        for (u32 LevelId = 0; LevelId < Occlusion->NumLevels; ++LevelId)
+        {
+            RenderGraphAccessAdd(Graph, Occlusion->Levels[LevelId].ImageId, RenderGraphUsage_StorageCompute,
+                                 RenderGraphUsage_GeneralReadCompute, true);
         }
+
+        RenderGraphPassAdd(Graph, RenderGraphPass_OcclusionCullLate, RenderGraphPassFlag_SideEffect, ForwardOcclusionCullRecord, State, true);
+        for (u32 LevelId = 0; LevelId < Occlusion->NumLevels; ++LevelId)
+        {
+            RenderGraphAccessAdd(Graph, Occlusion->Levels[LevelId].ImageId, RenderGraphUsage_GeneralReadCompute,
+                                 RenderGraphUsage_GeneralReadCompute, false);
+        }
+
+        RenderGraphPassAdd(Graph, RenderGraphPass_DepthPrepassLate, 0, ForwardDepthPrepassRecord, State, OcclusionList_Late);
+        RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, false);
+    }
+    else if (State->DepthPrepassActive)
+    {
+        RenderGraphPassAdd(Graph, RenderGraphPass_DepthPrepass, 0, ForwardDepthPrepassRecord, State, OcclusionList_Final);
+        RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment, true);
+    }
+    ForwardTimestampAdd(Graph, RenderGraphPass_PrepassTimestamp, RegressionTimestamp_PrepassEnd);
+
+    // NOTE: The prepass and occlusion culling don't touch the shadow map, they run on the graphics queue while the blurs run on the
+    // compute queue. The join submits them and makes the rest of the frame wait on the blurs. The graph already has the moments in
+    // their consumer state, this only does the ownership acquire
+    if (Frame->BlurAsync)
+    {
+        RenderGraphPassAdd(Graph, RenderGraphPass_AsyncComputeJoin, RenderGraphPassFlag_SideEffect, VarianceShadowBlurJoinRecord, State);
+    }
+    
+    if (State->DepthPrepassActive)
+    {
+        Frame->ForwardRenderTarget = &State->ForwardPrepassRenderTarget;
+        Frame->ForwardPipeline = ForwardPrepassPipeline;
+    }
+
+    if (ShadowMask)
+    {
+        shadow_mask* Mask = &State->ShadowMask;
+        // NOTE: The history images aren't tracked by the graph, the pass writes them for the next frame
+        RenderGraphPassAdd(Graph, RenderGraphPass_ShadowMask, RenderGraphPassFlag_SideEffect, ForwardShadowMaskRecord, State);
+        ForwardShadowReadsAdd(Graph, State, ShadowMode, RenderGraphUsage_SampledCompute);
+        RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthReadCompute, RenderGraphUsage_DepthReadCompute, false);
+        RenderGraphAccessAdd(Graph, Mask->FullMaskImageId, RenderGraphUsage_StorageCompute, RenderGraphUsage_StorageCompute, true);
+        if (Mask->Mode == ShadowMaskMode_Half)
+        {
+            RenderGraphAccessAdd(Graph, Mask->HalfMaskImageId, RenderGraphUsage_StorageCompute, RenderGraphUsage_GeneralReadCompute, true);
+            RenderGraphAccessAdd(Graph, Mask->HalfDepthImageId, RenderGraphUsage_StorageCompute, RenderGraphUsage_GeneralReadCompute, true);
+        }
+        
+        Frame->ForwardPipeline = Mask->ForwardPipeline;
+        Frame->ForwardDescriptor = Mask->ForwardDescriptor;
+    }
+    ForwardTimestampAdd(Graph, RenderGraphPass_ShadowMaskTimestamp, RegressionTimestamp_ShadowMaskEnd);
+
+    // NOTE: Draw Meshes, the swap chain isn't tracked so the forward pass is a side effect
+    RenderGraphPassAdd(Graph, RenderGraphPass_Forward, RenderGraphPassFlag_SideEffect, ForwardRecord, State);
+    if (ShadowMask)
+    {
+        RenderGraphAccessAdd(Graph, State->ShadowMask.FullMaskImageId, RenderGraphUsage_GeneralReadFragment,
+                             RenderGraphUsage_GeneralReadFragment, false);
+    }
+    else
+    {
+        ForwardShadowReadsAdd(Graph, State, ShadowMode, RenderGraphUsage_SampledFragment);
     }
-    RenderTargetPassEnd(Commands);        
+    RenderGraphAccessAdd(Graph, State->DepthImageId, RenderGraphUsage_DepthAttachment, RenderGraphUsage_DepthAttachment,
+                         !State->DepthPrepassActive);
+    ForwardTimestampAdd(Graph, RenderGraphPass_ForwardTimestamp, RegressionTimestamp_ForwardEnd);
 }
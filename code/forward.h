@@ -1,5 +1,37 @@
 #pragma once
 
+/*
+
+  NOTE: Shadow Caching
+
+    Most casters don't move and neither does the light, so static casters get rendered once into a cache that is only rebuilt when
+    the key (light transform, resolution, static instance set) changes. Every frame we copy the cache into the live shadow map and
+    only draw the dynamic casters on top. If there are no dynamic casters and the live map already holds the cache, we skip the shadow
+    work entirely (including the VSM blurs).
+
+    The light transform comes from the camera fit, which snaps the origin and depth range to whole texels and the texel size to
+    1/SHADOW_FIT_TEXEL_STEPS power of 2 steps. The key hashes those snapped integers (shadow_fit), so it only changes when the light
+    volume moved a texel or the visible part of the scene changed size, not on every camera move.
+  
+ */
+
+struct shadow_cache
+{
+    b32 Valid;
+    u64 Key;
+    // NOTE: True when the live shadow map holds exactly the cached static casters
+    b32 OutputMatchesCache;
+    
+    VkImage DepthImage;
+    render_target_entry DepthEntry;
+    u32 DepthImageId;
+    // NOTE: Only used by variance shadows, holds the unblurred static moments
+    VkImage MomentImage;
+    render_target_entry MomentEntry;
+    u32 MomentImageId;
+    render_target RenderTarget;
+};
+
 struct standard_shadow_data
 {
     vk_linear_arena Arena;
@@ -9,13 +41,67 @@ struct standard_shadow_data
     VkSampler Sampler;
     VkImage ShadowImage;
     render_target_entry ShadowEntry;
+    u32 ShadowImageId;
+    // NOTE: Loads the cached static casters and draws the dynamic casters on top
     render_target RenderTarget;
+    shadow_cache Cache;
     vk_pipeline* ShadowPipeline;
     vk_pipeline* ForwardPipeline;
+    // NOTE: Depth test EQUAL without writes, used after the depth prepass
+    vk_pipeline* ForwardPrepassPipeline;
 
     VkDescriptorSet ShadowDescriptor;
 };
 
+/*
+
+  NOTE: Supersampled Variance Shadows
+
+    Moments are linear, so averaging them over a texel gives the moments of the whole texel. With Samples > 1 the casters get
+    rasterized into moment/depth targets that are ScaleX*ScaleY times the size of the shadow map (2x2 for 4 samples, 4x2 for 8) and
+    Blur X averages the samples of each tap while it blurs (a custom resolve), so there is no separate resolve pass or resolved image.
+    The extra edge coverage lets a lower base resolution look as good as a higher single sample one.
+
+    The targets are plain single sample images, so they go through the same render pass builder and share the shadow pipeline with
+    the single sample path. That keeps them under the pipeline manager and shader hot reload. Unlike MSAA the fragment shader runs
+    per sample, the variance one only writes depth and depth squared so that is cheap next to the rasterization. The live targets
+    are render graph transients.
+  
+ */
+
+// NOTE: Supersampled cache at 8 samples of the 1024x1024 the UI goes up to, 12 bytes a sample
+#define VARIANCE_SUPERSAMPLE_ARENA_SIZE MegaBytes(100)
+
+struct variance_supersample
+{
+    u32 Samples;
+    u32 ScaleX;
+    u32 ScaleY;
+
+    // NOTE: Supersampled version of the shadow cache, the arena gets created the first time supersampling is on
+    b32 Created;
+    vk_linear_arena Arena;
+    VkImage CacheMomentImage;
+    render_target_entry CacheMomentEntry;
+    u32 CacheMomentImageId;
+    VkImage CacheDepthImage;
+    render_target_entry CacheDepthEntry;
+    u32 CacheDepthImageId;
+    render_target CacheRenderTarget;
+
+    // NOTE: Transient, the moments have to stay alive until Blur X resolved them
+    VkImage MomentImage;
+    render_target_entry MomentEntry;
+    u32 MomentImageId;
+    VkImage DepthImage;
+    render_target_entry DepthEntry;
+    u32 DepthImageId;
+    render_target RenderTarget;
+
+    VkDescriptorSet BlurXDescriptor;
+    vk_pipeline* BlurXPipeline;
+};
+
 struct variance_shadow_data
 {
     vk_linear_arena Arena;
@@ -24,27 +110,166 @@ struct variance_shadow_data
     u32 Height;
     VkSampler Sampler;
 
+    // NOTE: Transient, only needed while the dynamic casters get drawn
     VkImage DepthImage;
     render_target_entry DepthEntry;
+    u32 DepthImageId;
     VkImage VarianceImage;
     render_target_entry VarianceEntry;
-    // NOTE: For blurring to ping pong with
+    u32 VarianceImageId;
+    // NOTE: For blurring to ping pong with, transient
     VkImage VarianceImage2;
     render_target_entry VarianceEntry2; 
+    u32 VarianceImageId2;
+    // NOTE: Loads the cached static casters and draws the dynamic casters on top
     render_target RenderTarget;
+    shadow_cache Cache;
     vk_pipeline* ShadowPipeline;
     vk_pipeline* ForwardPipeline;
+    // NOTE: Depth test EQUAL without writes, used after the depth prepass
+    vk_pipeline* ForwardPrepassPipeline;
 
     VkDescriptorSet ShadowDescriptor;
 
-    
+    // NOTE: Blurs run as compute so that they can go on the async compute queue
     VkDescriptorSetLayout BlurDescLayout;
     VkDescriptorSet BlurXDescriptor;
     VkDescriptorSet BlurYDescriptor;
-    render_target BlurXTarget;
-    render_target BlurYTarget;
     vk_pipeline* BlurXPipeline;
     vk_pipeline* BlurYPipeline;
+
+    variance_supersample Supersample;
+};
+
+/*
+
+  NOTE: Clipmap Shadows
+
+    Each level is a square window of the light space plane centered on the camera. Level N covers twice the world extent of level N - 1
+    at the same resolution. Windows only move in whole texel steps and are addressed toroidally (a texel at absolute light space
+    position A always lives at A mod Resolution), so when the camera moves we only re-render the strips that got exposed, plus the area
+    dynamic casters covered last frame and cover now. Everything else is loaded from the previous frame. The light direction, the depth
+    slab and the static caster set invalidate all levels when they change.
+  
+ */
+
+#define CLIPMAP_NUM_LEVELS 4
+#define CLIPMAP_RESOLUTION 1024
+// NOTE: World extent of level 0, every level after it covers twice the one before
+#define CLIPMAP_BASE_WORLD_DIM 16.0f
+// NOTE: Half the depth of the light space slab the levels store, casters outside of it get clipped
+#define CLIPMAP_DEPTH_RADIUS 64.0f
+
+// NOTE: Half open rect in absolute light space texels of a level
+struct clipmap_rect
+{
+    i32 MinX;
+    i32 MinY;
+    i32 MaxX;
+    i32 MaxY;
+};
+
+// NOTE: Light space xy bounds of a instance
+struct clipmap_bounds
+{
+    v2 Min;
+    v2 Max;
+};
+
+struct clipmap_level_gpu
+{
+    m4 VPTransform;
+    v2 UvOffset;
+    v2 Pad;
+};
+
+struct clipmap_globals_gpu
+{
+    clipmap_level_gpu Levels[CLIPMAP_NUM_LEVELS];
+    f32 InvResolution;
+};
+
+struct clipmap_level
+{
+    VkImage ShadowImage;
+    render_target_entry ShadowEntry;
+    u32 ShadowImageId;
+    render_target RenderTarget;
+
+    VkBuffer UniformBuffer;
+    VkDescriptorSet Descriptor;
+
+    b32 Valid;
+    f32 TexelSize;
+    // NOTE: Absolute texel of the windows min corner
+    i32 WindowX;
+    i32 WindowY;
+    // NOTE: Set when the ortho projection maps increasing light space coordinates to decreasing pixel coordinates
+    b32 FlipX;
+    b32 FlipY;
+    // NOTE: Where window pixel 0 lands in the image
+    i32 OffsetX;
+    i32 OffsetY;
+    m4 VPTransform;
+
+    u32 NumDirtyRects;
+    clipmap_rect* DirtyRects;
+    u32 NumPrevDynamicRects;
+    clipmap_rect* PrevDynamicRects;
+};
+
+struct clipmap_shadow_data
+{
+    vk_linear_arena Arena;
+
+    u32 Resolution;
+    f32 BaseWorldDim;
+    f32 DepthRadius;
+    VkSampler Sampler;
+    clipmap_level Levels[CLIPMAP_NUM_LEVELS];
+
+    VkDescriptorSetLayout LevelDescLayout;
+    VkBuffer GlobalsBuffer;
+
+    // NOTE: Invalidate all levels when they change
+    v3 LightDir;
+    f32 DepthCenter;
+    u64 StaticKey;
+
+    u32 MaxNumInstances;
+    clipmap_bounds* InstanceBounds;
+    // NOTE: Scratch for the casters under a dirty rect
+    u32* RectInstances;
+    
+    vk_pipeline* ShadowPipeline;
+    vk_pipeline* ForwardPipeline;
+    // NOTE: Depth test EQUAL without writes, used after the depth prepass
+    vk_pipeline* ForwardPrepassPipeline;
+
+    VkDescriptorSet ShadowDescriptor;
+};
+
+/*
+
+  NOTE: Depth Prepass
+
+    The forward shaders do the full shadow lookup + lighting, so every overdrawn pixel pays for it multiple times. With the prepass we
+    first draw the forward draw list position only into DepthEntry, then the forward pipelines test EQUAL without writing depth so
+    every pixel gets shaded exactly once. Both vertex shaders compute gl_Position with the same expression and mark it invariant,
+    otherwise EQUAL would reject pixels.
+
+    The prepass pays for itself when the scene has real depth complexity, in auto mode we estimate it from the projected bounding
+    spheres of the visible instances (see SceneLodSelect) and only run the prepass above FORWARD_PREPASS_MIN_OVERDRAW.
+  
+ */
+
+#define FORWARD_PREPASS_MIN_OVERDRAW 2.0f
+
+enum depth_prepass_mode
+{
+    DepthPrepassMode_Off,
+    DepthPrepassMode_On,
+    DepthPrepassMode_Auto,
 };
 
 enum shadow_mode
@@ -54,21 +279,61 @@ enum shadow_mode
     ShadowMode_Standard,
     ShadowMode_Pcf,
     ShadowMode_Variance,
+    ShadowMode_Clipmap,
 };
 
-struct forward_state
+// NOTE: What the pass record callbacks of this frame need, filled in by ForwardRender
+struct forward_frame
 {
-    vk_linear_arena RenderTargetArena;
+    render_scene* Scene;
+    async_compute* AsyncCompute;
+    shadow_mode ShadowMode;
+    standard_shadow_data* StandardShadow;
+    b32 Occlusion;
+    // NOTE: The shadow set of the current mode, the forward pass binds ForwardDescriptor (the mask replaces it)
+    VkDescriptorSet ShadowDescriptor;
+    vk_pipeline* ForwardPipeline;
+    VkDescriptorSet ForwardDescriptor;
+    render_target* ForwardRenderTarget;
+    // NOTE: Who samples the shadow map after the blurs
+    VkPipelineStageFlags BlurConsumerStages;
+    // NOTE: The blurs went to the async compute queue and their consumers have to join them
+    b32 BlurAsync;
+};
 
+struct forward_state
+{
     standard_shadow_data StandardShadow;
     standard_shadow_data PcfShadow;
     variance_shadow_data VarianceShadow;
+    clipmap_shadow_data ClipmapShadow;
 
-    VkImage ColorImage;
-    render_target_entry ColorEntry;
+    // NOTE: We render straight into the swap chain so there is no intermediate color image to copy from
+    render_target_entry* ColorEntry;
+    // NOTE: Size of the screen sized transients, see ForwardTransientsCreate
+    u32 Width;
+    u32 Height;
+    // NOTE: Transient, lives from the depth prepass to the forward pass
     VkImage DepthImage;
     render_target_entry DepthEntry;
+    u32 DepthImageId;
     render_target ForwardRenderTarget;
 
+    depth_prepass_mode DepthPrepassMode;
+    b32 DepthPrepassActive;
+    render_target DepthPrepassRenderTarget;
+    // NOTE: Loads the early occlusion phase depth for the late phase draws
+    render_target DepthPrepassLoadRenderTarget;
+    // NOTE: Same as the forward RT but it loads the prepass depth instead of clearing it
+    render_target ForwardPrepassRenderTarget;
+    vk_pipeline* DepthPrepassPipeline;
+
+    // NOTE: Forces the depth prepass since the pyramid is built from it
+    occlusion_culling Occlusion;
+    // NOTE: Also forces the depth prepass, the mask is resolved from it
+    shadow_mask ShadowMask;
+
     VkDescriptorSetLayout ShadowDescLayout;
+
+    forward_frame Frame;
 };
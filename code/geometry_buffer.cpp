@@ -0,0 +1,524 @@
+
+//
+// NOTE: Geometry Allocator
+//
+
+inline void GeometryAllocatorCreate(growable_state* Growable, u32 Size, geometry_allocator* Result)
+{
+    *Result = {};
+    Result->Size = Size;
+    Result->MaxNumFreeBlocks = GrowableCapacityGet(0, 1);
+    Result->FreeBlocks = GrowableArrayResizeType(Growable, Result->FreeBlocks, geometry_block, 0, Result->MaxNumFreeBlocks);
+    Result->NumFreeBlocks = 1;
+    Result->FreeBlocks[0].Offset = 0;
+    Result->FreeBlocks[0].Size = Size;
+}
+
+inline b32 GeometryAllocate(geometry_allocator* Allocator, u32 Size, u32* Offset)
+{
+    for (u32 BlockId = 0; BlockId < Allocator->NumFreeBlocks; ++BlockId)
+    {
+        geometry_block* Block = Allocator->FreeBlocks + BlockId;
+        if (Block->Size < Size)
+        {
+            continue;
+        }
+
+        *Offset = Block->Offset;
+        Block->Offset += Size;
+        Block->Size -= Size;
+        if (Block->Size == 0)
+        {
+            for (u32 MoveId = BlockId; MoveId < Allocator->NumFreeBlocks - 1; ++MoveId)
+            {
+                Allocator->FreeBlocks[MoveId] = Allocator->FreeBlocks[MoveId + 1];
+            }
+            Allocator->NumFreeBlocks -= 1;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+inline void GeometryFree(geometry_allocator* Allocator, u32 Offset, u32 Size)
+{
+    if (Size == 0)
+    {
+        return;
+    }
+
+    // NOTE: Find the first free block after us
+    u32 InsertId = 0;
+    while (InsertId < Allocator->NumFreeBlocks && Allocator->FreeBlocks[InsertId].Offset < Offset)
+    {
+        InsertId += 1;
+    }
+
+    geometry_block* Prev = InsertId > 0 ? Allocator->FreeBlocks + InsertId - 1 : 0;
+    geometry_block* Next = InsertId < Allocator->NumFreeBlocks ? Allocator->FreeBlocks + InsertId : 0;
+    Assert(!Prev || Prev->Offset + Prev->Size <= Offset);
+    Assert(!Next || Offset + Size <= Next->Offset);
+
+    b32 MergePrev = Prev && Prev->Offset + Prev->Size == Offset;
+    b32 MergeNext = Next && Offset + Size == Next->Offset;
+    if (MergePrev && MergeNext)
+    {
+        Prev->Size += Size + Next->Size;
+        for (u32 MoveId = InsertId; MoveId < Allocator->NumFreeBlocks - 1; ++MoveId)
+        {
+            Allocator->FreeBlocks[MoveId] = Allocator->FreeBlocks[MoveId + 1];
+        }
+        Allocator->NumFreeBlocks -= 1;
+    }
+    else if (MergePrev)
+    {
+        Prev->Size += Size;
+    }
+    else if (MergeNext)
+    {
+        Next->Offset = Offset;
+        Next->Size += Size;
+    }
+    else
+    {
+        // NOTE: Every live allocation can split at most one free block, so this only grows with the number of meshes
+        if (Allocator->NumFreeBlocks == Allocator->MaxNumFreeBlocks)
+        {
+            u32 NewMaxNumFreeBlocks = GrowableCapacityGet(Allocator->MaxNumFreeBlocks, Allocator->NumFreeBlocks + 1);
+            Allocator->FreeBlocks = GrowableArrayResizeType(&DemoState->Growable, Allocator->FreeBlocks, geometry_block,
+                                                            Allocator->MaxNumFreeBlocks, NewMaxNumFreeBlocks);
+            Allocator->MaxNumFreeBlocks = NewMaxNumFreeBlocks;
+            DemoState->Growable.NumGrows += 1;
+        }
+        
+        for (u32 MoveId = Allocator->NumFreeBlocks; MoveId > InsertId; --MoveId)
+        {
+            Allocator->FreeBlocks[MoveId] = Allocator->FreeBlocks[MoveId - 1];
+        }
+        Allocator->FreeBlocks[InsertId].Offset = Offset;
+        Allocator->FreeBlocks[InsertId].Size = Size;
+        Allocator->NumFreeBlocks += 1;
+    }
+}
+
+//
+// NOTE: Geometry Buffer
+//
+
+inline void GeometryCommandsResize(growable_state* Growable, geometry_buffer* Geometry, u32 MaxNumCommands)
+{
+    // NOTE: Commands get rebuilt and re-uploaded every frame, so the indirect buffer doesn't have to keep its contents
+    u32 OldMax = Geometry->MaxNumCommands;
+    Geometry->Commands = GrowableArrayResizeType(Growable, Geometry->Commands, VkDrawIndexedIndirectCommand, OldMax, MaxNumCommands);
+    Geometry->Batches = GrowableArrayResizeType(Growable, Geometry->Batches, geometry_draw_batch, OldMax, MaxNumCommands);
+    Geometry->SortKeys = GrowableArrayResizeType(Growable, Geometry->SortKeys, u64, OldMax, MaxNumCommands);
+    Geometry->SortValues = GrowableArrayResizeType(Growable, Geometry->SortValues, u32, OldMax, MaxNumCommands);
+    Geometry->SortKeysTemp = GrowableArrayResizeType(Growable, Geometry->SortKeysTemp, u64, OldMax, MaxNumCommands);
+    Geometry->SortValuesTemp = GrowableArrayResizeType(Growable, Geometry->SortValuesTemp, u32, OldMax, MaxNumCommands);
+    // NOTE: Storage usage so that occlusion culling can read the commands
+    GrowableBufferResize(Growable, VK_NULL_HANDLE, &Geometry->IndirectBuffer,
+                         VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         sizeof(VkDrawIndexedIndirectCommand)*u64(MaxNumCommands), false);
+    Geometry->MaxNumCommands = MaxNumCommands;
+}
+
+inline u32 GeometryCapacityClamp(u64 NumElements, u64 ElementSize)
+{
+    // NOTE: Offsets are u32 element counts (vertexOffset even an i32), and a single buffer has to fit one allocation
+    u64 MaxNumElements = Min(u64(0x7FFFFFFF), u64(GEOMETRY_MAX_BUFFER_SIZE) / ElementSize);
+    u32 Result = u32(Min(NumElements, MaxNumElements));
+    return Result;
+}
+
+inline void GeometryBufferCreate(growable_state* Growable, u64 RequestedNumVertices, u64 RequestedNumIndices16, u64 RequestedNumIndices32,
+                                 u32 MaxNumCommands, geometry_buffer* Result)
+{
+    *Result = {};
+
+    // NOTE: Requests past what a buffer can hold get clamped, the meshes that don't fit anymore fail to add like in any full buffer
+    u32 MaxNumVertices = GeometryCapacityClamp(RequestedNumVertices, Max(u64(sizeof(v3)), u64(sizeof(mesh_vertex_attributes))));
+    u32 MaxNumIndices16 = GeometryCapacityClamp(RequestedNumIndices16, sizeof(u16));
+    u32 MaxNumIndices32 = GeometryCapacityClamp(RequestedNumIndices32, sizeof(u32));
+    GeometryAllocatorCreate(Growable, MaxNumVertices, &Result->VertexAllocator);
+    GeometryAllocatorCreate(Growable, MaxNumIndices16, &Result->Index16Allocator);
+    GeometryAllocatorCreate(Growable, MaxNumIndices32, &Result->Index32Allocator);
+
+    Result->PositionBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(v3)*MaxNumVertices);
+    Result->AttributeBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                             sizeof(mesh_vertex_attributes)*MaxNumVertices);
+    Result->Index16Buffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           sizeof(u16)*MaxNumIndices16);
+    Result->Index32Buffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           sizeof(u32)*MaxNumIndices32);
+
+    Result->MultiDrawIndirect = DemoState->DeviceCaps.MultiDrawIndirect;
+    Result->IndirectFirstInstance = DemoState->DeviceCaps.DrawIndirectFirstInstance;
+
+    GeometryCommandsResize(Growable, Result, MaxNumCommands);
+}
+
+inline b32 GeometryMeshAllocate(geometry_buffer* Geometry, u32 NumVertices, u32 NumIndices, render_mesh* RenderMesh)
+{
+    RenderMesh->IndexType = NumVertices <= 0x10000 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    RenderMesh->NumVertices = NumVertices;
+    RenderMesh->NumIndices = NumIndices;
+
+    if (!GeometryAllocate(&Geometry->VertexAllocator, NumVertices, &RenderMesh->VertexOffset))
+    {
+        return false;
+    }
+    
+    geometry_allocator* IndexAllocator = (RenderMesh->IndexType == VK_INDEX_TYPE_UINT16 ?
+                                          &Geometry->Index16Allocator : &Geometry->Index32Allocator);
+    if (!GeometryAllocate(IndexAllocator, NumIndices, &RenderMesh->IndexOffset))
+    {
+        GeometryFree(&Geometry->VertexAllocator, RenderMesh->VertexOffset, NumVertices);
+        return false;
+    }
+
+    return true;
+}
+
+inline void GeometryMeshWritesGet(geometry_buffer* Geometry, render_mesh* RenderMesh, v3** GpuPositions, mesh_vertex_attributes** GpuAttributes,
+                                  void** GpuIndices)
+{
+    *GpuPositions = (v3*)VkTransferPushWrite(&RenderState->TransferManager, Geometry->PositionBuffer,
+                                             sizeof(v3)*RenderMesh->VertexOffset, sizeof(v3)*RenderMesh->NumVertices,
+                                             BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                             BarrierMask(VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+    u64 AttributeSize = sizeof(mesh_vertex_attributes);
+    *GpuAttributes = (mesh_vertex_attributes*)VkTransferPushWrite(&RenderState->TransferManager, Geometry->AttributeBuffer,
+                                                                  AttributeSize*RenderMesh->VertexOffset,
+                                                                  AttributeSize*RenderMesh->NumVertices,
+                                                                  BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                  BarrierMask(VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+
+    if (RenderMesh->IndexType == VK_INDEX_TYPE_UINT16)
+    {
+        *GpuIndices = VkTransferPushWrite(&RenderState->TransferManager, Geometry->Index16Buffer,
+                                          sizeof(u16)*RenderMesh->IndexOffset, sizeof(u16)*RenderMesh->NumIndices,
+                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                          BarrierMask(VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+    }
+    else
+    {
+        *GpuIndices = VkTransferPushWrite(&RenderState->TransferManager, Geometry->Index32Buffer,
+                                          sizeof(u32)*RenderMesh->IndexOffset, sizeof(u32)*RenderMesh->NumIndices,
+                                          BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                          BarrierMask(VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+    }
+}
+
+inline b32 GeometryMeshAdd(geometry_buffer* Geometry, mesh* Mesh, render_mesh* RenderMesh)
+{
+    if (!GeometryMeshAllocate(Geometry, Mesh->NumVertices, Mesh->NumIndices, RenderMesh))
+    {
+        return false;
+    }
+
+    // NOTE: Upload
+    v3* GpuPositions = 0;
+    mesh_vertex_attributes* GpuAttributes = 0;
+    void* GpuIndices = 0;
+    GeometryMeshWritesGet(Geometry, RenderMesh, &GpuPositions, &GpuAttributes, &GpuIndices);
+    for (u32 VertexId = 0; VertexId < Mesh->NumVertices; ++VertexId)
+    {
+        GpuPositions[VertexId] = Mesh->Vertices[VertexId].Pos;
+        GpuAttributes[VertexId] = MeshVertexAttributesPack(Mesh->Vertices + VertexId);
+    }
+
+    if (RenderMesh->IndexType == VK_INDEX_TYPE_UINT16)
+    {
+        for (u32 IndexId = 0; IndexId < Mesh->NumIndices; ++IndexId)
+        {
+            ((u16*)GpuIndices)[IndexId] = u16(Mesh->Indices[IndexId]);
+        }
+    }
+    else
+    {
+        Copy(Mesh->Indices, GpuIndices, sizeof(u32)*Mesh->NumIndices);
+    }
+
+    return true;
+}
+
+inline b32 GeometryMeshStream(geometry_buffer* Geometry, asset_stream* Stream, u32 TicketId, u32 NumVertices, v3* Positions,
+                               mesh_vertex_attributes* Attributes, u32 NumIndices, void* Indices, render_mesh* RenderMesh)
+{
+    // NOTE: The streams are already in the GPU layout, so the worker copies them straight into the staging ring. Indices have to be
+    // the width GeometryMeshAllocate picks for this vertex count, and the source memory has to stay around until the ticket is resident
+    if (!GeometryMeshAllocate(Geometry, NumVertices, NumIndices, RenderMesh))
+    {
+        return false;
+    }
+
+    AssetStreamBufferRequest(Stream, TicketId, Geometry->PositionBuffer, sizeof(v3)*RenderMesh->VertexOffset, sizeof(v3)*NumVertices,
+                             AssetStreamLoadCopy, Positions, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+    u64 AttributeSize = sizeof(mesh_vertex_attributes);
+    AssetStreamBufferRequest(Stream, TicketId, Geometry->AttributeBuffer, AttributeSize*RenderMesh->VertexOffset, AttributeSize*NumVertices,
+                             AssetStreamLoadCopy, Attributes, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+    u64 IndexSize = RenderMesh->IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32);
+    VkBuffer IndexBuffer = RenderMesh->IndexType == VK_INDEX_TYPE_UINT16 ? Geometry->Index16Buffer : Geometry->Index32Buffer;
+    AssetStreamBufferRequest(Stream, TicketId, IndexBuffer, IndexSize*RenderMesh->IndexOffset, IndexSize*NumIndices, AssetStreamLoadCopy,
+                             Indices, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+
+    return true;
+}
+
+inline void GeometryMeshRemove(geometry_buffer* Geometry, growable_state* Growable, render_mesh* RenderMesh)
+{
+    // NOTE: The ranges get freed in GeometryFrameBegin once nothing uses them anymore
+    if (Geometry->NumRetired == Geometry->MaxNumRetired)
+    {
+        u32 NewMaxNumRetired = GrowableCapacityGet(Geometry->MaxNumRetired, Geometry->NumRetired + 1);
+        Geometry->Retired = GrowableArrayResizeType(Growable, Geometry->Retired, geometry_retired, Geometry->MaxNumRetired, NewMaxNumRetired);
+        Geometry->MaxNumRetired = NewMaxNumRetired;
+        Growable->NumGrows += 1;
+    }
+
+    geometry_retired* Retired = Geometry->Retired + Geometry->NumRetired++;
+    Retired->VertexOffset = RenderMesh->VertexOffset;
+    Retired->NumVertices = RenderMesh->NumVertices;
+    Retired->IndexOffset = RenderMesh->IndexOffset;
+    Retired->NumIndices = RenderMesh->NumIndices;
+    Retired->IndexType = RenderMesh->IndexType;
+    Retired->StreamTicket = RenderMesh->StreamTicket;
+    Retired->FrameId = Growable->FrameId;
+}
+
+inline void GeometryFrameBegin(geometry_buffer* Geometry, growable_state* Growable, asset_stream* Stream)
+{
+    // NOTE: Called after GrowableFrameBegin, frame N has finished once we started frame N + GROWABLE_FRAMES_IN_FLIGHT. Queued stream
+    // copies still land in the old ranges, so those wait for the ticket too
+    u32 NumKept = 0;
+    for (u32 RetiredId = 0; RetiredId < Geometry->NumRetired; ++RetiredId)
+    {
+        geometry_retired* Retired = Geometry->Retired + RetiredId;
+        if (Growable->FrameId >= Retired->FrameId + GROWABLE_FRAMES_IN_FLIGHT && AssetStreamTicketResident(Stream, Retired->StreamTicket))
+        {
+            GeometryFree(&Geometry->VertexAllocator, Retired->VertexOffset, Retired->NumVertices);
+            geometry_allocator* IndexAllocator = (Retired->IndexType == VK_INDEX_TYPE_UINT16 ?
+                                                  &Geometry->Index16Allocator : &Geometry->Index32Allocator);
+            GeometryFree(IndexAllocator, Retired->IndexOffset, Retired->NumIndices);
+        }
+        else
+        {
+            Geometry->Retired[NumKept++] = *Retired;
+        }
+    }
+    Geometry->NumRetired = NumKept;
+}
+
+//
+// NOTE: Draw Keys
+//
+
+inline u64 DrawKeyDepthBits(f32 Depth)
+{
+    u64 Result = u64(RadixSortFloatKey(Depth) >> 8);
+    return Result;
+}
+
+inline u64 DrawKeyStateBits(draw_pass Pass, u32 PipelineId, VkIndexType IndexType)
+{
+    Assert(PipelineId < 256);
+    u64 Result = (u64(Pass) << 60) | (u64(PipelineId) << 52) | (u64(IndexType == VK_INDEX_TYPE_UINT32 ? 1 : 0) << 51);
+    return Result;
+}
+
+inline u64 DrawKeyForwardCreate(u32 PipelineId, VkIndexType IndexType, f32 Depth, u32 MaterialId, u32 MeshId, u32 LodId)
+{
+    Assert(MaterialId < DRAW_KEY_MAX_MATERIALS && MeshId < DRAW_KEY_MAX_MESHES && LodId < 8);
+    u64 Result = (DrawKeyStateBits(DrawPass_Forward, PipelineId, IndexType) | (DrawKeyDepthBits(Depth) << 27) |
+                  (u64(MaterialId) << 15) | (u64(MeshId) << 3) | u64(LodId));
+    return Result;
+}
+
+inline u64 DrawKeyShadowCreate(draw_pass Pass, u32 PipelineId, VkIndexType IndexType, u32 MeshId, u32 LodId, u32 MaterialId, f32 Depth)
+{
+    Assert(MaterialId < DRAW_KEY_MAX_MATERIALS && MeshId < DRAW_KEY_MAX_MESHES && LodId < 8);
+    u64 Result = (DrawKeyStateBits(Pass, PipelineId, IndexType) | (u64(MeshId) << 39) | (u64(LodId) << 36) |
+                  (u64(MaterialId) << 24) | DrawKeyDepthBits(Depth));
+    return Result;
+}
+
+inline draw_pass DrawKeyPassGet(u64 Key)
+{
+    draw_pass Result = draw_pass(Key >> 60);
+    return Result;
+}
+
+//
+// NOTE: Draw Lists
+//
+
+inline void GeometryDrawListsReset(geometry_buffer* Geometry)
+{
+    Geometry->NumCommands = 0;
+    Geometry->NumBatches = 0;
+    Geometry->NumSortEntries = 0;
+}
+
+inline void GeometryDrawSortAdd(geometry_buffer* Geometry, u64 Key, u32 InstanceId)
+{
+    Assert(Geometry->NumSortEntries < Geometry->MaxNumCommands);
+    Geometry->SortKeys[Geometry->NumSortEntries] = Key;
+    Geometry->SortValues[Geometry->NumSortEntries] = InstanceId;
+    Geometry->NumSortEntries += 1;
+}
+
+inline void GeometryDrawSort(geometry_buffer* Geometry)
+{
+    RadixSort(Geometry->SortKeys, Geometry->SortValues, Geometry->SortKeysTemp, Geometry->SortValuesTemp, Geometry->NumSortEntries);
+}
+
+inline geometry_draw_list GeometryDrawListBegin(geometry_buffer* Geometry)
+{
+    geometry_draw_list Result = {};
+    Result.FirstCommand = Geometry->NumCommands;
+    Result.FirstBatch = Geometry->NumBatches;
+
+    return Result;
+}
+
+inline void GeometryDrawAdd(geometry_buffer* Geometry, geometry_draw_list* List, u64 Key, render_mesh* Mesh, u32 LodId, u32 InstanceId)
+{
+    Assert(Geometry->NumCommands < Geometry->MaxNumCommands);
+
+    mesh_lod* Lod = Mesh->Lods + LodId;
+    VkDrawIndexedIndirectCommand* Command = Geometry->Commands + Geometry->NumCommands++;
+    Command->indexCount = Lod->NumIndices;
+    Command->instanceCount = 1;
+    Command->firstIndex = Mesh->IndexOffset + Lod->FirstIndex;
+    Command->vertexOffset = i32(Mesh->VertexOffset);
+    Command->firstInstance = InstanceId;
+    List->NumCommands += 1;
+
+    // NOTE: Only start a new batch when the state prefix of the key changes
+    u64 StateKey = Key >> DRAW_KEY_STATE_SHIFT;
+    geometry_draw_batch* Batch = List->NumBatches > 0 ? Geometry->Batches + Geometry->NumBatches - 1 : 0;
+    if (!Batch || Batch->StateKey != StateKey)
+    {
+        Batch = Geometry->Batches + Geometry->NumBatches++;
+        Batch->FirstCommand = Geometry->NumCommands - 1;
+        Batch->NumCommands = 0;
+        Batch->StateKey = StateKey;
+        Batch->IndexType = Mesh->IndexType;
+        List->NumBatches += 1;
+    }
+    Batch->NumCommands += 1;
+}
+
+inline void GeometryDrawListsUpload(geometry_buffer* Geometry)
+{
+    if (Geometry->NumCommands == 0)
+    {
+        return;
+    }
+
+    VkDrawIndexedIndirectCommand* GpuCommands = VkTransferPushWriteArray(&RenderState->TransferManager, Geometry->IndirectBuffer.Buffer,
+                                                                         VkDrawIndexedIndirectCommand, Geometry->NumCommands,
+                                                                         BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                         BarrierMask(VkAccessFlagBits(VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT),
+                                                                                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    Copy(Geometry->Commands, GpuCommands, sizeof(VkDrawIndexedIndirectCommand)*Geometry->NumCommands);
+}
+
+inline void GeometryBind(VkCommandBuffer CmdBuffer, geometry_buffer* Geometry, b32 BindAttributes)
+{
+    VkBuffer VertexBuffers[] = { Geometry->PositionBuffer, Geometry->AttributeBuffer };
+    VkDeviceSize Offsets[] = { 0, 0 };
+    vkCmdBindVertexBuffers(CmdBuffer, 0, BindAttributes ? 2 : 1, VertexBuffers, Offsets);
+}
+
+inline void GeometryIndexBufferBind(VkCommandBuffer CmdBuffer, geometry_buffer* Geometry, VkIndexType IndexType)
+{
+    VkBuffer IndexBuffer = IndexType == VK_INDEX_TYPE_UINT16 ? Geometry->Index16Buffer : Geometry->Index32Buffer;
+    vkCmdBindIndexBuffer(CmdBuffer, IndexBuffer, 0, IndexType);
+}
+
+inline void GeometryCommandDraw(VkCommandBuffer CmdBuffer, geometry_buffer* Geometry, VkBuffer CommandBuffer, u32 CommandId)
+{
+    // NOTE: Without drawIndirectFirstInstance the instance id can only come from a direct draw out of the CPU copy. CommandBuffer has
+    // to have the same layout as the indirect buffer
+    if (Geometry->IndirectFirstInstance)
+    {
+        vkCmdDrawIndexedIndirect(CmdBuffer, CommandBuffer, sizeof(VkDrawIndexedIndirectCommand)*CommandId, 1,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        VkDrawIndexedIndirectCommand* Command = Geometry->Commands + CommandId;
+        vkCmdDrawIndexed(CmdBuffer, Command->indexCount, Command->instanceCount, Command->firstIndex, Command->vertexOffset,
+                         Command->firstInstance);
+    }
+}
+
+inline void GeometryDrawListRender(VkCommandBuffer CmdBuffer, geometry_buffer* Geometry, geometry_draw_list* List,
+                                   VkBuffer CommandBuffer = VK_NULL_HANDLE)
+{
+    // NOTE: CommandBuffer replaces the indirect buffer with one that has the same layout (occlusion culling writes culled commands in
+    // place). The index binding only changes between batches
+    if (CommandBuffer == VK_NULL_HANDLE)
+    {
+        CommandBuffer = Geometry->IndirectBuffer.Buffer;
+    }
+    
+    b32 IndexBound = false;
+    VkIndexType BoundIndexType = VK_INDEX_TYPE_UINT32;
+    for (u32 BatchId = List->FirstBatch; BatchId < List->FirstBatch + List->NumBatches; ++BatchId)
+    {
+        geometry_draw_batch* Batch = Geometry->Batches + BatchId;
+        if (!IndexBound || Batch->IndexType != BoundIndexType)
+        {
+            GeometryIndexBufferBind(CmdBuffer, Geometry, Batch->IndexType);
+            IndexBound = true;
+            BoundIndexType = Batch->IndexType;
+        }
+
+        if (Geometry->IndirectFirstInstance && Geometry->MultiDrawIndirect)
+        {
+            VkDeviceSize Offset = sizeof(VkDrawIndexedIndirectCommand)*Batch->FirstCommand;
+            vkCmdDrawIndexedIndirect(CmdBuffer, CommandBuffer, Offset, Batch->NumCommands, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else
+        {
+            for (u32 CommandId = Batch->FirstCommand; CommandId < Batch->FirstCommand + Batch->NumCommands; ++CommandId)
+            {
+                GeometryCommandDraw(CmdBuffer, Geometry, CommandBuffer, CommandId);
+            }
+        }
+    }
+}
+
+inline void GeometryDrawListRenderCount(VkCommandBuffer CmdBuffer, geometry_buffer* Geometry, geometry_draw_list* List, VkBuffer CommandBuffer,
+                                        VkBuffer CountBuffer, VkDeviceSize CountOffset)
+{
+    // NOTE: Same batches as GeometryDrawListRender, but the commands were compacted on the GPU (per batch, starting at the batches
+    // first command) and each batch has a u32 draw count at CountOffset + its index in the list
+    b32 IndexBound = false;
+    VkIndexType BoundIndexType = VK_INDEX_TYPE_UINT32;
+    for (u32 BatchId = 0; BatchId < List->NumBatches; ++BatchId)
+    {
+        geometry_draw_batch* Batch = Geometry->Batches + List->FirstBatch + BatchId;
+        if (!IndexBound || Batch->IndexType != BoundIndexType)
+        {
+            GeometryIndexBufferBind(CmdBuffer, Geometry, Batch->IndexType);
+            IndexBound = true;
+            BoundIndexType = Batch->IndexType;
+        }
+
+        VkDeviceSize Offset = sizeof(VkDrawIndexedIndirectCommand)*Batch->FirstCommand;
+        vkCmdDrawIndexedIndirectCount(CmdBuffer, CommandBuffer, Offset, CountBuffer, CountOffset + sizeof(u32)*BatchId, Batch->NumCommands,
+                                      sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
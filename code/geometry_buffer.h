@@ -0,0 +1,134 @@
+#pragma once
+
+/*
+
+  NOTE: Geometry Buffer
+
+    All mesh geometry lives in one vertex buffer pair (positions + attributes, see mesh.h) and one index buffer per index type. Each
+    mesh is a suballocation, so draws just pass vertexOffset/firstIndex and a pass binds the buffers once. Indices stay relative to
+    the meshes first vertex, which is why 16bit indices keep working no matter where in the buffer a mesh lands.
+
+    Ranges come from first fit free lists sorted by offset, freeing coalesces with the neighbors. Removed meshes don't free their
+    ranges right away, frames in flight can still draw them and a streamed mesh can still have copies queued into them. They get
+    retired like the growable buffers and go back to the free lists in GeometryFrameBegin, once GROWABLE_FRAMES_IN_FLIGHT frames
+    passed and their stream ticket is resident.
+
+    Draws get recorded into draw lists of VkDrawIndexedIndirectCommand. Consecutive draws that share a index type get merged into one
+    batch which is a single multi draw indirect call (materials are bindless so they don't split batches, without bindless the forward
+    pass walks the commands itself and rebinds the material sets, see ForwardDrawsMaterialRender). Without multiDrawIndirect
+    each command of a batch is its own indirect draw, and without drawIndirectFirstInstance the instance id can't come out of the
+    indirect buffer, so the commands get drawn directly from the CPU copy (see device_setup.h).
+
+    The vertex and index buffers don't grow, the asset stream and the transfer manager hold on to their handles while copies are in
+    flight. They get sized for the scene file plus room for the built in meshes (clamped to GEOMETRY_MAX_BUFFER_SIZE, the smallest
+    maxMemoryAllocationSize the spec allows), a mesh that doesn't fit anymore fails to add (GeometryMeshAllocate returns false) and
+    the scene leaves its instances out. The free lists are CPU only and grow like the other growable containers.
+
+  NOTE: Draw Keys
+
+    Every draw of every pass gets a 64bit key and one LSD radix sort per frame orders all of them. The top bits are the state that
+    costs us something to change (pass, pipeline, index buffer), a batch only ends when that prefix changes. Below that the passes
+    differ:
+
+      - Forward:  | pass 4 | pipeline 8 | index type 1 | depth 24 | material 12 | mesh 12 | lod 3 |, front to back for early z
+      - Shadow:   | pass 4 | pipeline 8 | index type 1 | mesh 12 | lod 3 | material 12 | depth 24 |, by state, depth only breaks ties
+
+    Depths are the top bits of the float, flipped so that the integer order matches the float order. The sort does 8 passes of 8
+    bits but skips every digit that all keys share, which for the state heavy upper bytes is most of them.
+
+    Mesh and material ids are the scene ids, so they have to stay below DRAW_KEY_MAX_MESHES/MATERIALS. SceneMeshAdd and
+    SceneMaterialAdd fail past that (same as a full geometry buffer) and SceneFileOpen rejects files with more meshes.
+
+ */
+
+enum draw_pass
+{
+    DrawPass_Forward,
+    DrawPass_ShadowStatic,
+    DrawPass_ShadowDynamic,
+
+    DrawPass_Count,
+};
+
+#define GEOMETRY_MAX_BUFFER_SIZE MegaBytes(1024)
+
+#define DRAW_KEY_STATE_SHIFT 51
+#define DRAW_KEY_MAX_MESHES (1 << 12)
+#define DRAW_KEY_MAX_MATERIALS (1 << 12)
+
+struct geometry_block
+{
+    u32 Offset;
+    u32 Size;
+};
+
+struct geometry_allocator
+{
+    u32 Size;
+    u32 MaxNumFreeBlocks;
+    u32 NumFreeBlocks;
+    // NOTE: Sorted by offset, neighbors never touch
+    geometry_block* FreeBlocks;
+};
+
+struct geometry_retired
+{
+    u32 VertexOffset;
+    u32 NumVertices;
+    u32 IndexOffset;
+    u32 NumIndices;
+    VkIndexType IndexType;
+    u32 StreamTicket;
+    u64 FrameId;
+};
+
+struct geometry_draw_batch
+{
+    u32 FirstCommand;
+    u32 NumCommands;
+    // NOTE: Key bits above DRAW_KEY_STATE_SHIFT
+    u64 StateKey;
+    VkIndexType IndexType;
+};
+
+struct geometry_draw_list
+{
+    u32 FirstCommand;
+    u32 NumCommands;
+    u32 FirstBatch;
+    u32 NumBatches;
+};
+
+struct geometry_buffer
+{
+    geometry_allocator VertexAllocator;
+    geometry_allocator Index16Allocator;
+    geometry_allocator Index32Allocator;
+
+    // NOTE: Ranges of removed meshes, waiting until nothing references them anymore
+    u32 MaxNumRetired;
+    u32 NumRetired;
+    geometry_retired* Retired;
+
+    VkBuffer PositionBuffer;
+    VkBuffer AttributeBuffer;
+    VkBuffer Index16Buffer;
+    VkBuffer Index32Buffer;
+
+    // NOTE: Draw lists of the current frame share these
+    b32 MultiDrawIndirect;
+    b32 IndirectFirstInstance;
+    u32 MaxNumCommands;
+    u32 NumCommands;
+    VkDrawIndexedIndirectCommand* Commands;
+    u32 NumBatches;
+    geometry_draw_batch* Batches;
+    growable_buffer IndirectBuffer;
+
+    // NOTE: Sort scratch, values are instance ids
+    u32 NumSortEntries;
+    u64* SortKeys;
+    u32* SortValues;
+    u64* SortKeysTemp;
+    u32* SortValuesTemp;
+};
@@ -0,0 +1,152 @@
+
+//
+// NOTE: Growable Storage
+//
+
+inline u32 GrowableCapacityGet(u32 Capacity, u32 Required)
+{
+    u64 Result = Max(Capacity, u32(GROWABLE_MIN_CAPACITY));
+    while (Result < u64(Required))
+    {
+        Result *= 2;
+    }
+
+    Assert(Result <= 0xFFFFFFFF);
+    return u32(Result);
+}
+
+inline void* GrowableArrayResize(growable_state* State, void* Array, u64 OldSize, u64 NewSize)
+{
+    Assert(NewSize >= OldSize);
+
+    void* Result = VirtualAlloc(0, NewSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    Assert(Result);
+    if (Array)
+    {
+        Copy(Array, Result, OldSize);
+        VirtualFree(Array, 0, MEM_RELEASE);
+    }
+
+    State->CpuBytes += NewSize - OldSize;
+    return Result;
+}
+
+#define GrowableArrayResizeType(State, Array, Type, OldCount, NewCount) \
+    (Type*)GrowableArrayResize(State, Array, sizeof(Type)*u64(OldCount), sizeof(Type)*u64(NewCount))
+
+inline void GrowableRetire(growable_state* State, VkBuffer Buffer, VkDeviceMemory Memory)
+{
+    Assert(State->NumRetired < GROWABLE_MAX_RETIRED);
+    growable_retired* Retired = State->Retired + State->NumRetired++;
+    Retired->Buffer = Buffer;
+    Retired->Memory = Memory;
+    Retired->FrameId = State->FrameId;
+}
+
+inline void GrowableFrameBegin(growable_state* State)
+{
+    State->FrameId += 1;
+
+    // NOTE: Frame N has finished once we started frame N + GROWABLE_FRAMES_IN_FLIGHT
+    u32 NumKept = 0;
+    for (u32 RetiredId = 0; RetiredId < State->NumRetired; ++RetiredId)
+    {
+        growable_retired* Retired = State->Retired + RetiredId;
+        if (State->FrameId >= Retired->FrameId + GROWABLE_FRAMES_IN_FLIGHT)
+        {
+            vkDestroyBuffer(RenderState->Device, Retired->Buffer, 0);
+            vkFreeMemory(RenderState->Device, Retired->Memory, 0);
+        }
+        else
+        {
+            State->Retired[NumKept++] = *Retired;
+        }
+    }
+    State->NumRetired = NumKept;
+}
+
+inline u32 GrowableFrameSlot(growable_state* State)
+{
+    u32 Result = u32(State->FrameId % GROWABLE_FRAMES_IN_FLIGHT);
+    return Result;
+}
+
+inline void GrowableBufferAllocate(growable_state* State, growable_buffer* Buffer, VkBufferUsageFlags Usage, u64 NewSize,
+                                   VkMemoryPropertyFlags Flags)
+{
+    VkBufferCreateInfo BufferCreateInfo = {};
+    BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    BufferCreateInfo.size = NewSize;
+    BufferCreateInfo.usage = Usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkCheckResult(vkCreateBuffer(RenderState->Device, &BufferCreateInfo, 0, &Buffer->Buffer));
+
+    VkMemoryRequirements Requirements;
+    vkGetBufferMemoryRequirements(RenderState->Device, Buffer->Buffer, &Requirements);
+
+    // NOTE: The framework arenas can't free, growable buffers get their own allocation
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = Requirements.size;
+    AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(Requirements.memoryTypeBits, Flags);
+    VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Buffer->Memory));
+    VkCheckResult(vkBindBufferMemory(RenderState->Device, Buffer->Buffer, Buffer->Memory, 0));
+    State->GpuBytes += NewSize - Buffer->Size;
+    Buffer->Size = NewSize;
+    Buffer->Usage = Usage;
+}
+
+inline void GrowableBufferResize(growable_state* State, VkCommandBuffer CmdBuffer, growable_buffer* Buffer, VkBufferUsageFlags Usage,
+                                 u64 NewSize, b32 KeepContents)
+{
+    Assert(NewSize >= Buffer->Size);
+    growable_buffer OldBuffer = *Buffer;
+    GrowableBufferAllocate(State, Buffer, Usage, NewSize, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (OldBuffer.Buffer != VK_NULL_HANDLE)
+    {
+        if (KeepContents)
+        {
+            // NOTE: Whatever wrote the old buffer last frame has to be done before we read it, and readers of the new buffer this
+            // frame have to wait on the copy
+            VkMemoryBarrier Barrier = {};
+            Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            Barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            Barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(CmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &Barrier, 0, 0, 0, 0);
+
+            VkBufferCopy Region = {};
+            Region.size = OldBuffer.Size;
+            vkCmdCopyBuffer(CmdBuffer, OldBuffer.Buffer, Buffer->Buffer, 1, &Region);
+            // NOTE: Same as the CPU arrays, new space starts out zeroed (sizes are multiples of 4 for fills)
+            vkCmdFillBuffer(CmdBuffer, Buffer->Buffer, OldBuffer.Size, NewSize - OldBuffer.Size, 0);
+
+            Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            vkCmdPipelineBarrier(CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &Barrier, 0, 0, 0, 0);
+        }
+
+        GrowableRetire(State, OldBuffer.Buffer, OldBuffer.Memory);
+    }
+}
+
+inline void GrowableMappedBufferResize(growable_state* State, growable_mapped_buffer* Buffer, VkBufferUsageFlags Usage, u64 NewSize)
+{
+    // NOTE: The CPU rewrites these every frame, so growing never copies. Freeing the memory of a retired buffer unmaps it
+    for (u32 SlotId = 0; SlotId < GROWABLE_FRAMES_IN_FLIGHT; ++SlotId)
+    {
+        growable_buffer* Slot = Buffer->Slots + SlotId;
+        Assert(NewSize >= Slot->Size);
+        growable_buffer OldSlot = *Slot;
+        GrowableBufferAllocate(State, Slot, Usage, NewSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VkCheckResult(vkMapMemory(RenderState->Device, Slot->Memory, 0, VK_WHOLE_SIZE, 0, (void**)&Buffer->Mapped[SlotId]));
+
+        if (OldSlot.Buffer != VK_NULL_HANDLE)
+        {
+            GrowableRetire(State, OldSlot.Buffer, OldSlot.Memory);
+        }
+    }
+}
+
+// NOTE: Coherent memory, the writes are visible to the GPU once the frame gets submitted
+#define GrowableMappedArray(Buffer, FrameSlot, Type) (Type*)(Buffer)->Mapped[FrameSlot]
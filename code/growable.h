@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+
+  NOTE: Growable Storage
+
+    Containers whose size depends on the scene (instances, lights, meshes, draw commands) start small and grow geometrically, on the
+    CPU and on the GPU, so nothing has to be sized for the worst case up front:
+
+      - CPU arrays live in their own VirtualAlloc allocations instead of the demo arena so they can be freed. Growing copies the old
+        contents, which is what the BVH refit and the clipmap dirty tracking rely on
+      - GPU buffers get their own device local allocation. Growing creates the new buffer, optionally copies the old contents on the
+        GPU (for buffers the GPU carries across frames like the occlusion visibility) and retires the old buffer. Retired buffers get
+        destroyed once every frame that could still reference them has finished, GROWABLE_FRAMES_IN_FLIGHT frames later
+      - Data the CPU rewrites every frame (instances, shadow transforms, occlusion bounds) goes into mapped buffers instead. Those are
+        host visible, stay mapped and have one buffer per frame in flight, so the CPU writes this frames copy while the GPU may still
+        read the other one and nothing per instance goes through the framework staging buffer
+      - Descriptor sets that point at growable buffers get one copy per frame in flight. A set only gets rewritten when its frame
+        comes around again, so we never update a set a command buffer in flight still uses. Sets of a frame slot point at the mapped
+        buffer of the same slot
+
+    Capacities only ever grow, a scene that shrinks keeps its memory. We track high water marks per container and the number of
+    grows so that the UI can show how close the defaults are to what scenes really need.
+
+ */
+
+#define GROWABLE_MIN_CAPACITY 64
+#define GROWABLE_MAX_RETIRED 64
+// NOTE: The framework waits on the previous frame in VkCommandsBegin, we don't rely on that staying true
+#define GROWABLE_FRAMES_IN_FLIGHT 2
+
+struct growable_buffer
+{
+    VkBuffer Buffer;
+    VkDeviceMemory Memory;
+    u64 Size;
+    VkBufferUsageFlags Usage;
+};
+
+struct growable_mapped_buffer
+{
+    growable_buffer Slots[GROWABLE_FRAMES_IN_FLIGHT];
+    u8* Mapped[GROWABLE_FRAMES_IN_FLIGHT];
+};
+
+struct growable_retired
+{
+    VkBuffer Buffer;
+    VkDeviceMemory Memory;
+    u64 FrameId;
+};
+
+struct growable_state
+{
+    u64 FrameId;
+    u32 NumRetired;
+    growable_retired Retired[GROWABLE_MAX_RETIRED];
+
+    // NOTE: Stats, grows count containers not buffers
+    u32 NumGrows;
+    u64 CpuBytes;
+    u64 GpuBytes;
+};
@@ -0,0 +1,950 @@
+
+//
+// NOTE: Mesh Generation
+//
+
+inline mesh MeshCreate(linear_arena* Arena, u32 NumVertices, u32 NumIndices)
+{
+    mesh Result = {};
+    Result.NumVertices = NumVertices;
+    Result.Vertices = PushArray(Arena, mesh_vertex, NumVertices);
+    Result.NumIndices = NumIndices;
+    Result.Indices = PushArray(Arena, u32, NumIndices);
+    Result.NumLods = 1;
+    Result.Lods[0].FirstIndex = 0;
+    Result.Lods[0].NumIndices = NumIndices;
+    Result.Lods[0].Error = 0.0f;
+
+    return Result;
+}
+
+inline void MeshFaceAdd(mesh* Mesh, u32 FaceId, v3 Normal, v3 Right, v3 Up)
+{
+    // NOTE: Unit sized face centered at Normal * 0.5
+    u32 BaseVertex = FaceId*4;
+    mesh_vertex* Vertices = Mesh->Vertices + BaseVertex;
+    v3 Center = 0.5f*Normal;
+    Vertices[0] = { Center - 0.5f*Right - 0.5f*Up, Normal, V2(0, 1) };
+    Vertices[1] = { Center + 0.5f*Right - 0.5f*Up, Normal, V2(1, 1) };
+    Vertices[2] = { Center + 0.5f*Right + 0.5f*Up, Normal, V2(1, 0) };
+    Vertices[3] = { Center - 0.5f*Right + 0.5f*Up, Normal, V2(0, 0) };
+
+    u32* Indices = Mesh->Indices + FaceId*6;
+    Indices[0] = BaseVertex + 0;
+    Indices[1] = BaseVertex + 1;
+    Indices[2] = BaseVertex + 2;
+    Indices[3] = BaseVertex + 2;
+    Indices[4] = BaseVertex + 3;
+    Indices[5] = BaseVertex + 0;
+}
+
+inline mesh MeshQuadCreate(linear_arena* Arena)
+{
+    // NOTE: Unit quad in the xy plane, facing -z
+    mesh Result = MeshCreate(Arena, 4, 6);
+    MeshFaceAdd(&Result, 0, V3(0, 0, -1), V3(1, 0, 0), V3(0, 1, 0));
+    for (u32 VertexId = 0; VertexId < Result.NumVertices; ++VertexId)
+    {
+        Result.Vertices[VertexId].Pos.z = 0.0f;
+    }
+
+    return Result;
+}
+
+inline mesh MeshCubeCreate(linear_arena* Arena)
+{
+    // NOTE: Unit cube centered at the origin, each face gets its own vertices so that normals are flat
+    mesh Result = MeshCreate(Arena, 24, 36);
+    MeshFaceAdd(&Result, 0, V3(1, 0, 0), V3(0, 0, 1), V3(0, 1, 0));
+    MeshFaceAdd(&Result, 1, V3(-1, 0, 0), V3(0, 0, -1), V3(0, 1, 0));
+    MeshFaceAdd(&Result, 2, V3(0, 1, 0), V3(1, 0, 0), V3(0, 0, 1));
+    MeshFaceAdd(&Result, 3, V3(0, -1, 0), V3(1, 0, 0), V3(0, 0, -1));
+    MeshFaceAdd(&Result, 4, V3(0, 0, 1), V3(-1, 0, 0), V3(0, 1, 0));
+    MeshFaceAdd(&Result, 5, V3(0, 0, -1), V3(1, 0, 0), V3(0, 1, 0));
+
+    return Result;
+}
+
+inline mesh MeshSphereCreate(linear_arena* Arena, u32 NumLatitude, u32 NumLongitude)
+{
+    // NOTE: UV sphere with a diameter of 1 centered at the origin
+    mesh Result = MeshCreate(Arena, (NumLatitude + 1)*(NumLongitude + 1), NumLatitude*NumLongitude*6);
+
+    mesh_vertex* CurrVertex = Result.Vertices;
+    for (u32 LatId = 0; LatId <= NumLatitude; ++LatId)
+    {
+        f32 V = f32(LatId) / f32(NumLatitude);
+        f32 Theta = V*Pi32;
+        for (u32 LongId = 0; LongId <= NumLongitude; ++LongId)
+        {
+            f32 U = f32(LongId) / f32(NumLongitude);
+            f32 Phi = U*2.0f*Pi32;
+            
+            v3 Normal = V3(Sin(Theta)*Cos(Phi), Cos(Theta), Sin(Theta)*Sin(Phi));
+            *CurrVertex++ = { 0.5f*Normal, Normal, V2(U, V) };
+        }
+    }
+
+    u32* CurrIndex = Result.Indices;
+    for (u32 LatId = 0; LatId < NumLatitude; ++LatId)
+    {
+        for (u32 LongId = 0; LongId < NumLongitude; ++LongId)
+        {
+            u32 I0 = LatId*(NumLongitude + 1) + LongId;
+            u32 I1 = I0 + NumLongitude + 1;
+            
+            *CurrIndex++ = I0;
+            *CurrIndex++ = I0 + 1;
+            *CurrIndex++ = I1;
+            *CurrIndex++ = I1;
+            *CurrIndex++ = I0 + 1;
+            *CurrIndex++ = I1 + 1;
+        }
+    }
+
+    return Result;
+}
+
+//
+// NOTE: Mesh Bounds
+//
+
+inline void MeshBoundsGet(mesh* Mesh, v3* BoundsMin, v3* BoundsMax, v3* SphereCenter, f32* SphereRadius)
+{
+    Assert(Mesh->NumVertices > 0);
+    
+    *BoundsMin = Mesh->Vertices[0].Pos;
+    *BoundsMax = Mesh->Vertices[0].Pos;
+    for (u32 VertexId = 1; VertexId < Mesh->NumVertices; ++VertexId)
+    {
+        v3 Pos = Mesh->Vertices[VertexId].Pos;
+        *BoundsMin = V3(Min(BoundsMin->x, Pos.x), Min(BoundsMin->y, Pos.y), Min(BoundsMin->z, Pos.z));
+        *BoundsMax = V3(Max(BoundsMax->x, Pos.x), Max(BoundsMax->y, Pos.y), Max(BoundsMax->z, Pos.z));
+    }
+
+    // NOTE: Centered on the AABB, not optimal but close enough for culling
+    *SphereCenter = 0.5f*(*BoundsMin + *BoundsMax);
+    f32 RadiusSq = 0.0f;
+    for (u32 VertexId = 0; VertexId < Mesh->NumVertices; ++VertexId)
+    {
+        RadiusSq = Max(RadiusSq, LengthSquared(Mesh->Vertices[VertexId].Pos - *SphereCenter));
+    }
+    *SphereRadius = SquareRoot(RadiusSq);
+}
+
+//
+// NOTE: Mesh Simplification
+//
+
+inline mesh_quadric MeshQuadricFromPlane(v3 Normal, f32 D, f32 Weight)
+{
+    mesh_quadric Result = {};
+    Result.A00 = Weight*Normal.x*Normal.x;
+    Result.A01 = Weight*Normal.x*Normal.y;
+    Result.A02 = Weight*Normal.x*Normal.z;
+    Result.A03 = Weight*Normal.x*D;
+    Result.A11 = Weight*Normal.y*Normal.y;
+    Result.A12 = Weight*Normal.y*Normal.z;
+    Result.A13 = Weight*Normal.y*D;
+    Result.A22 = Weight*Normal.z*Normal.z;
+    Result.A23 = Weight*Normal.z*D;
+    Result.A33 = Weight*D*D;
+    Result.Weight = Weight;
+
+    return Result;
+}
+
+inline void MeshQuadricAdd(mesh_quadric* Dst, mesh_quadric* Src)
+{
+    f32* DstData = (f32*)Dst;
+    f32* SrcData = (f32*)Src;
+    for (u32 ElementId = 0; ElementId < sizeof(mesh_quadric) / sizeof(f32); ++ElementId)
+    {
+        DstData[ElementId] += SrcData[ElementId];
+    }
+}
+
+inline f32 MeshQuadricEval(mesh_quadric* Q, v3 P)
+{
+    // NOTE: [P 1]^T * Q * [P 1], which is the sum of squared distances to the planes
+    f32 Result = (Q->A00*P.x*P.x + 2.0f*Q->A01*P.x*P.y + 2.0f*Q->A02*P.x*P.z + 2.0f*Q->A03*P.x +
+                  Q->A11*P.y*P.y + 2.0f*Q->A12*P.y*P.z + 2.0f*Q->A13*P.y +
+                  Q->A22*P.z*P.z + 2.0f*Q->A23*P.z +
+                  Q->A33);
+    return Max(Result, 0.0f);
+}
+
+inline u32 MeshPositionHash(v3 Pos)
+{
+    u32* Bits = (u32*)&Pos;
+    u32 Result = (Bits[0]*73856093) ^ (Bits[1]*19349663) ^ (Bits[2]*83492791);
+    return Result;
+}
+
+inline b32 MeshCollapseFlips(mesh_vertex* Vertices, u32* Indices, u32* TriangleOffsets, u32* TriangleIds, u32 From, u32 To)
+{
+    // NOTE: Reject collapses that turn a triangle around From upside down (or degenerate it) unless it contains To (it goes away)
+    for (u32 AdjId = TriangleOffsets[From]; AdjId < TriangleOffsets[From + 1]; ++AdjId)
+    {
+        u32* Triangle = Indices + 3*TriangleIds[AdjId];
+        if (Triangle[0] == To || Triangle[1] == To || Triangle[2] == To)
+        {
+            continue;
+        }
+
+        v3 Before[3];
+        v3 After[3];
+        for (u32 CornerId = 0; CornerId < 3; ++CornerId)
+        {
+            Before[CornerId] = Vertices[Triangle[CornerId]].Pos;
+            After[CornerId] = Vertices[Triangle[CornerId] == From ? To : Triangle[CornerId]].Pos;
+        }
+
+        v3 NormalBefore = Cross(Before[1] - Before[0], Before[2] - Before[0]);
+        v3 NormalAfter = Cross(After[1] - After[0], After[2] - After[0]);
+        if (Dot(NormalBefore, NormalAfter) <= 0.25f*LengthSquared(NormalBefore))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void MeshLodChainBuild(linear_arena* Arena, linear_arena* TempArena, mesh* Mesh)
+{
+    Assert(Mesh->NumLods == 1);
+    
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    u32 NumVertices = Mesh->NumVertices;
+    mesh_vertex* Vertices = Mesh->Vertices;
+    u32 NumSourceIndices = Mesh->Lods[0].NumIndices;
+
+    // NOTE: We only keep LODs that are at most 3/4 of the previous one, so the whole chain fits in 4x
+    u32* Indices = PushArray(Arena, u32, 4*NumSourceIndices);
+    Copy(Mesh->Indices, Indices, sizeof(u32)*NumSourceIndices);
+    
+    // NOTE: Lock vertices whose position is shared with another vertex (uv/normal seams)
+    b32* Locked = PushArray(TempArena, b32, NumVertices);
+    {
+        u32 TableSize = 1;
+        while (TableSize < 2*NumVertices)
+        {
+            TableSize *= 2;
+        }
+
+        u32* Table = PushArray(TempArena, u32, TableSize);
+        for (u32 SlotId = 0; SlotId < TableSize; ++SlotId)
+        {
+            Table[SlotId] = 0xFFFFFFFF;
+        }
+        
+        for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+        {
+            Locked[VertexId] = false;
+            v3 Pos = Vertices[VertexId].Pos;
+            u32 SlotId = MeshPositionHash(Pos) & (TableSize - 1);
+            while (Table[SlotId] != 0xFFFFFFFF)
+            {
+                v3 Other = Vertices[Table[SlotId]].Pos;
+                if (Other.x == Pos.x && Other.y == Pos.y && Other.z == Pos.z)
+                {
+                    Locked[VertexId] = true;
+                    Locked[Table[SlotId]] = true;
+                    break;
+                }
+                SlotId = (SlotId + 1) & (TableSize - 1);
+            }
+
+            if (Table[SlotId] == 0xFFFFFFFF)
+            {
+                Table[SlotId] = VertexId;
+            }
+        }
+    }
+
+    // NOTE: Lock open borders, a edge that only one triangle uses has no reverse half edge
+    {
+        u32 NumHalfEdges = NumSourceIndices;
+        u32 TableSize = 1;
+        while (TableSize < 2*NumHalfEdges)
+        {
+            TableSize *= 2;
+        }
+
+        u64* Table = PushArray(TempArena, u64, TableSize);
+        for (u32 SlotId = 0; SlotId < TableSize; ++SlotId)
+        {
+            Table[SlotId] = 0xFFFFFFFFFFFFFFFFull;
+        }
+
+        for (u32 IndexId = 0; IndexId < NumSourceIndices; ++IndexId)
+        {
+            u32 V0 = Indices[IndexId];
+            u32 V1 = Indices[(IndexId % 3) == 2 ? IndexId - 2 : IndexId + 1];
+            u64 Key = (u64(V0) << 32) | u64(V1);
+            u32 SlotId = u32((Key*11400714819323198485ull) >> 40) & (TableSize - 1);
+            while (Table[SlotId] != 0xFFFFFFFFFFFFFFFFull && Table[SlotId] != Key)
+            {
+                SlotId = (SlotId + 1) & (TableSize - 1);
+            }
+            Table[SlotId] = Key;
+        }
+
+        for (u32 IndexId = 0; IndexId < NumSourceIndices; ++IndexId)
+        {
+            u32 V0 = Indices[IndexId];
+            u32 V1 = Indices[(IndexId % 3) == 2 ? IndexId - 2 : IndexId + 1];
+            u64 Key = (u64(V1) << 32) | u64(V0);
+            u32 SlotId = u32((Key*11400714819323198485ull) >> 40) & (TableSize - 1);
+            b32 Found = false;
+            while (Table[SlotId] != 0xFFFFFFFFFFFFFFFFull)
+            {
+                if (Table[SlotId] == Key)
+                {
+                    Found = true;
+                    break;
+                }
+                SlotId = (SlotId + 1) & (TableSize - 1);
+            }
+
+            if (!Found)
+            {
+                Locked[V0] = true;
+                Locked[V1] = true;
+            }
+        }
+    }
+    
+    // NOTE: Area weighted plane quadrics
+    mesh_quadric* Quadrics = PushArray(TempArena, mesh_quadric, NumVertices);
+    ZeroMem(Quadrics, sizeof(mesh_quadric)*NumVertices);
+    for (u32 IndexId = 0; IndexId < NumSourceIndices; IndexId += 3)
+    {
+        v3 P0 = Vertices[Indices[IndexId + 0]].Pos;
+        v3 P1 = Vertices[Indices[IndexId + 1]].Pos;
+        v3 P2 = Vertices[Indices[IndexId + 2]].Pos;
+        v3 Normal = Cross(P1 - P0, P2 - P0);
+        f32 DoubleArea = Length(Normal);
+        if (DoubleArea <= 0.0f)
+        {
+            continue;
+        }
+
+        Normal = Normal / DoubleArea;
+        mesh_quadric Quadric = MeshQuadricFromPlane(Normal, -Dot(Normal, P0), 0.5f*DoubleArea);
+        MeshQuadricAdd(Quadrics + Indices[IndexId + 0], &Quadric);
+        MeshQuadricAdd(Quadrics + Indices[IndexId + 1], &Quadric);
+        MeshQuadricAdd(Quadrics + Indices[IndexId + 2], &Quadric);
+    }
+
+    u32* Remap = PushArray(TempArena, u32, NumVertices);
+    b32* Touched = PushArray(TempArena, b32, NumVertices);
+    u32* TriangleOffsets = PushArray(TempArena, u32, NumVertices + 1);
+    u32* TriangleIds = PushArray(TempArena, u32, NumSourceIndices);
+    mesh_collapse* Collapses = PushArray(TempArena, mesh_collapse, NumSourceIndices);
+    // NOTE: Collapses get visited cheapest first through the sorted ids
+    u64* SortKeys = PushArray(TempArena, u64, NumSourceIndices);
+    u32* SortIds = PushArray(TempArena, u32, NumSourceIndices);
+    u64* SortKeysTemp = PushArray(TempArena, u64, NumSourceIndices);
+    u32* SortIdsTemp = PushArray(TempArena, u32, NumSourceIndices);
+    
+    u32 NumLods = 1;
+    mesh_lod Lods[MESH_MAX_LODS] = {};
+    Lods[0] = Mesh->Lods[0];
+    f32 Error = 0.0f;
+    while (NumLods < MESH_MAX_LODS)
+    {
+        mesh_lod* PrevLod = Lods + NumLods - 1;
+        u32* CurrIndices = Indices + PrevLod->FirstIndex + PrevLod->NumIndices;
+        u32 NumCurrIndices = PrevLod->NumIndices;
+        Copy(Indices + PrevLod->FirstIndex, CurrIndices, sizeof(u32)*NumCurrIndices);
+
+        u32 TargetIndices = (PrevLod->NumIndices / 6) * 3;
+        if (TargetIndices < 3*8)
+        {
+            break;
+        }
+
+        // NOTE: Collapse in passes, each pass only touches disjoint neighborhoods so the adjacency stays valid
+        while (NumCurrIndices > TargetIndices)
+        {
+            // NOTE: Vertex -> triangle adjacency
+            ZeroMem(TriangleOffsets, sizeof(u32)*(NumVertices + 1));
+            for (u32 IndexId = 0; IndexId < NumCurrIndices; ++IndexId)
+            {
+                TriangleOffsets[CurrIndices[IndexId] + 1] += 1;
+            }
+            for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+            {
+                TriangleOffsets[VertexId + 1] += TriangleOffsets[VertexId];
+            }
+            // NOTE: Use Remap as a fill counter
+            for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+            {
+                Remap[VertexId] = 0;
+            }
+            for (u32 IndexId = 0; IndexId < NumCurrIndices; ++IndexId)
+            {
+                u32 VertexId = CurrIndices[IndexId];
+                TriangleIds[TriangleOffsets[VertexId] + Remap[VertexId]++] = IndexId / 3;
+            }
+
+            // NOTE: Candidate collapses, cheapest direction per edge
+            u32 NumCollapses = 0;
+            for (u32 IndexId = 0; IndexId < NumCurrIndices; ++IndexId)
+            {
+                u32 V0 = CurrIndices[IndexId];
+                u32 V1 = CurrIndices[(IndexId % 3) == 2 ? IndexId - 2 : IndexId + 1];
+                if (V0 > V1 || (Locked[V0] && Locked[V1]))
+                {
+                    // NOTE: Each edge shows up twice (once per direction), only keep one
+                    continue;
+                }
+
+                mesh_quadric Quadric = Quadrics[V0];
+                MeshQuadricAdd(&Quadric, Quadrics + V1);
+                f32 Cost01 = MeshQuadricEval(&Quadric, Vertices[V1].Pos);
+                f32 Cost10 = MeshQuadricEval(&Quadric, Vertices[V0].Pos);
+
+                // NOTE: Locked vertices can only be collapsed onto
+                b32 Collapse01 = Locked[V1] || (!Locked[V0] && Cost01 <= Cost10);
+                mesh_collapse* Collapse = Collapses + NumCollapses++;
+                Collapse->Cost = Collapse01 ? Cost01 : Cost10;
+                Collapse->Error = Quadric.Weight > 0.0f ? SquareRoot(Collapse->Cost / Quadric.Weight) : 0.0f;
+                Collapse->From = Collapse01 ? V0 : V1;
+                Collapse->To = Collapse01 ? V1 : V0;
+
+                SortKeys[NumCollapses - 1] = RadixSortFloatKey(Collapse->Cost);
+                SortIds[NumCollapses - 1] = NumCollapses - 1;
+            }
+            RadixSort(SortKeys, SortIds, SortKeysTemp, SortIdsTemp, NumCollapses);
+
+            for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+            {
+                Remap[VertexId] = VertexId;
+                Touched[VertexId] = false;
+            }
+
+            u32 NumRemoved = 0;
+            u32 MaxRemoved = NumCurrIndices - TargetIndices;
+            for (u32 CollapseId = 0; CollapseId < NumCollapses && NumRemoved < MaxRemoved; ++CollapseId)
+            {
+                mesh_collapse* Collapse = Collapses + SortIds[CollapseId];
+                if (Touched[Collapse->From] || Touched[Collapse->To] ||
+                    MeshCollapseFlips(Vertices, CurrIndices, TriangleOffsets, TriangleIds, Collapse->From, Collapse->To))
+                {
+                    continue;
+                }
+
+                Remap[Collapse->From] = Collapse->To;
+                MeshQuadricAdd(Quadrics + Collapse->To, Quadrics + Collapse->From);
+                Error = Max(Error, Collapse->Error);
+
+                // NOTE: Everything around From changes so nothing there can collapse again this pass
+                for (u32 AdjId = TriangleOffsets[Collapse->From]; AdjId < TriangleOffsets[Collapse->From + 1]; ++AdjId)
+                {
+                    u32* Triangle = CurrIndices + 3*TriangleIds[AdjId];
+                    Touched[Triangle[0]] = true;
+                    Touched[Triangle[1]] = true;
+                    Touched[Triangle[2]] = true;
+                }
+                
+                // NOTE: A interior edge collapse removes the 2 triangles that share it
+                NumRemoved += 6;
+            }
+
+            if (NumRemoved == 0)
+            {
+                break;
+            }
+
+            // NOTE: Apply the collapses and drop the degenerate triangles
+            u32 NumNewIndices = 0;
+            for (u32 IndexId = 0; IndexId < NumCurrIndices; IndexId += 3)
+            {
+                u32 I0 = Remap[CurrIndices[IndexId + 0]];
+                u32 I1 = Remap[CurrIndices[IndexId + 1]];
+                u32 I2 = Remap[CurrIndices[IndexId + 2]];
+                if (I0 != I1 && I1 != I2 && I2 != I0)
+                {
+                    CurrIndices[NumNewIndices++] = I0;
+                    CurrIndices[NumNewIndices++] = I1;
+                    CurrIndices[NumNewIndices++] = I2;
+                }
+            }
+            NumCurrIndices = NumNewIndices;
+        }
+
+        // NOTE: Stop once the simplifier gets stuck (everything left is locked or would flip)
+        if (NumCurrIndices > (PrevLod->NumIndices*3) / 4)
+        {
+            break;
+        }
+
+        mesh_lod* Lod = Lods + NumLods++;
+        Lod->FirstIndex = PrevLod->FirstIndex + PrevLod->NumIndices;
+        Lod->NumIndices = NumCurrIndices;
+        Lod->Error = Error;
+    }
+
+    Mesh->Indices = Indices;
+    Mesh->NumLods = NumLods;
+    Mesh->NumIndices = 0;
+    for (u32 LodId = 0; LodId < NumLods; ++LodId)
+    {
+        Mesh->Lods[LodId] = Lods[LodId];
+        Mesh->NumIndices += Lods[LodId].NumIndices;
+    }
+    
+    EndTempMem(TempMem);
+}
+
+inline u32 MeshLodSelect(mesh_lod* Lods, u32 NumLods, f32 MaxError)
+{
+    // NOTE: Coarsest LOD whose error is still below what we can resolve
+    u32 Result = 0;
+    for (u32 LodId = 1; LodId < NumLods; ++LodId)
+    {
+        if (Lods[LodId].Error <= MaxError)
+        {
+            Result = LodId;
+        }
+    }
+
+    return Result;
+}
+
+//
+// NOTE: Mesh Optimization
+//
+
+inline mesh_cache_stats MeshCacheStatsGet(linear_arena* TempArena, u32* Indices, u32 NumIndices, u32 NumVertices)
+{
+    mesh_cache_stats Result = {};
+    if (NumIndices == 0)
+    {
+        return Result;
+    }
+    
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    // NOTE: A vertex is in the FIFO if less than cache size misses happened since it was inserted
+    u32* InsertTime = PushArray(TempArena, u32, NumVertices);
+    ZeroMem(InsertTime, sizeof(u32)*NumVertices);
+    b32* Used = PushArray(TempArena, b32, NumVertices);
+    ZeroMem(Used, sizeof(b32)*NumVertices);
+    
+    u32 Time = MESH_STATS_CACHE_SIZE;
+    u32 NumMisses = 0;
+    u32 NumUsedVertices = 0;
+    for (u32 IndexId = 0; IndexId < NumIndices; ++IndexId)
+    {
+        u32 VertexId = Indices[IndexId];
+        if (!Used[VertexId])
+        {
+            Used[VertexId] = true;
+            NumUsedVertices += 1;
+        }
+        
+        if (Time - InsertTime[VertexId] >= MESH_STATS_CACHE_SIZE)
+        {
+            InsertTime[VertexId] = Time++;
+            NumMisses += 1;
+        }
+    }
+
+    Result.Acmr = f32(NumMisses) / f32(NumIndices / 3);
+    Result.Atvr = f32(NumMisses) / f32(NumUsedVertices);
+
+    EndTempMem(TempMem);
+
+    return Result;
+}
+
+inline f32 MeshVertexScore(i32 CachePos, u32 NumRemaining)
+{
+    if (NumRemaining == 0)
+    {
+        // NOTE: No triangle left needs this vertex
+        return -1.0f;
+    }
+
+    f32 Result = 0.0f;
+    if (CachePos >= 0)
+    {
+        if (CachePos < 3)
+        {
+            // NOTE: Used by the last triangle, we don't want to favor them over the rest of the cache or we get long strips
+            Result = 0.75f;
+        }
+        else
+        {
+            Result = powf(1.0f - f32(CachePos - 3) / f32(MESH_OPTIMIZE_CACHE_SIZE - 3), 1.5f);
+        }
+    }
+
+    // NOTE: Boost vertices with few triangles left so that we don't leave lone triangles behind
+    Result += 2.0f / SquareRoot(f32(NumRemaining));
+    
+    return Result;
+}
+
+inline void MeshCacheOptimize(linear_arena* TempArena, u32* Indices, u32 NumIndices, u32 NumVertices)
+{
+    u32 NumTriangles = NumIndices / 3;
+    if (NumTriangles == 0)
+    {
+        return;
+    }
+    
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    // NOTE: Vertex -> remaining triangles, emitted triangles get swapped out to the end of each vertices range
+    u32* TriangleOffsets = PushArray(TempArena, u32, NumVertices + 1);
+    u32* NumRemaining = PushArray(TempArena, u32, NumVertices);
+    u32* TriangleIds = PushArray(TempArena, u32, NumIndices);
+    ZeroMem(TriangleOffsets, sizeof(u32)*(NumVertices + 1));
+    ZeroMem(NumRemaining, sizeof(u32)*NumVertices);
+    for (u32 IndexId = 0; IndexId < NumIndices; ++IndexId)
+    {
+        TriangleOffsets[Indices[IndexId] + 1] += 1;
+    }
+    for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        TriangleOffsets[VertexId + 1] += TriangleOffsets[VertexId];
+    }
+    for (u32 IndexId = 0; IndexId < NumIndices; ++IndexId)
+    {
+        u32 VertexId = Indices[IndexId];
+        TriangleIds[TriangleOffsets[VertexId] + NumRemaining[VertexId]++] = IndexId / 3;
+    }
+
+    i32* CachePos = PushArray(TempArena, i32, NumVertices);
+    f32* VertexScores = PushArray(TempArena, f32, NumVertices);
+    for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        CachePos[VertexId] = -1;
+        VertexScores[VertexId] = MeshVertexScore(-1, NumRemaining[VertexId]);
+    }
+
+    f32* TriangleScores = PushArray(TempArena, f32, NumTriangles);
+    b32* Emitted = PushArray(TempArena, b32, NumTriangles);
+    for (u32 TriangleId = 0; TriangleId < NumTriangles; ++TriangleId)
+    {
+        u32* Triangle = Indices + 3*TriangleId;
+        TriangleScores[TriangleId] = VertexScores[Triangle[0]] + VertexScores[Triangle[1]] + VertexScores[Triangle[2]];
+        Emitted[TriangleId] = false;
+    }
+
+    u32* Result = PushArray(TempArena, u32, NumIndices);
+    u32 Cache[MESH_OPTIMIZE_CACHE_SIZE + 3];
+    u32 CacheSize = 0;
+    u32 ScanCursor = 0;
+    i32 BestTriangle = -1;
+    for (u32 EmitId = 0; EmitId < NumTriangles; ++EmitId)
+    {
+        if (BestTriangle < 0)
+        {
+            // NOTE: Nothing in the cache has triangles left, continue with the best remaining triangle
+            f32 BestScore = -1.0f;
+            for (u32 TriangleId = ScanCursor; TriangleId < NumTriangles; ++TriangleId)
+            {
+                if (!Emitted[TriangleId] && TriangleScores[TriangleId] > BestScore)
+                {
+                    BestScore = TriangleScores[TriangleId];
+                    BestTriangle = TriangleId;
+                }
+            }
+            Assert(BestTriangle >= 0);
+        }
+
+        u32* Triangle = Indices + 3*BestTriangle;
+        Emitted[BestTriangle] = true;
+        Result[3*EmitId + 0] = Triangle[0];
+        Result[3*EmitId + 1] = Triangle[1];
+        Result[3*EmitId + 2] = Triangle[2];
+        while (ScanCursor < NumTriangles && Emitted[ScanCursor])
+        {
+            ScanCursor += 1;
+        }
+        
+        // NOTE: Remove the triangle from its vertices adjacency
+        for (u32 CornerId = 0; CornerId < 3; ++CornerId)
+        {
+            u32 VertexId = Triangle[CornerId];
+            u32* VertexTriangles = TriangleIds + TriangleOffsets[VertexId];
+            for (u32 AdjId = 0; AdjId < NumRemaining[VertexId]; ++AdjId)
+            {
+                if (VertexTriangles[AdjId] == u32(BestTriangle))
+                {
+                    VertexTriangles[AdjId] = VertexTriangles[NumRemaining[VertexId] - 1];
+                    VertexTriangles[NumRemaining[VertexId] - 1] = BestTriangle;
+                    NumRemaining[VertexId] -= 1;
+                    break;
+                }
+            }
+        }
+
+        // NOTE: Move the triangles vertices to the front of the LRU cache, the cache temporarily grows by up to 3
+        u32 NewCache[MESH_OPTIMIZE_CACHE_SIZE + 6];
+        u32 NewCacheSize = 0;
+        NewCache[NewCacheSize++] = Triangle[0];
+        NewCache[NewCacheSize++] = Triangle[1];
+        NewCache[NewCacheSize++] = Triangle[2];
+        for (u32 CacheId = 0; CacheId < CacheSize; ++CacheId)
+        {
+            u32 VertexId = Cache[CacheId];
+            if (VertexId != Triangle[0] && VertexId != Triangle[1] && VertexId != Triangle[2])
+            {
+                NewCache[NewCacheSize++] = VertexId;
+            }
+        }
+
+        // NOTE: Update scores of everything in the cache (and what got pushed out) and find the next best triangle among them
+        f32 BestScore = -1.0f;
+        BestTriangle = -1;
+        CacheSize = Min(NewCacheSize, u32(MESH_OPTIMIZE_CACHE_SIZE));
+        for (u32 CacheId = 0; CacheId < NewCacheSize; ++CacheId)
+        {
+            u32 VertexId = NewCache[CacheId];
+            if (CacheId < CacheSize)
+            {
+                Cache[CacheId] = VertexId;
+            }
+            CachePos[VertexId] = CacheId < CacheSize ? i32(CacheId) : -1;
+
+            f32 NewScore = MeshVertexScore(CachePos[VertexId], NumRemaining[VertexId]);
+            f32 ScoreDelta = NewScore - VertexScores[VertexId];
+            VertexScores[VertexId] = NewScore;
+            
+            u32* VertexTriangles = TriangleIds + TriangleOffsets[VertexId];
+            for (u32 AdjId = 0; AdjId < NumRemaining[VertexId]; ++AdjId)
+            {
+                u32 TriangleId = VertexTriangles[AdjId];
+                TriangleScores[TriangleId] += ScoreDelta;
+                if (TriangleScores[TriangleId] > BestScore)
+                {
+                    BestScore = TriangleScores[TriangleId];
+                    BestTriangle = TriangleId;
+                }
+            }
+        }
+    }
+
+    Copy(Result, Indices, sizeof(u32)*NumIndices);
+    
+    EndTempMem(TempMem);
+}
+
+inline void MeshOverdrawOptimize(linear_arena* TempArena, mesh_vertex* Vertices, u32 NumVertices, u32* Indices, u32 NumIndices)
+{
+    u32 NumTriangles = NumIndices / 3;
+    if (NumTriangles == 0)
+    {
+        return;
+    }
+    
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    // NOTE: Cut the cache optimized order wherever the simulated cache got flushed (all 3 vertices missed), so every cluster keeps
+    // its cache locality no matter what order the clusters end up in
+    u32 MaxNumClusters = NumTriangles;
+    mesh_cluster* Clusters = PushArray(TempArena, mesh_cluster, MaxNumClusters);
+    u32 NumClusters = 0;
+    {
+        u32* InsertTime = PushArray(TempArena, u32, NumVertices);
+        ZeroMem(InsertTime, sizeof(u32)*NumVertices);
+        u32 Time = MESH_STATS_CACHE_SIZE;
+
+        for (u32 TriangleId = 0; TriangleId < NumTriangles; ++TriangleId)
+        {
+            u32 NumMisses = 0;
+            for (u32 CornerId = 0; CornerId < 3; ++CornerId)
+            {
+                u32 VertexId = Indices[3*TriangleId + CornerId];
+                if (Time - InsertTime[VertexId] >= MESH_STATS_CACHE_SIZE)
+                {
+                    InsertTime[VertexId] = Time++;
+                    NumMisses += 1;
+                }
+            }
+
+            if (TriangleId == 0 || NumMisses == 3)
+            {
+                mesh_cluster* Cluster = Clusters + NumClusters++;
+                Cluster->FirstIndex = 3*TriangleId;
+                Cluster->NumIndices = 0;
+            }
+            Clusters[NumClusters - 1].NumIndices += 3;
+        }
+    }
+    
+    v3 MeshCenter = V3(0.0f);
+    for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        MeshCenter += Vertices[VertexId].Pos;
+    }
+    MeshCenter = MeshCenter / f32(NumVertices);
+
+    for (u32 ClusterId = 0; ClusterId < NumClusters; ++ClusterId)
+    {
+        mesh_cluster* Cluster = Clusters + ClusterId;
+        
+        v3 Centroid = V3(0.0f);
+        v3 Normal = V3(0.0f);
+        f32 Area = 0.0f;
+        for (u32 IndexId = Cluster->FirstIndex; IndexId < Cluster->FirstIndex + Cluster->NumIndices; IndexId += 3)
+        {
+            v3 P0 = Vertices[Indices[IndexId + 0]].Pos;
+            v3 P1 = Vertices[Indices[IndexId + 1]].Pos;
+            v3 P2 = Vertices[Indices[IndexId + 2]].Pos;
+            v3 TriangleNormal = Cross(P1 - P0, P2 - P0);
+            f32 TriangleArea = Length(TriangleNormal);
+            Centroid += TriangleArea*(P0 + P1 + P2) / 3.0f;
+            Normal += TriangleNormal;
+            Area += TriangleArea;
+        }
+
+        Cluster->SortKey = 0.0f;
+        if (Area > 0.0f && LengthSquared(Normal) > 0.0f)
+        {
+            Centroid = Centroid / Area;
+            Cluster->SortKey = Dot(Centroid - MeshCenter, Normalize(Normal));
+        }
+    }
+
+    // NOTE: Descending, clusters that face away from the center (and so occlude the rest) go first
+    u64* SortKeys = PushArray(TempArena, u64, NumClusters);
+    u32* SortIds = PushArray(TempArena, u32, NumClusters);
+    u64* SortKeysTemp = PushArray(TempArena, u64, NumClusters);
+    u32* SortIdsTemp = PushArray(TempArena, u32, NumClusters);
+    for (u32 ClusterId = 0; ClusterId < NumClusters; ++ClusterId)
+    {
+        SortKeys[ClusterId] = ~RadixSortFloatKey(Clusters[ClusterId].SortKey);
+        SortIds[ClusterId] = ClusterId;
+    }
+    RadixSort(SortKeys, SortIds, SortKeysTemp, SortIdsTemp, NumClusters);
+
+    u32* Result = PushArray(TempArena, u32, NumIndices);
+    u32 NumResultIndices = 0;
+    for (u32 ClusterId = 0; ClusterId < NumClusters; ++ClusterId)
+    {
+        mesh_cluster* Cluster = Clusters + SortIds[ClusterId];
+        Copy(Indices + Cluster->FirstIndex, Result + NumResultIndices, sizeof(u32)*Cluster->NumIndices);
+        NumResultIndices += Cluster->NumIndices;
+    }
+    Copy(Result, Indices, sizeof(u32)*NumIndices);
+    
+    EndTempMem(TempMem);
+}
+
+inline void MeshVertexFetchOptimize(linear_arena* TempArena, mesh* Mesh)
+{
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    // NOTE: Renumber vertices in order of first use, LOD 0 comes first in the index buffer so its order wins
+    u32* Remap = PushArray(TempArena, u32, Mesh->NumVertices);
+    for (u32 VertexId = 0; VertexId < Mesh->NumVertices; ++VertexId)
+    {
+        Remap[VertexId] = 0xFFFFFFFF;
+    }
+
+    mesh_vertex* Vertices = PushArray(TempArena, mesh_vertex, Mesh->NumVertices);
+    u32 NumUsedVertices = 0;
+    for (u32 IndexId = 0; IndexId < Mesh->NumIndices; ++IndexId)
+    {
+        u32 VertexId = Mesh->Indices[IndexId];
+        if (Remap[VertexId] == 0xFFFFFFFF)
+        {
+            Vertices[NumUsedVertices] = Mesh->Vertices[VertexId];
+            Remap[VertexId] = NumUsedVertices++;
+        }
+        Mesh->Indices[IndexId] = Remap[VertexId];
+    }
+
+    // NOTE: Unreferenced vertices get dropped
+    Copy(Vertices, Mesh->Vertices, sizeof(mesh_vertex)*NumUsedVertices);
+    Mesh->NumVertices = NumUsedVertices;
+    
+    EndTempMem(TempMem);
+}
+
+inline void MeshOptimize(linear_arena* TempArena, mesh* Mesh, mesh_cache_stats* StatsBefore, mesh_cache_stats* StatsAfter)
+{
+    *StatsBefore = MeshCacheStatsGet(TempArena, Mesh->Indices + Mesh->Lods[0].FirstIndex, Mesh->Lods[0].NumIndices, Mesh->NumVertices);
+    
+    for (u32 LodId = 0; LodId < Mesh->NumLods; ++LodId)
+    {
+        mesh_lod* Lod = Mesh->Lods + LodId;
+        MeshCacheOptimize(TempArena, Mesh->Indices + Lod->FirstIndex, Lod->NumIndices, Mesh->NumVertices);
+        MeshOverdrawOptimize(TempArena, Mesh->Vertices, Mesh->NumVertices, Mesh->Indices + Lod->FirstIndex, Lod->NumIndices);
+    }
+    MeshVertexFetchOptimize(TempArena, Mesh);
+
+    *StatsAfter = MeshCacheStatsGet(TempArena, Mesh->Indices + Mesh->Lods[0].FirstIndex, Mesh->Lods[0].NumIndices, Mesh->NumVertices);
+}
+
+//
+// NOTE: Vertex Quantization
+//
+
+inline u16 MeshF32ToF16(f32 Value)
+{
+    // NOTE: Round to nearest, no denormals/NaNs (we only use this for uvs)
+    u32 Bits = *(u32*)&Value;
+    u32 Sign = (Bits >> 16) & 0x8000;
+    i32 Exponent = i32((Bits >> 23) & 0xFF) - 127 + 15;
+    u32 Mantissa = Bits & 0x7FFFFF;
+
+    u16 Result = 0;
+    if (Exponent <= 0)
+    {
+        Result = u16(Sign);
+    }
+    else if (Exponent >= 31)
+    {
+        Result = u16(Sign | 0x7C00);
+    }
+    else
+    {
+        // NOTE: Rounding can carry into the exponent which is what we want
+        Result = u16((Sign | (u32(Exponent) << 10) | (Mantissa >> 13)) + ((Mantissa >> 12) & 1));
+    }
+
+    return Result;
+}
+
+inline i16 MeshF32ToSnorm16(f32 Value)
+{
+    f32 Clamped = Max(-1.0f, Min(1.0f, Value));
+    i16 Result = i16(Clamped >= 0.0f ? Clamped*32767.0f + 0.5f : Clamped*32767.0f - 0.5f);
+    return Result;
+}
+
+inline v2 MeshOctEncode(v3 Normal)
+{
+    // NOTE: Project onto the octahedron and fold the bottom half over the top
+    v2 Result = Normal.xy / (Abs(Normal.x) + Abs(Normal.y) + Abs(Normal.z));
+    if (Normal.z < 0.0f)
+    {
+        v2 Folded = V2(1.0f - Abs(Result.y), 1.0f - Abs(Result.x));
+        Result.x = Result.x >= 0.0f ? Folded.x : -Folded.x;
+        Result.y = Result.y >= 0.0f ? Folded.y : -Folded.y;
+    }
+
+    return Result;
+}
+
+inline mesh_vertex_attributes MeshVertexAttributesPack(mesh_vertex* Vertex)
+{
+    mesh_vertex_attributes Result = {};
+    v2 OctNormal = MeshOctEncode(Vertex->Normal);
+    Result.NormalX = MeshF32ToSnorm16(OctNormal.x);
+    Result.NormalY = MeshF32ToSnorm16(OctNormal.y);
+    Result.U = MeshF32ToF16(Vertex->Uv.x);
+    Result.V = MeshF32ToF16(Vertex->Uv.y);
+
+    return Result;
+}
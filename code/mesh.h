@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+
+  NOTE: CPU side meshes
+
+    We generate our meshes on the CPU so that we have the data around to compute bounds (and later do other processing on it) before
+    it gets uploaded. On upload we split the vertices into 2 streams:
+
+      - Positions (12 bytes), the only thing depth only passes need so they don't pull normals/uvs through the vertex cache
+      - Attributes (8 bytes), octahedral normals in 2 snorm16s + uvs in 2 halfs
+
+  NOTE: LODs
+
+    Every mesh gets a LOD chain from a quadric error metric simplifier (Garland/Heckbert) that only does half edge collapses, so all
+    LODs share the vertex buffer and each LOD is just a range of the index buffer. Every LOD halves the triangle count and records the
+    max geometric error it introduced, which is what selection compares against the pixel/texel footprint. The quadrics are area
+    weighted so big triangles dominate which collapse goes first, the error divides that weight back out so it is the area weighted
+    RMS distance to the original planes (in mesh units). Vertices on uv/normal seams and open borders are locked so that LODs don't
+    tear.
+
+  NOTE: Optimization
+
+    Before upload every LOD gets its triangles reordered for the post transform cache (Forsyth's linear speed optimizer), then the
+    cache friendly order gets cut into clusters which are sorted so that outward facing clusters draw first (Sander et al. 2007), which
+    cuts down overdraw without giving up much of the cache hits. Last, vertices get renumbered in order of first use so that vertex
+    fetch walks through memory linearly. We report ACMR (cache misses per triangle) and ATVR (cache misses per vertex, 1 is optimal)
+    for a FIFO cache before and after.
+
+    - https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    - https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf
+  
+ */
+
+#define MESH_MAX_LODS 8
+// NOTE: How much error we accept, the shadow pass only cares about the silhouette at texel resolution so it gets to be coarser
+#define MESH_LOD_FORWARD_PIXELS 1.0f
+#define MESH_LOD_SHADOW_TEXELS 2.0f
+
+// NOTE: The optimizer scores against a LRU cache, the stats simulate a FIFO cache like most hardware has
+#define MESH_OPTIMIZE_CACHE_SIZE 32
+#define MESH_STATS_CACHE_SIZE 16
+
+struct mesh_vertex
+{
+    v3 Pos;
+    v3 Normal;
+    v2 Uv;
+};
+
+struct mesh_lod
+{
+    u32 FirstIndex;
+    u32 NumIndices;
+    f32 Error;
+};
+
+struct mesh
+{
+    u32 NumVertices;
+    mesh_vertex* Vertices;
+    // NOTE: Holds all LODs back to back
+    u32 NumIndices;
+    u32* Indices;
+
+    u32 NumLods;
+    mesh_lod Lods[MESH_MAX_LODS];
+};
+
+struct mesh_quadric
+{
+    // NOTE: Symmetric 4x4, stored as the upper triangle
+    f32 A00, A01, A02, A03;
+    f32 A11, A12, A13;
+    f32 A22, A23;
+    f32 A33;
+    // NOTE: Sum of the plane weights (triangle areas), summed along with the rest so that we can normalize the error
+    f32 Weight;
+};
+
+struct mesh_collapse
+{
+    // NOTE: Cost orders the collapses, Error is the cost normalized by the quadric weight
+    f32 Cost;
+    f32 Error;
+    u32 From;
+    u32 To;
+};
+
+struct mesh_cache_stats
+{
+    // NOTE: Cache misses per triangle and per vertex
+    f32 Acmr;
+    f32 Atvr;
+};
+
+struct mesh_cluster
+{
+    f32 SortKey;
+    u32 FirstIndex;
+    u32 NumIndices;
+};
+
+struct mesh_vertex_attributes
+{
+    i16 NormalX;
+    i16 NormalY;
+    u16 U;
+    u16 V;
+};
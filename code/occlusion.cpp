@@ -0,0 +1,322 @@
+
+//
+// NOTE: Occlusion Culling
+//
+
+inline void OcclusionBufferBarrier(VkCommandBuffer CmdBuffer, VkPipelineStageFlags SrcStage, VkAccessFlags SrcAccess,
+                                   VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    VkMemoryBarrier Barrier = {};
+    Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    Barrier.srcAccessMask = SrcAccess;
+    Barrier.dstAccessMask = DstAccess;
+    vkCmdPipelineBarrier(CmdBuffer, SrcStage, DstStage, 0, 1, &Barrier, 0, 0, 0, 0);
+}
+
+inline void OcclusionResize(occlusion_culling* Occlusion, render_graph* Graph, u32 Width, u32 Height, render_target_entry* DepthEntry)
+{
+    // NOTE: Level 0 is half res, every level rounds up so odd edges stay covered. The pyramid only lives from its build to the late
+    // cull, so the levels are transients
+    u32 PrevNumLevels = Occlusion->NumLevels;
+    Occlusion->NumLevels = 0;
+    u32 LevelWidth = (Width + 1) / 2;
+    u32 LevelHeight = (Height + 1) / 2;
+    while (Occlusion->NumLevels < OCCLUSION_MAX_LEVELS)
+    {
+        occlusion_level* Level = Occlusion->Levels + Occlusion->NumLevels++;
+        Level->Width = LevelWidth;
+        Level->Height = LevelHeight;
+        RenderGraphTransientCreate(Graph, &Level->ImageId, LevelWidth, LevelHeight, VK_FORMAT_R32_SFLOAT,
+                                   VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                                   RenderGraphPass_OcclusionPyramid, RenderGraphPass_OcclusionCullLate, &Level->Image, &Level->Entry);
+
+        if (LevelWidth == 1 && LevelHeight == 1)
+        {
+            break;
+        }
+        LevelWidth = (LevelWidth + 1) / 2;
+        LevelHeight = (LevelHeight + 1) / 2;
+    }
+
+    // NOTE: Smaller windows need fewer levels, give the memory of the rest back
+    for (u32 LevelId = Occlusion->NumLevels; LevelId < PrevNumLevels; ++LevelId)
+    {
+        RenderGraphTransientDestroy(Graph, Occlusion->Levels[LevelId].ImageId);
+    }
+
+    // NOTE: Downsample chain, the first level reads the depth buffer
+    for (u32 LevelId = 0; LevelId < Occlusion->NumLevels; ++LevelId)
+    {
+        occlusion_level* Level = Occlusion->Levels + LevelId;
+        if (LevelId == 0)
+        {
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Level->Descriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   DepthEntry->View, DemoState->PointSampler, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        }
+        else
+        {
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Level->Descriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   Occlusion->Levels[LevelId - 1].Entry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        VkDescriptorImageWrite(&RenderState->DescriptorManager, Level->Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                               Level->Entry.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    // NOTE: The culling shader indexes the levels, unused slots repeat the last level so the whole array stays valid
+    {
+        VkDescriptorImageInfo ImageInfos[OCCLUSION_MAX_LEVELS] = {};
+        for (u32 LevelId = 0; LevelId < OCCLUSION_MAX_LEVELS; ++LevelId)
+        {
+            occlusion_level* Level = Occlusion->Levels + Min(LevelId, Occlusion->NumLevels - 1);
+            ImageInfos[LevelId].sampler = DemoState->PointSampler;
+            ImageInfos[LevelId].imageView = Level->Entry.View;
+            ImageInfos[LevelId].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        // NOTE: Resizes happen after a device wait idle, so every frames set can be written right away
+        for (u32 SlotId = 0; SlotId < GROWABLE_FRAMES_IN_FLIGHT; ++SlotId)
+        {
+            VkWriteDescriptorSet Write = {};
+            Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            Write.dstSet = Occlusion->CullDescriptors[SlotId];
+            Write.dstBinding = 1;
+            Write.dstArrayElement = 0;
+            Write.descriptorCount = OCCLUSION_MAX_LEVELS;
+            Write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            Write.pImageInfo = ImageInfos;
+            vkUpdateDescriptorSets(RenderState->Device, 1, &Write, 0, 0);
+        }
+    }
+}
+
+inline void OcclusionCullDescriptorWrite(occlusion_culling* Occlusion, geometry_buffer* Geometry, u32 FrameSlot)
+{
+    VkDescriptorSet Descriptor = Occlusion->CullDescriptors[FrameSlot];
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Occlusion->GlobalsBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Occlusion->BoundsBuffer.Slots[FrameSlot].Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Geometry->IndirectBuffer.Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Occlusion->BatchFirstBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Occlusion->BatchIdBuffer.Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Occlusion->VisibilityBuffer.Buffer);
+    for (u32 ListId = 0; ListId < OcclusionList_Count; ++ListId)
+    {
+        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 7 + ListId, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                Occlusion->CommandBuffers[ListId].Buffer);
+    }
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Occlusion->CountBuffer);
+}
+
+inline void OcclusionCapacityResize(growable_state* Growable, VkCommandBuffer CmdBuffer, occlusion_culling* Occlusion, u32 MaxNumInstances,
+                                    u32 MaxNumCommands)
+{
+    // NOTE: Only the visibility carries over between frames, everything else gets uploaded or written by the cull every frame
+    GrowableMappedBufferResize(Growable, &Occlusion->BoundsBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               sizeof(occlusion_bounds_gpu)*u64(MaxNumInstances));
+    GrowableBufferResize(Growable, CmdBuffer, &Occlusion->BatchIdBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         sizeof(u32)*u64(MaxNumCommands), false);
+    GrowableBufferResize(Growable, CmdBuffer, &Occlusion->VisibilityBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         sizeof(u32)*u64(MaxNumInstances), true);
+    for (u32 ListId = 0; ListId < OcclusionList_Count; ++ListId)
+    {
+        GrowableBufferResize(Growable, CmdBuffer, &Occlusion->CommandBuffers[ListId],
+                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                             sizeof(VkDrawIndexedIndirectCommand)*u64(MaxNumCommands), false);
+    }
+
+    Occlusion->MaxNumInstances = MaxNumInstances;
+    Occlusion->MaxNumCommands = MaxNumCommands;
+    Occlusion->CullDescriptorsDirty = (1u << GROWABLE_FRAMES_IN_FLIGHT) - 1;
+}
+
+inline void OcclusionFrameBegin(occlusion_culling* Occlusion, geometry_buffer* Geometry, u32 FrameSlot)
+{
+    // NOTE: This frames set isn't in use anymore, so it can pick up buffers that grew since it was last written
+    Occlusion->CullDescriptor = Occlusion->CullDescriptors[FrameSlot];
+    if (Occlusion->CullDescriptorsDirty & (1u << FrameSlot))
+    {
+        OcclusionCullDescriptorWrite(Occlusion, Geometry, FrameSlot);
+        Occlusion->CullDescriptorsDirty &= ~(1u << FrameSlot);
+    }
+}
+
+inline void OcclusionCreate(growable_state* Growable, geometry_buffer* Geometry, u32 MaxNumInstances, b32 MaterialBindless,
+                            occlusion_culling* Result)
+{
+    u32 MaxNumCommands = Geometry->MaxNumCommands;
+    *Result = {};
+
+    Result->Supported = Geometry->IndirectFirstInstance;
+    Result->Enabled = Result->Supported;
+    Result->Compact = DemoState->DeviceCaps.DrawIndirectCount && MaterialBindless;
+
+    // NOTE: Buffers
+    {
+        Result->GlobalsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                               sizeof(occlusion_globals_gpu));
+        Result->BatchFirstBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                  sizeof(u32)*OCCLUSION_MAX_BATCHES);
+        OcclusionCapacityResize(Growable, VK_NULL_HANDLE, Result, MaxNumInstances, MaxNumCommands);
+        Result->CountBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                             sizeof(u32)*OCCLUSION_MAX_BATCHES*OcclusionList_Count);
+    }
+
+    // NOTE: Pyramid downsample
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->DownsampleDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+        }
+
+        for (u32 LevelId = 0; LevelId < OCCLUSION_MAX_LEVELS; ++LevelId)
+        {
+            Result->Levels[LevelId].Descriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool,
+                                                                         Result->DownsampleDescLayout);
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+        {
+            Result->DownsampleDescLayout,
+        };
+        Result->DownsamplePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                             "shader_hiz_downsample_comp.spv", "main", Layouts, ArrayCount(Layouts));
+    }
+
+    // NOTE: Culling
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->CullDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, OCCLUSION_MAX_LEVELS, VK_SHADER_STAGE_COMPUTE_BIT);
+            // NOTE: Bounds, input commands, batch firsts, batch ids, visibility
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            // NOTE: Early, late, final commands and the counts
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+        }
+
+        for (u32 SlotId = 0; SlotId < GROWABLE_FRAMES_IN_FLIGHT; ++SlotId)
+        {
+            Result->CullDescriptors[SlotId] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->CullDescLayout);
+            OcclusionCullDescriptorWrite(Result, Geometry, SlotId);
+        }
+        Result->CullDescriptor = Result->CullDescriptors[0];
+        Result->CullDescriptorsDirty = 0;
+
+        VkDescriptorSetLayout Layouts[] =
+        {
+            Result->CullDescLayout,
+        };
+        Result->CullEarlyPipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                            "shader_occlusion_cull_early_comp.spv", "main", Layouts, ArrayCount(Layouts));
+        Result->CullLatePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                           "shader_occlusion_cull_late_comp.spv", "main", Layouts, ArrayCount(Layouts));
+    }
+}
+
+inline void OcclusionUpload(occlusion_culling* Occlusion, render_scene* Scene, u32 FrameSlot)
+{
+    geometry_draw_list* List = &Scene->ForwardDraws;
+    Assert(List->NumBatches <= OCCLUSION_MAX_BATCHES);
+
+    // NOTE: Globals
+    {
+        occlusion_globals_gpu* Globals = VkTransferPushWriteStruct(&RenderState->TransferManager, Occlusion->GlobalsBuffer, occlusion_globals_gpu,
+                                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                                   BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+        *Globals = {};
+        Globals->VPTransform = CameraGetVP(&Scene->Camera);
+        Globals->PyramidSize = V2(f32(Occlusion->Levels[0].Width), f32(Occlusion->Levels[0].Height));
+        Globals->NumLevels = Occlusion->NumLevels;
+        Globals->FirstCommand = List->FirstCommand;
+        Globals->NumCommands = List->NumCommands;
+        Globals->Compact = Occlusion->Compact;
+    }
+
+    if (Scene->NumOpaqueInstances > 0)
+    {
+        occlusion_bounds_gpu* Bounds = GrowableMappedArray(&Occlusion->BoundsBuffer, FrameSlot, occlusion_bounds_gpu);
+        for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+        {
+            instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+            Bounds[InstanceId].Min = V4(CurrInstance->BoundsMin, 0.0f);
+            Bounds[InstanceId].Max = V4(CurrInstance->BoundsMax, 0.0f);
+        }
+    }
+
+    // NOTE: Batch ids are indexed by command, they only cover the forward list
+    if (List->NumBatches > 0)
+    {
+        u32* BatchFirsts = VkTransferPushWriteArray(&RenderState->TransferManager, Occlusion->BatchFirstBuffer, u32, List->NumBatches,
+                                                    BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                    BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+        u32* BatchIds = (u32*)VkTransferPushWrite(&RenderState->TransferManager, Occlusion->BatchIdBuffer.Buffer, sizeof(u32)*List->FirstCommand,
+                                                  sizeof(u32)*List->NumCommands,
+                                                  BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                  BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+        for (u32 BatchId = 0; BatchId < List->NumBatches; ++BatchId)
+        {
+            geometry_draw_batch* Batch = Scene->Geometry.Batches + List->FirstBatch + BatchId;
+            BatchFirsts[BatchId] = Batch->FirstCommand;
+            for (u32 CommandId = 0; CommandId < Batch->NumCommands; ++CommandId)
+            {
+                BatchIds[Batch->FirstCommand - List->FirstCommand + CommandId] = BatchId;
+            }
+        }
+    }
+}
+
+inline void OcclusionCull(VkCommandBuffer CmdBuffer, occlusion_culling* Occlusion, geometry_draw_list* List, b32 Late)
+{
+    if (!Late)
+    {
+        // NOTE: First use the visibility is garbage, start with nothing visible so everything goes through the late test
+        if (!Occlusion->VisibilityCleared)
+        {
+            vkCmdFillBuffer(CmdBuffer, Occlusion->VisibilityBuffer.Buffer, 0, VK_WHOLE_SIZE, 0);
+            Occlusion->VisibilityCleared = true;
+        }
+        vkCmdFillBuffer(CmdBuffer, Occlusion->CountBuffer, 0, VK_WHOLE_SIZE, 0);
+        OcclusionBufferBarrier(CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    vk_pipeline* Pipeline = Late ? Occlusion->CullLatePipeline : Occlusion->CullEarlyPipeline;
+    vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+    vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, 1, &Occlusion->CullDescriptor, 0, 0);
+    vkCmdDispatch(CmdBuffer, (List->NumCommands + 63) / 64, 1, 1);
+
+    OcclusionBufferBarrier(CmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+inline void OcclusionPyramidBuild(VkCommandBuffer CmdBuffer, occlusion_culling* Occlusion)
+{
+    // NOTE: The graph moves depth to read only and discards the levels, every level gets fully rewritten
+    vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Occlusion->DownsamplePipeline->Handle);
+    for (u32 LevelId = 0; LevelId < Occlusion->NumLevels; ++LevelId)
+    {
+        occlusion_level* Level = Occlusion->Levels + LevelId;
+
+        vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Occlusion->DownsamplePipeline->Layout, 0, 1, &Level->Descriptor, 0, 0);
+        vkCmdDispatch(CmdBuffer, (Level->Width + 7) / 8, (Level->Height + 7) / 8, 1);
+
+        // NOTE: The next level reads this one
+        AsyncComputeImageBarrier(CmdBuffer, Level->Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                                 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+
+  NOTE: Occlusion Culling
+
+    The BVH only removes what is outside the frustum, everything hidden behind the walls still gets drawn. We cull the forward draw
+    list on the GPU against a hierarchical depth pyramid in two phases:
+
+      - Early: draw the commands whose instance was visible last frame into the depth prepass
+      - Build the pyramid from that depth, each texel is the farthest (min, depth is reversed) depth of its footprint
+      - Late: test every command against the pyramid. Newly visible ones get drawn into the depth prepass, everything visible now or
+        drawn in the early phase goes into the final list for the forward pass, and the visibility flags get updated for next frame
+
+    Both phases write the frame's forward commands into their own indirect buffers, so the CPU never waits on the results. There are
+    two layouts:
+
+      - Compact: the commands that pass get appended per batch and the draws use vkCmdDrawIndexedIndirectCount. The slots come from
+        an atomic per batch, so the draw order within a batch is whatever order the threads got there, not the front to back order of
+        the draw keys. That only costs early z in the depth prepass itself, everything after it tests EQUAL against resolved depth
+      - In place: every command keeps its slot and culled ones get instanceCount 0, the draws are the same fixed count draws as the
+        unculled list. Used without drawIndirectCount and without bindless materials, since the per material rebinds walk the CPU
+        commands and need them at the same index. Keeps the front to back order
+
+    The pyramid levels are separate images so they can be created like any other render target entry, level 0 is half the depth
+    resolution (rounded up).
+
+    Visibility is tracked per instance id. The demo re-adds instances in the same order every frame, if that changes the worst case
+    is a frame where some instances go through the late phase.
+
+    IMPORTANT: The culled commands get drawn straight from the GPU buffers, so this needs drawIndirectFirstInstance (see
+    DeviceCaps.DrawIndirectFirstInstance) for the instance ids. Without it we keep drawing the unculled lists. Compact needs
+    drawIndirectCount (core in 1.2, see DeviceCaps.DrawIndirectCount).
+
+ */
+
+#define OCCLUSION_MAX_LEVELS 16
+#define OCCLUSION_MAX_BATCHES 64
+
+enum occlusion_list
+{
+    OcclusionList_Early,
+    OcclusionList_Late,
+    OcclusionList_Final,
+
+    OcclusionList_Count,
+};
+
+struct occlusion_globals_gpu
+{
+    m4 VPTransform;
+    v2 PyramidSize;
+    u32 NumLevels;
+    u32 FirstCommand;
+    u32 NumCommands;
+    b32 Compact;
+    u32 Pad1;
+    u32 Pad2;
+};
+
+struct occlusion_bounds_gpu
+{
+    v4 Min;
+    v4 Max;
+};
+
+struct occlusion_level
+{
+    u32 Width;
+    u32 Height;
+    u32 ImageId;
+    VkImage Image;
+    render_target_entry Entry;
+    // NOTE: Reads the previous level (or the depth buffer) and writes this one
+    VkDescriptorSet Descriptor;
+};
+
+struct occlusion_culling
+{
+    b32 Supported;
+    b32 Enabled;
+    b32 Compact;
+
+    u32 NumLevels;
+    occlusion_level Levels[OCCLUSION_MAX_LEVELS];
+    VkDescriptorSetLayout DownsampleDescLayout;
+    vk_pipeline* DownsamplePipeline;
+
+    u32 MaxNumInstances;
+    u32 MaxNumCommands;
+    VkBuffer GlobalsBuffer;
+    growable_mapped_buffer BoundsBuffer;
+    VkBuffer BatchFirstBuffer;
+    growable_buffer BatchIdBuffer;
+    // NOTE: Persistent across frames, 1 if the instance passed the late test last frame. Keeps its contents when it grows
+    growable_buffer VisibilityBuffer;
+    b32 VisibilityCleared;
+    growable_buffer CommandBuffers[OcclusionList_Count];
+    // NOTE: OCCLUSION_MAX_BATCHES counters per list
+    VkBuffer CountBuffer;
+
+    VkDescriptorSetLayout CullDescLayout;
+    // NOTE: One set per frame in flight since growing rebinds the buffers, CullDescriptor is the one of the current frame
+    VkDescriptorSet CullDescriptor;
+    VkDescriptorSet CullDescriptors[GROWABLE_FRAMES_IN_FLIGHT];
+    u32 CullDescriptorsDirty;
+    vk_pipeline* CullEarlyPipeline;
+    vk_pipeline* CullLatePipeline;
+};
@@ -0,0 +1,71 @@
+
+//
+// NOTE: Radix Sort
+//
+
+inline u32 RadixSortFloatKey(f32 Value)
+{
+    // NOTE: Flip negative floats completely and positive ones only in the sign, then the integers sort like the floats
+    u32 Bits = *(u32*)&Value;
+    u32 Result = (Bits & 0x80000000) ? ~Bits : (Bits | 0x80000000);
+    return Result;
+}
+
+inline void RadixSort(u64* Keys, u32* Values, u64* TempKeys, u32* TempValues, u32 NumEntries)
+{
+    // NOTE: LSD radix sort, stable, 8 passes of 8 bits. All 8 histograms get built in one pass over the keys
+    u32 Histograms[8][256];
+    ZeroMem(Histograms, sizeof(Histograms));
+    for (u32 EntryId = 0; EntryId < NumEntries; ++EntryId)
+    {
+        u64 Key = Keys[EntryId];
+        for (u32 DigitId = 0; DigitId < 8; ++DigitId)
+        {
+            Histograms[DigitId][(Key >> (8*DigitId)) & 0xFF] += 1;
+        }
+    }
+
+    u64* SrcKeys = Keys;
+    u32* SrcValues = Values;
+    u64* DstKeys = TempKeys;
+    u32* DstValues = TempValues;
+    for (u32 DigitId = 0; DigitId < 8; ++DigitId)
+    {
+        u32* Histogram = Histograms[DigitId];
+
+        // NOTE: Every key has the same digit, this pass wouldn't move anything. Narrow keys skip their zero upper bytes this way
+        if (NumEntries == 0 || Histogram[(SrcKeys[0] >> (8*DigitId)) & 0xFF] == NumEntries)
+        {
+            continue;
+        }
+
+        u32 Offsets[256];
+        u32 Sum = 0;
+        for (u32 BucketId = 0; BucketId < 256; ++BucketId)
+        {
+            Offsets[BucketId] = Sum;
+            Sum += Histogram[BucketId];
+        }
+
+        for (u32 EntryId = 0; EntryId < NumEntries; ++EntryId)
+        {
+            u64 Key = SrcKeys[EntryId];
+            u32 DstId = Offsets[(Key >> (8*DigitId)) & 0xFF]++;
+            DstKeys[DstId] = Key;
+            DstValues[DstId] = SrcValues[EntryId];
+        }
+
+        u64* SwapKeys = SrcKeys;
+        SrcKeys = DstKeys;
+        DstKeys = SwapKeys;
+        u32* SwapValues = SrcValues;
+        SrcValues = DstValues;
+        DstValues = SwapValues;
+    }
+
+    if (SrcKeys != Keys)
+    {
+        Copy(SrcKeys, Keys, sizeof(u64)*NumEntries);
+        Copy(SrcValues, Values, sizeof(u32)*NumEntries);
+    }
+}
@@ -0,0 +1,468 @@
+
+//
+// NOTE: Shadow Regression Mode
+//
+
+inline void* RegressionFileRead(linear_arena* Arena, char* FileName, u64* Size)
+{
+    void* Result = 0;
+    *Size = 0;
+
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+        if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0 && FileSize.QuadPart <= 0xFFFFFFFF)
+        {
+            DWORD BytesRead = 0;
+            Result = PushArray(Arena, u8, u64(FileSize.QuadPart));
+            if (ReadFile(File, Result, DWORD(FileSize.QuadPart), &BytesRead, 0) && BytesRead == DWORD(FileSize.QuadPart))
+            {
+                *Size = u64(FileSize.QuadPart);
+            }
+            else
+            {
+                Result = 0;
+            }
+        }
+
+        CloseHandle(File);
+    }
+
+    return Result;
+}
+
+inline b32 RegressionFileWrite(char* FileName, void* Data0, u64 Size0, void* Data1, u64 Size1)
+{
+    b32 Result = false;
+
+    HANDLE File = CreateFileA(FileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (File != INVALID_HANDLE_VALUE)
+    {
+        DWORD BytesWritten0 = 0;
+        DWORD BytesWritten1 = 0;
+        Result = WriteFile(File, Data0, DWORD(Size0), &BytesWritten0, 0) && BytesWritten0 == DWORD(Size0);
+        if (Result && Size1 > 0)
+        {
+            Result = WriteFile(File, Data1, DWORD(Size1), &BytesWritten1, 0) && BytesWritten1 == DWORD(Size1);
+        }
+
+        CloseHandle(File);
+    }
+
+    return Result;
+}
+
+inline void RegressionResize(regression_state* Regression, u32 Width, u32 Height)
+{
+    VkArenaClear(&Regression->Arena);
+    Regression->Width = Width;
+    Regression->Height = Height;
+    RenderTargetEntryReCreate(&Regression->Arena, Width, Height, REGRESSION_COLOR_FORMAT,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                              &Regression->ColorImage, &Regression->ColorEntry);
+
+    u64 Size = 4*u64(Width)*u64(Height);
+    if (Regression->ReadbackSize < Size)
+    {
+        ReadbackBufferReCreate(Size, &Regression->ReadbackBuffer, &Regression->ReadbackMemory, &Regression->ReadbackPtr);
+        Regression->ReadbackSize = Size;
+    }
+}
+
+inline void RegressionCreate(u32 Width, u32 Height, regression_state* Result)
+{
+    *Result = {};
+
+    // NOTE: Every shadow mode once, plus the shadow mask paths since they replace the forward shadow lookup. ShadowMode_None
+    // has no forward pipeline so it isn't a case
+    regression_case Cases[] =
+        {
+            { "standard", ShadowMode_Standard, ShadowMaskMode_Off, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+            { "standard_grazing", ShadowMode_Standard, ShadowMaskMode_Off, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(1.0f, -0.3f, 0.2f) },
+            { "pcf", ShadowMode_Pcf, ShadowMaskMode_Off, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+            { "variance", ShadowMode_Variance, ShadowMaskMode_Off, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+            { "clipmap", ShadowMode_Clipmap, ShadowMaskMode_Off, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+            { "pcf_mask_full", ShadowMode_Pcf, ShadowMaskMode_Full, false, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+            { "pcf_mask_half_temporal", ShadowMode_Pcf, ShadowMaskMode_Half, true, V3(2.0f, 2.0f, -5.0f), V3(-0.35f, -0.35f, 0.87f), V3(0.4f, -1.0f, 0.0f) },
+        };
+
+    Result->NumCases = ArrayCount(Cases);
+    Result->Cases = PushArray(&DemoState->Arena, regression_case, Result->NumCases);
+    Copy(Cases, Result->Cases, sizeof(Cases));
+    Result->Results = PushArray(&DemoState->Arena, regression_result, Result->NumCases);
+    ZeroMem(Result->Results, sizeof(regression_result)*Result->NumCases);
+    for (u32 PassId = 0; PassId < RegressionPass_Count; ++PassId)
+    {
+        Result->MeasuredMs[PassId] = PushArray(&DemoState->Arena, f32, REGRESSION_MEASURE_FRAMES);
+    }
+
+    // NOTE: Goldens get loaded in here, they are as big as the window
+    void* Memory = VirtualAlloc(0, REGRESSION_CPU_MEMORY_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    Assert(Memory);
+    Result->CpuArena = LinearArenaCreate(Memory, REGRESSION_CPU_MEMORY_SIZE);
+    CreateDirectoryA(REGRESSION_DIR, 0);
+
+    Result->Arena = VkLinearArenaCreate(RenderState->Device, RenderState->LocalMemoryId, MegaBytes(64));
+    RegressionResize(Result, Width, Height);
+
+    // NOTE: Present RT, only clears the swap chain image
+    {
+        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, Width, Height);
+        RenderTargetAddTarget(&Builder, &DemoState->SwapChainEntry, VkClearColorCreate(0, 0, 0, 1));
+
+        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
+
+        u32 ColorId = VkRenderPassAttachmentAdd(&RpBuilder, RenderState->SwapChainFormat, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        VkRenderPassColorRefAdd(&RpBuilder, ColorId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderPassSubPassEnd(&RpBuilder);
+
+        Result->PresentTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
+    }
+
+    // NOTE: Timestamps
+    {
+        VkPhysicalDeviceProperties Properties;
+        vkGetPhysicalDeviceProperties(RenderState->PhysicalDevice, &Properties);
+        Result->TimestampsSupported = Properties.limits.timestampComputeAndGraphics;
+        Result->TimestampPeriod = Properties.limits.timestampPeriod;
+
+        if (Result->TimestampsSupported)
+        {
+            VkQueryPoolCreateInfo CreateInfo = {};
+            CreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            CreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            CreateInfo.queryCount = RegressionTimestamp_Count;
+            VkCheckResult(vkCreateQueryPool(RenderState->Device, &CreateInfo, 0, &Result->QueryPool));
+        }
+    }
+}
+
+inline void RegressionTimestampWrite(VkCommandBuffer CmdBuffer, regression_state* Regression, regression_timestamp Timestamp)
+{
+    if (Regression->TimestampsSupported)
+    {
+        vkCmdWriteTimestamp(CmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, Regression->QueryPool, Timestamp);
+    }
+}
+
+inline f32 RegressionMedianGet(f32* Values, u32 NumValues)
+{
+    // NOTE: Insertion sort, we only ever have a few dozen values
+    for (u32 ValueId = 1; ValueId < NumValues; ++ValueId)
+    {
+        f32 Value = Values[ValueId];
+        u32 InsertId = ValueId;
+        while (InsertId > 0 && Values[InsertId - 1] > Value)
+        {
+            Values[InsertId] = Values[InsertId - 1];
+            InsertId -= 1;
+        }
+        Values[InsertId] = Value;
+    }
+
+    f32 Result = Values[NumValues / 2];
+    return Result;
+}
+
+inline f32 RegressionColorDistance(u8* A, u8* B)
+{
+    // NOTE: "Redmean" weighted RGB distance, a cheap approximation of perceptual color difference. Scaled so that black vs white is 255
+    f32 RedMean = 0.5f*(f32(A[0]) + f32(B[0]));
+    f32 DeltaR = f32(A[0]) - f32(B[0]);
+    f32 DeltaG = f32(A[1]) - f32(B[1]);
+    f32 DeltaB = f32(A[2]) - f32(B[2]);
+    f32 Result = SquareRoot((2.0f + RedMean / 256.0f)*DeltaR*DeltaR + 4.0f*DeltaG*DeltaG +
+                            (2.0f + (255.0f - RedMean) / 256.0f)*DeltaB*DeltaB) / 3.0f;
+    return Result;
+}
+
+inline void RegressionImageCompare(regression_state* Regression, u8* Golden, regression_result* Result)
+{
+    u8* Image = (u8*)Regression->ReadbackPtr;
+    i32 Width = i32(Regression->Width);
+    i32 Height = i32(Regression->Height);
+
+    u32 NumBadPixels = 0;
+    f32 TotalError = 0.0f;
+    f32 MaxError = 0.0f;
+    for (i32 Y = 0; Y < Height; ++Y)
+    {
+        for (i32 X = 0; X < Width; ++X)
+        {
+            u8* Texel = Image + 4*(Y*Width + X);
+            f32 Error = RegressionColorDistance(Texel, Golden + 4*(Y*Width + X));
+            for (i32 OffsetY = -1; OffsetY <= 1 && Error > 0.0f; ++OffsetY)
+            {
+                for (i32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+                {
+                    i32 SampleX = Min(Max(X + OffsetX, 0), Width - 1);
+                    i32 SampleY = Min(Max(Y + OffsetY, 0), Height - 1);
+                    Error = Min(Error, RegressionColorDistance(Texel, Golden + 4*(SampleY*Width + SampleX)));
+                }
+            }
+
+            NumBadPixels += Error > REGRESSION_PIXEL_THRESHOLD ? 1 : 0;
+            TotalError += Error;
+            MaxError = Max(MaxError, Error);
+        }
+    }
+
+    Result->BadPixelRatio = f32(NumBadPixels) / f32(Width*Height);
+    Result->MeanError = TotalError / f32(Width*Height);
+    Result->MaxError = MaxError;
+    Result->ImagePassed = Result->BadPixelRatio <= REGRESSION_MAX_BAD_PIXEL_RATIO && Result->MeanError <= REGRESSION_MAX_MEAN_ERROR;
+}
+
+inline void RegressionCaseFinish(regression_state* Regression)
+{
+    regression_case* Case = Regression->Cases + Regression->CaseId;
+    regression_result* Result = Regression->Results + Regression->CaseId;
+    temp_mem TempMem = BeginTempMem(&Regression->CpuArena);
+
+    char FileName[256];
+
+    // NOTE: Image
+    {
+        regression_file_header Header = {};
+        Header.Magic = REGRESSION_FILE_MAGIC;
+        Header.Version = REGRESSION_FILE_VERSION;
+        Header.Width = Regression->Width;
+        Header.Height = Regression->Height;
+        u64 ImageSize = 4*u64(Regression->Width)*u64(Regression->Height);
+
+        _snprintf_s(FileName, sizeof(FileName), _TRUNCATE, "%s%s.golden", REGRESSION_DIR, Case->Name);
+        u64 FileSize = 0;
+        u8* File = SHADOW_REGRESSION_RECORD ? 0 : (u8*)RegressionFileRead(&Regression->CpuArena, FileName, &FileSize);
+        if (File)
+        {
+            // NOTE: A golden of a different resolution or version is a failure, not something we silently replace
+            regression_file_header* GoldenHeader = (regression_file_header*)File;
+            if (FileSize == sizeof(Header) + ImageSize && GoldenHeader->Magic == Header.Magic && GoldenHeader->Version == Header.Version &&
+                GoldenHeader->Width == Header.Width && GoldenHeader->Height == Header.Height)
+            {
+                RegressionImageCompare(Regression, File + sizeof(Header), Result);
+            }
+        }
+        else if (SHADOW_REGRESSION_RECORD)
+        {
+            Result->ImageRecorded = RegressionFileWrite(FileName, &Header, sizeof(Header), Regression->ReadbackPtr, ImageSize);
+            Result->ImagePassed = Result->ImageRecorded;
+        }
+        else
+        {
+            // NOTE: A missing golden fails, otherwise a run without them passes without having compared anything
+            Result->ImageMissing = true;
+        }
+    }
+
+    // NOTE: Timings
+    Result->TimingsSupported = Regression->TimestampsSupported;
+    if (Result->TimingsSupported)
+    {
+        for (u32 PassId = 0; PassId < RegressionPass_Count; ++PassId)
+        {
+            Result->Timings.PassMs[PassId] = RegressionMedianGet(Regression->MeasuredMs[PassId], REGRESSION_MEASURE_FRAMES);
+        }
+
+        regression_file_header Header = {};
+        Header.Magic = REGRESSION_FILE_MAGIC;
+        Header.Version = REGRESSION_FILE_VERSION;
+        Header.Width = Regression->Width;
+        Header.Height = Regression->Height;
+
+        _snprintf_s(FileName, sizeof(FileName), _TRUNCATE, "%s%s.timing", REGRESSION_DIR, Case->Name);
+        u64 FileSize = 0;
+        u8* File = SHADOW_REGRESSION_RECORD ? 0 : (u8*)RegressionFileRead(&Regression->CpuArena, FileName, &FileSize);
+        if (File)
+        {
+            regression_file_header* BaselineHeader = (regression_file_header*)File;
+            if (FileSize == sizeof(Header) + sizeof(regression_timings) && BaselineHeader->Magic == Header.Magic &&
+                BaselineHeader->Version == Header.Version && BaselineHeader->Width == Header.Width && BaselineHeader->Height == Header.Height)
+            {
+                Copy(File + sizeof(Header), &Result->Baseline, sizeof(regression_timings));
+                Result->TimingsPassed = true;
+                for (u32 PassId = 0; PassId < RegressionPass_Count; ++PassId)
+                {
+                    f32 Limit = Result->Baseline.PassMs[PassId]*(1.0f + REGRESSION_TIME_RELATIVE_SLACK) + REGRESSION_TIME_ABSOLUTE_SLACK_MS;
+                    Result->TimingsPassed = Result->TimingsPassed && Result->Timings.PassMs[PassId] <= Limit;
+                }
+            }
+        }
+        else if (SHADOW_REGRESSION_RECORD)
+        {
+            Result->TimingsRecorded = RegressionFileWrite(FileName, &Header, sizeof(Header), &Result->Timings, sizeof(regression_timings));
+            Result->Baseline = Result->Timings;
+            Result->TimingsPassed = Result->TimingsRecorded;
+        }
+        else
+        {
+            Result->TimingsMissing = true;
+        }
+    }
+
+    EndTempMem(TempMem);
+}
+
+inline void RegressionReportWrite(regression_state* Regression, u32* NumFailures)
+{
+    temp_mem TempMem = BeginTempMem(&Regression->CpuArena);
+
+    u64 MaxReportSize = MegaBytes(1);
+    char* Report = PushArray(&Regression->CpuArena, char, MaxReportSize);
+    u64 ReportSize = 0;
+
+    char* PassNames[RegressionPass_Count] = { "shadow", "prepass", "shadow_mask", "forward", "frame" };
+    *NumFailures = 0;
+    for (u32 CaseId = 0; CaseId < Regression->NumCases; ++CaseId)
+    {
+        regression_case* Case = Regression->Cases + CaseId;
+        regression_result* Result = Regression->Results + CaseId;
+        b32 Passed = Result->ImagePassed && (!Result->TimingsSupported || Result->TimingsPassed);
+        *NumFailures += Passed ? 0 : 1;
+
+        ReportSize += _snprintf_s(Report + ReportSize, MaxReportSize - ReportSize, _TRUNCATE,
+                                  "%s %s: image %s (bad %.4f%%, mean %.3f, max %.1f)\n", Passed ? "PASS" : "FAIL", Case->Name,
+                                  Result->ImageRecorded ? "recorded" : (Result->ImageMissing ? "missing golden" : (Result->ImagePassed ? "ok" : "regressed")),
+                                  100.0f*Result->BadPixelRatio, Result->MeanError, Result->MaxError);
+        if (!Result->TimingsSupported)
+        {
+            ReportSize += _snprintf_s(Report + ReportSize, MaxReportSize - ReportSize, _TRUNCATE, "    timings not supported\n");
+            continue;
+        }
+
+        if (Result->TimingsMissing)
+        {
+            ReportSize += _snprintf_s(Report + ReportSize, MaxReportSize - ReportSize, _TRUNCATE, "    timing baseline missing\n");
+        }
+
+        for (u32 PassId = 0; PassId < RegressionPass_Count; ++PassId)
+        {
+            ReportSize += _snprintf_s(Report + ReportSize, MaxReportSize - ReportSize, _TRUNCATE, "    %-12s %8.3f ms (baseline %8.3f ms)%s\n",
+                                      PassNames[PassId], Result->Timings.PassMs[PassId], Result->Baseline.PassMs[PassId],
+                                      Result->TimingsRecorded ? " recorded" : "");
+        }
+    }
+
+    ReportSize += _snprintf_s(Report + ReportSize, MaxReportSize - ReportSize, _TRUNCATE, "%u of %u cases failed\n",
+                              *NumFailures, Regression->NumCases);
+    OutputDebugStringA(Report);
+    RegressionFileWrite(REGRESSION_REPORT_NAME, Report, ReportSize, 0, 0);
+
+    EndTempMem(TempMem);
+}
+
+inline void RegressionFrameBegin(VkCommandBuffer CmdBuffer, regression_state* Regression)
+{
+    if (Regression->QueriesPending)
+    {
+        u64 Timestamps[RegressionTimestamp_Count];
+        VkCheckResult(vkGetQueryPoolResults(RenderState->Device, Regression->QueryPool, 0, RegressionTimestamp_Count, sizeof(Timestamps),
+                                            Timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+        f32 NsToMs = Regression->TimestampPeriod / 1000000.0f;
+        u32 MeasureId = Regression->PendingMeasureId;
+        Regression->MeasuredMs[RegressionPass_Shadow][MeasureId] = NsToMs*f32(Timestamps[RegressionTimestamp_ShadowEnd] - Timestamps[RegressionTimestamp_FrameBegin]);
+        Regression->MeasuredMs[RegressionPass_Prepass][MeasureId] = NsToMs*f32(Timestamps[RegressionTimestamp_PrepassEnd] - Timestamps[RegressionTimestamp_ShadowEnd]);
+        Regression->MeasuredMs[RegressionPass_ShadowMask][MeasureId] = NsToMs*f32(Timestamps[RegressionTimestamp_ShadowMaskEnd] - Timestamps[RegressionTimestamp_PrepassEnd]);
+        Regression->MeasuredMs[RegressionPass_Forward][MeasureId] = NsToMs*f32(Timestamps[RegressionTimestamp_ForwardEnd] - Timestamps[RegressionTimestamp_ShadowMaskEnd]);
+        Regression->MeasuredMs[RegressionPass_Frame][MeasureId] = NsToMs*f32(Timestamps[RegressionTimestamp_ForwardEnd] - Timestamps[RegressionTimestamp_FrameBegin]);
+        Regression->QueriesPending = false;
+    }
+
+    if (Regression->Phase == RegressionPhase_Compare)
+    {
+        // NOTE: Last frame copied the color image back
+        VkCheckResult(vkDeviceWaitIdle(RenderState->Device));
+        RegressionCaseFinish(Regression);
+
+        Regression->CaseId += 1;
+        Regression->Phase = RegressionPhase_Warmup;
+        Regression->PhaseFrame = 0;
+        if (Regression->CaseId == Regression->NumCases)
+        {
+            u32 NumFailures = 0;
+            RegressionReportWrite(Regression, &NumFailures);
+            ExitProcess(NumFailures);
+        }
+    }
+
+    if (Regression->TimestampsSupported)
+    {
+        vkCmdResetQueryPool(CmdBuffer, Regression->QueryPool, 0, RegressionTimestamp_Count);
+        RegressionTimestampWrite(CmdBuffer, Regression, RegressionTimestamp_FrameBegin);
+    }
+}
+
+inline void RegressionCaseApply(regression_state* Regression)
+{
+    regression_case* Case = Regression->Cases + Regression->CaseId;
+
+    DemoState->ShadowMode = Case->ShadowMode;
+    DemoState->ShadowView = Case->LightView;
+    DemoState->ForwardState.ShadowMask.Mode = Case->ShadowMaskMode;
+    DemoState->ForwardState.ShadowMask.Temporal = Case->Temporal;
+
+    camera* Camera = &DemoState->Scene.Camera;
+    *Camera = CameraFpsCreate(Case->CameraPos, Normalize(Case->CameraView), true, 1.0f, 0.005f);
+    CameraSetPersp(Camera, f32(Regression->Width) / f32(Regression->Height), 90.0f, 0.01f, 1000.0f);
+}
+
+inline void RegressionFrameEnd(vk_commands Commands, regression_state* Regression)
+{
+    switch (Regression->Phase)
+    {
+        case RegressionPhase_Warmup:
+        {
+            Regression->PhaseFrame += 1;
+            if (Regression->PhaseFrame == REGRESSION_WARMUP_FRAMES)
+            {
+                Regression->Phase = RegressionPhase_Measure;
+                Regression->PhaseFrame = 0;
+            }
+        } break;
+
+        case RegressionPhase_Measure:
+        {
+            Regression->QueriesPending = Regression->TimestampsSupported;
+            Regression->PendingMeasureId = Regression->PhaseFrame;
+            Regression->PhaseFrame += 1;
+            if (Regression->PhaseFrame == REGRESSION_MEASURE_FRAMES)
+            {
+                Regression->Phase = RegressionPhase_Capture;
+                Regression->PhaseFrame = 0;
+            }
+        } break;
+
+        case RegressionPhase_Capture:
+        {
+            AsyncComputeImageBarrier(Commands.Buffer, Regression->ColorImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+            VkBufferImageCopy Region = {};
+            Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            Region.imageSubresource.layerCount = 1;
+            Region.imageExtent = { Regression->Width, Regression->Height, 1 };
+            vkCmdCopyImageToBuffer(Commands.Buffer, Regression->ColorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Regression->ReadbackBuffer,
+                                   1, &Region);
+
+            // NOTE: The forward RT starts from undefined, so the image can stay in transfer layout
+            Regression->Phase = RegressionPhase_Compare;
+        } break;
+
+        default:
+        {
+            InvalidCodePath;
+        } break;
+    }
+
+    RenderTargetUpdateEntries(&DemoState->TempArena, &Regression->PresentTarget);
+    RenderTargetPassBegin(&Regression->PresentTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
+    RenderTargetPassEnd(Commands);
+}
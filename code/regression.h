@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+
+  NOTE: Shadow Regression Mode
+
+    Built with SHADOW_REGRESSION=1 (build.bat regression) the demo stops being interactive and runs a fixed list of camera/light
+    setups, one per shadow_mode plus the shadow mask variants. The forward pass renders into an offscreen RGBA8 target instead of the
+    swap chain so the result can be copied back and doesn't depend on the swap chain format. Every case:
+
+      - Warms up for REGRESSION_WARMUP_FRAMES so caches, clipmap levels and temporal history settle
+      - Measures REGRESSION_MEASURE_FRAMES with GPU timestamps around the shadow, prepass, shadow mask and forward passes, and takes
+        the median of each so a single hitch doesn't fail the run
+      - Copies the color image back and compares it to the golden image in REGRESSION_DIR
+
+    Images are compared in a perceptual way: per pixel we take the smallest weighted color distance to the golden 3x3 neighbourhood,
+    so edges that moved by a pixel because a driver rasterizes slightly differently don't count. A case fails if too many pixels are
+    over the threshold or if the mean error goes up. Timings fail if a pass got slower than its baseline by more than a relative and
+    an absolute slack, the absolute one keeps very cheap passes from failing on noise.
+
+    A missing golden or baseline fails its case. Built with SHADOW_REGRESSION_RECORD=1 as well (build.bat regression record) the run
+    doesn't compare anything and overwrites every golden and baseline with what it rendered. The run is meant to go through a software
+    ICD (lavapipe or SwiftShader) so that images are stable across machines, timings are only comparable on the same machine and ICD.
+    When all cases are done we write REGRESSION_REPORT_NAME and exit the process with the number of failures as exit code.
+
+    IMPORTANT: No goldens or baselines are checked in, they depend on the ICD and the machine. Set SHADOW_SOFTWARE_ICD to the ICD json
+    manifest and run build.bat regression record once, after that build.bat regression compares against what got recorded. build.bat
+    refuses to run without the ICD, and refuses to compare when data\regression has no goldens.
+
+ */
+
+#include <stdio.h>
+
+#ifndef SHADOW_REGRESSION_RECORD
+#define SHADOW_REGRESSION_RECORD 0
+#endif
+
+#define REGRESSION_DIR "regression\\"
+#define REGRESSION_REPORT_NAME "regression_report.txt"
+#define REGRESSION_COLOR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+#define REGRESSION_CPU_MEMORY_SIZE MegaBytes(64)
+#define REGRESSION_WARMUP_FRAMES 32
+#define REGRESSION_MEASURE_FRAMES 64
+#define REGRESSION_FILE_MAGIC 0x47525348 // NOTE: "HSRG"
+#define REGRESSION_FILE_VERSION 1
+
+// NOTE: Image thresholds, distances are in 0-255 units
+#define REGRESSION_PIXEL_THRESHOLD 8.0f
+#define REGRESSION_MAX_BAD_PIXEL_RATIO 0.002f
+#define REGRESSION_MAX_MEAN_ERROR 0.5f
+// NOTE: Timing thresholds
+#define REGRESSION_TIME_RELATIVE_SLACK 0.15f
+#define REGRESSION_TIME_ABSOLUTE_SLACK_MS 0.05f
+
+enum regression_timestamp
+{
+    RegressionTimestamp_FrameBegin,
+    RegressionTimestamp_ShadowEnd,
+    RegressionTimestamp_PrepassEnd,
+    RegressionTimestamp_ShadowMaskEnd,
+    RegressionTimestamp_ForwardEnd,
+
+    RegressionTimestamp_Count,
+};
+
+enum regression_pass
+{
+    RegressionPass_Shadow,
+    RegressionPass_Prepass,
+    RegressionPass_ShadowMask,
+    RegressionPass_Forward,
+    // NOTE: Whole frame, including what is between the passes
+    RegressionPass_Frame,
+
+    RegressionPass_Count,
+};
+
+enum regression_phase
+{
+    RegressionPhase_Warmup,
+    RegressionPhase_Measure,
+    RegressionPhase_Capture,
+    RegressionPhase_Compare,
+    RegressionPhase_Done,
+};
+
+struct regression_case
+{
+    char* Name;
+    shadow_mode ShadowMode;
+    shadow_mask_mode ShadowMaskMode;
+    b32 Temporal;
+    v3 CameraPos;
+    v3 CameraView;
+    v3 LightView;
+};
+
+// NOTE: Layout of the golden images (followed by Width*Height RGBA8 texels) and the timing baselines
+struct regression_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 Width;
+    u32 Height;
+};
+
+struct regression_timings
+{
+    f32 PassMs[RegressionPass_Count];
+};
+
+struct regression_result
+{
+    b32 ImageRecorded;
+    b32 ImageMissing;
+    b32 ImagePassed;
+    f32 BadPixelRatio;
+    f32 MeanError;
+    f32 MaxError;
+
+    b32 TimingsSupported;
+    b32 TimingsRecorded;
+    b32 TimingsMissing;
+    b32 TimingsPassed;
+    regression_timings Timings;
+    regression_timings Baseline;
+};
+
+struct regression_state
+{
+    u32 NumCases;
+    regression_case* Cases;
+    regression_result* Results;
+    u32 CaseId;
+    regression_phase Phase;
+    u32 PhaseFrame;
+    linear_arena CpuArena;
+
+    // NOTE: Offscreen color target the forward pass renders into
+    vk_linear_arena Arena;
+    u32 Width;
+    u32 Height;
+    VkImage ColorImage;
+    render_target_entry ColorEntry;
+    // NOTE: Clears the swap chain image so that the UI has something to render on top of
+    render_target PresentTarget;
+
+    u64 ReadbackSize;
+    VkBuffer ReadbackBuffer;
+    VkDeviceMemory ReadbackMemory;
+    void* ReadbackPtr;
+
+    b32 TimestampsSupported;
+    f32 TimestampPeriod;
+    VkQueryPool QueryPool;
+    // NOTE: Set when last frame was a measured one, its queries get read before we reset the pool
+    b32 QueriesPending;
+    u32 PendingMeasureId;
+    f32* MeasuredMs[RegressionPass_Count];
+};
+
+#if SHADOW_REGRESSION
+#define REGRESSION_TIMESTAMP(CmdBuffer, Timestamp) RegressionTimestampWrite(CmdBuffer, &DemoState->Regression, Timestamp)
+#else
+#define REGRESSION_TIMESTAMP(CmdBuffer, Timestamp)
+#endif
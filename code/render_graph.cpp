@@ -0,0 +1,547 @@
+
+//
+// NOTE: Render Graph
+//
+
+global render_graph_usage_info RenderGraphUsageInfos[RenderGraphUsage_Count] =
+{
+    // NOTE: ColorAttachment, DepthAttachment
+    { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT },
+    { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT },
+    // NOTE: DepthReadCompute
+    { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    // NOTE: SampledFragment, SampledCompute
+    { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    // NOTE: StorageCompute, GeneralReadCompute, GeneralReadFragment
+    { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT },
+    { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    // NOTE: TransferSrc, TransferDst
+    { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT },
+    { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT },
+};
+
+inline void RenderGraphImagesResize(growable_state* Growable, render_graph* Graph, u32 MaxNumImages)
+{
+    Graph->Images = GrowableArrayResizeType(Growable, Graph->Images, render_graph_image, Graph->MaxNumImages, MaxNumImages);
+    Graph->Needed = GrowableArrayResizeType(Growable, Graph->Needed, b32, Graph->MaxNumImages, MaxNumImages);
+    Graph->MaxNumImages = MaxNumImages;
+}
+
+inline void RenderGraphCreate(growable_state* Growable, b32 AsyncDedicated, render_graph* Result)
+{
+    *Result = {};
+    Result->AsyncDedicated = AsyncDedicated;
+    Result->NumImages = 1;
+    RenderGraphImagesResize(Growable, Result, GrowableCapacityGet(0, 1));
+}
+
+inline render_graph_image* RenderGraphImageAlloc(render_graph* Graph, u32* ImageId)
+{
+    // NOTE: Growing moves the images, image pointers don't survive creating another image
+    if (*ImageId == 0)
+    {
+        if (Graph->NumImages == Graph->MaxNumImages)
+        {
+            RenderGraphImagesResize(&DemoState->Growable, Graph, GrowableCapacityGet(Graph->MaxNumImages, Graph->NumImages + 1));
+            DemoState->Growable.NumGrows += 1;
+        }
+        *ImageId = Graph->NumImages++;
+    }
+
+    render_graph_image* Result = Graph->Images + *ImageId;
+    return Result;
+}
+
+inline void RenderGraphImageImport(render_graph* Graph, u32* ImageId, VkImage Image, VkImageAspectFlags Aspect)
+{
+    // NOTE: Re-importing after a resize starts over from undefined, the new image has no contents yet
+    render_graph_image* Result = RenderGraphImageAlloc(Graph, ImageId);
+    Assert(!Result->Transient);
+    *Result = {};
+    Result->Image = Image;
+    Result->Aspect = Aspect;
+    Result->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+//
+// NOTE: Transients
+//
+
+inline b32 RenderGraphLifetimesOverlap(render_graph_image* A, render_graph_image* B)
+{
+    b32 Result = A->FirstPass <= B->LastPass && B->FirstPass <= A->LastPass;
+    return Result;
+}
+
+inline b32 RenderGraphMemoryOverlaps(render_graph_image* A, render_graph_image* B)
+{
+    b32 Result = (A->OverflowMemory == VK_NULL_HANDLE && B->OverflowMemory == VK_NULL_HANDLE &&
+                  A->Offset < B->Offset + B->Size && B->Offset < A->Offset + A->Size);
+    return Result;
+}
+
+inline u64 RenderGraphTransientPlace(render_graph* Graph, render_graph_image* Image, u64 Alignment)
+{
+    // NOTE: First fit. The lowest valid offset is either the heap start (candidate 0, which is the reserved image) or right after an
+    // image that is alive at the same time. Placement doesn't know the heap size, right after the image that ends last always fits
+    u64 Result = 0xFFFFFFFFFFFFFFFF;
+    for (u32 CandidateId = 0; CandidateId < Graph->NumImages; ++CandidateId)
+    {
+        u64 Offset = 0;
+        if (CandidateId > 0)
+        {
+            render_graph_image* Candidate = Graph->Images + CandidateId;
+            if (!Candidate->Transient || Candidate == Image || Candidate->Size == 0 || !RenderGraphLifetimesOverlap(Candidate, Image))
+            {
+                continue;
+            }
+            Offset = (Candidate->Offset + Candidate->Size + Alignment - 1) / Alignment * Alignment;
+        }
+
+        if (Offset >= Result)
+        {
+            continue;
+        }
+
+        b32 Fits = true;
+        for (u32 OtherId = 1; OtherId < Graph->NumImages && Fits; ++OtherId)
+        {
+            render_graph_image* Other = Graph->Images + OtherId;
+            if (Other->Transient && Other != Image && Other->Size != 0 && RenderGraphLifetimesOverlap(Other, Image))
+            {
+                Fits = Offset >= Other->Offset + Other->Size || Other->Offset >= Offset + Image->Size;
+            }
+        }
+
+        if (Fits)
+        {
+            Result = Offset;
+        }
+    }
+
+    return Result;
+}
+
+inline void RenderGraphTransientStatsUpdate(render_graph* Graph)
+{
+    Graph->TransientHeapUsed = 0;
+    Graph->TransientOverflowSize = 0;
+    Graph->TransientSizeSum = 0;
+    for (u32 ImageId = 1; ImageId < Graph->NumImages; ++ImageId)
+    {
+        render_graph_image* Image = Graph->Images + ImageId;
+        if (Image->Transient)
+        {
+            if (Image->Offset + Image->Size > Graph->TransientHeapUsed)
+            {
+                Graph->TransientHeapUsed = Image->Offset + Image->Size;
+            }
+            if (Image->OverflowMemory != VK_NULL_HANDLE)
+            {
+                Graph->TransientOverflowSize += Image->Size;
+            }
+            Graph->TransientSizeSum += Image->Size;
+        }
+    }
+}
+
+inline void RenderGraphTransientRelease(render_graph_image* Image)
+{
+    if (Image->Transient)
+    {
+        vkDestroyImageView(RenderState->Device, Image->View, 0);
+        vkDestroyImage(RenderState->Device, Image->Image, 0);
+        if (Image->OverflowMemory != VK_NULL_HANDLE)
+        {
+            vkFreeMemory(RenderState->Device, Image->OverflowMemory, 0);
+        }
+    }
+}
+
+inline void RenderGraphTransientCreate(render_graph* Graph, u32* ImageId, u32 Width, u32 Height, VkFormat Format, VkImageUsageFlags Usage,
+                                       VkImageAspectFlags Aspect, render_graph_pass_id FirstPass, render_graph_pass_id LastPass,
+                                       VkImage* ResultImage, render_target_entry* ResultEntry)
+{
+    // NOTE: Re-creating happens on resizes, where the GPU is done with the frame that used the old image
+    render_graph_image* Image = RenderGraphImageAlloc(Graph, ImageId);
+    RenderGraphTransientRelease(Image);
+
+    *Image = {};
+    Image->Transient = true;
+    Image->Aspect = Aspect;
+    Image->FirstPass = FirstPass;
+    Image->LastPass = LastPass;
+    Image->Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImageCreateInfo ImageCreateInfo = {};
+    ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    ImageCreateInfo.format = Format;
+    ImageCreateInfo.extent = { Width, Height, 1 };
+    ImageCreateInfo.mipLevels = 1;
+    ImageCreateInfo.arrayLayers = 1;
+    ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    ImageCreateInfo.usage = Usage;
+    ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkCheckResult(vkCreateImage(RenderState->Device, &ImageCreateInfo, 0, &Image->Image));
+
+    VkMemoryRequirements Requirements;
+    vkGetImageMemoryRequirements(RenderState->Device, Image->Image, &Requirements);
+    Image->Size = Requirements.size;
+    Image->MemoryTypeBits = Requirements.memoryTypeBits;
+    Image->Offset = RenderGraphTransientPlace(Graph, Image, Requirements.alignment);
+
+    if (Graph->TransientMemory != VK_NULL_HANDLE && Image->Offset + Image->Size <= Graph->TransientHeapSize &&
+        (Requirements.memoryTypeBits & (1u << Graph->TransientMemoryTypeId)))
+    {
+        VkCheckResult(vkBindImageMemory(RenderState->Device, Image->Image, Graph->TransientMemory, Image->Offset));
+    }
+    else
+    {
+        // NOTE: Doesn't fit the heap (or there is none yet). The image keeps its placement, so that the heap fit accounts for it, but
+        // lives in its own memory until then and doesn't alias anything
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = Requirements.size;
+        AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Image->OverflowMemory));
+        VkCheckResult(vkBindImageMemory(RenderState->Device, Image->Image, Image->OverflowMemory, 0));
+    }
+
+    VkImageViewCreateInfo ViewCreateInfo = {};
+    ViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    ViewCreateInfo.image = Image->Image;
+    ViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ViewCreateInfo.format = Format;
+    ViewCreateInfo.subresourceRange.aspectMask = Aspect;
+    ViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    ViewCreateInfo.subresourceRange.levelCount = 1;
+    ViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    ViewCreateInfo.subresourceRange.layerCount = 1;
+    VkCheckResult(vkCreateImageView(RenderState->Device, &ViewCreateInfo, 0, &Image->View));
+
+    *ResultImage = Image->Image;
+    *ResultEntry = RenderTargetSwapChainEntryCreate(Width, Height, Format);
+    ResultEntry->View = Image->View;
+
+    RenderGraphTransientStatsUpdate(Graph);
+}
+
+inline void RenderGraphTransientDestroy(render_graph* Graph, u32 ImageId)
+{
+    // NOTE: Keeps the slot, creating it again reuses the id
+    render_graph_image* Image = Graph->Images + ImageId;
+    if (Image->Transient)
+    {
+        RenderGraphTransientRelease(Image);
+        *Image = {};
+        RenderGraphTransientStatsUpdate(Graph);
+    }
+}
+
+// NOTE: Call at resize time, after all transients got created. Returns true if the heap got reallocated, then every transient has to
+// be created again (they are unplaced and their images are bound to freed memory)
+inline b32 RenderGraphTransientHeapFit(render_graph* Graph)
+{
+    // NOTE: Overflowed images go into the heap, a heap that is more than twice the high water mark gets shrunk
+    b32 Overflow = Graph->TransientOverflowSize > 0;
+    b32 Oversized = Graph->TransientHeapSize > 2*Graph->TransientHeapUsed;
+    if (!Overflow && !Oversized)
+    {
+        return false;
+    }
+
+    VkCheckResult(vkDeviceWaitIdle(RenderState->Device));
+    if (Graph->TransientMemory != VK_NULL_HANDLE)
+    {
+        vkFreeMemory(RenderState->Device, Graph->TransientMemory, 0);
+        Graph->TransientMemory = VK_NULL_HANDLE;
+        Graph->TransientHeapSize = 0;
+    }
+
+    u32 MemoryTypeBits = 0xFFFFFFFF;
+    for (u32 ImageId = 1; ImageId < Graph->NumImages; ++ImageId)
+    {
+        render_graph_image* Image = Graph->Images + ImageId;
+        if (Image->Transient)
+        {
+            MemoryTypeBits &= Image->MemoryTypeBits;
+        }
+    }
+
+    if (Graph->TransientHeapUsed > 0)
+    {
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = Graph->TransientHeapUsed;
+        AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(MemoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Graph->TransientMemory));
+        Graph->TransientMemoryTypeId = AllocateInfo.memoryTypeIndex;
+        Graph->TransientHeapSize = AllocateInfo.allocationSize;
+    }
+
+    // NOTE: Re-created images only place against each other. If they come out in a different order than before and don't fit, they
+    // overflow again until the next fit
+    for (u32 ImageId = 1; ImageId < Graph->NumImages; ++ImageId)
+    {
+        render_graph_image* Image = Graph->Images + ImageId;
+        if (Image->Transient)
+        {
+            Image->Size = 0;
+        }
+    }
+
+    return true;
+}
+
+//
+// NOTE: Frame
+//
+
+inline void RenderGraphBegin(render_graph* Graph)
+{
+    Graph->NumPasses = 0;
+    Graph->NumAccesses = 0;
+}
+
+inline void RenderGraphPassAdd(render_graph* Graph, render_graph_pass_id Id, u32 Flags, render_graph_pass_record* Record, void* Data,
+                               u32 Param = 0)
+{
+    Assert(Graph->NumPasses < RenderGraphPass_Count);
+    Assert(Graph->NumPasses == 0 || Graph->Passes[Graph->NumPasses - 1].Id < Id);
+
+    render_graph_pass* Pass = Graph->Passes + Graph->NumPasses++;
+    *Pass = {};
+    Pass->Id = Id;
+    Pass->Flags = Flags;
+    Pass->Record = Record;
+    Pass->Data = Data;
+    Pass->Param = Param;
+    Pass->FirstAccess = Graph->NumAccesses;
+}
+
+// NOTE: Adds to the last added pass
+inline void RenderGraphAccessAdd(render_graph* Graph, u32 ImageId, render_graph_usage Usage, render_graph_usage FinalUsage, b32 Discard)
+{
+    Assert(Graph->NumPasses > 0);
+    Assert(ImageId > 0 && ImageId < Graph->NumImages);
+    Assert(Graph->NumAccesses < RENDER_GRAPH_MAX_ACCESSES);
+
+    render_graph_pass* Pass = Graph->Passes + Graph->NumPasses - 1;
+    render_graph_access* Access = Graph->Accesses + Graph->NumAccesses++;
+    Access->ImageId = ImageId;
+    Access->Usage = Usage;
+    Access->FinalUsage = FinalUsage;
+    Access->Discard = Discard;
+    Pass->NumAccesses += 1;
+}
+
+inline void RenderGraphCull(render_graph* Graph)
+{
+    // NOTE: Walk back to front. A pass lives if it has side effects or writes something a later live pass still needs. Discarding
+    // accesses end the chain, everything else needs the writers before it
+    b32* Needed = Graph->Needed;
+    ZeroMem(Needed, sizeof(b32)*Graph->NumImages);
+    Graph->NumPassesCulled = 0;
+    for (i32 PassId = i32(Graph->NumPasses) - 1; PassId >= 0; --PassId)
+    {
+        render_graph_pass* Pass = Graph->Passes + PassId;
+        render_graph_access* Accesses = Graph->Accesses + Pass->FirstAccess;
+
+        Pass->Alive = (Pass->Flags & RenderGraphPassFlag_SideEffect) != 0;
+        for (u32 AccessId = 0; AccessId < Pass->NumAccesses; ++AccessId)
+        {
+            render_graph_access* Access = Accesses + AccessId;
+            VkAccessFlags AccessMask = RenderGraphUsageInfos[Access->Usage].Access | RenderGraphUsageInfos[Access->FinalUsage].Access;
+            if ((AccessMask & RENDER_GRAPH_WRITE_ACCESS) && (!Graph->Images[Access->ImageId].Transient || Needed[Access->ImageId]))
+            {
+                Pass->Alive = true;
+            }
+        }
+
+        if (!Pass->Alive)
+        {
+            Graph->NumPassesCulled += 1;
+            continue;
+        }
+
+        for (u32 AccessId = 0; AccessId < Pass->NumAccesses; ++AccessId)
+        {
+            render_graph_access* Access = Accesses + AccessId;
+            Needed[Access->ImageId] = !Access->Discard;
+        }
+    }
+}
+
+inline void RenderGraphPassBarrier(render_graph* Graph, VkCommandBuffer CmdBuffer, render_graph_pass* Pass)
+{
+    VkImageMemoryBarrier Barriers[RENDER_GRAPH_MAX_ACCESSES];
+    u32 NumBarriers = 0;
+    VkPipelineStageFlags SrcStages = 0;
+    VkPipelineStageFlags DstStages = 0;
+
+    // NOTE: On a dedicated compute queue the pass transitions its transients itself
+    b32 PassOwnsTransients = (Pass->Flags & RenderGraphPassFlag_AsyncCompute) && Graph->AsyncDedicated;
+
+    for (u32 AccessId = 0; AccessId < Pass->NumAccesses; ++AccessId)
+    {
+        render_graph_access* Access = Graph->Accesses + Pass->FirstAccess + AccessId;
+        render_graph_image* Image = Graph->Images + Access->ImageId;
+        render_graph_usage_info* Info = RenderGraphUsageInfos + Access->Usage;
+
+        if (Image->Transient)
+        {
+            // NOTE: Outside of its pass range the memory belongs to another transient, and nothing survives between frames
+            Assert(Pass->Id >= Image->FirstPass && Pass->Id <= Image->LastPass);
+            Assert(Access->Discard || Image->WrittenThisFrame);
+            Image->WrittenThisFrame = true;
+            if (PassOwnsTransients)
+            {
+                continue;
+            }
+        }
+
+        b32 Write = (Info->Access & RENDER_GRAPH_WRITE_ACCESS) != 0;
+        b32 Transition = Access->Discard || Image->Layout != Info->Layout;
+        VkPipelineStageFlags Src = 0;
+        VkAccessFlags SrcAccess = 0;
+        if (Transition || Write)
+        {
+            // NOTE: Write after read/write, a layout transition counts as a write
+            Src = Image->WriteStages | Image->ReadStages;
+            SrcAccess = Image->WriteAccess;
+        }
+        else if ((Info->Stages & ~Image->VisibleStages) || (Info->Access & ~Image->VisibleAccess))
+        {
+            // NOTE: Read after write, only if the last write isn't visible to this stage yet
+            Src = Image->WriteStages;
+            SrcAccess = Image->WriteAccess;
+        }
+
+        if (Image->Transient && Access->Discard)
+        {
+            // NOTE: The memory might have belonged to an aliased transient earlier this frame or last frame
+            for (u32 OtherId = 1; OtherId < Graph->NumImages; ++OtherId)
+            {
+                render_graph_image* Other = Graph->Images + OtherId;
+                if (Other->Transient && Other != Image && RenderGraphMemoryOverlaps(Other, Image))
+                {
+                    Src |= Other->WriteStages | Other->ReadStages;
+                    SrcAccess |= Other->WriteAccess;
+                }
+            }
+        }
+
+        if (!Transition && Src == 0)
+        {
+            continue;
+        }
+
+        VkImageMemoryBarrier* Barrier = Barriers + NumBarriers++;
+        *Barrier = {};
+        Barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        Barrier->srcAccessMask = SrcAccess;
+        Barrier->dstAccessMask = Info->Access;
+        Barrier->oldLayout = Access->Discard ? VK_IMAGE_LAYOUT_UNDEFINED : Image->Layout;
+        Barrier->newLayout = Info->Layout;
+        Barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Barrier->image = Image->Image;
+        Barrier->subresourceRange.aspectMask = Image->Aspect;
+        Barrier->subresourceRange.baseMipLevel = 0;
+        Barrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        Barrier->subresourceRange.baseArrayLayer = 0;
+        Barrier->subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        SrcStages |= Src;
+        DstStages |= Info->Stages;
+
+        if (Transition)
+        {
+            // NOTE: The transition is now the last write, later stages chain through this barriers destination
+            Image->Layout = Info->Layout;
+            Image->WriteStages = Info->Stages;
+            Image->WriteAccess = 0;
+            Image->VisibleStages = Info->Stages;
+            Image->VisibleAccess = Info->Access;
+            Image->ReadStages = 0;
+        }
+        else
+        {
+            Image->VisibleStages |= Info->Stages;
+            Image->VisibleAccess |= Info->Access;
+        }
+    }
+
+    if (NumBarriers > 0)
+    {
+        vkCmdPipelineBarrier(CmdBuffer, SrcStages ? SrcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, DstStages, 0, 0, 0, 0, 0,
+                             NumBarriers, Barriers);
+        Graph->NumBarrierBatches += 1;
+        Graph->NumImageBarriers += NumBarriers;
+    }
+}
+
+inline void RenderGraphPassFinish(render_graph* Graph, render_graph_pass* Pass)
+{
+    for (u32 AccessId = 0; AccessId < Pass->NumAccesses; ++AccessId)
+    {
+        render_graph_access* Access = Graph->Accesses + Pass->FirstAccess + AccessId;
+        render_graph_image* Image = Graph->Images + Access->ImageId;
+        render_graph_usage_info* Info = RenderGraphUsageInfos + Access->FinalUsage;
+
+        Image->Layout = Info->Layout;
+        if (Info->Access & RENDER_GRAPH_WRITE_ACCESS)
+        {
+            Image->WriteStages = Info->Stages;
+            Image->WriteAccess = Info->Access & RENDER_GRAPH_WRITE_ACCESS;
+            Image->VisibleStages = 0;
+            Image->VisibleAccess = 0;
+            Image->ReadStages = 0;
+        }
+        else if (Access->FinalUsage != Access->Usage)
+        {
+            // NOTE: The pass made its own writes visible to the final usage
+            Image->WriteStages = Info->Stages;
+            Image->WriteAccess = 0;
+            Image->VisibleStages = Info->Stages;
+            Image->VisibleAccess = Info->Access;
+            Image->ReadStages = 0;
+        }
+        else
+        {
+            Image->ReadStages |= Info->Stages;
+        }
+    }
+}
+
+inline void RenderGraphExecute(render_graph* Graph, vk_commands* Commands)
+{
+    RenderGraphCull(Graph);
+
+    Graph->NumBarrierBatches = 0;
+    Graph->NumImageBarriers = 0;
+    for (u32 ImageId = 1; ImageId < Graph->NumImages; ++ImageId)
+    {
+        Graph->Images[ImageId].WrittenThisFrame = false;
+    }
+
+    for (u32 PassId = 0; PassId < Graph->NumPasses; ++PassId)
+    {
+        render_graph_pass* Pass = Graph->Passes + PassId;
+        if (!Pass->Alive)
+        {
+            continue;
+        }
+
+        // NOTE: Passes can switch Commands over to another command buffer (async compute), so always record into the current one
+        RenderGraphPassBarrier(Graph, Commands->Buffer, Pass);
+        Pass->Record(Commands, Pass->Data, Pass->Param);
+        RenderGraphPassFinish(Graph, Pass);
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+/*
+
+  NOTE: Render Graph
+
+    ForwardRender used to record its passes straight into the command buffer, and every module placed its own barriers based on
+    whatever layout it assumed the previous pass left behind. Now the passes of a frame get declared up front with the images they
+    touch, and the graph records them:
+
+      - Passes are added every frame in a fixed order (render_graph_pass_id) with a record callback and their image accesses. Work
+        that isn't needed this frame simply doesn't get added. A pass whose outputs are never read gets culled, passes that write
+        imported images or anything the graph doesn't track (buffers, the swap chain) have to be marked as side effects
+      - Every image has a tracked layout and last access that carries over between frames. Before each pass we emit a single batched
+        barrier that covers exactly the hazards of its accesses (read after write, write after read/write, layout changes) and
+        nothing for images that are already in the right state. Render passes keep their attachments in attachment layout from start
+        to end, so the graph sees every transition
+      - Transient images only live within a frame and are placed in one shared heap. Their lifetime is a static pass range, images
+        whose ranges don't overlap share memory. Placement is first fit at creation (resize time) and the first access of a frame
+        discards the contents, synchronized against whatever used the memory before
+      - The heap is sized to the placement high water mark. Images placed past its end get their own memory for the time being, and
+        RenderGraphTransientHeapFit reallocates the heap at the next resize so that everything fits in it again
+
+    An access describes the state at the start of the pass (Usage) and the state the pass leaves the image in (FinalUsage). When
+    they differ the pass did its own synchronization in between (dispatch chains, queue ownership transfers) and FinalUsage has to
+    already be visible when the pass ends.
+
+    IMPORTANT: With a dedicated async compute queue, passes flagged AsyncCompute transition their transients themselves on the
+    compute queue and those transients have to be created with a lifetime that runs to RenderGraphPass_AsyncComputeJoin, since the
+    graphics work between the hand off and the join runs concurrently with them.
+
+ */
+
+#define RENDER_GRAPH_MAX_ACCESSES 128
+#define RENDER_GRAPH_WRITE_ACCESS (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | \
+                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT)
+
+#define RENDER_GRAPH_PASS_RECORD(name) void name(vk_commands* Commands, void* Data, u32 Param)
+typedef RENDER_GRAPH_PASS_RECORD(render_graph_pass_record);
+
+// NOTE: Frame order, passes have to be added in this order
+enum render_graph_pass_id
+{
+    RenderGraphPass_ShadowCache,
+    RenderGraphPass_Shadow,
+    RenderGraphPass_ShadowBlur,
+    // NOTE: One per clipmap level
+    RenderGraphPass_ClipmapLevel0,
+    RenderGraphPass_ClipmapLevel1,
+    RenderGraphPass_ClipmapLevel2,
+    RenderGraphPass_ClipmapLevel3,
+    RenderGraphPass_ShadowTimestamp,
+
+    RenderGraphPass_OcclusionCullEarly,
+    RenderGraphPass_DepthPrepass,
+    RenderGraphPass_OcclusionPyramid,
+    RenderGraphPass_OcclusionCullLate,
+    RenderGraphPass_DepthPrepassLate,
+    RenderGraphPass_PrepassTimestamp,
+    // NOTE: Everything above overlaps with the async compute work, everything below can consume it
+    RenderGraphPass_AsyncComputeJoin,
+
+    RenderGraphPass_ShadowMask,
+    RenderGraphPass_ShadowMaskTimestamp,
+
+    RenderGraphPass_Forward,
+    RenderGraphPass_ForwardTimestamp,
+    RenderGraphPass_CpuRasterReadback,
+
+    RenderGraphPass_Count,
+};
+
+enum render_graph_pass_flags
+{
+    RenderGraphPassFlag_SideEffect = 1 << 0,
+    RenderGraphPassFlag_AsyncCompute = 1 << 1,
+};
+
+// NOTE: Indexes RenderGraphUsageInfos
+enum render_graph_usage
+{
+    RenderGraphUsage_ColorAttachment,
+    RenderGraphUsage_DepthAttachment,
+    RenderGraphUsage_DepthReadCompute,
+    RenderGraphUsage_SampledFragment,
+    RenderGraphUsage_SampledCompute,
+    RenderGraphUsage_StorageCompute,
+    RenderGraphUsage_GeneralReadCompute,
+    RenderGraphUsage_GeneralReadFragment,
+    RenderGraphUsage_TransferSrc,
+    RenderGraphUsage_TransferDst,
+
+    RenderGraphUsage_Count,
+};
+
+struct render_graph_usage_info
+{
+    VkImageLayout Layout;
+    VkPipelineStageFlags Stages;
+    VkAccessFlags Access;
+};
+
+struct render_graph_image
+{
+    VkImage Image;
+    VkImageAspectFlags Aspect;
+
+    // NOTE: Transients own their image and view, and occupy [Offset, Offset + Size) of the heap while their pass range is alive
+    b32 Transient;
+    VkImageView View;
+    render_graph_pass_id FirstPass;
+    render_graph_pass_id LastPass;
+    u64 Offset;
+    // NOTE: Zero while not placed, after the heap moved and before the image gets re-created
+    u64 Size;
+    u32 MemoryTypeBits;
+    // NOTE: Only for images that got placed past the end of the heap
+    VkDeviceMemory OverflowMemory;
+    b32 WrittenThisFrame;
+
+    // NOTE: State after the last recorded access. Visible is what already sees the last write, Read is who read it since
+    VkImageLayout Layout;
+    VkPipelineStageFlags WriteStages;
+    VkAccessFlags WriteAccess;
+    VkPipelineStageFlags VisibleStages;
+    VkAccessFlags VisibleAccess;
+    VkPipelineStageFlags ReadStages;
+};
+
+struct render_graph_access
+{
+    u32 ImageId;
+    render_graph_usage Usage;
+    render_graph_usage FinalUsage;
+    // NOTE: The previous contents aren't needed, the pass overwrites (or clears) all of it
+    b32 Discard;
+};
+
+struct render_graph_pass
+{
+    render_graph_pass_id Id;
+    u32 Flags;
+    render_graph_pass_record* Record;
+    void* Data;
+    u32 Param;
+    u32 FirstAccess;
+    u32 NumAccesses;
+    b32 Alive;
+};
+
+struct render_graph
+{
+    b32 AsyncDedicated;
+
+    // NOTE: Image 0 is reserved so that a zero id means not created yet. Ids only get handed out at creation, so the images grow
+    // like the growable containers. Needed is the per image scratch of RenderGraphCull
+    u32 MaxNumImages;
+    u32 NumImages;
+    render_graph_image* Images;
+    b32* Needed;
+
+    VkDeviceMemory TransientMemory;
+    u32 TransientMemoryTypeId;
+    u64 TransientHeapSize;
+
+    // NOTE: Reset every frame
+    u32 NumPasses;
+    render_graph_pass Passes[RenderGraphPass_Count];
+    u32 NumAccesses;
+    render_graph_access Accesses[RENDER_GRAPH_MAX_ACCESSES];
+
+    // NOTE: Stats, the barrier counts are of the last frame
+    u32 NumPassesCulled;
+    u32 NumBarrierBatches;
+    u32 NumImageBarriers;
+    u64 TransientHeapUsed;
+    u64 TransientOverflowSize;
+    u64 TransientSizeSum;
+};
@@ -0,0 +1,310 @@
+
+//
+// NOTE: Scene BVH
+//
+
+inline void SceneBvhResize(growable_state* Growable, scene_bvh* Bvh, u32 MaxNumInstances)
+{
+    // NOTE: Small groups can produce nodes with a single child, 2N is a comfortable upper bound. Growing keeps the tree and the leaf
+    // refs valid, the instance count changes anyway when we grow so the next update rebuilds
+    u32 OldMaxNumNodes = Bvh->MaxNumNodes;
+    u32 OldMaxNumInstances = Bvh->MaxNumInstances;
+    Bvh->MaxNumNodes = Max(2*MaxNumInstances, 1u);
+    Bvh->MaxNumInstances = MaxNumInstances;
+    Bvh->Nodes = GrowableArrayResizeType(Growable, Bvh->Nodes, bvh_node, OldMaxNumNodes, Bvh->MaxNumNodes);
+    Bvh->LeafRefs = GrowableArrayResizeType(Growable, Bvh->LeafRefs, bvh_leaf_ref, OldMaxNumInstances, MaxNumInstances);
+    Bvh->BuildIds = GrowableArrayResizeType(Growable, Bvh->BuildIds, u32, OldMaxNumInstances, MaxNumInstances);
+    Bvh->Stack = GrowableArrayResizeType(Growable, Bvh->Stack, u32, 4*u64(OldMaxNumNodes), 4*u64(Bvh->MaxNumNodes));
+}
+
+inline void SceneBvhCreate(growable_state* Growable, u32 MaxNumInstances, scene_bvh* Result)
+{
+    *Result = {};
+    SceneBvhResize(Growable, Result, MaxNumInstances);
+}
+
+inline void SceneBvhSlotSet(bvh_node* Node, u32 Slot, v3 Min, v3 Max)
+{
+    ((f32*)&Node->MinX)[Slot] = Min.x;
+    ((f32*)&Node->MinY)[Slot] = Min.y;
+    ((f32*)&Node->MinZ)[Slot] = Min.z;
+    ((f32*)&Node->MaxX)[Slot] = Max.x;
+    ((f32*)&Node->MaxY)[Slot] = Max.y;
+    ((f32*)&Node->MaxZ)[Slot] = Max.z;
+}
+
+inline void SceneBvhNodeBoundsGet(bvh_node* Node, v3* ResultMin, v3* ResultMax)
+{
+    b32 First = true;
+    for (u32 Slot = 0; Slot < 4; ++Slot)
+    {
+        if (Node->Children[Slot] == BVH_EMPTY_CHILD)
+        {
+            continue;
+        }
+
+        if (First)
+        {
+            *ResultMin = V3(((f32*)&Node->MinX)[Slot], ((f32*)&Node->MinY)[Slot], ((f32*)&Node->MinZ)[Slot]);
+            *ResultMax = V3(((f32*)&Node->MaxX)[Slot], ((f32*)&Node->MaxY)[Slot], ((f32*)&Node->MaxZ)[Slot]);
+            First = false;
+        }
+        else
+        {
+            *ResultMin = V3(Min(ResultMin->x, ((f32*)&Node->MinX)[Slot]), Min(ResultMin->y, ((f32*)&Node->MinY)[Slot]), Min(ResultMin->z, ((f32*)&Node->MinZ)[Slot]));
+            *ResultMax = V3(Max(ResultMax->x, ((f32*)&Node->MaxX)[Slot]), Max(ResultMax->y, ((f32*)&Node->MaxY)[Slot]), Max(ResultMax->z, ((f32*)&Node->MaxZ)[Slot]));
+        }
+    }
+}
+
+inline f32 SceneBvhCentroidGet(instance_entry* Instance, u32 Axis)
+{
+    v3 Centroid = 0.5f*(Instance->BoundsMin + Instance->BoundsMax);
+    f32 Result = Axis == 0 ? Centroid.x : (Axis == 1 ? Centroid.y : Centroid.z);
+    return Result;
+}
+
+inline void SceneBvhSort(instance_entry* Instances, u32* Ids, i32 First, i32 Last, u32 Axis)
+{
+    // NOTE: Quick sort by centroid along the split axis
+    while (First < Last)
+    {
+        f32 Pivot = SceneBvhCentroidGet(Instances + Ids[(First + Last) / 2], Axis);
+        i32 Left = First;
+        i32 Right = Last;
+        while (Left <= Right)
+        {
+            while (SceneBvhCentroidGet(Instances + Ids[Left], Axis) < Pivot) { Left += 1; }
+            while (SceneBvhCentroidGet(Instances + Ids[Right], Axis) > Pivot) { Right -= 1; }
+            if (Left <= Right)
+            {
+                u32 Temp = Ids[Left];
+                Ids[Left] = Ids[Right];
+                Ids[Right] = Temp;
+                Left += 1;
+                Right -= 1;
+            }
+        }
+
+        // NOTE: Recurse on the smaller half so the stack stays shallow
+        if (Right - First < Last - Left)
+        {
+            SceneBvhSort(Instances, Ids, First, Right, Axis);
+            First = Left;
+        }
+        else
+        {
+            SceneBvhSort(Instances, Ids, Left, Last, Axis);
+            Last = Right;
+        }
+    }
+}
+
+inline u32 SceneBvhBuildNode(scene_bvh* Bvh, instance_entry* Instances, u32* Ids, u32 NumIds, u32 Parent, u32 ParentSlot)
+{
+    Assert(Bvh->NumNodes < Bvh->MaxNumNodes);
+    u32 NodeId = Bvh->NumNodes++;
+    bvh_node* Node = Bvh->Nodes + NodeId;
+    *Node = {};
+    Node->Parent = Parent;
+    Node->ParentSlot = ParentSlot;
+    for (u32 Slot = 0; Slot < 4; ++Slot)
+    {
+        Node->Children[Slot] = BVH_EMPTY_CHILD;
+    }
+    
+    if (NumIds <= 4)
+    {
+        for (u32 Slot = 0; Slot < NumIds; ++Slot)
+        {
+            u32 InstanceId = Ids[Slot];
+            instance_entry* Instance = Instances + InstanceId;
+            Node->Children[Slot] = InstanceId | BVH_LEAF_BIT;
+            SceneBvhSlotSet(Node, Slot, Instance->BoundsMin, Instance->BoundsMax);
+
+            bvh_leaf_ref* LeafRef = Bvh->LeafRefs + InstanceId;
+            LeafRef->NodeId = NodeId;
+            LeafRef->Slot = Slot;
+            LeafRef->BoundsMin = Instance->BoundsMin;
+            LeafRef->BoundsMax = Instance->BoundsMax;
+        }
+
+        return NodeId;
+    }
+
+    // NOTE: Split along the longest axis of the centroid bounds into 4 equal sized groups
+    u32 Axis = 0;
+    {
+        v3 CentroidMin = 0.5f*(Instances[Ids[0]].BoundsMin + Instances[Ids[0]].BoundsMax);
+        v3 CentroidMax = CentroidMin;
+        for (u32 IdIndex = 1; IdIndex < NumIds; ++IdIndex)
+        {
+            instance_entry* Instance = Instances + Ids[IdIndex];
+            v3 Centroid = 0.5f*(Instance->BoundsMin + Instance->BoundsMax);
+            CentroidMin = V3(Min(CentroidMin.x, Centroid.x), Min(CentroidMin.y, Centroid.y), Min(CentroidMin.z, Centroid.z));
+            CentroidMax = V3(Max(CentroidMax.x, Centroid.x), Max(CentroidMax.y, Centroid.y), Max(CentroidMax.z, Centroid.z));
+        }
+
+        v3 Extent = CentroidMax - CentroidMin;
+        Axis = (Extent.x >= Extent.y && Extent.x >= Extent.z) ? 0 : (Extent.y >= Extent.z ? 1 : 2);
+    }
+    SceneBvhSort(Instances, Ids, 0, i32(NumIds) - 1, Axis);
+
+    for (u32 Slot = 0; Slot < 4; ++Slot)
+    {
+        u32 First = (NumIds*Slot) / 4;
+        u32 Last = (NumIds*(Slot + 1)) / 4;
+        u32 ChildId = SceneBvhBuildNode(Bvh, Instances, Ids + First, Last - First, NodeId, Slot);
+
+        Node = Bvh->Nodes + NodeId;
+        Node->Children[Slot] = ChildId;
+
+        v3 ChildMin, ChildMax;
+        SceneBvhNodeBoundsGet(Bvh->Nodes + ChildId, &ChildMin, &ChildMax);
+        SceneBvhSlotSet(Node, Slot, ChildMin, ChildMax);
+    }
+
+    return NodeId;
+}
+
+inline void SceneBvhRefitInstance(scene_bvh* Bvh, u32 InstanceId, v3 BoundsMin, v3 BoundsMax)
+{
+    bvh_leaf_ref* LeafRef = Bvh->LeafRefs + InstanceId;
+    LeafRef->BoundsMin = BoundsMin;
+    LeafRef->BoundsMax = BoundsMax;
+
+    bvh_node* Node = Bvh->Nodes + LeafRef->NodeId;
+    SceneBvhSlotSet(Node, LeafRef->Slot, BoundsMin, BoundsMax);
+
+    // NOTE: Propagate up to the root
+    u32 NodeId = LeafRef->NodeId;
+    while (NodeId != 0)
+    {
+        Node = Bvh->Nodes + NodeId;
+        v3 NodeMin, NodeMax;
+        SceneBvhNodeBoundsGet(Node, &NodeMin, &NodeMax);
+        SceneBvhSlotSet(Bvh->Nodes + Node->Parent, Node->ParentSlot, NodeMin, NodeMax);
+        NodeId = Node->Parent;
+    }
+}
+
+inline void SceneBvhUpdate(scene_bvh* Bvh, instance_entry* Instances, u32 NumInstances)
+{
+    if (NumInstances != Bvh->NumInstances)
+    {
+        // NOTE: Rebuild
+        Bvh->NumInstances = NumInstances;
+        Bvh->NumNodes = 0;
+        if (NumInstances > 0)
+        {
+            for (u32 InstanceId = 0; InstanceId < NumInstances; ++InstanceId)
+            {
+                Bvh->BuildIds[InstanceId] = InstanceId;
+            }
+            SceneBvhBuildNode(Bvh, Instances, Bvh->BuildIds, NumInstances, BVH_EMPTY_CHILD, 0);
+        }
+
+        return;
+    }
+
+    // NOTE: Refit only what moved
+    for (u32 InstanceId = 0; InstanceId < NumInstances; ++InstanceId)
+    {
+        instance_entry* Instance = Instances + InstanceId;
+        bvh_leaf_ref* LeafRef = Bvh->LeafRefs + InstanceId;
+        if (Instance->BoundsMin.x != LeafRef->BoundsMin.x || Instance->BoundsMin.y != LeafRef->BoundsMin.y ||
+            Instance->BoundsMin.z != LeafRef->BoundsMin.z || Instance->BoundsMax.x != LeafRef->BoundsMax.x ||
+            Instance->BoundsMax.y != LeafRef->BoundsMax.y || Instance->BoundsMax.z != LeafRef->BoundsMax.z)
+        {
+            SceneBvhRefitInstance(Bvh, InstanceId, Instance->BoundsMin, Instance->BoundsMax);
+        }
+    }
+}
+
+//
+// NOTE: Frustum Culling
+//
+
+inline bvh_frustum BvhFrustumFromVP(m4 VPTransform)
+{
+    // NOTE: Gribb/Hartmann plane extraction. We pull the rows out by transforming the basis vectors since those give us columns
+    v4 Col0 = VPTransform * V4(1, 0, 0, 0);
+    v4 Col1 = VPTransform * V4(0, 1, 0, 0);
+    v4 Col2 = VPTransform * V4(0, 0, 1, 0);
+    v4 Col3 = VPTransform * V4(0, 0, 0, 1);
+    v4 Row0 = V4(Col0.x, Col1.x, Col2.x, Col3.x);
+    v4 Row1 = V4(Col0.y, Col1.y, Col2.y, Col3.y);
+    v4 Row2 = V4(Col0.z, Col1.z, Col2.z, Col3.z);
+    v4 Row3 = V4(Col0.w, Col1.w, Col2.w, Col3.w);
+
+    // NOTE: Vulkan clip space is -w <= x, y <= w and 0 <= z <= w
+    bvh_frustum Result = {};
+    Result.Planes[0] = Row3 + Row0;
+    Result.Planes[1] = Row3 - Row0;
+    Result.Planes[2] = Row3 + Row1;
+    Result.Planes[3] = Row3 - Row1;
+    Result.Planes[4] = Row2;
+    Result.Planes[5] = Row3 - Row2;
+
+    return Result;
+}
+
+inline u32 BvhFrustumTest4(bvh_frustum* Frustum, bvh_node* Node)
+{
+    // NOTE: For every plane we take the corner of each box furthest along the normal, if it is behind the plane the box is out
+    __m128 Inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+    for (u32 PlaneId = 0; PlaneId < 6; ++PlaneId)
+    {
+        v4 Plane = Frustum->Planes[PlaneId];
+        __m128 Nx = _mm_set1_ps(Plane.x);
+        __m128 Ny = _mm_set1_ps(Plane.y);
+        __m128 Nz = _mm_set1_ps(Plane.z);
+        __m128 D = _mm_set1_ps(Plane.w);
+        
+        __m128 X = _mm_max_ps(_mm_mul_ps(Nx, Node->MinX), _mm_mul_ps(Nx, Node->MaxX));
+        __m128 Y = _mm_max_ps(_mm_mul_ps(Ny, Node->MinY), _mm_mul_ps(Ny, Node->MaxY));
+        __m128 Z = _mm_max_ps(_mm_mul_ps(Nz, Node->MinZ), _mm_mul_ps(Nz, Node->MaxZ));
+        __m128 Distance = _mm_add_ps(_mm_add_ps(X, Y), _mm_add_ps(Z, D));
+        Inside = _mm_and_ps(Inside, _mm_cmpge_ps(Distance, _mm_setzero_ps()));
+    }
+
+    u32 Result = u32(_mm_movemask_ps(Inside));
+    return Result;
+}
+
+inline u32 SceneBvhCull(scene_bvh* Bvh, m4 VPTransform, u32* VisibleIds)
+{
+    u32 NumVisible = 0;
+    if (Bvh->NumNodes == 0)
+    {
+        return NumVisible;
+    }
+
+    bvh_frustum Frustum = BvhFrustumFromVP(VPTransform);
+    u32 StackSize = 0;
+    Bvh->Stack[StackSize++] = 0;
+    while (StackSize > 0)
+    {
+        bvh_node* Node = Bvh->Nodes + Bvh->Stack[--StackSize];
+        u32 Mask = BvhFrustumTest4(&Frustum, Node);
+        for (u32 Slot = 0; Slot < 4; ++Slot)
+        {
+            u32 Child = Node->Children[Slot];
+            if (!(Mask & (1 << Slot)) || Child == BVH_EMPTY_CHILD)
+            {
+                continue;
+            }
+
+            if (Child & BVH_LEAF_BIT)
+            {
+                VisibleIds[NumVisible++] = Child & ~BVH_LEAF_BIT;
+            }
+            else
+            {
+                Bvh->Stack[StackSize++] = Child;
+            }
+        }
+    }
+
+    return NumVisible;
+}
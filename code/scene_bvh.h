@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+
+  NOTE: Scene BVH
+
+    4 wide BVH over the opaque instances. Every node stores the bounds of its 4 children in SoA form so that we can test all of them
+    against a plane with a handful of SSE instructions. A child is either another node or a single instance (leaf bit set).
+
+    Instances get re-added every frame, so as long as the instance count stays the same we keep the tree and only refit the path from
+    each instance whose bounds changed up to the root. If the count changes we rebuild.
+  
+ */
+
+#include <xmmintrin.h>
+
+#define BVH_LEAF_BIT 0x80000000
+#define BVH_EMPTY_CHILD 0xFFFFFFFF
+
+struct bvh_node
+{
+    __m128 MinX;
+    __m128 MinY;
+    __m128 MinZ;
+    __m128 MaxX;
+    __m128 MaxY;
+    __m128 MaxZ;
+    u32 Children[4];
+    
+    u32 Parent;
+    u32 ParentSlot;
+};
+
+// NOTE: Where an instance lives in the tree + the bounds it was last refit with
+struct bvh_leaf_ref
+{
+    u32 NodeId;
+    u32 Slot;
+    v3 BoundsMin;
+    v3 BoundsMax;
+};
+
+struct bvh_frustum
+{
+    // NOTE: Planes stored SoA, inside is Dot(Normal, P) + D >= 0
+    v4 Planes[6];
+};
+
+struct scene_bvh
+{
+    u32 MaxNumNodes;
+    u32 NumNodes;
+    bvh_node* Nodes;
+
+    u32 MaxNumInstances;
+    u32 NumInstances;
+    bvh_leaf_ref* LeafRefs;
+
+    // NOTE: Scratch for building/traversing
+    u32* BuildIds;
+    u32* Stack;
+};
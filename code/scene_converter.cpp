@@ -0,0 +1,744 @@
+
+/*
+
+  NOTE: Scene Converter
+
+    Offline tool that turns a Wavefront OBJ file into the binary scene format in scene_file.h (build.bat converter):
+
+      scene_converter.exe <input.obj> [output.scn] [grid size] [lights.txt]
+
+    Every o/g group becomes a mesh. Faces get fan triangulated, v/vt/vn triples get deduplicated into vertices and corners without a
+    normal get the area weighted normal of the faces around them. Each mesh then goes through the same LOD chain, optimization and
+    attribute packing the demo does at load time, so the demo only has to copy the result into the geometry buffer. Materials are
+    ignored for now.
+
+    Every mesh gets one static instance at the origin. With a grid size N the whole set gets repeated N x N times in the xz plane
+    which is how we build the large instance count test scenes (N = 1000 gives a million instances per mesh).
+
+    OBJ has no lights, so point lights come from an optional text file with one "pl x y z r g b max_distance" line per light. They get
+    repeated with the grid like the instances.
+
+ */
+
+#include "framework_vulkan\framework_vulkan.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mesh.h"
+#include "scene_file.h"
+#include "radix_sort.cpp"
+#include "mesh.cpp"
+
+#define SCENE_CONVERTER_MEMORY_SIZE MegaBytes(2048)
+#define SCENE_CONVERTER_TEMP_MEMORY_SIZE MegaBytes(512)
+
+struct obj_corner
+{
+    // NOTE: 0 based, -1 if the face didn't reference one
+    i32 Position;
+    i32 Uv;
+    i32 Normal;
+};
+
+struct obj_group
+{
+    u32 FirstCorner;
+    u32 NumCorners;
+};
+
+struct converter_mesh
+{
+    mesh Mesh;
+    v3 BoundsMin;
+    v3 BoundsMax;
+    v3 SphereCenter;
+    f32 SphereRadius;
+    u32 IndexSize;
+};
+
+//
+// NOTE: File IO
+//
+
+inline u64 ConverterChunkSize(u64 Remaining)
+{
+    // NOTE: ReadFile/WriteFile take 32bit sizes
+    u64 Result = Remaining < MegaBytes(256) ? Remaining : MegaBytes(256);
+    return Result;
+}
+
+inline u8* ConverterFileRead(linear_arena* Arena, char* FileName, u64* Size)
+{
+    u8* Result = 0;
+    *Size = 0;
+
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER FileSize;
+        if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0)
+        {
+            // NOTE: Null terminated so the parser can't run off the end
+            Result = PushArray(Arena, u8, u64(FileSize.QuadPart) + 1);
+            u64 Offset = 0;
+            while (Offset < u64(FileSize.QuadPart))
+            {
+                DWORD ChunkSize = DWORD(ConverterChunkSize(u64(FileSize.QuadPart) - Offset));
+                DWORD BytesRead = 0;
+                if (!ReadFile(File, Result + Offset, ChunkSize, &BytesRead, 0) || BytesRead != ChunkSize)
+                {
+                    break;
+                }
+                Offset += BytesRead;
+            }
+
+            if (Offset == u64(FileSize.QuadPart))
+            {
+                Result[Offset] = 0;
+                *Size = Offset;
+            }
+            else
+            {
+                Result = 0;
+            }
+        }
+
+        CloseHandle(File);
+    }
+
+    return Result;
+}
+
+inline b32 ConverterFileWrite(HANDLE File, u64* Offset, void* Data, u64 Size)
+{
+    b32 Result = true;
+    u8* Src = (u8*)Data;
+    u64 Written = 0;
+    while (Result && Written < Size)
+    {
+        DWORD ChunkSize = DWORD(ConverterChunkSize(Size - Written));
+        DWORD BytesWritten = 0;
+        Result = WriteFile(File, Src + Written, ChunkSize, &BytesWritten, 0) && BytesWritten == ChunkSize;
+        Written += BytesWritten;
+    }
+
+    *Offset += Written;
+    return Result;
+}
+
+inline b32 ConverterFilePad(HANDLE File, u64* Offset)
+{
+    u8 Zeros[SCENE_FILE_ALIGNMENT] = {};
+    u64 PadSize = (SCENE_FILE_ALIGNMENT - (*Offset % SCENE_FILE_ALIGNMENT)) % SCENE_FILE_ALIGNMENT;
+    b32 Result = ConverterFileWrite(File, Offset, Zeros, PadSize);
+    return Result;
+}
+
+inline u64 ConverterAlign(u64 Offset)
+{
+    u64 Result = (Offset + SCENE_FILE_ALIGNMENT - 1) / SCENE_FILE_ALIGNMENT * SCENE_FILE_ALIGNMENT;
+    return Result;
+}
+
+//
+// NOTE: OBJ Parsing
+//
+
+inline char* ObjLineSkip(char* At)
+{
+    while (*At && *At != '\n')
+    {
+        At += 1;
+    }
+    if (*At == '\n')
+    {
+        At += 1;
+    }
+
+    return At;
+}
+
+inline char* ObjSpacesSkip(char* At)
+{
+    while (*At == ' ' || *At == '\t' || *At == '\r')
+    {
+        At += 1;
+    }
+
+    return At;
+}
+
+inline b32 ObjKeywordIs(char* At, char* Keyword)
+{
+    while (*Keyword)
+    {
+        if (*At++ != *Keyword++)
+        {
+            return false;
+        }
+    }
+
+    b32 Result = *At == ' ' || *At == '\t';
+    return Result;
+}
+
+inline f32 ObjF32Parse(char** At)
+{
+    *At = ObjSpacesSkip(*At);
+    char* End = 0;
+    f32 Result = strtof(*At, &End);
+    *At = End;
+    return Result;
+}
+
+inline i32 ObjIndexResolve(i32 Index, u32 Count)
+{
+    // NOTE: OBJ indices are 1 based, negative ones count back from the last element read so far
+    i32 Result = -1;
+    if (Index > 0)
+    {
+        Result = Index - 1;
+    }
+    else if (Index < 0)
+    {
+        Result = i32(Count) + Index;
+    }
+
+    if (Result >= i32(Count))
+    {
+        Result = -1;
+    }
+
+    return Result;
+}
+
+inline b32 ObjCornerParse(char** At, u32 NumPositions, u32 NumUvs, u32 NumNormals, obj_corner* Corner)
+{
+    *At = ObjSpacesSkip(*At);
+    if (!(**At == '-' || (**At >= '0' && **At <= '9')))
+    {
+        return false;
+    }
+
+    // NOTE: p, p/t, p//n or p/t/n
+    char* End = 0;
+    Corner->Position = ObjIndexResolve(i32(strtol(*At, &End, 10)), NumPositions);
+    Corner->Uv = -1;
+    Corner->Normal = -1;
+    *At = End;
+    if (**At == '/')
+    {
+        *At += 1;
+        if (**At != '/')
+        {
+            Corner->Uv = ObjIndexResolve(i32(strtol(*At, &End, 10)), NumUvs);
+            *At = End;
+        }
+        if (**At == '/')
+        {
+            *At += 1;
+            Corner->Normal = ObjIndexResolve(i32(strtol(*At, &End, 10)), NumNormals);
+            *At = End;
+        }
+    }
+
+    // NOTE: Skip whatever else is glued to the token
+    while (**At && **At != ' ' && **At != '\t' && **At != '\r' && **At != '\n')
+    {
+        *At += 1;
+    }
+
+    b32 Result = Corner->Position >= 0;
+    return Result;
+}
+
+//
+// NOTE: Mesh Building
+//
+
+inline u32 ConverterCornerHash(obj_corner Corner)
+{
+    u32 Result = u32(Corner.Position)*73856093u ^ u32(Corner.Uv)*19349663u ^ u32(Corner.Normal)*83492791u;
+    return Result;
+}
+
+inline void ConverterMeshBuild(linear_arena* Arena, linear_arena* TempArena, v3* Positions, v2* Uvs, v3* Normals, obj_corner* Corners,
+                               u32 NumCorners, converter_mesh* Result)
+{
+    temp_mem TempMem = BeginTempMem(TempArena);
+
+    // NOTE: Deduplicate the corners into vertices
+    u32 TableSize = 1;
+    while (TableSize < 2*NumCorners)
+    {
+        TableSize <<= 1;
+    }
+    u32* Table = PushArray(TempArena, u32, TableSize);
+    for (u32 SlotId = 0; SlotId < TableSize; ++SlotId)
+    {
+        Table[SlotId] = 0xFFFFFFFF;
+    }
+
+    obj_corner* UniqueCorners = PushArray(TempArena, obj_corner, NumCorners);
+    u32* Indices = PushArray(TempArena, u32, NumCorners);
+    u32 NumVertices = 0;
+    for (u32 CornerId = 0; CornerId < NumCorners; ++CornerId)
+    {
+        obj_corner Corner = Corners[CornerId];
+        u32 Slot = ConverterCornerHash(Corner) & (TableSize - 1);
+        while (Table[Slot] != 0xFFFFFFFF)
+        {
+            obj_corner Other = UniqueCorners[Table[Slot]];
+            if (Other.Position == Corner.Position && Other.Uv == Corner.Uv && Other.Normal == Corner.Normal)
+            {
+                break;
+            }
+            Slot = (Slot + 1) & (TableSize - 1);
+        }
+
+        if (Table[Slot] == 0xFFFFFFFF)
+        {
+            Table[Slot] = NumVertices;
+            UniqueCorners[NumVertices++] = Corner;
+        }
+        Indices[CornerId] = Table[Slot];
+    }
+
+    Result->Mesh = MeshCreate(Arena, NumVertices, NumCorners);
+    mesh* Mesh = &Result->Mesh;
+    for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        obj_corner Corner = UniqueCorners[VertexId];
+        mesh_vertex* Vertex = Mesh->Vertices + VertexId;
+        Vertex->Pos = Positions[Corner.Position];
+        Vertex->Uv = Corner.Uv >= 0 ? Uvs[Corner.Uv] : V2(0.0f, 0.0f);
+        Vertex->Normal = Corner.Normal >= 0 ? Normals[Corner.Normal] : V3(0.0f, 0.0f, 0.0f);
+    }
+    Copy(Indices, Mesh->Indices, sizeof(u32)*NumCorners);
+
+    // NOTE: Corners without a normal get the area weighted face normals around them (the cross product is 2x the area)
+    for (u32 IndexId = 0; IndexId < NumCorners; IndexId += 3)
+    {
+        v3 P0 = Mesh->Vertices[Mesh->Indices[IndexId + 0]].Pos;
+        v3 P1 = Mesh->Vertices[Mesh->Indices[IndexId + 1]].Pos;
+        v3 P2 = Mesh->Vertices[Mesh->Indices[IndexId + 2]].Pos;
+        v3 FaceNormal = Cross(P1 - P0, P2 - P0);
+        for (u32 CornerId = 0; CornerId < 3; ++CornerId)
+        {
+            if (Corners[IndexId + CornerId].Normal < 0)
+            {
+                mesh_vertex* Vertex = Mesh->Vertices + Mesh->Indices[IndexId + CornerId];
+                Vertex->Normal = Vertex->Normal + FaceNormal;
+            }
+        }
+    }
+    for (u32 VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        mesh_vertex* Vertex = Mesh->Vertices + VertexId;
+        f32 NormalLength = Length(Vertex->Normal);
+        Vertex->Normal = NormalLength > 0.0f ? (1.0f / NormalLength)*Vertex->Normal : V3(0.0f, 1.0f, 0.0f);
+    }
+
+    EndTempMem(TempMem);
+
+    mesh_cache_stats StatsBefore = {};
+    mesh_cache_stats StatsAfter = {};
+    MeshLodChainBuild(Arena, TempArena, Mesh);
+    MeshOptimize(TempArena, Mesh, &StatsBefore, &StatsAfter);
+    MeshBoundsGet(Mesh, &Result->BoundsMin, &Result->BoundsMax, &Result->SphereCenter, &Result->SphereRadius);
+    Result->IndexSize = Mesh->NumVertices <= 0x10000 ? sizeof(u16) : sizeof(u32);
+
+    printf("  mesh: %u vertices, %u triangles, %u lods, ACMR %.2f -> %.2f\n", Mesh->NumVertices, Mesh->Lods[0].NumIndices / 3,
+           Mesh->NumLods, StatsBefore.Acmr, StatsAfter.Acmr);
+}
+
+//
+// NOTE: Conversion
+//
+
+int main(int ArgC, char** ArgV)
+{
+    if (ArgC < 2)
+    {
+        printf("usage: scene_converter <input.obj> [output.scn] [grid size] [lights.txt]\n");
+        return 1;
+    }
+
+    char* InputName = ArgV[1];
+    char* OutputName = ArgC > 2 ? ArgV[2] : SCENE_FILE_NAME;
+    i32 GridArg = ArgC > 3 ? atoi(ArgV[3]) : 1;
+    u32 GridSize = GridArg > 1 ? u32(GridArg) : 1;
+    char* LightsName = ArgC > 4 ? ArgV[4] : 0;
+
+    void* Memory = VirtualAlloc(0, SCENE_CONVERTER_MEMORY_SIZE + SCENE_CONVERTER_TEMP_MEMORY_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!Memory)
+    {
+        printf("failed to allocate memory\n");
+        return 1;
+    }
+    linear_arena Arena = LinearArenaCreate(Memory, SCENE_CONVERTER_MEMORY_SIZE + SCENE_CONVERTER_TEMP_MEMORY_SIZE);
+    linear_arena TempArena = LinearSubArena(&Arena, SCENE_CONVERTER_TEMP_MEMORY_SIZE);
+
+    u64 TextSize = 0;
+    char* Text = (char*)ConverterFileRead(&Arena, InputName, &TextSize);
+    if (!Text)
+    {
+        printf("failed to read %s\n", InputName);
+        return 1;
+    }
+
+    // NOTE: Point lights
+    u32 NumLights = 0;
+    scene_file_point_light* Lights = 0;
+    if (LightsName)
+    {
+        u64 LightsTextSize = 0;
+        char* LightsText = (char*)ConverterFileRead(&Arena, LightsName, &LightsTextSize);
+        if (!LightsText)
+        {
+            printf("failed to read %s\n", LightsName);
+            return 1;
+        }
+
+        for (char* At = LightsText; *At; At = ObjLineSkip(At))
+        {
+            At = ObjSpacesSkip(At);
+            NumLights += ObjKeywordIs(At, "pl") ? 1 : 0;
+        }
+
+        Lights = PushArray(&Arena, scene_file_point_light, NumLights);
+        ZeroMem(Lights, sizeof(scene_file_point_light)*NumLights);
+        scene_file_point_light* CurrLight = Lights;
+        for (char* At = LightsText; *At; At = ObjLineSkip(At))
+        {
+            At = ObjSpacesSkip(At);
+            if (ObjKeywordIs(At, "pl"))
+            {
+                At += 2;
+                CurrLight->Pos.x = ObjF32Parse(&At);
+                CurrLight->Pos.y = ObjF32Parse(&At);
+                CurrLight->Pos.z = ObjF32Parse(&At);
+                CurrLight->Color.x = ObjF32Parse(&At);
+                CurrLight->Color.y = ObjF32Parse(&At);
+                CurrLight->Color.z = ObjF32Parse(&At);
+                CurrLight->MaxDistance = ObjF32Parse(&At);
+                CurrLight += 1;
+            }
+        }
+    }
+
+    // NOTE: First pass counts so that the second one can write into exactly sized arrays
+    u32 MaxNumPositions = 0;
+    u32 MaxNumUvs = 0;
+    u32 MaxNumNormals = 0;
+    u32 MaxNumCorners = 0;
+    u32 MaxNumGroups = 1;
+    for (char* At = Text; *At; At = ObjLineSkip(At))
+    {
+        At = ObjSpacesSkip(At);
+        if (ObjKeywordIs(At, "v"))
+        {
+            MaxNumPositions += 1;
+        }
+        else if (ObjKeywordIs(At, "vt"))
+        {
+            MaxNumUvs += 1;
+        }
+        else if (ObjKeywordIs(At, "vn"))
+        {
+            MaxNumNormals += 1;
+        }
+        else if (ObjKeywordIs(At, "o") || ObjKeywordIs(At, "g"))
+        {
+            MaxNumGroups += 1;
+        }
+        else if (ObjKeywordIs(At, "f"))
+        {
+            u32 NumFaceCorners = 0;
+            for (char* Token = At + 1; *Token && *Token != '\n'; ++Token)
+            {
+                if ((Token[-1] == ' ' || Token[-1] == '\t') && Token[0] != ' ' && Token[0] != '\t' && Token[0] != '\r')
+                {
+                    NumFaceCorners += 1;
+                }
+            }
+            MaxNumCorners += NumFaceCorners >= 3 ? 3*(NumFaceCorners - 2) : 0;
+        }
+    }
+
+    v3* Positions = PushArray(&Arena, v3, MaxNumPositions);
+    v2* Uvs = PushArray(&Arena, v2, MaxNumUvs);
+    v3* Normals = PushArray(&Arena, v3, MaxNumNormals);
+    obj_corner* Corners = PushArray(&Arena, obj_corner, MaxNumCorners);
+    obj_group* Groups = PushArray(&Arena, obj_group, MaxNumGroups);
+    u32 NumPositions = 0;
+    u32 NumUvs = 0;
+    u32 NumNormals = 0;
+    u32 NumCorners = 0;
+    u32 NumGroups = 0;
+    Groups[0] = {};
+
+    for (char* At = Text; *At; At = ObjLineSkip(At))
+    {
+        At = ObjSpacesSkip(At);
+        if (ObjKeywordIs(At, "v"))
+        {
+            At += 1;
+            v3* Position = Positions + NumPositions++;
+            Position->x = ObjF32Parse(&At);
+            Position->y = ObjF32Parse(&At);
+            Position->z = ObjF32Parse(&At);
+        }
+        else if (ObjKeywordIs(At, "vt"))
+        {
+            At += 2;
+            v2* Uv = Uvs + NumUvs++;
+            Uv->x = ObjF32Parse(&At);
+            // NOTE: OBJ has v pointing up, our textures have row 0 at the top
+            Uv->y = 1.0f - ObjF32Parse(&At);
+        }
+        else if (ObjKeywordIs(At, "vn"))
+        {
+            At += 2;
+            v3* Normal = Normals + NumNormals++;
+            Normal->x = ObjF32Parse(&At);
+            Normal->y = ObjF32Parse(&At);
+            Normal->z = ObjF32Parse(&At);
+        }
+        else if (ObjKeywordIs(At, "o") || ObjKeywordIs(At, "g"))
+        {
+            if (Groups[NumGroups].NumCorners > 0)
+            {
+                NumGroups += 1;
+                Groups[NumGroups].FirstCorner = NumCorners;
+                Groups[NumGroups].NumCorners = 0;
+            }
+        }
+        else if (ObjKeywordIs(At, "f"))
+        {
+            At += 1;
+            obj_corner First = {};
+            obj_corner Prev = {};
+            obj_corner Curr = {};
+            u32 NumFaceCorners = 0;
+            while (ObjCornerParse(&At, NumPositions, NumUvs, NumNormals, &Curr))
+            {
+                // NOTE: Fan triangulation, drop triangles that are degenerate by index
+                if (NumFaceCorners >= 2 && First.Position != Prev.Position && Prev.Position != Curr.Position &&
+                    Curr.Position != First.Position)
+                {
+                    Assert(NumCorners + 3 <= MaxNumCorners);
+                    Corners[NumCorners++] = First;
+                    Corners[NumCorners++] = Prev;
+                    Corners[NumCorners++] = Curr;
+                    Groups[NumGroups].NumCorners += 3;
+                }
+
+                if (NumFaceCorners == 0)
+                {
+                    First = Curr;
+                }
+                Prev = Curr;
+                NumFaceCorners += 1;
+            }
+        }
+    }
+    if (Groups[NumGroups].NumCorners > 0)
+    {
+        NumGroups += 1;
+    }
+
+    if (NumGroups == 0)
+    {
+        printf("%s has no faces\n", InputName);
+        return 1;
+    }
+
+    // NOTE: Build meshes
+    printf("%s: %u positions, %u triangles, %u meshes\n", InputName, NumPositions, NumCorners / 3, NumGroups);
+    converter_mesh* Meshes = PushArray(&Arena, converter_mesh, NumGroups);
+    v3 SceneMin = {};
+    v3 SceneMax = {};
+    for (u32 GroupId = 0; GroupId < NumGroups; ++GroupId)
+    {
+        obj_group* Group = Groups + GroupId;
+        converter_mesh* Mesh = Meshes + GroupId;
+        ConverterMeshBuild(&Arena, &TempArena, Positions, Uvs, Normals, Corners + Group->FirstCorner, Group->NumCorners, Mesh);
+
+        if (GroupId == 0)
+        {
+            SceneMin = Mesh->BoundsMin;
+            SceneMax = Mesh->BoundsMax;
+        }
+        SceneMin = V3(Min(SceneMin.x, Mesh->BoundsMin.x), Min(SceneMin.y, Mesh->BoundsMin.y), Min(SceneMin.z, Mesh->BoundsMin.z));
+        SceneMax = V3(Max(SceneMax.x, Mesh->BoundsMax.x), Max(SceneMax.y, Mesh->BoundsMax.y), Max(SceneMax.z, Mesh->BoundsMax.z));
+    }
+
+    // NOTE: Lay the file out
+    scene_file_header Header = {};
+    Header.Magic = SCENE_FILE_MAGIC;
+    Header.Version = SCENE_FILE_VERSION;
+    Header.NumMeshes = NumGroups;
+    Header.DirectionalLight.Dir = V3(0.4f, -1.0f, 0.0f);
+    Header.DirectionalLight.Color = V3(1.0f, 1.0f, 1.0f);
+    Header.DirectionalLight.AmbientColor = V3(0.15f);
+
+    u64 NumInstances = u64(GridSize)*u64(GridSize)*u64(NumGroups);
+    if (NumInstances > 0xFFFFFFFF)
+    {
+        printf("grid size %u gives too many instances\n", GridSize);
+        return 1;
+    }
+    Header.NumInstances = u32(NumInstances);
+
+    u64 NumPointLights = u64(GridSize)*u64(GridSize)*u64(NumLights);
+    if (NumPointLights > 0xFFFFFFFF)
+    {
+        printf("grid size %u gives too many point lights\n", GridSize);
+        return 1;
+    }
+    Header.NumPointLights = u32(NumPointLights);
+
+    u64 Offset = ConverterAlign(sizeof(scene_file_header));
+    Header.MeshesOffset = Offset;
+    Offset = ConverterAlign(Offset + sizeof(scene_file_mesh)*u64(Header.NumMeshes));
+    Header.InstancesOffset = Offset;
+    Offset = ConverterAlign(Offset + sizeof(scene_file_instance)*u64(Header.NumInstances));
+    Header.PointLightsOffset = Offset;
+    Offset = ConverterAlign(Offset + sizeof(scene_file_point_light)*u64(Header.NumPointLights));
+
+    scene_file_mesh* FileMeshes = PushArray(&Arena, scene_file_mesh, Header.NumMeshes);
+    ZeroMem(FileMeshes, sizeof(scene_file_mesh)*Header.NumMeshes);
+    for (u32 MeshId = 0; MeshId < Header.NumMeshes; ++MeshId)
+    {
+        converter_mesh* Mesh = Meshes + MeshId;
+        scene_file_mesh* FileMesh = FileMeshes + MeshId;
+        FileMesh->NumVertices = Mesh->Mesh.NumVertices;
+        FileMesh->NumIndices = Mesh->Mesh.NumIndices;
+        FileMesh->IndexSize = Mesh->IndexSize;
+        FileMesh->NumLods = Mesh->Mesh.NumLods;
+        Copy(Mesh->Mesh.Lods, FileMesh->Lods, sizeof(mesh_lod)*Mesh->Mesh.NumLods);
+        FileMesh->BoundsMin = Mesh->BoundsMin;
+        FileMesh->BoundsMax = Mesh->BoundsMax;
+        FileMesh->SphereCenter = Mesh->SphereCenter;
+        FileMesh->SphereRadius = Mesh->SphereRadius;
+
+        FileMesh->PositionsOffset = Offset;
+        Offset = ConverterAlign(Offset + sizeof(v3)*u64(FileMesh->NumVertices));
+        FileMesh->AttributesOffset = Offset;
+        Offset = ConverterAlign(Offset + sizeof(mesh_vertex_attributes)*u64(FileMesh->NumVertices));
+        FileMesh->IndicesOffset = Offset;
+        Offset = ConverterAlign(Offset + u64(FileMesh->IndexSize)*u64(FileMesh->NumIndices));
+
+        Header.NumVertices += FileMesh->NumVertices;
+        if (FileMesh->IndexSize == sizeof(u16))
+        {
+            Header.NumIndices16 += FileMesh->NumIndices;
+        }
+        else
+        {
+            Header.NumIndices32 += FileMesh->NumIndices;
+        }
+    }
+    Header.FileSize = Offset;
+
+    // NOTE: Instances and point lights, the grid gets spaced by the scene extent so copies never overlap
+    scene_file_instance* Instances = PushArray(&Arena, scene_file_instance, Header.NumInstances);
+    ZeroMem(Instances, sizeof(scene_file_instance)*Header.NumInstances);
+    scene_file_point_light* PointLights = PushArray(&Arena, scene_file_point_light, Header.NumPointLights);
+    ZeroMem(PointLights, sizeof(scene_file_point_light)*Header.NumPointLights);
+    {
+        v3 Extent = SceneMax - SceneMin;
+        f32 Spacing = 1.25f*Max(Extent.x, Extent.z);
+        f32 GridStart = -0.5f*Spacing*f32(GridSize - 1);
+        scene_file_instance* CurrInstance = Instances;
+        scene_file_point_light* CurrLight = PointLights;
+        for (u32 GridZ = 0; GridZ < GridSize; ++GridZ)
+        {
+            for (u32 GridX = 0; GridX < GridSize; ++GridX)
+            {
+                v3 GridPos = V3(GridStart + Spacing*f32(GridX), 0.0f, GridStart + Spacing*f32(GridZ));
+                m4 Transform = M4Pos(GridPos);
+                for (u32 MeshId = 0; MeshId < Header.NumMeshes; ++MeshId)
+                {
+                    CurrInstance->WTransform = Transform;
+                    CurrInstance->MeshId = MeshId;
+                    CurrInstance->Static = true;
+                    CurrInstance += 1;
+                }
+
+                for (u32 LightId = 0; LightId < NumLights; ++LightId)
+                {
+                    *CurrLight = Lights[LightId];
+                    CurrLight->Pos = Lights[LightId].Pos + GridPos;
+                    CurrLight += 1;
+                }
+            }
+        }
+    }
+
+    // NOTE: Write everything in file order
+    HANDLE File = CreateFileA(OutputName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        printf("failed to create %s\n", OutputName);
+        return 1;
+    }
+
+    u64 WriteOffset = 0;
+    b32 Written = ConverterFileWrite(File, &WriteOffset, &Header, sizeof(Header)) && ConverterFilePad(File, &WriteOffset);
+    Written = Written && ConverterFileWrite(File, &WriteOffset, FileMeshes, sizeof(scene_file_mesh)*u64(Header.NumMeshes));
+    Written = Written && ConverterFilePad(File, &WriteOffset);
+    Written = Written && ConverterFileWrite(File, &WriteOffset, Instances, sizeof(scene_file_instance)*u64(Header.NumInstances));
+    Written = Written && ConverterFilePad(File, &WriteOffset);
+    Written = Written && ConverterFileWrite(File, &WriteOffset, PointLights, sizeof(scene_file_point_light)*u64(Header.NumPointLights));
+    Written = Written && ConverterFilePad(File, &WriteOffset);
+    for (u32 MeshId = 0; Written && MeshId < Header.NumMeshes; ++MeshId)
+    {
+        mesh* Mesh = &Meshes[MeshId].Mesh;
+        scene_file_mesh* FileMesh = FileMeshes + MeshId;
+        temp_mem TempMem = BeginTempMem(&TempArena);
+
+        // NOTE: Same split and packing as GeometryMeshAdd
+        v3* PackedPositions = PushArray(&TempArena, v3, Mesh->NumVertices);
+        mesh_vertex_attributes* PackedAttributes = PushArray(&TempArena, mesh_vertex_attributes, Mesh->NumVertices);
+        for (u32 VertexId = 0; VertexId < Mesh->NumVertices; ++VertexId)
+        {
+            PackedPositions[VertexId] = Mesh->Vertices[VertexId].Pos;
+            PackedAttributes[VertexId] = MeshVertexAttributesPack(Mesh->Vertices + VertexId);
+        }
+
+        void* PackedIndices = Mesh->Indices;
+        if (FileMesh->IndexSize == sizeof(u16))
+        {
+            u16* Indices16 = PushArray(&TempArena, u16, Mesh->NumIndices);
+            for (u32 IndexId = 0; IndexId < Mesh->NumIndices; ++IndexId)
+            {
+                Indices16[IndexId] = u16(Mesh->Indices[IndexId]);
+            }
+            PackedIndices = Indices16;
+        }
+
+        Assert(WriteOffset == FileMesh->PositionsOffset);
+        Written = Written && ConverterFileWrite(File, &WriteOffset, PackedPositions, sizeof(v3)*u64(Mesh->NumVertices));
+        Written = Written && ConverterFilePad(File, &WriteOffset);
+        Written = Written && ConverterFileWrite(File, &WriteOffset, PackedAttributes, sizeof(mesh_vertex_attributes)*u64(Mesh->NumVertices));
+        Written = Written && ConverterFilePad(File, &WriteOffset);
+        Written = Written && ConverterFileWrite(File, &WriteOffset, PackedIndices, u64(FileMesh->IndexSize)*u64(Mesh->NumIndices));
+        Written = Written && ConverterFilePad(File, &WriteOffset);
+
+        EndTempMem(TempMem);
+    }
+    CloseHandle(File);
+
+    if (!Written || WriteOffset != Header.FileSize)
+    {
+        printf("failed to write %s\n", OutputName);
+        DeleteFileA(OutputName);
+        return 1;
+    }
+
+    printf("wrote %s: %u meshes, %u instances, %u point lights, %llu bytes\n", OutputName, Header.NumMeshes, Header.NumInstances,
+           Header.NumPointLights, Header.FileSize);
+    return 0;
+}
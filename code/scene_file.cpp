@@ -0,0 +1,127 @@
+
+//
+// NOTE: Open/Close
+//
+
+inline b32 SceneFileSectionValid(scene_file_header* Header, u64 Offset, u64 Size)
+{
+    b32 Result = ((Offset % SCENE_FILE_ALIGNMENT) == 0 && Offset <= Header->FileSize && Size <= Header->FileSize - Offset);
+    return Result;
+}
+
+inline void SceneFileClose(scene_file* SceneFile)
+{
+    if (SceneFile->Base)
+    {
+        UnmapViewOfFile(SceneFile->Base);
+    }
+    if (SceneFile->Mapping)
+    {
+        CloseHandle(SceneFile->Mapping);
+    }
+    if (SceneFile->File != INVALID_HANDLE_VALUE && SceneFile->File)
+    {
+        CloseHandle(SceneFile->File);
+    }
+    *SceneFile = {};
+}
+
+inline b32 SceneFileOpen(char* FileName, scene_file* Result)
+{
+    *Result = {};
+    QueryPerformanceCounter(&Result->LoadStartTime);
+
+    // NOTE: Most of the file gets read front to back once when meshes get uploaded, let the cache manager read ahead
+    Result->File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (Result->File == INVALID_HANDLE_VALUE)
+    {
+        // NOTE: No scene file is fine, we fall back to the built in scene
+        return false;
+    }
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(Result->File, &FileSize) || u64(FileSize.QuadPart) < sizeof(scene_file_header))
+    {
+        SceneFileClose(Result);
+        return false;
+    }
+
+    Result->Mapping = CreateFileMappingA(Result->File, 0, PAGE_READONLY, 0, 0, 0);
+    if (!Result->Mapping)
+    {
+        SceneFileClose(Result);
+        return false;
+    }
+
+    Result->Base = (u8*)MapViewOfFile(Result->Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Result->Base)
+    {
+        SceneFileClose(Result);
+        return false;
+    }
+
+    // NOTE: Validate everything we index with before using it, so a truncated or stale file gets rejected instead of faulting
+    scene_file_header* Header = (scene_file_header*)Result->Base;
+    b32 Valid = (Header->Magic == SCENE_FILE_MAGIC && Header->Version == SCENE_FILE_VERSION &&
+                 Header->FileSize == u64(FileSize.QuadPart));
+    // NOTE: Mesh ids go into 12 bits of the draw keys, a file that can't fit them even on its own gets rejected
+    Valid = Valid && Header->NumMeshes <= DRAW_KEY_MAX_MESHES;
+    Valid = Valid && SceneFileSectionValid(Header, Header->MeshesOffset, sizeof(scene_file_mesh)*u64(Header->NumMeshes));
+    Valid = Valid && SceneFileSectionValid(Header, Header->InstancesOffset, sizeof(scene_file_instance)*u64(Header->NumInstances));
+    Valid = Valid && SceneFileSectionValid(Header, Header->PointLightsOffset, sizeof(scene_file_point_light)*u64(Header->NumPointLights));
+    if (Valid)
+    {
+        scene_file_mesh* Meshes = (scene_file_mesh*)(Result->Base + Header->MeshesOffset);
+        u64 NumVertices = 0;
+        u64 NumIndices16 = 0;
+        u64 NumIndices32 = 0;
+        for (u32 MeshId = 0; Valid && MeshId < Header->NumMeshes; ++MeshId)
+        {
+            scene_file_mesh* Mesh = Meshes + MeshId;
+            u32 ExpectedIndexSize = Mesh->NumVertices <= 0x10000 ? sizeof(u16) : sizeof(u32);
+            Valid = (Mesh->NumVertices > 0 && Mesh->IndexSize == ExpectedIndexSize && Mesh->NumLods > 0 && Mesh->NumLods <= MESH_MAX_LODS);
+            Valid = Valid && SceneFileSectionValid(Header, Mesh->PositionsOffset, sizeof(v3)*u64(Mesh->NumVertices));
+            Valid = Valid && SceneFileSectionValid(Header, Mesh->AttributesOffset, sizeof(mesh_vertex_attributes)*u64(Mesh->NumVertices));
+            Valid = Valid && SceneFileSectionValid(Header, Mesh->IndicesOffset, u64(Mesh->IndexSize)*u64(Mesh->NumIndices));
+            for (u32 LodId = 0; Valid && LodId < Mesh->NumLods; ++LodId)
+            {
+                mesh_lod* Lod = Mesh->Lods + LodId;
+                Valid = (Lod->FirstIndex <= Mesh->NumIndices && Lod->NumIndices <= Mesh->NumIndices - Lod->FirstIndex);
+            }
+
+            // NOTE: Index values don't get checked, that would touch every page of the file at load time. We trust the converter
+            NumVertices += Mesh->NumVertices;
+            if (Mesh->IndexSize == sizeof(u16))
+            {
+                NumIndices16 += Mesh->NumIndices;
+            }
+            else
+            {
+                NumIndices32 += Mesh->NumIndices;
+            }
+        }
+
+        Valid = Valid && (NumVertices == Header->NumVertices && NumIndices16 == Header->NumIndices16 && NumIndices32 == Header->NumIndices32);
+
+        // NOTE: Instances index the mesh table when the scene gets populated every frame
+        scene_file_instance* Instances = (scene_file_instance*)(Result->Base + Header->InstancesOffset);
+        for (u32 InstanceId = 0; Valid && InstanceId < Header->NumInstances; ++InstanceId)
+        {
+            Valid = Instances[InstanceId].MeshId < Header->NumMeshes;
+        }
+    }
+
+    if (!Valid)
+    {
+        SceneFileClose(Result);
+        return false;
+    }
+
+    Result->Loaded = true;
+    Result->Header = Header;
+    Result->Meshes = (scene_file_mesh*)(Result->Base + Header->MeshesOffset);
+    Result->Instances = (scene_file_instance*)(Result->Base + Header->InstancesOffset);
+    Result->PointLights = (scene_file_point_light*)(Result->Base + Header->PointLightsOffset);
+
+    return true;
+}
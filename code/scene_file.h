@@ -0,0 +1,119 @@
+#pragma once
+
+/*
+
+  NOTE: Binary Scene Files
+
+    Scenes that don't come from code are stored in one versioned binary file that gets memory mapped and used in place. Everything is
+    already in the layout the renderer consumes, so loading does no parsing and no per object fixups:
+
+      - Meshes come out of the converter with their LOD chain built and optimized, and with the vertex streams already split and
+        packed the way the geometry buffer stores them (positions, packed attributes, 16 or 32bit indices holding all LODs). Upload
+        is one copy of each blob from the mapping into the asset streams staging ring (see asset_stream.h)
+      - Instances, point lights and the directional light are arrays of the structs below that the scene reads straight out of the
+        mapping, instance mesh ids index the files mesh table. Static instances go into the scene once, lights and dynamic instances
+        get read every frame
+      - The reference rasterizer reads positions/indices out of the mapping too, so the mapping stays open while the scene is loaded
+
+    Every section starts at a SCENE_FILE_ALIGNMENT aligned offset from the start of the file, and offsets are 64bit so files can grow
+    past 4GB. The header records the totals so that the scene can size its capacities before anything gets uploaded. Files are
+    little endian and the version gets bumped on any layout change, old files are rejected instead of being misread.
+
+    scene_converter (build.bat converter) writes these from Wavefront OBJ files, see scene_converter.cpp.
+
+ */
+
+#define SCENE_FILE_MAGIC 0x4E424353 // NOTE: "SCBN"
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_ALIGNMENT 64
+#define SCENE_FILE_NAME "scene.scn"
+
+struct scene_file_mesh
+{
+    u32 NumVertices;
+    u32 NumIndices;
+    // NOTE: 2 or 4, meshes with at most 64K vertices get 16bit indices
+    u32 IndexSize;
+    u32 NumLods;
+    mesh_lod Lods[MESH_MAX_LODS];
+
+    // NOTE: Local space bounds
+    v3 BoundsMin;
+    v3 BoundsMax;
+    v3 SphereCenter;
+    f32 SphereRadius;
+
+    // NOTE: v3 per vertex, mesh_vertex_attributes per vertex and IndexSize per index
+    u64 PositionsOffset;
+    u64 AttributesOffset;
+    u64 IndicesOffset;
+};
+
+struct scene_file_instance
+{
+    m4 WTransform;
+    u32 MeshId;
+    b32 Static;
+    u32 Pad[2];
+};
+
+struct scene_file_point_light
+{
+    v3 Pos;
+    v3 Color;
+    f32 MaxDistance;
+    u32 Pad;
+};
+
+struct scene_file_directional_light
+{
+    // NOTE: Direction the light travels in
+    v3 Dir;
+    v3 Color;
+    v3 AmbientColor;
+    u32 Pad;
+};
+
+struct scene_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 FileSize;
+
+    u32 NumMeshes;
+    u32 NumInstances;
+    u32 NumPointLights;
+    // NOTE: Totals over all meshes, used to size the geometry buffer
+    u32 NumVertices;
+    u64 NumIndices16;
+    u64 NumIndices32;
+
+    scene_file_directional_light DirectionalLight;
+
+    u64 MeshesOffset;
+    u64 InstancesOffset;
+    u64 PointLightsOffset;
+};
+
+struct scene_file
+{
+    b32 Loaded;
+    HANDLE File;
+    HANDLE Mapping;
+    u8* Base;
+
+    scene_file_header* Header;
+    scene_file_mesh* Meshes;
+    scene_file_instance* Instances;
+    scene_file_point_light* PointLights;
+
+    // NOTE: Scene mesh id of every file mesh
+    u32* MeshIds;
+    u32 NumDynamicInstances;
+    u32* DynamicInstanceIds;
+    b32 StaticAdded;
+
+    // NOTE: Time from opening the file until the static instances went in, so every mesh was resident
+    LARGE_INTEGER LoadStartTime;
+    f32 LoadMs;
+};
@@ -3,9 +3,36 @@
 // NOTE: Material
 //
 
+struct material_entry
+{
+    uint ColorTextureId;
+    uint NormalTextureId;
+    uint Pad0;
+    uint Pad1;
+};
+
+// NOTE: Bindless, the texture array is partially bound. It has a fixed size so that shaders which never sample it don't need
+// runtimeDescriptorArray. Keep MATERIAL_MAX_TEXTURES in sync with shadow_demo.h
+#define MATERIAL_MAX_TEXTURES 1024
+
+#ifndef MATERIAL_BINDLESS
+#define MATERIAL_BINDLESS 1
+#endif
+
+#if MATERIAL_BINDLESS
+#define MATERIAL_TEXTURE_DESCRIPTOR(set_number) layout(set = set_number, binding = 1) uniform sampler2D MaterialTextures[MATERIAL_MAX_TEXTURES];
+#else
+// NOTE: Not bindless, the set belongs to one material and only holds its color texture
+#define MATERIAL_TEXTURE_DESCRIPTOR(set_number) layout(set = set_number, binding = 1) uniform sampler2D MaterialColorTexture;
+#endif
+
 #define MATERIAL_DESCRIPTOR_LAYOUT(set_number)                          \
-    layout(set = set_number, binding = 0) uniform sampler2D ColorTexture; \
-    layout(set = set_number, binding = 1) uniform sampler2D NormalTexture; \
+    layout(set = set_number, binding = 0) readonly buffer material_buffer \
+    {                                                                   \
+        material_entry Materials[];                                     \
+    };                                                                  \
+                                                                        \
+    MATERIAL_TEXTURE_DESCRIPTOR(set_number)                             \
 
 //
 // NOTE: Scene
@@ -17,6 +44,10 @@ struct instance_entry
 {
     mat4 WTransform;
     mat4 WVPTransform;
+    uint MaterialId;
+    uint Pad0;
+    uint Pad1;
+    uint Pad2;
 };
 
 #define SCENE_DESCRIPTOR_LAYOUT(set_number)                             \
@@ -52,8 +83,34 @@ struct instance_entry
     };                                                                  \
                                                                         \
 
+#define CLIPMAP_NUM_LEVELS 4
+
+struct clipmap_level
+{
+    mat4 VPTransform;
+    vec2 UvOffset;
+    vec2 Pad;
+};
+
 #define SHADOW_DESCRIPTOR_LAYOUT(set_number) \
     layout(set = set_number, binding = 0) uniform sampler2D StandardShadowMap; \
     layout(set = set_number, binding = 1) uniform sampler2D VarianceShadowMap; \
+    layout(set = set_number, binding = 2) uniform sampler2D ClipmapShadowMap0; \
+    layout(set = set_number, binding = 3) uniform sampler2D ClipmapShadowMap1; \
+    layout(set = set_number, binding = 4) uniform sampler2D ClipmapShadowMap2; \
+    layout(set = set_number, binding = 5) uniform sampler2D ClipmapShadowMap3; \
+    layout(set = set_number, binding = 6) uniform clipmap_globals \
+    { \
+        clipmap_level Levels[CLIPMAP_NUM_LEVELS]; \
+        float InvResolution; \
+    } ClipmapGlobals; \
     
     
+
+//
+// NOTE: Shadow Mask
+//
+
+#define SHADOW_MASK_DESCRIPTOR_LAYOUT(set_number) \
+    layout(set = set_number, binding = 0) uniform sampler2D ShadowMask; \
+
@@ -17,13 +17,18 @@
 
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_GOOGLE_include_directive : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
 #include "shader_blinn_phong_lighting.cpp"
 #include "shader_descriptor_layouts.cpp"
 
 MATERIAL_DESCRIPTOR_LAYOUT(0)
 SCENE_DESCRIPTOR_LAYOUT(1)
+#if SHADOW_MASK
+SHADOW_MASK_DESCRIPTOR_LAYOUT(2)
+#else
 SHADOW_DESCRIPTOR_LAYOUT(2)
+#endif
 
 #if SHADOW_VERTEX
 
@@ -40,6 +45,37 @@ void main()
 
 #endif
 
+#if DEPTH_PREPASS_VERTEX
+
+layout(location = 0) in vec3 InPos;
+
+// NOTE: Has to match FORWARD_VERTEX bit for bit since the forward pass tests EQUAL against this depth
+invariant gl_Position;
+
+void main()
+{
+    instance_entry Entry = InstanceBuffer[gl_InstanceIndex];
+    gl_Position = Entry.WVPTransform * vec4(InPos, 1);
+}
+
+#endif
+
+#if SHADOW_CLIPMAP_VERTEX
+
+layout(set = 3, binding = 0) uniform clipmap_level_buffer
+{
+    mat4 VPTransform;
+} ClipmapLevel;
+
+layout(location = 0) in vec3 InPos;
+
+void main()
+{
+    gl_Position = ClipmapLevel.VPTransform * InstanceBuffer[gl_InstanceIndex].WTransform * vec4(InPos, 1);
+}
+
+#endif
+
 #if SHADOW_VARIANCE_FRAGMENT
 
 layout(location = 0) in float InDepth;
@@ -62,23 +98,39 @@ void main()
 #if FORWARD_VERTEX
 
 layout(location = 0) in vec3 InPos;
-layout(location = 1) in vec3 InNormal;
+layout(location = 1) in vec2 InOctNormal;
 layout(location = 2) in vec2 InUv;
 
 layout(location = 0) out vec3 OutWorldPos;
 layout(location = 1) out vec3 OutWorldNormal;
 layout(location = 2) out vec2 OutUv;
 layout(location = 3) out vec3 OutDirLightPos;
+layout(location = 4) flat out uint OutMaterialId;
+
+// NOTE: Needed for the EQUAL depth test after the depth prepass
+invariant gl_Position;
+
+vec3 OctDecode(vec2 Encoded)
+{
+    // NOTE: https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+    vec3 Result = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+    float T = max(-Result.z, 0.0);
+    Result.x += Result.x >= 0.0 ? -T : T;
+    Result.y += Result.y >= 0.0 ? -T : T;
+    return normalize(Result);
+}
 
 void main()
 {
     instance_entry Entry = InstanceBuffer[gl_InstanceIndex];
+    vec3 InNormal = OctDecode(InOctNormal);
     
     gl_Position = Entry.WVPTransform * vec4(InPos, 1);
     OutWorldPos = (Entry.WTransform * vec4(InPos, 1)).xyz;
     OutWorldNormal = (Entry.WTransform * vec4(InNormal, 0)).xyz;
     OutUv = InUv;
     OutDirLightPos = (DirectionalTransforms[gl_InstanceIndex] * vec4(InPos, 1)).xyz;
+    OutMaterialId = Entry.MaterialId;
 }
 
 #endif
@@ -89,91 +141,25 @@ layout(location = 0) in vec3 InWorldPos;
 layout(location = 1) in vec3 InWorldNormal;
 layout(location = 2) in vec2 InUv;
 layout(location = 3) in vec3 InDirLightPos;
+layout(location = 4) flat in uint InMaterialId;
 
 layout(location = 0) out vec4 OutColor;
 
-float DirLightOcclusionStandardGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
-{
-    // NOTE: You can embedd the NDC transform in the matrix but then you need a separate set of transforms for each object
-    vec2 Uv = 0.5*LightPos.xy + vec2(0.5);
-
-    // NOTE: This bias comes from http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-16-shadow-mapping/ and
-    // https://www.trentreed.net/blog/exponential-shadow-maps/ . The idea is dot is cos(theta) so acos(cos(theta)) = theta so it all
-    // becomes tan(angle between vectors). Since we are scaling by the tangent of the angle between vectors, the more perpendicular the
-    // angles are, the larger our bias will be. This appears to be a decent approximation
-    float Bias = clamp(0.005 * tan(acos(clamp(dot(SurfaceNormal, LightDir), 0, 1))), 0, 0.005);
-    float Depth = texture(StandardShadowMap, Uv).x;
-
-    return step(Depth, LightPos.z + Bias);
-}
-
-float DirLightOcclusionPcfGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
-{
-    // NOTE: http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-16-shadow-mapping/
-    vec2 PoissonDisk[4] =
-        {
-            vec2( -0.94201624, -0.39906216 ),
-            vec2( 0.94558609, -0.76890725 ),
-            vec2( -0.094184101, -0.92938870 ),
-            vec2( 0.34495938, 0.29387760 ),
-        };
-
-    vec2 LightPosUv = 0.5*LightPos.xy + vec2(0.5);
-    float Bias = clamp(0.005 * tan(acos(clamp(dot(SurfaceNormal, LightDir), 0, 1))), 0, 0.005);
-    float Occlusion = 0.0f;
-    for (int i = 0; i < 4; ++i)
-    {
-        // TODO: We define the spreading via /700 but its probably better to define it via pixel size in world space using derivatives?
-        float Depth = texture(StandardShadowMap, LightPosUv + PoissonDisk[i]/700.0).x;
-        Occlusion += (1.0f / 4.0f) * step(Depth, LightPos.z + Bias);
-    }
-
-    // TODO: Probably better to do uniform sampling of 7x7 region using gathers
-    
-    return Occlusion;
-}
-
-float LineStep(float Min, float Max, float Value)
-{
-    // NOTE: Inverse to lerp
-    return clamp((Value - Min) / (Max - Min), 0, 1);
-}
-
-float DirLightOcclusionVarianceGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
-{
-    // NOTE: https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-8-summed-area-variance-shadow-maps
-    // NOTE: https://http.download.nvidia.com/developer/presentations/2006/gdc/2006-GDC-Variance-Shadow-Maps.pdf
-    float Occlusion = 0.0f;
-
-    LightPos.z = 1.0f - LightPos.z;
-    
-    // NOTE: You can embedd the NDC transform in the matrix but then you need a separate set of transforms for each object
-    vec2 Uv = 0.5*LightPos.xy + vec2(0.5);
-    vec2 Moments = texture(VarianceShadowMap, Uv).xy;
-    
-    float Mean = Moments.x;
-    float VarianceSq = Moments.y - Moments.x * Moments.x;
-
-    // NOTE: We add this to reduce precision errors in variance
-    //VarianceSq = max(VarianceSq, 0.00001);
-    
-    float LitFactor = float(LightPos.z <= Mean);
-    float DepthDifference = LightPos.z - Mean;
-    float PMax = VarianceSq / (VarianceSq + DepthDifference*DepthDifference);
-
-    // NOTE: We add this to reduce light bleeding
-    PMax = LineStep(0.4, 1, PMax);
-    
-    Occlusion = max(LitFactor, PMax);
-    
-    return Occlusion;
-}
+#if !SHADOW_MASK
+#include "shader_shadow_lookup.cpp"
+#endif
 
 void main()
 {
     vec3 CameraPos = SceneBuffer.CameraPos;
     
-    vec4 TexelColor = texture(ColorTexture, InUv);
+#if MATERIAL_BINDLESS
+    // NOTE: A multi draw can mix materials within a wave, so the texture index has to be marked non uniform
+    material_entry Material = Materials[InMaterialId];
+    vec4 TexelColor = texture(MaterialTextures[nonuniformEXT(Material.ColorTextureId)], InUv);
+#else
+    vec4 TexelColor = texture(MaterialColorTexture, InUv);
+#endif
     vec3 SurfacePos = InWorldPos;
     vec3 SurfaceNormal = normalize(InWorldNormal);
     vec3 SurfaceColor = vec3(1, 1, 1); //TexelColor.rgb;
@@ -200,6 +186,13 @@ void main()
 #endif
 #if VARIANCE
         float Occlusion = DirLightOcclusionVarianceGet(SurfaceNormal, DirectionalLight.Dir, InDirLightPos);
+#endif
+#if CLIPMAP
+        float Occlusion = DirLightOcclusionClipmapGet(SurfaceNormal, DirectionalLight.Dir, InWorldPos);
+#endif
+#if SHADOW_MASK
+        // NOTE: Already resolved in screen space by the shadow mask pass
+        float Occlusion = texelFetch(ShadowMask, ivec2(gl_FragCoord.xy), 0).x;
 #endif
         Color += Occlusion*BlinnPhongLighting(View, SurfaceColor, SurfaceNormal, 32, DirectionalLight.Dir, DirectionalLight.Color);
         Color += DirectionalLight.AmbientLight;
@@ -13,15 +13,35 @@
 #extension GL_GOOGLE_include_directive : enable
 
 layout(binding = 0, set = 0) uniform sampler2D InputTexture;
+layout(binding = 1, set = 0, rg32f) uniform writeonly image2D OutputImage;
 
-#if GAUSSIAN_BLUR_X
-
-layout(location = 0) out vec2 OutMoments;
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
-void main()
+vec2 GaussianBlurFetch(ivec2 PixelCoord)
 {
-    ivec2 PixelCoord = ivec2(gl_FragCoord.xy);
+#if GAUSSIAN_BLUR_SUPERSAMPLE
+    // NOTE: Custom resolve, moments are linear so the average of the samples is the moments of the whole texel. The input is
+    // Scale times the size of the output, each output texel covers a Scale sized box of samples
+    ivec2 Scale = textureSize(InputTexture, 0) / imageSize(OutputImage);
+    ivec2 SampleCoord = PixelCoord * Scale;
+    vec2 Result = vec2(0);
+    for (int SampleY = 0; SampleY < Scale.y; ++SampleY)
+    {
+        for (int SampleX = 0; SampleX < Scale.x; ++SampleX)
+        {
+            Result += texelFetch(InputTexture, SampleCoord + ivec2(SampleX, SampleY), 0).xy;
+        }
+    }
+    Result /= float(Scale.x * Scale.y);
+#else
+    vec2 Result = texelFetch(InputTexture, PixelCoord, 0).xy;
+#endif
     
+    return Result;
+}
+
+vec2 GaussianBlur(ivec2 PixelCoord, ivec2 Step)
+{
     // NOTE: https://graphics.stanford.edu/~mdfisher/Code/ShadowMap/GaussianBlurX.ps.html
     vec2 Output = vec2(0);
     float Coefficients[21] = 
@@ -35,39 +55,26 @@ void main()
 
     for (int TexelId = 0; TexelId < 21; ++TexelId)
     {
-        Output += texelFetch(InputTexture, PixelCoord + ivec2(TexelId - 10, 0), 0).xy * Coefficients[TexelId];
+        Output += GaussianBlurFetch(PixelCoord + (TexelId - 10)*Step) * Coefficients[TexelId];
     }
 
-    OutMoments = Output;
+    return Output;
 }
 
-#endif
-
-#if GAUSSIAN_BLUR_Y
-
-layout(location = 0) out vec2 OutMoments;
-
 void main()
 {
-    ivec2 PixelCoord = ivec2(gl_FragCoord.xy);
-    
-    // NOTE: https://graphics.stanford.edu/~mdfisher/Code/ShadowMap/GaussianBlurY.ps.html
-    vec2 Output = vec2(0);
-    float Coefficients[21] = 
-        {
-            0.000272337, 0.00089296, 0.002583865, 0.00659813, 0.014869116,
-            0.029570767, 0.051898313, 0.080381679, 0.109868729, 0.132526984,
-            0.14107424, 0.132526984, 0.109868729, 0.080381679, 0.051898313,
-            0.029570767, 0.014869116, 0.00659813, 0.002583865, 0.00089296,
-            0.000272337
-        };
-
-    for (int TexelId = 0; TexelId < 21; ++TexelId)
+    ivec2 PixelCoord = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(PixelCoord, imageSize(OutputImage))))
     {
-        Output += texelFetch(InputTexture, PixelCoord + ivec2(0, TexelId - 10), 0).xy * Coefficients[TexelId];
+        return;
     }
-
-    OutMoments = Output;
-}
-
+    
+#if GAUSSIAN_BLUR_X
+    vec2 Output = GaussianBlur(PixelCoord, ivec2(1, 0));
 #endif
+#if GAUSSIAN_BLUR_Y
+    vec2 Output = GaussianBlur(PixelCoord, ivec2(0, 1));
+#endif
+    
+    imageStore(OutputImage, PixelCoord, vec4(Output, 0, 0));
+}
@@ -0,0 +1,222 @@
+#version 450
+
+/*
+
+  NOTE: References for the two phase culling:
+
+    - https://advances.realtimerendering.com/s2015/aaltonenhaar_siggraph2015_combined_final_footer_220dpi.pdf
+    - https://interplayoflight.wordpress.com/2017/11/15/experiments-in-gpu-based-occlusion-culling/
+
+ */
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+#define OCCLUSION_MAX_LEVELS 16
+#define OCCLUSION_MAX_BATCHES 64
+
+//
+// NOTE: Pyramid Downsample
+//
+
+#if HIZ_DOWNSAMPLE
+
+layout(set = 0, binding = 0) uniform sampler2D InputTexture;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D OutputImage;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+void main()
+{
+    ivec2 PixelCoord = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 OutputSize = imageSize(OutputImage);
+    if (any(greaterThanEqual(PixelCoord, OutputSize)))
+    {
+        return;
+    }
+
+    // NOTE: Depth is reversed so the farthest depth is the min. Odd inputs fold their last row/column into the last output texel
+    ivec2 InputSize = textureSize(InputTexture, 0);
+    ivec2 SrcMin = 2*PixelCoord;
+    ivec2 SrcMax = min(SrcMin + ivec2(1), InputSize - ivec2(1));
+    if (PixelCoord.x == OutputSize.x - 1)
+    {
+        SrcMax.x = InputSize.x - 1;
+    }
+    if (PixelCoord.y == OutputSize.y - 1)
+    {
+        SrcMax.y = InputSize.y - 1;
+    }
+
+    float Depth = 1.0f;
+    for (int Y = SrcMin.y; Y <= SrcMax.y; ++Y)
+    {
+        for (int X = SrcMin.x; X <= SrcMax.x; ++X)
+        {
+            Depth = min(Depth, texelFetch(InputTexture, ivec2(X, Y), 0).x);
+        }
+    }
+
+    imageStore(OutputImage, PixelCoord, vec4(Depth, 0, 0, 0));
+}
+
+#endif
+
+//
+// NOTE: Culling
+//
+
+#if OCCLUSION_CULL_EARLY || OCCLUSION_CULL_LATE
+
+struct draw_command
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+struct occlusion_bounds
+{
+    vec4 Min;
+    vec4 Max;
+};
+
+layout(set = 0, binding = 0) uniform occlusion_globals
+{
+    mat4 VPTransform;
+    vec2 PyramidSize;
+    uint NumLevels;
+    uint FirstCommand;
+    uint NumCommands;
+    uint Compact;
+} Globals;
+
+layout(set = 0, binding = 1) uniform sampler2D PyramidLevels[OCCLUSION_MAX_LEVELS];
+layout(set = 0, binding = 2) readonly buffer bounds_buffer { occlusion_bounds Bounds[]; };
+layout(set = 0, binding = 3) readonly buffer input_commands { draw_command InputCommands[]; };
+layout(set = 0, binding = 4) readonly buffer batch_firsts { uint BatchFirsts[]; };
+layout(set = 0, binding = 5) readonly buffer batch_ids { uint BatchIds[]; };
+layout(set = 0, binding = 6) buffer visibility_buffer { uint Visibility[]; };
+layout(set = 0, binding = 7) writeonly buffer early_commands { draw_command EarlyCommands[]; };
+layout(set = 0, binding = 8) writeonly buffer late_commands { draw_command LateCommands[]; };
+layout(set = 0, binding = 9) writeonly buffer final_commands { draw_command FinalCommands[]; };
+layout(set = 0, binding = 10) buffer count_buffer { uint Counts[]; };
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+bool PyramidVisible(vec3 BoundsMin, vec3 BoundsMax)
+{
+    vec2 UvMin = vec2(1);
+    vec2 UvMax = vec2(0);
+    float NearestDepth = 0.0f;
+    for (int CornerId = 0; CornerId < 8; ++CornerId)
+    {
+        vec3 Corner = vec3((CornerId & 1) != 0 ? BoundsMax.x : BoundsMin.x,
+                           (CornerId & 2) != 0 ? BoundsMax.y : BoundsMin.y,
+                           (CornerId & 4) != 0 ? BoundsMax.z : BoundsMin.z);
+        vec4 Clip = Globals.VPTransform * vec4(Corner, 1);
+        if (Clip.w <= 0.0f)
+        {
+            // NOTE: Crosses the near plane, can't say anything
+            return true;
+        }
+
+        vec3 Ndc = Clip.xyz / Clip.w;
+        vec2 Uv = 0.5f*Ndc.xy + vec2(0.5f);
+        UvMin = min(UvMin, Uv);
+        UvMax = max(UvMax, Uv);
+        NearestDepth = max(NearestDepth, Ndc.z);
+    }
+
+    UvMin = clamp(UvMin, vec2(0), vec2(1));
+    UvMax = clamp(UvMax, vec2(0), vec2(1));
+
+    // NOTE: Map into level 0 texels and shift down from there. Every level rounds up, so level 0 texel i lands in texel i >> Level
+    // exactly, where scaling the UV by an odd levels size drifts off the texels that were folded together at the right/bottom edges.
+    // Level 0 rounds up the depth size the same way, so the min side gets one texel of slack to stay conservative
+    ivec2 PyramidSize = ivec2(Globals.PyramidSize);
+    ivec2 BaseMin = clamp(ivec2(UvMin*Globals.PyramidSize) - ivec2(1), ivec2(0), PyramidSize - ivec2(1));
+    ivec2 BaseMax = clamp(ivec2(UvMax*Globals.PyramidSize), ivec2(0), PyramidSize - ivec2(1));
+
+    // NOTE: Pick the level where the rect covers at most 2x2 texels
+    ivec2 Extent = BaseMax - BaseMin + ivec2(1);
+    uint Level = uint(ceil(log2(float(max(Extent.x, Extent.y)))));
+    Level = min(Level, Globals.NumLevels - 1);
+
+    ivec2 LevelSize = textureSize(PyramidLevels[nonuniformEXT(Level)], 0);
+    ivec2 TexelMin = min(BaseMin >> int(Level), LevelSize - ivec2(1));
+    ivec2 TexelMax = min(BaseMax >> int(Level), LevelSize - ivec2(1));
+
+    float OccluderDepth = min(min(texelFetch(PyramidLevels[nonuniformEXT(Level)], TexelMin, 0).x,
+                                  texelFetch(PyramidLevels[nonuniformEXT(Level)], ivec2(TexelMax.x, TexelMin.y), 0).x),
+                              min(texelFetch(PyramidLevels[nonuniformEXT(Level)], ivec2(TexelMin.x, TexelMax.y), 0).x,
+                                  texelFetch(PyramidLevels[nonuniformEXT(Level)], TexelMax, 0).x));
+
+    // NOTE: Reversed depth, visible if the nearest point is in front of the farthest occluder
+    return NearestDepth >= OccluderDepth;
+}
+
+void Emit(uint ListId, uint BatchId, uint InputId, draw_command Command, bool Pass)
+{
+    // NOTE: Compact appends in whatever order the threads arrive, which loses the front to back order within the batch (see
+    // occlusion.h). In place keeps the slot and zeroes the instances of culled commands
+    uint CommandId = InputId;
+    if (Globals.Compact != 0)
+    {
+        if (!Pass)
+        {
+            return;
+        }
+        
+        uint Slot = atomicAdd(Counts[ListId*OCCLUSION_MAX_BATCHES + BatchId], 1);
+        CommandId = BatchFirsts[BatchId] + Slot;
+    }
+    else if (!Pass)
+    {
+        Command.InstanceCount = 0;
+    }
+    
+    if (ListId == 0)
+    {
+        EarlyCommands[CommandId] = Command;
+    }
+    else if (ListId == 1)
+    {
+        LateCommands[CommandId] = Command;
+    }
+    else
+    {
+        FinalCommands[CommandId] = Command;
+    }
+}
+
+void main()
+{
+    uint LocalCommandId = gl_GlobalInvocationID.x;
+    if (LocalCommandId >= Globals.NumCommands)
+    {
+        return;
+    }
+
+    uint CommandId = Globals.FirstCommand + LocalCommandId;
+    draw_command Command = InputCommands[CommandId];
+    uint InstanceId = Command.FirstInstance;
+    uint BatchId = BatchIds[CommandId];
+    bool DrawnEarly = Visibility[InstanceId] != 0;
+
+#if OCCLUSION_CULL_EARLY
+    Emit(0, BatchId, CommandId, Command, DrawnEarly);
+#endif
+
+#if OCCLUSION_CULL_LATE
+    bool Visible = PyramidVisible(Bounds[InstanceId].Min.xyz, Bounds[InstanceId].Max.xyz);
+    Emit(1, BatchId, CommandId, Command, Visible && !DrawnEarly);
+    Emit(2, BatchId, CommandId, Command, Visible || DrawnEarly);
+    Visibility[InstanceId] = Visible ? 1 : 0;
+#endif
+}
+
+#endif
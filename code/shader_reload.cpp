@@ -0,0 +1,396 @@
+
+//
+// NOTE: Shader Tables
+//
+
+global shader_reload_file ShaderReloadFiles[] =
+{
+    { L"shader_forward.cpp", ShaderSource_Forward },
+    { L"shader_shadow_mask.cpp", ShaderSource_ShadowMask },
+    { L"shader_occlusion.cpp", ShaderSource_Occlusion },
+    { L"shader_gaussian_blur.cpp", ShaderSource_GaussianBlur },
+    { L"shader_blinn_phong_lighting.cpp", ShaderSource_Forward },
+    { L"shader_descriptor_layouts.cpp", ShaderSource_Forward | ShaderSource_ShadowMask },
+    { L"shader_light_types.cpp", ShaderSource_Forward | ShaderSource_ShadowMask },
+    { L"shader_shadow_lookup.cpp", ShaderSource_Forward | ShaderSource_ShadowMask },
+};
+
+inline char* ShaderReloadSourceName(shader_source Source)
+{
+    char* Result = 0;
+    switch (Source)
+    {
+        case ShaderSource_Forward: Result = "shader_forward.cpp"; break;
+        case ShaderSource_ShadowMask: Result = "shader_shadow_mask.cpp"; break;
+        case ShaderSource_Occlusion: Result = "shader_occlusion.cpp"; break;
+        case ShaderSource_GaussianBlur: Result = "shader_gaussian_blur.cpp"; break;
+        default: InvalidCodePath;
+    }
+
+    return Result;
+}
+
+inline u32 ShaderReloadSourceFind(char* Name)
+{
+    u32 Result = 0;
+    for (u32 Source = ShaderSource_Forward; Source <= ShaderSource_GaussianBlur; Source <<= 1)
+    {
+        char* SourceName = ShaderReloadSourceName(shader_source(Source));
+        u32 CharId = 0;
+        while (Name[CharId] && Name[CharId] == SourceName[CharId])
+        {
+            CharId += 1;
+        }
+
+        if (Name[CharId] == SourceName[CharId])
+        {
+            Result = Source;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+inline b32 ShaderReloadPermutationsLoad(shader_reload* Reload)
+{
+    // NOTE: Same list build.bat compiles from. Fields point into the file contents, which stay around in the demo arena
+    char FileName[MAX_PATH];
+    _snprintf_s(FileName, sizeof(FileName), _TRUNCATE, "%s\\%s", SHADER_RELOAD_CODE_DIR, SHADER_RELOAD_PERMUTATIONS_FILE);
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize = {};
+    GetFileSizeEx(File, &FileSize);
+    char* Text = PushArray(&DemoState->Arena, char, u64(FileSize.QuadPart) + 1);
+    DWORD BytesRead = 0;
+    b32 Read = ReadFile(File, Text, DWORD(FileSize.QuadPart), &BytesRead, 0) && BytesRead == DWORD(FileSize.QuadPart);
+    CloseHandle(File);
+    if (!Read)
+    {
+        return false;
+    }
+    Text[FileSize.QuadPart] = 0;
+
+    char* Line = Text;
+    while (*Line)
+    {
+        char* LineEnd = Line;
+        while (*LineEnd && *LineEnd != '\n')
+        {
+            LineEnd += 1;
+        }
+        char* NextLine = *LineEnd ? LineEnd + 1 : LineEnd;
+        *LineEnd = 0;
+        if (LineEnd > Line && LineEnd[-1] == '\r')
+        {
+            LineEnd[-1] = 0;
+        }
+
+        // NOTE: Blank lines and # comments get skipped, same as for /f in build.bat
+        if (Line[0] && Line[0] != '#')
+        {
+            char* Fields[4] = {};
+            u32 NumFields = 1;
+            Fields[0] = Line;
+            for (char* Curr = Line; *Curr; ++Curr)
+            {
+                if (*Curr == '|')
+                {
+                    *Curr = 0;
+                    if (NumFields == ArrayCount(Fields))
+                    {
+                        return false;
+                    }
+                    Fields[NumFields++] = Curr + 1;
+                }
+            }
+
+            u32 Source = ShaderReloadSourceFind(Fields[0]);
+            if (NumFields != ArrayCount(Fields) || !Source || Reload->NumPermutations == SHADER_RELOAD_MAX_PERMUTATIONS)
+            {
+                return false;
+            }
+
+            shader_reload_permutation* Permutation = Reload->Permutations + Reload->NumPermutations++;
+            Permutation->Source = shader_source(Source);
+            Permutation->Defines = Fields[1];
+            Permutation->Stage = Fields[2];
+            Permutation->Output = Fields[3];
+        }
+
+        Line = NextLine;
+    }
+
+    return true;
+}
+
+//
+// NOTE: Watcher Thread
+//
+
+inline b32 ShaderReloadNameEquals(WCHAR* Name, u32 NameLength, wchar_t* Expected)
+{
+    // NOTE: Notification names aren't null terminated. NTFS is case insensitive but editors keep the case, so we compare exactly
+    u32 CharId = 0;
+    for (; CharId < NameLength && Expected[CharId]; ++CharId)
+    {
+        if (Name[CharId] != Expected[CharId])
+        {
+            return false;
+        }
+    }
+
+    b32 Result = CharId == NameLength && Expected[CharId] == 0;
+    return Result;
+}
+
+inline b32 ShaderReloadNameIsSpirv(WCHAR* Name, u32 NameLength)
+{
+    b32 Result = (NameLength > 4 && Name[NameLength - 4] == L'.' && Name[NameLength - 3] == L's' && Name[NameLength - 2] == L'p' &&
+                  Name[NameLength - 1] == L'v');
+    return Result;
+}
+
+inline void ShaderReloadDirRead(shader_reload* Reload, u32 DirId)
+{
+    // NOTE: Saving a file shows up as size/write changes or as a rename from a temp file, depending on the editor
+    Reload->DirOverlapped[DirId] = {};
+    Reload->DirOverlapped[DirId].hEvent = Reload->DirEvents[DirId];
+    BOOL Success = ReadDirectoryChangesW(Reload->Dirs[DirId], Reload->DirNotify[DirId], sizeof(Reload->DirNotify[DirId]), FALSE,
+                                         FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, 0,
+                                         &Reload->DirOverlapped[DirId], 0);
+    Assert(Success);
+}
+
+inline void ShaderReloadCompile(shader_reload* Reload, u32 SourceMask)
+{
+    // NOTE: One process per permutation, glslangValidator is single threaded
+    HANDLE Processes[SHADER_RELOAD_MAX_PERMUTATIONS];
+    u32 NumProcesses = 0;
+    for (u32 PermutationId = 0; PermutationId < Reload->NumPermutations; ++PermutationId)
+    {
+        shader_reload_permutation* Permutation = Reload->Permutations + PermutationId;
+        if (!(Permutation->Source & SourceMask))
+        {
+            continue;
+        }
+
+        char CommandLine[512];
+        _snprintf_s(CommandLine, sizeof(CommandLine), _TRUNCATE, "glslangValidator %s -S %s -e main -g -V -o %s\\%s %s\\%s",
+                    Permutation->Defines, Permutation->Stage, SHADER_RELOAD_DATA_DIR, Permutation->Output, SHADER_RELOAD_CODE_DIR,
+                    ShaderReloadSourceName(Permutation->Source));
+
+        // NOTE: The compiler shares our console so errors show up there
+        STARTUPINFOA StartupInfo = {};
+        StartupInfo.cb = sizeof(StartupInfo);
+        PROCESS_INFORMATION ProcessInfo = {};
+        if (CreateProcessA(0, CommandLine, 0, 0, FALSE, 0, 0, 0, &StartupInfo, &ProcessInfo))
+        {
+            CloseHandle(ProcessInfo.hThread);
+            Processes[NumProcesses++] = ProcessInfo.hProcess;
+        }
+        else
+        {
+            InterlockedIncrement(&Reload->NumCompilesFailed);
+        }
+    }
+
+    if (NumProcesses > 0)
+    {
+        Assert(NumProcesses <= MAXIMUM_WAIT_OBJECTS);
+        WaitForMultipleObjects(NumProcesses, Processes, TRUE, INFINITE);
+    }
+
+    for (u32 ProcessId = 0; ProcessId < NumProcesses; ++ProcessId)
+    {
+        DWORD ExitCode = 1;
+        GetExitCodeProcess(Processes[ProcessId], &ExitCode);
+        if (ExitCode != 0)
+        {
+            InterlockedIncrement(&Reload->NumCompilesFailed);
+        }
+        InterlockedIncrement(&Reload->NumCompiles);
+        CloseHandle(Processes[ProcessId]);
+    }
+}
+
+DWORD WINAPI ShaderReloadWatcherThread(LPVOID Param)
+{
+    shader_reload* Reload = (shader_reload*)Param;
+
+    for (u32 DirId = 0; DirId < ArrayCount(Reload->Dirs); ++DirId)
+    {
+        ShaderReloadDirRead(Reload, DirId);
+    }
+
+    u32 AllSourcesMask = ShaderSource_Forward | ShaderSource_ShadowMask | ShaderSource_Occlusion | ShaderSource_GaussianBlur;
+    u32 SourceMask = 0;
+    b32 SpirvChanged = false;
+    while (true)
+    {
+        // NOTE: Once something changed we wait until the directories were quiet for the debounce time
+        HANDLE Handles[] = { Reload->QuitEvent, Reload->DirEvents[0], Reload->DirEvents[1] };
+        DWORD Timeout = (SourceMask || SpirvChanged) ? SHADER_RELOAD_DEBOUNCE_MS : INFINITE;
+        DWORD WaitResult = WaitForMultipleObjects(ArrayCount(Handles), Handles, FALSE, Timeout);
+        if (WaitResult == WAIT_OBJECT_0)
+        {
+            break;
+        }
+
+        if (WaitResult == WAIT_TIMEOUT)
+        {
+            // NOTE: The compiler writes spirv files, which come back as data changes and bump the generation after their own
+            // debounce, so we don't bump it here
+            if (SourceMask)
+            {
+                ShaderReloadCompile(Reload, SourceMask);
+                SourceMask = 0;
+            }
+            else if (SpirvChanged)
+            {
+                InterlockedIncrement(&Reload->Generation);
+                SpirvChanged = false;
+            }
+            continue;
+        }
+
+        u32 DirId = WaitResult - (WAIT_OBJECT_0 + 1);
+        Assert(DirId < ArrayCount(Reload->Dirs));
+        DWORD NumBytes = 0;
+        if (GetOverlappedResult(Reload->Dirs[DirId], Reload->DirOverlapped + DirId, &NumBytes, FALSE))
+        {
+            if (NumBytes == 0)
+            {
+                // NOTE: The notification buffer overflowed, we don't know what changed
+                SourceMask |= DirId == 0 ? AllSourcesMask : 0;
+                SpirvChanged = SpirvChanged || DirId == 1;
+            }
+            else
+            {
+                FILE_NOTIFY_INFORMATION* Info = (FILE_NOTIFY_INFORMATION*)Reload->DirNotify[DirId];
+                while (true)
+                {
+                    u32 NameLength = Info->FileNameLength / sizeof(WCHAR);
+                    if (DirId == 0)
+                    {
+                        for (u32 FileId = 0; FileId < ArrayCount(ShaderReloadFiles); ++FileId)
+                        {
+                            if (ShaderReloadNameEquals(Info->FileName, NameLength, ShaderReloadFiles[FileId].Name))
+                            {
+                                SourceMask |= ShaderReloadFiles[FileId].SourceMask;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        SpirvChanged = SpirvChanged || ShaderReloadNameIsSpirv(Info->FileName, NameLength);
+                    }
+
+                    if (Info->NextEntryOffset == 0)
+                    {
+                        break;
+                    }
+                    Info = (FILE_NOTIFY_INFORMATION*)((u8*)Info + Info->NextEntryOffset);
+                }
+            }
+        }
+
+        ShaderReloadDirRead(Reload, DirId);
+    }
+
+    return 0;
+}
+
+//
+// NOTE: Shader Reload
+//
+
+inline void ShaderReloadDestroy(shader_reload* Reload)
+{
+    if (Reload->Thread)
+    {
+        SetEvent(Reload->QuitEvent);
+        WaitForSingleObject(Reload->Thread, INFINITE);
+        CloseHandle(Reload->Thread);
+        Reload->Thread = 0;
+    }
+
+    // NOTE: Closing the directories cancels the reads still in flight
+    for (u32 DirId = 0; DirId < ArrayCount(Reload->Dirs); ++DirId)
+    {
+        if (Reload->Dirs[DirId] != INVALID_HANDLE_VALUE && Reload->Dirs[DirId])
+        {
+            CancelIoEx(Reload->Dirs[DirId], 0);
+            CloseHandle(Reload->Dirs[DirId]);
+        }
+        if (Reload->DirEvents[DirId])
+        {
+            CloseHandle(Reload->DirEvents[DirId]);
+        }
+        Reload->Dirs[DirId] = 0;
+        Reload->DirEvents[DirId] = 0;
+    }
+
+    if (Reload->QuitEvent)
+    {
+        CloseHandle(Reload->QuitEvent);
+        Reload->QuitEvent = 0;
+    }
+    Reload->Active = false;
+}
+
+inline void ShaderReloadCreate(shader_reload* Result)
+{
+    *Result = {};
+
+    char* DirNames[] = { SHADER_RELOAD_CODE_DIR, SHADER_RELOAD_DATA_DIR };
+    for (u32 DirId = 0; DirId < ArrayCount(Result->Dirs); ++DirId)
+    {
+        Result->Dirs[DirId] = CreateFileA(DirNames[DirId], FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                                          OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+        if (Result->Dirs[DirId] == INVALID_HANDLE_VALUE)
+        {
+            // NOTE: Not running from data\, MainLoop falls back to checking every frame
+            ShaderReloadDestroy(Result);
+            return;
+        }
+
+        Result->DirEvents[DirId] = CreateEventA(0, FALSE, FALSE, 0);
+        Assert(Result->DirEvents[DirId]);
+    }
+
+    // NOTE: Without the list we can't compile anything, so fall back the same way
+    if (!ShaderReloadPermutationsLoad(Result))
+    {
+        ShaderReloadDestroy(Result);
+        return;
+    }
+
+    Result->QuitEvent = CreateEventA(0, TRUE, FALSE, 0);
+    Assert(Result->QuitEvent);
+    Result->Thread = CreateThread(0, 0, ShaderReloadWatcherThread, Result, 0, 0);
+    Assert(Result->Thread);
+    Result->Active = true;
+}
+
+inline void ShaderReloadUpdate(shader_reload* Reload)
+{
+    // NOTE: Called before anything gets recorded, so swapped pipelines are used for the whole frame
+    if (!Reload->Active)
+    {
+        VkPipelineUpdateShaders(RenderState->Device, &RenderState->CpuArena, &RenderState->PipelineManager);
+        return;
+    }
+
+    LONG Generation = Reload->Generation;
+    if (Generation != Reload->SeenGeneration)
+    {
+        Reload->SeenGeneration = Generation;
+        Reload->NumReloads += 1;
+        VkPipelineUpdateShaders(RenderState->Device, &RenderState->CpuArena, &RenderState->PipelineManager);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+
+  NOTE: Shader Hot Reload
+
+    MainLoop used to call VkPipelineUpdateShaders every frame, which checks every shader file of every pipeline whether or not
+    anything changed. Now a watcher thread waits on directory change notifications instead and the main loop only looks at a
+    counter:
+
+      - Changes to code\shader_*.cpp get mapped to the shader sources that include the file (see ShaderReloadFiles), and the
+        watcher runs glslangValidator for every permutation of those sources. The permutations come from
+        code\shader_permutations.txt, which build.bat compiles from too, so both always use the same command lines. The compiles
+        run as parallel processes on the watcher, so the main thread never waits on the compiler
+      - Changes to data\*.spv (from the watcher or from running build.bat) bump Generation. MainLoop calls
+        VkPipelineUpdateShaders at the start of the next frame when Generation changed, so the pipelines only get swapped at a
+        frame boundary and only the ones whose shaders changed get rebuilt
+
+    Notifications get debounced since editors and the compiler write files in several steps. The demo runs in data\, so the code
+    directory is found relative to it. If either directory can't be watched or the permutation list can't be read, we fall back to
+    updating every frame. The list gets read once at startup, new permutations need a restart.
+
+ */
+
+#define SHADER_RELOAD_CODE_DIR "..\\code"
+#define SHADER_RELOAD_DATA_DIR "."
+#define SHADER_RELOAD_DEBOUNCE_MS 100
+#define SHADER_RELOAD_NOTIFY_SIZE 4096
+#define SHADER_RELOAD_PERMUTATIONS_FILE "shader_permutations.txt"
+// NOTE: The compiles of a change get waited on together, so this can't go past MAXIMUM_WAIT_OBJECTS
+#define SHADER_RELOAD_MAX_PERMUTATIONS 64
+
+enum shader_source
+{
+    ShaderSource_Forward = 1 << 0,
+    ShaderSource_ShadowMask = 1 << 1,
+    ShaderSource_Occlusion = 1 << 2,
+    ShaderSource_GaussianBlur = 1 << 3,
+};
+
+struct shader_reload_file
+{
+    wchar_t* Name;
+    // NOTE: Every source that includes this file, including itself
+    u32 SourceMask;
+};
+
+struct shader_reload_permutation
+{
+    shader_source Source;
+    char* Defines;
+    char* Stage;
+    char* Output;
+};
+
+struct shader_reload
+{
+    b32 Active;
+    HANDLE Thread;
+    HANDLE QuitEvent;
+    HANDLE Dirs[2];
+    HANDLE DirEvents[2];
+    OVERLAPPED DirOverlapped[2];
+    // NOTE: ReadDirectoryChangesW wants DWORD alignment
+    DWORD DirNotify[2][SHADER_RELOAD_NOTIFY_SIZE / sizeof(DWORD)];
+
+    u32 NumPermutations;
+    shader_reload_permutation Permutations[SHADER_RELOAD_MAX_PERMUTATIONS];
+
+    // NOTE: Written by the watcher, read by the main thread
+    volatile LONG Generation;
+    LONG SeenGeneration;
+
+    // NOTE: Stats
+    volatile LONG NumCompiles;
+    volatile LONG NumCompilesFailed;
+    u32 NumReloads;
+};
@@ -0,0 +1,142 @@
+
+/*
+
+  NOTE: Directional shadow lookups, shared by the forward shaders and the screen space shadow mask resolve. The including shader has
+  to declare SHADOW_DESCRIPTOR_LAYOUT first.
+
+ */
+
+float DirLightOcclusionStandardGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
+{
+    // NOTE: You can embedd the NDC transform in the matrix but then you need a separate set of transforms for each object
+    vec2 Uv = 0.5*LightPos.xy + vec2(0.5);
+
+    // NOTE: This bias comes from http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-16-shadow-mapping/ and
+    // https://www.trentreed.net/blog/exponential-shadow-maps/ . The idea is dot is cos(theta) so acos(cos(theta)) = theta so it all
+    // becomes tan(angle between vectors). Since we are scaling by the tangent of the angle between vectors, the more perpendicular the
+    // angles are, the larger our bias will be. This appears to be a decent approximation
+    float Bias = clamp(0.005 * tan(acos(clamp(dot(SurfaceNormal, LightDir), 0, 1))), 0, 0.005);
+    float Depth = texture(StandardShadowMap, Uv).x;
+
+    return step(Depth, LightPos.z + Bias);
+}
+
+float DirLightOcclusionPcfRotatedGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos, float Angle)
+{
+    // NOTE: http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-16-shadow-mapping/
+    vec2 PoissonDisk[4] =
+        {
+            vec2( -0.94201624, -0.39906216 ),
+            vec2( 0.94558609, -0.76890725 ),
+            vec2( -0.094184101, -0.92938870 ),
+            vec2( 0.34495938, 0.29387760 ),
+        };
+
+    // NOTE: Rotating the disk per pixel (and per frame when accumulating) turns the banding of a small kernel into noise
+    mat2 Rotation = mat2(cos(Angle), sin(Angle), -sin(Angle), cos(Angle));
+    vec2 LightPosUv = 0.5*LightPos.xy + vec2(0.5);
+    float Bias = clamp(0.005 * tan(acos(clamp(dot(SurfaceNormal, LightDir), 0, 1))), 0, 0.005);
+    float Occlusion = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        // TODO: We define the spreading via /700 but its probably better to define it via pixel size in world space using derivatives?
+        vec2 Offset = Rotation * PoissonDisk[i];
+        float Depth = texture(StandardShadowMap, LightPosUv + Offset/700.0).x;
+        Occlusion += (1.0f / 4.0f) * step(Depth, LightPos.z + Bias);
+    }
+
+    // TODO: Probably better to do uniform sampling of 7x7 region using gathers
+    
+    return Occlusion;
+}
+
+float DirLightOcclusionPcfGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
+{
+    return DirLightOcclusionPcfRotatedGet(SurfaceNormal, LightDir, LightPos, 0.0f);
+}
+
+float LineStep(float Min, float Max, float Value)
+{
+    // NOTE: Inverse to lerp
+    return clamp((Value - Min) / (Max - Min), 0, 1);
+}
+
+float DirLightOcclusionVarianceGet(vec3 SurfaceNormal, vec3 LightDir, vec3 LightPos)
+{
+    // NOTE: https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-8-summed-area-variance-shadow-maps
+    // NOTE: https://http.download.nvidia.com/developer/presentations/2006/gdc/2006-GDC-Variance-Shadow-Maps.pdf
+    float Occlusion = 0.0f;
+
+    LightPos.z = 1.0f - LightPos.z;
+    
+    // NOTE: You can embedd the NDC transform in the matrix but then you need a separate set of transforms for each object
+    vec2 Uv = 0.5*LightPos.xy + vec2(0.5);
+    vec2 Moments = texture(VarianceShadowMap, Uv).xy;
+    
+    float Mean = Moments.x;
+    float VarianceSq = Moments.y - Moments.x * Moments.x;
+
+    // NOTE: We add this to reduce precision errors in variance
+    //VarianceSq = max(VarianceSq, 0.00001);
+    
+    float LitFactor = float(LightPos.z <= Mean);
+    float DepthDifference = LightPos.z - Mean;
+    float PMax = VarianceSq / (VarianceSq + DepthDifference*DepthDifference);
+
+    // NOTE: We add this to reduce light bleeding
+    PMax = LineStep(0.4, 1, PMax);
+    
+    Occlusion = max(LitFactor, PMax);
+    
+    return Occlusion;
+}
+
+float ClipmapDepthGet(int LevelId, vec2 Uv)
+{
+    // NOTE: Keep the indices constant so we don't need non uniform indexing
+    float Result = 0;
+    if (LevelId == 0)
+    {
+        Result = texture(ClipmapShadowMap0, Uv).x;
+    }
+    else if (LevelId == 1)
+    {
+        Result = texture(ClipmapShadowMap1, Uv).x;
+    }
+    else if (LevelId == 2)
+    {
+        Result = texture(ClipmapShadowMap2, Uv).x;
+    }
+    else
+    {
+        Result = texture(ClipmapShadowMap3, Uv).x;
+    }
+
+    return Result;
+}
+
+float DirLightOcclusionClipmapGet(vec3 SurfaceNormal, vec3 LightDir, vec3 WorldPos)
+{
+    // NOTE: Pick the finest level whose window contains us. We keep a texel of margin so that we never read texels that belong to the
+    // other side of the toroidal wrap
+    float Margin = 1.0f - 2.0f*ClipmapGlobals.InvResolution;
+    for (int LevelId = 0; LevelId < CLIPMAP_NUM_LEVELS; ++LevelId)
+    {
+        clipmap_level Level = ClipmapGlobals.Levels[LevelId];
+        vec3 LightPos = (Level.VPTransform * vec4(WorldPos, 1)).xyz;
+        if (all(lessThan(abs(LightPos.xy), vec2(Margin))))
+        {
+            // NOTE: The window starts at UvOffset inside of the image and wraps around
+            vec2 Uv = fract(0.5*LightPos.xy + vec2(0.5) + Level.UvOffset);
+
+            // NOTE: Every level has the same depth range but bigger texels, so the slope part of the bias scales with the level
+            float Bias = clamp(0.005 * tan(acos(clamp(dot(SurfaceNormal, LightDir), 0, 1))), 0, 0.005) * float(1 << LevelId);
+            float Depth = ClipmapDepthGet(LevelId, Uv);
+
+            return step(Depth, LightPos.z + Bias);
+        }
+    }
+
+    // NOTE: Outside of all levels so nothing can shadow us
+    return 1.0f;
+}
@@ -0,0 +1,257 @@
+#version 450
+
+/*
+
+  NOTE: References for the screen space shadow mask:
+
+    - https://wickedengine.net/2017/10/22/improved-normal-reconstruction-from-depth/
+    - https://developer.nvidia.com/sites/default/files/akamai/gamedev/files/gdc12/GDC12_Bavoil_Stable_SSAO_In_BF3_With_STF.pdf
+
+ */
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "shader_descriptor_layouts.cpp"
+
+//
+// NOTE: Resolve
+//
+
+#if SHADOW_MASK_RESOLVE
+
+SCENE_DESCRIPTOR_LAYOUT(0)
+SHADOW_DESCRIPTOR_LAYOUT(1)
+
+#include "shader_shadow_lookup.cpp"
+
+#define TEMPORAL_MAX_FRAMES 16.0f
+
+layout(set = 2, binding = 0) uniform shadow_mask_globals
+{
+    mat4 InvVPTransform;
+    mat4 PrevVPTransform;
+    uint FrameIndex;
+    uint Temporal;
+    uint HistoryValid;
+} Globals;
+
+layout(set = 2, binding = 1) uniform sampler2D DepthTexture;
+layout(set = 2, binding = 2, r8) uniform writeonly image2D OutputMask;
+layout(set = 2, binding = 3, r32f) uniform writeonly image2D OutputDepth;
+// NOTE: x = occlusion, y = accumulated frames, zw = octahedral normal. Depth is the reversed depth the texel was shaded at
+layout(set = 2, binding = 4) uniform sampler2D PrevHistory;
+layout(set = 2, binding = 5) uniform sampler2D PrevHistoryDepth;
+layout(set = 2, binding = 6, rgba16f) uniform writeonly image2D OutputHistory;
+layout(set = 2, binding = 7, r32f) uniform writeonly image2D OutputHistoryDepth;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+float InterleavedGradientNoise(vec2 PixelPos)
+{
+    // NOTE: http://www.iryoku.com/next-generation-post-processing-in-call-of-duty-advanced-warfare
+    return fract(52.9829189f * fract(dot(PixelPos, vec2(0.06711056f, 0.00583715f))));
+}
+
+vec2 OctahedralEncode(vec3 Normal)
+{
+    Normal /= abs(Normal.x) + abs(Normal.y) + abs(Normal.z);
+    vec2 Result = Normal.xy;
+    if (Normal.z < 0.0f)
+    {
+        Result = (vec2(1.0f) - abs(Normal.yx)) * vec2(Normal.x >= 0.0f ? 1.0f : -1.0f, Normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return Result;
+}
+
+vec3 OctahedralDecode(vec2 Encoded)
+{
+    vec3 Result = vec3(Encoded, 1.0f - abs(Encoded.x) - abs(Encoded.y));
+    float T = max(-Result.z, 0.0f);
+    Result.x += Result.x >= 0.0f ? -T : T;
+    Result.y += Result.y >= 0.0f ? -T : T;
+
+    return normalize(Result);
+}
+
+vec3 WorldPosGet(ivec2 PixelCoord, float Depth, vec2 InvDepthSize)
+{
+    vec2 Uv = (vec2(PixelCoord) + vec2(0.5)) * InvDepthSize;
+    vec4 Position = Globals.InvVPTransform * vec4(2.0f*Uv - vec2(1.0f), Depth, 1.0f);
+    return Position.xyz / Position.w;
+}
+
+vec3 NeighbourPosGet(ivec2 PixelCoord, float Depth, ivec2 Step, ivec2 DepthSize, vec2 InvDepthSize)
+{
+    // NOTE: Take the side whose depth is closest to ours so the normal doesn't bend over silhouettes
+    ivec2 PosCoord = min(PixelCoord + Step, DepthSize - ivec2(1));
+    ivec2 NegCoord = max(PixelCoord - Step, ivec2(0));
+    float PosDepth = texelFetch(DepthTexture, PosCoord, 0).x;
+    float NegDepth = texelFetch(DepthTexture, NegCoord, 0).x;
+
+    vec3 Result = vec3(0);
+    if (abs(PosDepth - Depth) <= abs(NegDepth - Depth))
+    {
+        Result = WorldPosGet(PosCoord, PosDepth, InvDepthSize) - WorldPosGet(PixelCoord, Depth, InvDepthSize);
+    }
+    else
+    {
+        Result = WorldPosGet(PixelCoord, Depth, InvDepthSize) - WorldPosGet(NegCoord, NegDepth, InvDepthSize);
+    }
+
+    return Result;
+}
+
+void main()
+{
+    ivec2 PixelCoord = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 OutputSize = imageSize(OutputMask);
+    if (any(greaterThanEqual(PixelCoord, OutputSize)))
+    {
+        return;
+    }
+
+    ivec2 DepthSize = textureSize(DepthTexture, 0);
+    vec2 InvDepthSize = vec2(1) / vec2(DepthSize);
+    bool HalfRes = OutputSize.x < DepthSize.x;
+
+    // NOTE: At half res we shade the nearest surface of the footprint (depth is reversed so nearest is the max)
+    ivec2 SrcCoord = HalfRes ? 2*PixelCoord : PixelCoord;
+    float Depth = texelFetch(DepthTexture, min(SrcCoord, DepthSize - ivec2(1)), 0).x;
+    if (HalfRes)
+    {
+        ivec2 BaseCoord = SrcCoord;
+        for (int SampleId = 1; SampleId < 4; ++SampleId)
+        {
+            ivec2 SampleCoord = min(BaseCoord + ivec2(SampleId & 1, SampleId >> 1), DepthSize - ivec2(1));
+            float SampleDepth = texelFetch(DepthTexture, SampleCoord, 0).x;
+            if (SampleDepth > Depth)
+            {
+                Depth = SampleDepth;
+                SrcCoord = SampleCoord;
+            }
+        }
+
+        imageStore(OutputDepth, PixelCoord, vec4(Depth, 0, 0, 0));
+    }
+
+    float Occlusion = 1.0f;
+    vec3 WorldPos = vec3(0);
+    vec3 SurfaceNormal = vec3(0, 0, 1);
+    if (Depth > 0.0f)
+    {
+        WorldPos = WorldPosGet(SrcCoord, Depth, InvDepthSize);
+        vec3 DeltaX = NeighbourPosGet(SrcCoord, Depth, ivec2(1, 0), DepthSize, InvDepthSize);
+        vec3 DeltaY = NeighbourPosGet(SrcCoord, Depth, ivec2(0, 1), DepthSize, InvDepthSize);
+        SurfaceNormal = normalize(cross(DeltaY, DeltaX));
+        if (dot(SurfaceNormal, SceneBuffer.CameraPos - WorldPos) < 0.0f)
+        {
+            SurfaceNormal = -SurfaceNormal;
+        }
+
+        vec3 LightPos = (DirectionalLight.VPTransform * vec4(WorldPos, 1)).xyz;
+
+#if STANDARD
+        Occlusion = DirLightOcclusionStandardGet(SurfaceNormal, DirectionalLight.Dir, LightPos);
+#endif
+#if PCF
+        // NOTE: When accumulating, every frame sees a different rotation so the history converges to a much larger kernel
+        float Angle = 0.0f;
+        if (Globals.Temporal != 0)
+        {
+            Angle = 6.28318530718f * fract(InterleavedGradientNoise(vec2(PixelCoord)) + 0.61803398875f*float(Globals.FrameIndex & 63));
+        }
+        Occlusion = DirLightOcclusionPcfRotatedGet(SurfaceNormal, DirectionalLight.Dir, LightPos, Angle);
+#endif
+#if VARIANCE
+        Occlusion = DirLightOcclusionVarianceGet(SurfaceNormal, DirectionalLight.Dir, LightPos);
+#endif
+#if CLIPMAP
+        Occlusion = DirLightOcclusionClipmapGet(SurfaceNormal, DirectionalLight.Dir, WorldPos);
+#endif
+    }
+
+    if (Globals.Temporal != 0)
+    {
+        // NOTE: Reproject into last frame and reject the history if the surface there isn't the one we are shading now
+        float NumFrames = 1.0f;
+        float History = Occlusion;
+        if (Globals.HistoryValid != 0 && Depth > 0.0f)
+        {
+            vec4 PrevClip = Globals.PrevVPTransform * vec4(WorldPos, 1);
+            vec3 PrevNdc = PrevClip.xyz / PrevClip.w;
+            ivec2 PrevCoord = ivec2(floor((0.5f*PrevNdc.xy + vec2(0.5f)) * vec2(OutputSize)));
+            if (PrevClip.w > 0.0f && all(greaterThanEqual(PrevCoord, ivec2(0))) && all(lessThan(PrevCoord, OutputSize)))
+            {
+                vec4 PrevData = texelFetch(PrevHistory, PrevCoord, 0);
+                float PrevDepth = texelFetch(PrevHistoryDepth, PrevCoord, 0).x;
+                bool DepthMatch = abs(PrevDepth - PrevNdc.z) <= 0.01f*PrevNdc.z;
+                bool NormalMatch = dot(OctahedralDecode(PrevData.zw), SurfaceNormal) >= 0.9f;
+                if (DepthMatch && NormalMatch)
+                {
+                    NumFrames = min(PrevData.y + 1.0f, TEMPORAL_MAX_FRAMES);
+                    History = PrevData.x;
+                }
+            }
+        }
+
+        Occlusion = mix(History, Occlusion, 1.0f / NumFrames);
+        imageStore(OutputHistory, PixelCoord, vec4(Occlusion, NumFrames, OctahedralEncode(SurfaceNormal)));
+        imageStore(OutputHistoryDepth, PixelCoord, vec4(Depth, 0, 0, 0));
+    }
+
+    imageStore(OutputMask, PixelCoord, vec4(Occlusion, 0, 0, 0));
+}
+
+#endif
+
+//
+// NOTE: Bilateral Upsample
+//
+
+#if SHADOW_MASK_UPSAMPLE
+
+layout(set = 0, binding = 0) uniform sampler2D FullDepthTexture;
+layout(set = 0, binding = 1) uniform sampler2D HalfDepthTexture;
+layout(set = 0, binding = 2) uniform sampler2D HalfMaskTexture;
+layout(set = 0, binding = 3, r8) uniform writeonly image2D OutputMask;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+void main()
+{
+    ivec2 PixelCoord = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 OutputSize = imageSize(OutputMask);
+    if (any(greaterThanEqual(PixelCoord, OutputSize)))
+    {
+        return;
+    }
+
+    float Depth = texelFetch(FullDepthTexture, PixelCoord, 0).x;
+    ivec2 HalfSize = textureSize(HalfMaskTexture, 0);
+    vec2 HalfPos = 0.5f*(vec2(PixelCoord) + vec2(0.5)) - vec2(0.5);
+    ivec2 BaseCoord = ivec2(floor(HalfPos));
+    vec2 Fraction = HalfPos - vec2(BaseCoord);
+
+    // NOTE: Bilinear weights scaled by how close the low res depth is to ours. Depth isn't linear so we compare relative differences
+    float TotalWeight = 0.0f;
+    float Occlusion = 0.0f;
+    for (int SampleId = 0; SampleId < 4; ++SampleId)
+    {
+        ivec2 Offset = ivec2(SampleId & 1, SampleId >> 1);
+        ivec2 SampleCoord = clamp(BaseCoord + Offset, ivec2(0), HalfSize - ivec2(1));
+        vec2 Bilinear = mix(vec2(1) - Fraction, Fraction, vec2(Offset));
+        float SampleDepth = texelFetch(HalfDepthTexture, SampleCoord, 0).x;
+        float DepthWeight = 1.0f / (0.001f + abs(SampleDepth - Depth) / max(Depth, 0.0001f));
+        float Weight = Bilinear.x*Bilinear.y*DepthWeight;
+
+        Occlusion += Weight*texelFetch(HalfMaskTexture, SampleCoord, 0).x;
+        TotalWeight += Weight;
+    }
+
+    Occlusion = TotalWeight > 0.0f ? Occlusion / TotalWeight : 1.0f;
+    imageStore(OutputMask, PixelCoord, vec4(Occlusion, 0, 0, 0));
+}
+
+#endif
@@ -1,51 +1,385 @@
 
 #include "shadow_demo.h"
+#include "device_setup.cpp"
+#include "radix_sort.cpp"
+#include "mesh.cpp"
+#include "growable.cpp"
+#include "asset_stream.cpp"
+#include "texture_file.cpp"
+#include "render_graph.cpp"
+#include "scene_bvh.cpp"
+#include "geometry_buffer.cpp"
+#include "async_compute.cpp"
+#include "occlusion.cpp"
+#include "shadow_mask.cpp"
 #include "forward.cpp"
+#include "cpu_raster.cpp"
+#include "regression.cpp"
+#include "scene_file.cpp"
+#include "shader_reload.cpp"
 
 //
 // NOTE: Asset Storage System
 //
 
-inline u32 SceneMeshAdd(render_scene* Scene, vk_image Color, vk_image Normal, VkBuffer VertexBuffer, VkBuffer IndexBuffer, u32 NumIndices)
+inline void SceneTextureWrite(render_scene* Scene, u32 TextureId, vk_image Image, VkSampler Sampler)
 {
-    Assert(Scene->NumRenderMeshes < Scene->MaxNumRenderMeshes);
+    VkDescriptorImageInfo* ImageInfo = Scene->TextureInfos + TextureId;
+    ImageInfo->sampler = Sampler;
+    ImageInfo->imageView = Image.View;
+    ImageInfo->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if (!Scene->MaterialBindless)
+    {
+        // NOTE: The per material sets can still be in use, SceneCapacitySync rewrites them once their frame slot comes around
+        Scene->MaterialDescriptorsDirty = (1u << GROWABLE_FRAMES_IN_FLIGHT) - 1;
+        return;
+    }
     
-    u32 MeshId = Scene->NumRenderMeshes++;
-    render_mesh* Mesh = Scene->RenderMeshes + MeshId;
-    Mesh->Color = Color;
-    Mesh->Normal = Normal;
-    Mesh->VertexBuffer = VertexBuffer;
-    Mesh->IndexBuffer = IndexBuffer;
-    Mesh->NumIndices = NumIndices;
-    Mesh->MaterialDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Scene->MaterialDescLayout);
-    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mesh->MaterialDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                           Color.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mesh->MaterialDescriptor, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                           Normal.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // NOTE: The array is update after bind, so we can write elements directly even if the set is in use
+    VkWriteDescriptorSet Write = {};
+    Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    Write.dstSet = Scene->MaterialDescriptor;
+    Write.dstBinding = 1;
+    Write.dstArrayElement = TextureId;
+    Write.descriptorCount = 1;
+    Write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    Write.pImageInfo = ImageInfo;
+    vkUpdateDescriptorSets(RenderState->Device, 1, &Write, 0, 0);
+}
 
-    return MeshId;
+inline void SceneMaterialDescriptorsWrite(render_scene* Scene, u32 FrameSlot)
+{
+    // NOTE: Not bindless, each set holds the material table and the materials color texture
+    VkDescriptorBufferInfo BufferInfo = {};
+    BufferInfo.buffer = Scene->MaterialBuffer;
+    BufferInfo.offset = 0;
+    BufferInfo.range = VK_WHOLE_SIZE;
+    
+    for (u32 MaterialId = 0; MaterialId < Scene->NumMaterials; ++MaterialId)
+    {
+        VkWriteDescriptorSet Writes[2] = {};
+        Writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Writes[0].dstSet = Scene->MaterialSlotDescriptors[FrameSlot][MaterialId];
+        Writes[0].dstBinding = 0;
+        Writes[0].descriptorCount = 1;
+        Writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        Writes[0].pBufferInfo = &BufferInfo;
+        Writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Writes[1].dstSet = Scene->MaterialSlotDescriptors[FrameSlot][MaterialId];
+        Writes[1].dstBinding = 1;
+        Writes[1].descriptorCount = 1;
+        Writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        Writes[1].pImageInfo = Scene->TextureInfos + Scene->MaterialColorTextureIds[MaterialId];
+        vkUpdateDescriptorSets(RenderState->Device, ArrayCount(Writes), Writes, 0, 0);
+    }
+}
+
+inline u32 SceneTextureAdd(render_scene* Scene, vk_image Image, VkSampler Sampler)
+{
+    Assert(Scene->NumTextures < MATERIAL_MAX_TEXTURES);
+
+    u32 TextureId = Scene->NumTextures++;
+    SceneTextureWrite(Scene, TextureId, Image, Sampler);
+
+    return TextureId;
 }
 
-inline u32 SceneMeshAdd(render_scene* Scene, vk_image Color, vk_image Normal, procedural_mesh Mesh)
+inline u32 SceneTextureStream(render_scene* Scene, vk_image Image, VkSampler Sampler, u32 StreamTicket, texture_file* File = 0)
 {
-    u32 Result = SceneMeshAdd(Scene, Color, Normal, Mesh.Vertices, Mesh.Indices, Mesh.NumIndices);
+    // NOTE: Samples the placeholder until SceneStreamUpdate sees the ticket become resident
+    u32 TextureId = SceneTextureAdd(Scene, Scene->PlaceholderTexture, Sampler);
+    streamed_texture* Streamed = Scene->StreamedTextures + Scene->NumStreamedTextures++;
+    Streamed->TextureId = TextureId;
+    Streamed->StreamTicket = StreamTicket;
+    Streamed->Image = Image;
+    Streamed->Sampler = Sampler;
+    Streamed->File = File ? *File : texture_file{};
+
+    return TextureId;
+}
+
+inline u32 SceneTextureFileAdd(render_scene* Scene, asset_stream* Stream, char* FileName, b32 Color, VkSampler Sampler,
+                               u32 FallbackTextureId)
+{
+    // NOTE: Files we can't open, parse or sample fall back to an existing texture, as do non color files in a color slot and files
+    // past the size of the texture array
+    if (Scene->NumTextures == MATERIAL_MAX_TEXTURES)
+    {
+        return FallbackTextureId;
+    }
+    
+    texture_file File;
+    if (!TextureFileOpen(FileName, &File))
+    {
+        return FallbackTextureId;
+    }
+    if (Color && !File.FormatInfo.Color)
+    {
+        TextureFileClose(&File);
+        return FallbackTextureId;
+    }
+
+    Assert(Scene->NumFileTextures < ArrayCount(Scene->FileTextures));
+    u32 TicketId = AssetStreamTicketCreate(Stream);
+    texture_file_image* Image = Scene->FileTextures + Scene->NumFileTextures++;
+    *Image = TextureFileStream(Stream, &File, TicketId);
+    u32 Result = SceneTextureStream(Scene, Image->Image, Sampler, TicketId, &File);
     return Result;
 }
 
-inline void SceneOpaqueInstanceAdd(render_scene* Scene, u32 MeshId, m4 WTransform)
+inline void SceneStreamUpdate(render_scene* Scene, asset_stream* Stream)
 {
-    Assert(Scene->NumOpaqueInstances < Scene->MaxNumOpaqueInstances);
+    for (u32 StreamedId = 0; StreamedId < Scene->NumStreamedTextures;)
+    {
+        streamed_texture* Streamed = Scene->StreamedTextures + StreamedId;
+        if (AssetStreamTicketResident(Stream, Streamed->StreamTicket))
+        {
+            SceneTextureWrite(Scene, Streamed->TextureId, Streamed->Image, Streamed->Sampler);
+            if (Streamed->File.Loaded)
+            {
+                TextureFileClose(&Streamed->File);
+            }
+            *Streamed = Scene->StreamedTextures[--Scene->NumStreamedTextures];
+        }
+        else
+        {
+            StreamedId += 1;
+        }
+    }
+}
+
+ASSET_STREAM_LOAD(SceneCheckerLoad)
+{
+    // NOTE: Generated on the worker, Data holds the dimension. Alternating black and white texels, starting with white
+    u32 Dim = u32(u64(Data));
+    u32* Texels = (u32*)Dst;
+    Assert(Offset == 0 && Size == sizeof(u32)*Dim*Dim);
+    for (u32 Y = 0; Y < Dim; ++Y)
+    {
+        for (u32 X = 0; X < Dim; ++X)
+        {
+            Texels[Y*Dim + X] = ((X + Y) & 1) ? 0xFF000000 : 0xFFFFFFFF;
+        }
+    }
+}
+
+// NOTE: Returns 0xFFFFFFFF when the material table is full or the id wouldn't fit into the draw keys
+inline u32 SceneMaterialAdd(render_scene* Scene, u32 ColorTextureId, u32 NormalTextureId)
+{
+    Assert(ColorTextureId < Scene->NumTextures && NormalTextureId < Scene->NumTextures);
+    if (Scene->NumMaterials == MATERIAL_MAX_MATERIALS || Scene->NumMaterials == DRAW_KEY_MAX_MATERIALS)
+    {
+        return 0xFFFFFFFF;
+    }
+
+    u32 MaterialId = Scene->NumMaterials++;
+    Scene->MaterialColorTextureIds[MaterialId] = ColorTextureId;
+    if (!Scene->MaterialBindless)
+    {
+        for (u32 FrameSlot = 0; FrameSlot < GROWABLE_FRAMES_IN_FLIGHT; ++FrameSlot)
+        {
+            Scene->MaterialSlotDescriptors[FrameSlot][MaterialId] = VkDescriptorSetAllocate(RenderState->Device, Scene->MaterialDescPool,
+                                                                                            Scene->MaterialDescLayout);
+        }
+        Scene->MaterialDescriptorsDirty = (1u << GROWABLE_FRAMES_IN_FLIGHT) - 1;
+    }
+    
+    material_gpu* GpuMaterial = (material_gpu*)VkTransferPushWrite(&RenderState->TransferManager, Scene->MaterialBuffer,
+                                                                   sizeof(material_gpu)*MaterialId, sizeof(material_gpu),
+                                                                   BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                                   BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT));
+    *GpuMaterial = {};
+    GpuMaterial->ColorTextureId = ColorTextureId;
+    GpuMaterial->NormalTextureId = NormalTextureId;
+
+    return MaterialId;
+}
+
+// NOTE: Returns 0xFFFFFFFF when the material table is full
+inline u32 SceneMaterialFileAdd(render_scene* Scene, asset_stream* Stream, char* ColorFileName, char* NormalFileName, VkSampler Sampler,
+                                u32 FallbackTextureId)
+{
+    // NOTE: A null file name uses the fallback for that slot
+    u32 ColorTextureId = (ColorFileName ? SceneTextureFileAdd(Scene, Stream, ColorFileName, true, Sampler, FallbackTextureId) :
+                          FallbackTextureId);
+    u32 NormalTextureId = (NormalFileName ? SceneTextureFileAdd(Scene, Stream, NormalFileName, false, Sampler, FallbackTextureId) :
+                           FallbackTextureId);
+    u32 Result = SceneMaterialAdd(Scene, ColorTextureId, NormalTextureId);
+    return Result;
+}
+
+// NOTE: Returns 0xFFFFFFFF when every mesh id that fits into the draw keys is taken
+inline u32 SceneMeshSlotAllocate(render_scene* Scene)
+{
+    // NOTE: Reuse slots of removed meshes so that mesh ids stay small
+    u32 MeshId = 0;
+    while (MeshId < Scene->NumRenderMeshes && Scene->RenderMeshes[MeshId].Allocated)
+    {
+        MeshId += 1;
+    }
+    if (MeshId == DRAW_KEY_MAX_MESHES)
+    {
+        return 0xFFFFFFFF;
+    }
+    if (MeshId == Scene->NumRenderMeshes)
+    {
+        if (Scene->NumRenderMeshes == Scene->MaxNumRenderMeshes)
+        {
+            // NOTE: Render meshes only live on the CPU, the geometry buffer holds the GPU side
+            u32 NewMaxNumRenderMeshes = GrowableCapacityGet(Scene->MaxNumRenderMeshes, Scene->NumRenderMeshes + 1);
+            Scene->RenderMeshes = GrowableArrayResizeType(&DemoState->Growable, Scene->RenderMeshes, render_mesh, Scene->MaxNumRenderMeshes,
+                                                          NewMaxNumRenderMeshes);
+            Scene->MaxNumRenderMeshes = NewMaxNumRenderMeshes;
+            DemoState->Growable.NumGrows += 1;
+        }
+        Scene->NumRenderMeshes += 1;
+        Scene->HighWaterRenderMeshes = Max(Scene->HighWaterRenderMeshes, Scene->NumRenderMeshes);
+    }
+    
+    Scene->RenderMeshes[MeshId].Allocated = true;
+    return MeshId;
+}
+
+inline void SceneMeshSlotFree(render_scene* Scene, u32 MeshId)
+{
+    Scene->RenderMeshes[MeshId].Allocated = false;
+    while (Scene->NumRenderMeshes > 0 && !Scene->RenderMeshes[Scene->NumRenderMeshes - 1].Allocated)
+    {
+        Scene->NumRenderMeshes -= 1;
+    }
+}
+
+// NOTE: Returns 0xFFFFFFFF when the geometry buffer or the mesh ids are full
+inline u32 SceneMeshAdd(render_scene* Scene, mesh* Mesh)
+{
+    u32 MeshId = SceneMeshSlotAllocate(Scene);
+    if (MeshId == 0xFFFFFFFF)
+    {
+        return MeshId;
+    }
+    
+    render_mesh* RenderMesh = Scene->RenderMeshes + MeshId;
+    MeshLodChainBuild(&DemoState->Arena, &DemoState->TempArena, Mesh);
+    MeshOptimize(&DemoState->TempArena, Mesh, &RenderMesh->CacheStatsBefore, &RenderMesh->CacheStatsAfter);
+    RenderMesh->NumLods = Mesh->NumLods;
+    Copy(Mesh->Lods, RenderMesh->Lods, sizeof(mesh_lod)*Mesh->NumLods);
+    MeshBoundsGet(Mesh, &RenderMesh->BoundsMin, &RenderMesh->BoundsMax, &RenderMesh->SphereCenter, &RenderMesh->SphereRadius);
+    RenderMesh->CpuPositions = (u8*)&Mesh->Vertices[0].Pos;
+    RenderMesh->CpuPositionStride = sizeof(mesh_vertex);
+    RenderMesh->CpuIndices = Mesh->Indices;
+    RenderMesh->CpuIndices16 = false;
+    RenderMesh->StreamTicket = 0;
+    if (!GeometryMeshAdd(&Scene->Geometry, Mesh, RenderMesh))
+    {
+        SceneMeshSlotFree(Scene, MeshId);
+        MeshId = 0xFFFFFFFF;
+    }
+
+    return MeshId;
+}
+
+// NOTE: Returns 0xFFFFFFFF when the geometry buffer or the mesh ids are full
+inline u32 SceneMeshAddPacked(render_scene* Scene, asset_stream* Stream, scene_file_mesh* FileMesh, u8* FileBase)
+{
+    // NOTE: LODs and optimization were done by the converter, the streams get uploaded straight out of the mapped file
+    u32 MeshId = SceneMeshSlotAllocate(Scene);
+    if (MeshId == 0xFFFFFFFF)
+    {
+        return MeshId;
+    }
+    
+    render_mesh* RenderMesh = Scene->RenderMeshes + MeshId;
+    RenderMesh->NumLods = FileMesh->NumLods;
+    Copy(FileMesh->Lods, RenderMesh->Lods, sizeof(mesh_lod)*FileMesh->NumLods);
+    RenderMesh->BoundsMin = FileMesh->BoundsMin;
+    RenderMesh->BoundsMax = FileMesh->BoundsMax;
+    RenderMesh->SphereCenter = FileMesh->SphereCenter;
+    RenderMesh->SphereRadius = FileMesh->SphereRadius;
+    RenderMesh->CacheStatsBefore = {};
+    RenderMesh->CacheStatsAfter = {};
+
+    RenderMesh->CpuPositions = FileBase + FileMesh->PositionsOffset;
+    RenderMesh->CpuPositionStride = sizeof(v3);
+    RenderMesh->CpuIndices = FileBase + FileMesh->IndicesOffset;
+    RenderMesh->CpuIndices16 = FileMesh->IndexSize == sizeof(u16);
+    RenderMesh->StreamTicket = AssetStreamTicketCreate(Stream);
+    // NOTE: A ticket without requests is resident right away, so a failed add doesn't hold anything up
+    if (!GeometryMeshStream(&Scene->Geometry, Stream, RenderMesh->StreamTicket, FileMesh->NumVertices,
+                            (v3*)(FileBase + FileMesh->PositionsOffset), (mesh_vertex_attributes*)(FileBase + FileMesh->AttributesOffset),
+                            FileMesh->NumIndices, FileBase + FileMesh->IndicesOffset, RenderMesh))
+    {
+        SceneMeshSlotFree(Scene, MeshId);
+        MeshId = 0xFFFFFFFF;
+    }
+
+    return MeshId;
+}
+
+inline void SceneMeshRemove(render_scene* Scene, u32 MeshId)
+{
+    Assert(MeshId < Scene->NumRenderMeshes);
+    render_mesh* RenderMesh = Scene->RenderMeshes + MeshId;
+    Assert(RenderMesh->Allocated);
+
+    // IMPORTANT: Dynamic instances get re-added every frame, so the caller has to stop adding instances of this mesh first
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+    {
+        Assert(Scene->OpaqueInstances[InstanceId].MeshId != MeshId);
+    }
+
+    GeometryMeshRemove(&Scene->Geometry, &DemoState->Growable, RenderMesh);
+    SceneMeshSlotFree(Scene, MeshId);
+}
+
+inline void SceneOpaqueInstanceAdd(render_scene* Scene, u32 MeshId, u32 MaterialId, m4 WTransform, b32 Static)
+{
+    Assert(MaterialId < Scene->NumMaterials);
+    if (!AssetStreamTicketResident(&DemoState->AssetStream, Scene->RenderMeshes[MeshId].StreamTicket))
+    {
+        // NOTE: Meshes that are still streaming in don't get drawn yet
+        return;
+    }
+    
+    if (Scene->NumOpaqueInstances == Scene->MaxNumOpaqueInstances)
+    {
+        // NOTE: Only the CPU array grows here, everything on the GPU catches up in SceneCapacitySync before it gets uploaded
+        u32 NewMaxNumOpaqueInstances = GrowableCapacityGet(Scene->MaxNumOpaqueInstances, Scene->NumOpaqueInstances + 1);
+        Scene->OpaqueInstances = GrowableArrayResizeType(&DemoState->Growable, Scene->OpaqueInstances, instance_entry,
+                                                         Scene->MaxNumOpaqueInstances, NewMaxNumOpaqueInstances);
+        Scene->MaxNumOpaqueInstances = NewMaxNumOpaqueInstances;
+    }
 
     instance_entry* Instance = Scene->OpaqueInstances + Scene->NumOpaqueInstances++;
     Instance->MeshId = MeshId;
-    Instance->ShadowWVP = Scene->DirectionalLight.GpuData.VPTransform * WTransform;
+    Instance->MaterialId = MaterialId;
+    Instance->Static = Static;
+    Scene->NumDynamicOpaqueInstances += Static ? 0 : 1;
+    // NOTE: ShadowWVP gets set once the light bounds have been fit to the instances
     Instance->WTransform = WTransform;
-    Instance->WVPTransform = CameraGetVP(&Scene->Camera)*Instance->WTransform;
+    render_mesh* Mesh = Scene->RenderMeshes + MeshId;
+    BoundsTransform(WTransform, Mesh->BoundsMin, Mesh->BoundsMax, &Instance->BoundsMin, &Instance->BoundsMax);
+    Instance->Scale = Max(Length((WTransform*V4(1.0f, 0.0f, 0.0f, 0.0f)).xyz),
+                          Max(Length((WTransform*V4(0.0f, 1.0f, 0.0f, 0.0f)).xyz), Length((WTransform*V4(0.0f, 0.0f, 1.0f, 0.0f)).xyz)));
+}
+
+inline void SceneStaticInstancesEnd(render_scene* Scene)
+{
+    // NOTE: Everything added so far stays in the scene, so this has to happen before any dynamic instance got added this frame
+    Assert(Scene->NumDynamicOpaqueInstances == 0);
+    Scene->NumStaticOpaqueInstances = Scene->NumOpaqueInstances;
+    Scene->StaticGeneration += 1;
 }
 
 inline void ScenePointLightAdd(render_scene* Scene, v3 Pos, v3 Color, f32 MaxDistance)
 {
-    Assert(Scene->NumPointLights < Scene->MaxNumPointLights);
+    if (Scene->NumPointLights == Scene->MaxNumPointLights)
+    {
+        u32 NewMaxNumPointLights = GrowableCapacityGet(Scene->MaxNumPointLights, Scene->NumPointLights + 1);
+        Scene->PointLights = GrowableArrayResizeType(&DemoState->Growable, Scene->PointLights, point_light, Scene->MaxNumPointLights,
+                                                     NewMaxNumPointLights);
+        Scene->MaxNumPointLights = NewMaxNumPointLights;
+    }
 
     // TODO: Specify strength or a sphere so that we can visualize nicely too?
     point_light* PointLight = Scene->PointLights + Scene->NumPointLights++;
@@ -54,6 +388,197 @@ inline void ScenePointLightAdd(render_scene* Scene, v3 Pos, v3 Color, f32 MaxDis
     PointLight->MaxDistance = MaxDistance;
 }
 
+inline void SceneDescriptorWrite(render_scene* Scene, u32 FrameSlot)
+{
+    VkDescriptorSet Descriptor = Scene->SceneDescriptors[FrameSlot];
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Scene->SceneBuffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->OpaqueInstanceBuffer.Slots[FrameSlot].Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->PointLightBuffer.Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->PointLightTransforms.Buffer);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->DirectionalLight.Globals);
+    VkDescriptorBufferWrite(&RenderState->DescriptorManager, Descriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                            Scene->DirectionalLight.ShadowTransforms.Slots[FrameSlot].Buffer);
+}
+
+inline void SceneInstanceCapacityResize(growable_state* Growable, VkCommandBuffer CmdBuffer, render_scene* Scene, forward_state* Forward,
+                                        u32 MaxNumInstances)
+{
+    // NOTE: Per instance GPU data gets rewritten every frame, only the occlusion visibility has to survive the grow
+    u32 OldMaxNumInstances = Scene->GpuMaxNumOpaqueInstances;
+    GrowableMappedBufferResize(Growable, &Scene->OpaqueInstanceBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               sizeof(gpu_instance_entry)*u64(MaxNumInstances));
+    GrowableMappedBufferResize(Growable, &Scene->DirectionalLight.ShadowTransforms, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               sizeof(m4)*u64(MaxNumInstances));
+    Scene->ForwardVisible = GrowableArrayResizeType(Growable, Scene->ForwardVisible, u32, OldMaxNumInstances, MaxNumInstances);
+    Scene->ShadowVisible = GrowableArrayResizeType(Growable, Scene->ShadowVisible, u32, OldMaxNumInstances, MaxNumInstances);
+    if (Scene->Bvh.MaxNumInstances < MaxNumInstances)
+    {
+        SceneBvhResize(Growable, &Scene->Bvh, MaxNumInstances);
+    }
+    
+    // NOTE: Every instance lands in the forward list and in one of the shadow lists at most
+    if (Scene->Geometry.MaxNumCommands < 2*MaxNumInstances)
+    {
+        GeometryCommandsResize(Growable, &Scene->Geometry, 2*MaxNumInstances);
+    }
+    if (Forward)
+    {
+        OcclusionCapacityResize(Growable, CmdBuffer, &Forward->Occlusion, MaxNumInstances, Scene->Geometry.MaxNumCommands);
+        ClipmapCapacityResize(Growable, &Forward->ClipmapShadow, MaxNumInstances);
+    }
+    
+    Scene->GpuMaxNumOpaqueInstances = MaxNumInstances;
+    Scene->SceneDescriptorsDirty = (1u << GROWABLE_FRAMES_IN_FLIGHT) - 1;
+}
+
+inline void ScenePointLightCapacityResize(growable_state* Growable, render_scene* Scene, u32 MaxNumPointLights)
+{
+    GrowableBufferResize(Growable, VK_NULL_HANDLE, &Scene->PointLightBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         sizeof(point_light)*u64(MaxNumPointLights), false);
+    GrowableBufferResize(Growable, VK_NULL_HANDLE, &Scene->PointLightTransforms, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         sizeof(m4)*u64(MaxNumPointLights), false);
+    
+    Scene->GpuMaxNumPointLights = MaxNumPointLights;
+    Scene->SceneDescriptorsDirty = (1u << GROWABLE_FRAMES_IN_FLIGHT) - 1;
+}
+
+inline void SceneCapacitySync(growable_state* Growable, VkCommandBuffer CmdBuffer, render_scene* Scene, forward_state* Forward)
+{
+    // NOTE: Called once the scene got populated, before anything sized per instance or light gets touched
+    Scene->HighWaterOpaqueInstances = Max(Scene->HighWaterOpaqueInstances, Scene->NumOpaqueInstances);
+    Scene->HighWaterPointLights = Max(Scene->HighWaterPointLights, Scene->NumPointLights);
+    
+    if (Scene->GpuMaxNumOpaqueInstances < Scene->MaxNumOpaqueInstances)
+    {
+        SceneInstanceCapacityResize(Growable, CmdBuffer, Scene, Forward, Scene->MaxNumOpaqueInstances);
+        Growable->NumGrows += 1;
+    }
+    if (Scene->GpuMaxNumPointLights < Scene->MaxNumPointLights)
+    {
+        ScenePointLightCapacityResize(Growable, Scene, Scene->MaxNumPointLights);
+        Growable->NumGrows += 1;
+    }
+
+    // NOTE: This frames sets aren't in use by the GPU anymore, point them at the current buffers
+    u32 FrameSlot = GrowableFrameSlot(Growable);
+    b32 WroteDescriptors = (Scene->SceneDescriptorsDirty & (1u << FrameSlot)) != 0;
+    Scene->SceneDescriptor = Scene->SceneDescriptors[FrameSlot];
+    if (WroteDescriptors)
+    {
+        SceneDescriptorWrite(Scene, FrameSlot);
+        Scene->SceneDescriptorsDirty &= ~(1u << FrameSlot);
+    }
+    if (!Scene->MaterialBindless)
+    {
+        Scene->MaterialDescriptors = Scene->MaterialSlotDescriptors[FrameSlot];
+        if (Scene->MaterialDescriptorsDirty & (1u << FrameSlot))
+        {
+            SceneMaterialDescriptorsWrite(Scene, FrameSlot);
+            Scene->MaterialDescriptorsDirty &= ~(1u << FrameSlot);
+        }
+    }
+    if (Forward)
+    {
+        WroteDescriptors = WroteDescriptors || (Forward->Occlusion.CullDescriptorsDirty & (1u << FrameSlot)) != 0;
+        OcclusionFrameBegin(&Forward->Occlusion, &Scene->Geometry, FrameSlot);
+    }
+    
+    if (WroteDescriptors)
+    {
+        VkDescriptorManagerFlush(RenderState->Device, &RenderState->DescriptorManager);
+    }
+}
+
+inline void SceneFileMeshesAdd(linear_arena* Arena, render_scene* Scene, asset_stream* Stream, scene_file* SceneFile)
+{
+    Assert(SceneFile->Loaded);
+    scene_file_header* Header = SceneFile->Header;
+
+    SceneFile->MeshIds = PushArray(Arena, u32, Header->NumMeshes);
+    for (u32 MeshId = 0; MeshId < Header->NumMeshes; ++MeshId)
+    {
+        SceneFile->MeshIds[MeshId] = SceneMeshAddPacked(Scene, Stream, SceneFile->Meshes + MeshId, SceneFile->Base);
+    }
+
+    // NOTE: Only the dynamic instances get walked every frame once the static ones are in
+    SceneFile->NumDynamicInstances = 0;
+    for (u32 InstanceId = 0; InstanceId < Header->NumInstances; ++InstanceId)
+    {
+        SceneFile->NumDynamicInstances += SceneFile->Instances[InstanceId].Static ? 0 : 1;
+    }
+    SceneFile->DynamicInstanceIds = PushArray(Arena, u32, SceneFile->NumDynamicInstances);
+    u32 NumDynamicInstances = 0;
+    for (u32 InstanceId = 0; InstanceId < Header->NumInstances; ++InstanceId)
+    {
+        if (!SceneFile->Instances[InstanceId].Static)
+        {
+            SceneFile->DynamicInstanceIds[NumDynamicInstances++] = InstanceId;
+        }
+    }
+}
+
+// NOTE: Lights come straight out of the mapping every frame. Static instances go into the scene once, as soon as every file mesh is
+// resident, until then they get re-added every frame like the dynamic ones so that meshes show up as they stream in
+inline void SceneFilePopulate(render_scene* Scene, scene_file* SceneFile, u32 MaterialId)
+{
+    Assert(SceneFile->Loaded);
+    scene_file_header* Header = SceneFile->Header;
+
+    for (u32 LightId = 0; LightId < Header->NumPointLights; ++LightId)
+    {
+        scene_file_point_light* Light = SceneFile->PointLights + LightId;
+        ScenePointLightAdd(Scene, Light->Pos, Light->Color, Light->MaxDistance);
+    }
+
+    if (!SceneFile->StaticAdded)
+    {
+        b32 AllResident = true;
+        for (u32 MeshId = 0; MeshId < Header->NumMeshes && AllResident; ++MeshId)
+        {
+            u32 SceneMeshId = SceneFile->MeshIds[MeshId];
+            AllResident = (SceneMeshId == 0xFFFFFFFF ||
+                           AssetStreamTicketResident(&DemoState->AssetStream, Scene->RenderMeshes[SceneMeshId].StreamTicket));
+        }
+
+        for (u32 InstanceId = 0; InstanceId < Header->NumInstances; ++InstanceId)
+        {
+            scene_file_instance* Instance = SceneFile->Instances + InstanceId;
+            Assert(Instance->MeshId < Header->NumMeshes);
+            // NOTE: Meshes that didn't fit into the geometry buffer don't get drawn
+            if (Instance->Static && SceneFile->MeshIds[Instance->MeshId] != 0xFFFFFFFF)
+            {
+                SceneOpaqueInstanceAdd(Scene, SceneFile->MeshIds[Instance->MeshId], MaterialId, Instance->WTransform, true);
+            }
+        }
+
+        if (AllResident)
+        {
+            SceneStaticInstancesEnd(Scene);
+            SceneFile->StaticAdded = true;
+
+            LARGE_INTEGER Frequency;
+            LARGE_INTEGER EndTime;
+            QueryPerformanceFrequency(&Frequency);
+            QueryPerformanceCounter(&EndTime);
+            SceneFile->LoadMs = f32(f64(EndTime.QuadPart - SceneFile->LoadStartTime.QuadPart) * 1000.0 / f64(Frequency.QuadPart));
+        }
+        else
+        {
+            Scene->StaticGeneration += 1;
+        }
+    }
+
+    for (u32 DynamicId = 0; DynamicId < SceneFile->NumDynamicInstances; ++DynamicId)
+    {
+        scene_file_instance* Instance = SceneFile->Instances + SceneFile->DynamicInstanceIds[DynamicId];
+        Assert(Instance->MeshId < Header->NumMeshes);
+        if (SceneFile->MeshIds[Instance->MeshId] != 0xFFFFFFFF)
+        {
+            SceneOpaqueInstanceAdd(Scene, SceneFile->MeshIds[Instance->MeshId], MaterialId, Instance->WTransform, false);
+        }
+    }
+}
+
 inline void SceneDirectionalLightSet(render_scene* Scene, v3 LightDir, v3 Color, v3 AmbientColor, v3 BoundsMin, v3 BoundsMax)
 {
     // NOTE: Lighting is done in camera space
@@ -61,15 +586,236 @@ inline void SceneDirectionalLightSet(render_scene* Scene, v3 LightDir, v3 Color,
     Scene->DirectionalLight.GpuData.Color = Color;
     Scene->DirectionalLight.GpuData.AmbientColor = AmbientColor;
 
-    v3 Up = V3(0, 1, 0);
-    f32 DotValue = Abs(Dot(Up, LightDir));
-    if (DotValue > 0.99f && DotValue < 1.01f)
+    Scene->DirectionalLight.GpuData.VPTransform = (VkOrthoProjM4(BoundsMin.x, BoundsMax.x, BoundsMax.y, BoundsMin.y, BoundsMin.z, BoundsMax.z) *
+                                                   DirectionalLightViewGet(LightDir));
+}
+
+inline i32 ShadowFitTexelStep(f32 Extent, u32 Resolution)
+{
+    // NOTE: Smallest step whose texel size still covers the extent. Snapping the origin down moves it by up to a texel, so the extent
+    // only gets Resolution - 1 texels. The steps are 1/SHADOW_FIT_TEXEL_STEPS of a power of 2, so we waste at most ~1% of the map
+    f32 MinTexelSize = Max(Extent, 0.001f) / f32(Max(Resolution, 2u) - 1);
+    i32 Result = i32(ceilf(log2f(MinTexelSize)*f32(SHADOW_FIT_TEXEL_STEPS)));
+    return Result;
+}
+
+inline f32 ShadowFitTexelSize(i32 TexelStep)
+{
+    f32 Result = exp2f(f32(TexelStep) / f32(SHADOW_FIT_TEXEL_STEPS));
+    return Result;
+}
+
+inline void SceneDirectionalLightFit(render_scene* Scene, v3 LightDir, v3 Color, v3 AmbientColor, u32 ShadowResX, u32 ShadowResY)
+{
+    /*
+       NOTE: Fits the ortho volume to what can actually receive visible shadows:
+
+         - Receivers are the camera frustum intersected with the scene AABB, that gives us x/y and the far plane
+         - The near plane gets pulled back to include every caster that overlaps the receivers in x/y
+         - x/y get snapped to whole texels so that the map doesn't shimmer and the caches survive camera moves within a texel
+     */
+    
+    m4 LightView = DirectionalLightViewGet(LightDir);
+
+    v3 SceneMin = V3(0.0f);
+    v3 SceneMax = V3(0.0f);
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
     {
-        Up = V3(1, 0, 0);
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        SceneMin = InstanceId == 0 ? CurrInstance->BoundsMin : V3(Min(SceneMin.x, CurrInstance->BoundsMin.x), Min(SceneMin.y, CurrInstance->BoundsMin.y),
+                                                                    Min(SceneMin.z, CurrInstance->BoundsMin.z));
+        SceneMax = InstanceId == 0 ? CurrInstance->BoundsMax : V3(Max(SceneMax.x, CurrInstance->BoundsMax.x), Max(SceneMax.y, CurrInstance->BoundsMax.y),
+                                                                    Max(SceneMax.z, CurrInstance->BoundsMax.z));
     }
 
-    Scene->DirectionalLight.GpuData.VPTransform = (VkOrthoProjM4(BoundsMin.x, BoundsMax.x, BoundsMax.y, BoundsMin.y, BoundsMin.z, BoundsMax.z) *
-                                                   LookAtM4(LightDir, Up, V3(0, 0, 0)));
+    // NOTE: World space bounds of the camera frustum
+    v3 FrustumMin = V3(0.0f);
+    v3 FrustumMax = V3(0.0f);
+    {
+        m4 InverseVP = Inverse(CameraGetVP(&Scene->Camera));
+        for (u32 CornerId = 0; CornerId < 8; ++CornerId)
+        {
+            v4 Corner = InverseVP * V4((CornerId & 1) ? 1.0f : -1.0f, (CornerId & 2) ? 1.0f : -1.0f, (CornerId & 4) ? 1.0f : 0.0f, 1.0f);
+            v3 WorldPos = Corner.xyz / Corner.w;
+            FrustumMin = CornerId == 0 ? WorldPos : V3(Min(FrustumMin.x, WorldPos.x), Min(FrustumMin.y, WorldPos.y), Min(FrustumMin.z, WorldPos.z));
+            FrustumMax = CornerId == 0 ? WorldPos : V3(Max(FrustumMax.x, WorldPos.x), Max(FrustumMax.y, WorldPos.y), Max(FrustumMax.z, WorldPos.z));
+        }
+    }
+
+    v3 ReceiverMin = V3(Max(FrustumMin.x, SceneMin.x), Max(FrustumMin.y, SceneMin.y), Max(FrustumMin.z, SceneMin.z));
+    v3 ReceiverMax = V3(Min(FrustumMax.x, SceneMax.x), Min(FrustumMax.y, SceneMax.y), Min(FrustumMax.z, SceneMax.z));
+    if (ReceiverMin.x >= ReceiverMax.x || ReceiverMin.y >= ReceiverMax.y || ReceiverMin.z >= ReceiverMax.z)
+    {
+        // NOTE: Nothing visible, fall back to the whole scene so that the cache doesn't get thrown away
+        ReceiverMin = SceneMin;
+        ReceiverMax = SceneMax;
+    }
+
+    v3 BoundsMin = {};
+    v3 BoundsMax = {};
+    BoundsTransform(LightView, ReceiverMin, ReceiverMax, &BoundsMin, &BoundsMax);
+
+    // NOTE: Casters between the light and the receivers still need to land in the depth range
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+    {
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        v3 CasterMin = {};
+        v3 CasterMax = {};
+        BoundsTransform(LightView, CurrInstance->BoundsMin, CurrInstance->BoundsMax, &CasterMin, &CasterMax);
+        if (CasterMax.x > BoundsMin.x && CasterMin.x < BoundsMax.x && CasterMax.y > BoundsMin.y && CasterMin.y < BoundsMax.y)
+        {
+            BoundsMin.z = Min(BoundsMin.z, CasterMin.z);
+        }
+    }
+
+    // NOTE: The texel size moves in fine log steps and the origin in whole texels, so the map doesn't shimmer and a camera move
+    // within a texel keeps the exact same light volume. The projection gets rebuilt from the snapped integers, so the same fit always
+    // gives the same transform. Depth doesn't shimmer, it only gets snapped to texels so the fit stays stable along z too
+    {
+        shadow_fit* Fit = &Scene->DirectionalLight.Fit;
+        Fit->LightDir = LightDir;
+        Fit->TexelStepX = ShadowFitTexelStep(BoundsMax.x - BoundsMin.x, ShadowResX);
+        Fit->TexelStepY = ShadowFitTexelStep(BoundsMax.y - BoundsMin.y, ShadowResY);
+        f32 TexelX = ShadowFitTexelSize(Fit->TexelStepX);
+        f32 TexelY = ShadowFitTexelSize(Fit->TexelStepY);
+        f32 TexelZ = Max(TexelX, TexelY);
+        Fit->OriginX = i32(floorf(BoundsMin.x / TexelX));
+        Fit->OriginY = i32(floorf(BoundsMin.y / TexelY));
+        Fit->DepthMin = i32(floorf(BoundsMin.z / TexelZ));
+        Fit->DepthMax = i32(ceilf(BoundsMax.z / TexelZ));
+
+        BoundsMin = V3(TexelX*f32(Fit->OriginX), TexelY*f32(Fit->OriginY), TexelZ*f32(Fit->DepthMin));
+        BoundsMax = V3(TexelX*f32(Fit->OriginX + i32(ShadowResX)), TexelY*f32(Fit->OriginY + i32(ShadowResY)), TexelZ*f32(Fit->DepthMax));
+        Scene->DirectionalLight.TexelSize = TexelZ;
+    }
+
+    SceneDirectionalLightSet(Scene, LightDir, Color, AmbientColor, BoundsMin, BoundsMax);
+
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+    {
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        CurrInstance->ShadowWVP = Scene->DirectionalLight.GpuData.VPTransform * CurrInstance->WTransform;
+    }
+}
+
+inline void SceneLodSelect(render_scene* Scene, f32 ViewportWidth, f32 ViewportHeight)
+{
+    /*
+       NOTE: Both passes pick the coarsest LOD whose error stays under their footprint:
+
+         - Forward: the error is projected at the bounding sphere center, pixels per world unit = 0.5 * Height * P11 / w
+         - Shadow: the projection is ortho so a world unit is the same number of texels everywhere, the error only needs to stay
+           under a couple of texels which makes the shadow vertex count independent of how finely the source was tessellated
+     */
+
+    m4 VPTransform = CameraGetVP(&Scene->Camera);
+    // NOTE: The view matrix is orthonormal, so the length of the y row of VP is P11
+    v3 VPRowY = V3((VPTransform*V4(1.0f, 0.0f, 0.0f, 0.0f)).y, (VPTransform*V4(0.0f, 1.0f, 0.0f, 0.0f)).y,
+                   (VPTransform*V4(0.0f, 0.0f, 1.0f, 0.0f)).y);
+    f32 PixelsPerUnit = 0.5f*ViewportHeight*Length(VPRowY);
+    f32 ShadowMaxError = MESH_LOD_SHADOW_TEXELS*Scene->DirectionalLight.TexelSize;
+    
+    for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
+    {
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+
+        v4 ClipCenter = VPTransform*CurrInstance->WTransform*V4(CurrMesh->SphereCenter, 1.0f);
+        f32 Distance = ClipCenter.w - CurrMesh->SphereRadius*CurrInstance->Scale;
+        f32 ForwardMaxError = Distance > 0.0f ? MESH_LOD_FORWARD_PIXELS*Distance / PixelsPerUnit : 0.0f;
+
+        CurrInstance->ForwardLod = MeshLodSelect(CurrMesh->Lods, CurrMesh->NumLods, ForwardMaxError / CurrInstance->Scale);
+        CurrInstance->ShadowLod = MeshLodSelect(CurrMesh->Lods, CurrMesh->NumLods, ShadowMaxError / CurrInstance->Scale);
+    }
+
+    // NOTE: Estimate the forward depth complexity from the projected bounding spheres of the visible instances. Spheres overestimate
+    // the coverage but so does every estimate that ignores occlusion, we only compare it against a threshold
+    f32 ScreenArea = ViewportWidth*ViewportHeight;
+    f32 CoveredArea = 0.0f;
+    for (u32 VisibleId = 0; VisibleId < Scene->NumForwardVisible; ++VisibleId)
+    {
+        instance_entry* CurrInstance = Scene->OpaqueInstances + Scene->ForwardVisible[VisibleId];
+        render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+
+        v4 ClipCenter = VPTransform*CurrInstance->WTransform*V4(CurrMesh->SphereCenter, 1.0f);
+        f32 Radius = CurrMesh->SphereRadius*CurrInstance->Scale;
+        f32 InstanceArea = ScreenArea;
+        if (ClipCenter.w > Radius)
+        {
+            f32 PixelRadius = Radius*PixelsPerUnit / ClipCenter.w;
+            InstanceArea = Min(Pi32*PixelRadius*PixelRadius, ScreenArea);
+        }
+        CoveredArea += InstanceArea;
+    }
+    Scene->ForwardOverdraw = CoveredArea / ScreenArea;
+}
+
+inline void SceneDrawListsBuild(render_scene* Scene)
+{
+    geometry_buffer* Geometry = &Scene->Geometry;
+    GeometryDrawListsReset(Geometry);
+
+    // NOTE: There is one pipeline per pass for now, the key has room for more
+    u32 PipelineId = 0;
+    
+    // NOTE: Key every draw of every pass
+    {
+        m4 VPTransform = CameraGetVP(&Scene->Camera);
+        for (u32 VisibleId = 0; VisibleId < Scene->NumForwardVisible; ++VisibleId)
+        {
+            u32 InstanceId = Scene->ForwardVisible[VisibleId];
+            instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+            render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+
+            f32 Depth = (VPTransform*CurrInstance->WTransform*V4(CurrMesh->SphereCenter, 1.0f)).w;
+            u64 Key = DrawKeyForwardCreate(PipelineId, CurrMesh->IndexType, Depth, CurrInstance->MaterialId, CurrInstance->MeshId,
+                                           CurrInstance->ForwardLod);
+            GeometryDrawSortAdd(Geometry, Key, InstanceId);
+        }
+
+        v3 LightDir = Scene->DirectionalLight.GpuData.Dir;
+        for (u32 VisibleId = 0; VisibleId < Scene->NumShadowVisible; ++VisibleId)
+        {
+            u32 InstanceId = Scene->ShadowVisible[VisibleId];
+            instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+            render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+
+            // NOTE: Static and dynamic casters get rendered separately because of the shadow caches
+            draw_pass Pass = CurrInstance->Static ? DrawPass_ShadowStatic : DrawPass_ShadowDynamic;
+            f32 Depth = Dot(0.5f*(CurrInstance->BoundsMin + CurrInstance->BoundsMax), LightDir);
+            u64 Key = DrawKeyShadowCreate(Pass, PipelineId, CurrMesh->IndexType, CurrInstance->MeshId, CurrInstance->ShadowLod,
+                                          CurrInstance->MaterialId, Depth);
+            GeometryDrawSortAdd(Geometry, Key, InstanceId);
+        }
+    }
+
+    GeometryDrawSort(Geometry);
+
+    // NOTE: Passes are the top bits so every list is a contiguous run of the sorted keys
+    geometry_draw_list* Lists[DrawPass_Count] = { &Scene->ForwardDraws, &Scene->ShadowStaticDraws, &Scene->ShadowDynamicDraws };
+    for (u32 PassId = 0; PassId < DrawPass_Count; ++PassId)
+    {
+        *Lists[PassId] = GeometryDrawListBegin(Geometry);
+    }
+    
+    for (u32 EntryId = 0; EntryId < Geometry->NumSortEntries; ++EntryId)
+    {
+        u64 Key = Geometry->SortKeys[EntryId];
+        u32 InstanceId = Geometry->SortValues[EntryId];
+        draw_pass Pass = DrawKeyPassGet(Key);
+        geometry_draw_list* List = Lists[Pass];
+        if (List->NumCommands == 0)
+        {
+            *List = GeometryDrawListBegin(Geometry);
+        }
+        
+        instance_entry* CurrInstance = Scene->OpaqueInstances + InstanceId;
+        render_mesh* CurrMesh = Scene->RenderMeshes + CurrInstance->MeshId;
+        u32 LodId = Pass == DrawPass_Forward ? CurrInstance->ForwardLod : CurrInstance->ShadowLod;
+        GeometryDrawAdd(Geometry, List, Key, CurrMesh, LodId, InstanceId);
+    }
+
+    GeometryDrawListsUpload(Geometry);
 }
 
 //
@@ -107,11 +853,15 @@ DEMO_INIT(Init)
             InitParams.ValidationEnabled = true;
             InitParams.WindowWidth = WindowWidth;
             InitParams.WindowHeight = WindowHeight;
-            InitParams.StagingBufferSize = MegaBytes(400);
+            // NOTE: Only per frame globals, draw commands and the built in meshes go through here. Assets stream through their own
+            // ring and per instance data gets written into mapped buffers (see growable.h)
+            InitParams.StagingBufferSize = MegaBytes(64);
             InitParams.DeviceExtensionCount = ArrayCount(DeviceExtensions);
             InitParams.DeviceExtensions = DeviceExtensions;
             VkInit(VulkanLib, hInstance, WindowHandle, &DemoState->Arena, &DemoState->TempArena, InitParams);
         }
+
+        DemoDeviceCapsGet(RenderState->PhysicalDevice, &DemoState->DeviceCaps);
     }
     
     // NOTE: Create samplers
@@ -124,26 +874,6 @@ DEMO_INIT(Init)
     DemoState->SwapChainEntry = RenderTargetSwapChainEntryCreate(RenderState->WindowWidth, RenderState->WindowHeight,
                                                                  RenderState->SwapChainFormat);
 
-    // NOTE: Copy To Swap RT
-    {
-        render_target_builder Builder = RenderTargetBuilderBegin(&DemoState->Arena, &DemoState->TempArena, RenderState->WindowWidth,
-                                                                 RenderState->WindowHeight);
-        RenderTargetAddTarget(&Builder, &DemoState->SwapChainEntry, VkClearColorCreate(0, 0, 0, 1));
-                            
-        vk_render_pass_builder RpBuilder = VkRenderPassBuilderBegin(&DemoState->TempArena);
-        u32 ColorId = VkRenderPassAttachmentAdd(&RpBuilder, RenderState->SwapChainFormat, VK_ATTACHMENT_LOAD_OP_CLEAR,
-                                                VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_UNDEFINED,
-                                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-        VkRenderPassSubPassBegin(&RpBuilder, VK_PIPELINE_BIND_POINT_GRAPHICS);
-        VkRenderPassColorRefAdd(&RpBuilder, ColorId, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        VkRenderPassSubPassEnd(&RpBuilder);
-
-        DemoState->CopyToSwapTarget = RenderTargetBuilderEnd(&Builder, VkRenderPassBuilderEnd(&RpBuilder, RenderState->Device));
-        DemoState->CopyToSwapPipeline = FullScreenCopyImageCreate(DemoState->CopyToSwapTarget.RenderPass, 0);
-        DemoState->CopyToSwapDesc = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, RenderState->CopyImageDescLayout);
-    }
-
     // NOTE: Init scene system
     {
         render_scene* Scene = &DemoState->Scene;
@@ -155,38 +885,72 @@ DEMO_INIT(Init)
                                             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                             sizeof(scene_globals));
 
-        Scene->MaxNumRenderMeshes = 1000;
-        Scene->RenderMeshes = PushArray(&DemoState->Arena, render_mesh, Scene->MaxNumRenderMeshes);
-
-        Scene->MaxNumOpaqueInstances = 1000;
-        Scene->OpaqueInstances = PushArray(&DemoState->Arena, instance_entry, Scene->MaxNumOpaqueInstances);
-        Scene->OpaqueInstanceBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                     sizeof(gpu_instance_entry)*Scene->MaxNumOpaqueInstances);
+        // NOTE: A scene file sizes the scene to fit, the built in meshes/instances/lights still fit on top of it
+#if !SHADOW_REGRESSION
+        SceneFileOpen(SCENE_FILE_NAME, &DemoState->SceneFile);
+#endif
+        scene_file_header FileTotals = {};
+        if (DemoState->SceneFile.Loaded)
+        {
+            FileTotals = *DemoState->SceneFile.Header;
+        }
         
-        Scene->MaxNumPointLights = 1000;
-        Scene->PointLights = PushArray(&DemoState->Arena, point_light, Scene->MaxNumPointLights);
-        Scene->PointLightBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                 sizeof(point_light)*Scene->MaxNumPointLights);
-        Scene->PointLightTransforms = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                     sizeof(m4)*Scene->MaxNumPointLights);
+        // NOTE: Containers start out sized to the file and grow from there (growable.h), VirtualAlloc hands out zeroed pages
+        Scene->MaxNumRenderMeshes = GrowableCapacityGet(0, FileTotals.NumMeshes);
+        Scene->RenderMeshes = GrowableArrayResizeType(&DemoState->Growable, Scene->RenderMeshes, render_mesh, 0, Scene->MaxNumRenderMeshes);
+        Scene->MaxNumOpaqueInstances = GrowableCapacityGet(0, FileTotals.NumInstances);
+        Scene->OpaqueInstances = GrowableArrayResizeType(&DemoState->Growable, Scene->OpaqueInstances, instance_entry, 0,
+                                                         Scene->MaxNumOpaqueInstances);
+        Scene->MaxNumPointLights = GrowableCapacityGet(0, FileTotals.NumPointLights);
+        Scene->PointLights = GrowableArrayResizeType(&DemoState->Growable, Scene->PointLights, point_light, 0, Scene->MaxNumPointLights);
 
         Scene->DirectionalLight.Globals = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                                          sizeof(directional_light_gpu));
-        Scene->DirectionalLight.ShadowTransforms = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
-                                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                                  sizeof(m4)*Scene->MaxNumOpaqueInstances);
+        // NOTE: Vertices and indices don't grow, meshes that don't fit fail to add (see geometry_buffer.h)
+        GeometryBufferCreate(&DemoState->Growable, 512*1024 + u64(FileTotals.NumVertices), 2*1024*1024 + FileTotals.NumIndices16,
+                             512*1024 + FileTotals.NumIndices32, 2*Scene->MaxNumOpaqueInstances, &Scene->Geometry);
+        SceneBvhCreate(&DemoState->Growable, Scene->MaxNumOpaqueInstances, &Scene->Bvh);
+        // NOTE: The forward state doesn't exist yet, it sizes itself off GpuMaxNumOpaqueInstances
+        SceneInstanceCapacityResize(&DemoState->Growable, VK_NULL_HANDLE, Scene, 0, Scene->MaxNumOpaqueInstances);
+        ScenePointLightCapacityResize(&DemoState->Growable, Scene, Scene->MaxNumPointLights);
         
         // NOTE: Create general descriptor set layouts
         {
+            // NOTE: The layout builder doesn't know about binding flags, so the bindless material layout gets built by hand. Without
+            // bindless the same bindings hold a single texture and none of the flags
+            Scene->MaterialBindless = DemoState->DeviceCaps.Bindless;
             {
-                vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Scene->MaterialDescLayout);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
-                VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
-                VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+                VkDescriptorSetLayoutBinding Bindings[2] = {};
+                Bindings[0].binding = 0;
+                Bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                Bindings[0].descriptorCount = 1;
+                Bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+                Bindings[1].binding = 1;
+                Bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                Bindings[1].descriptorCount = Scene->MaterialBindless ? MATERIAL_MAX_TEXTURES : 1;
+                Bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+                VkDescriptorBindingFlagsEXT BindingFlags[2] =
+                    {
+                        0,
+                        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+                    };
+                VkDescriptorSetLayoutBindingFlagsCreateInfoEXT FlagsCreateInfo = {};
+                FlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+                FlagsCreateInfo.bindingCount = ArrayCount(BindingFlags);
+                FlagsCreateInfo.pBindingFlags = BindingFlags;
+                
+                VkDescriptorSetLayoutCreateInfo CreateInfo = {};
+                CreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                if (Scene->MaterialBindless)
+                {
+                    CreateInfo.pNext = &FlagsCreateInfo;
+                    CreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+                }
+                CreateInfo.bindingCount = ArrayCount(Bindings);
+                CreateInfo.pBindings = Bindings;
+                VkCheckResult(vkCreateDescriptorSetLayout(RenderState->Device, &CreateInfo, 0, &Scene->MaterialDescLayout));
             }
 
             {
@@ -201,73 +965,147 @@ DEMO_INIT(Init)
             }
         }
 
+        // NOTE: Bindless material set, it needs its own update after bind pool. Without bindless the pool holds the per material sets
+        // that SceneMaterialAdd allocates
+        {
+            u32 MaxNumSets = Scene->MaterialBindless ? 1 : GROWABLE_FRAMES_IN_FLIGHT*MATERIAL_MAX_MATERIALS;
+            VkDescriptorPoolSize PoolSizes[2] = {};
+            PoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            PoolSizes[0].descriptorCount = MaxNumSets;
+            PoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            PoolSizes[1].descriptorCount = Scene->MaterialBindless ? MATERIAL_MAX_TEXTURES : MaxNumSets;
+
+            VkDescriptorPoolCreateInfo PoolCreateInfo = {};
+            PoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            PoolCreateInfo.flags = Scene->MaterialBindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+            PoolCreateInfo.maxSets = MaxNumSets;
+            PoolCreateInfo.poolSizeCount = ArrayCount(PoolSizes);
+            PoolCreateInfo.pPoolSizes = PoolSizes;
+            VkCheckResult(vkCreateDescriptorPool(RenderState->Device, &PoolCreateInfo, 0, &Scene->MaterialDescPool));
+
+            Scene->MaterialBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   sizeof(material_gpu)*MATERIAL_MAX_MATERIALS);
+            if (Scene->MaterialBindless)
+            {
+                Scene->MaterialDescriptor = VkDescriptorSetAllocate(RenderState->Device, Scene->MaterialDescPool, Scene->MaterialDescLayout);
+                VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->MaterialDescriptor, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->MaterialBuffer);
+            }
+        }
+        
         // NOTE: Populate descriptors
-        Scene->SceneDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Scene->SceneDescLayout);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Scene->SceneBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->OpaqueInstanceBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->PointLightBuffer);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->PointLightTransforms);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->DirectionalLight.Globals);
-        VkDescriptorBufferWrite(&RenderState->DescriptorManager, Scene->SceneDescriptor, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, Scene->DirectionalLight.ShadowTransforms);
+        for (u32 FrameSlot = 0; FrameSlot < GROWABLE_FRAMES_IN_FLIGHT; ++FrameSlot)
+        {
+            Scene->SceneDescriptors[FrameSlot] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Scene->SceneDescLayout);
+            SceneDescriptorWrite(Scene, FrameSlot);
+        }
+        Scene->SceneDescriptorsDirty = 0;
+        Scene->SceneDescriptor = Scene->SceneDescriptors[0];
     }
 
     // NOTE: Create render data
     DemoState->ShadowMode = ShadowMode_Variance;
     DemoState->ShadowResX = 512;
     DemoState->ShadowResY = 512;
-    DemoState->ShadowWorldDim = 1.0f;
     DemoState->ShadowView = V3(0.4f, -1.0f, 0.0f);
-    DemoState->SwapChainFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    if (DemoState->SceneFile.Loaded)
+    {
+        // NOTE: Start out with the files light, the UI can still move it around
+        DemoState->ShadowView = DemoState->SceneFile.Header->DirectionalLight.Dir;
+    }
+    AsyncComputeCreate(&DemoState->AsyncCompute);
+    RenderGraphCreate(&DemoState->Growable, DemoState->AsyncCompute.Dedicated, &DemoState->RenderGraph);
     {
         renderer_create_info CreateInfo = {};
         CreateInfo.Width = RenderState->WindowWidth; //710;
         CreateInfo.Height = RenderState->WindowHeight; //400;
-        CreateInfo.ColorFormat = DemoState->SwapChainFormat;
+        CreateInfo.ColorFormat = RenderState->SwapChainFormat;
+        CreateInfo.ColorEntry = &DemoState->SwapChainEntry;
         CreateInfo.MaterialDescLayout = DemoState->Scene.MaterialDescLayout;
         CreateInfo.SceneDescLayout = DemoState->Scene.SceneDescLayout;
         CreateInfo.Scene = &DemoState->Scene;
-        ForwardCreate(CreateInfo, &DemoState->CopyToSwapDesc, DemoState->ShadowResX, DemoState->ShadowResY, &DemoState->ForwardState);
+#if SHADOW_REGRESSION
+        // NOTE: Render offscreen so that the image can be read back
+        RegressionCreate(CreateInfo.Width, CreateInfo.Height, &DemoState->Regression);
+        CreateInfo.ColorFormat = REGRESSION_COLOR_FORMAT;
+        CreateInfo.ColorEntry = &DemoState->Regression.ColorEntry;
+#endif
+        ForwardCreate(CreateInfo, DemoState->ShadowResX, DemoState->ShadowResY, &DemoState->ForwardState);
     }
+    CpuRasterCreate(&DemoState->CpuRaster);
+#if !SHADOW_REGRESSION
+    // NOTE: Regression runs keep checking every frame, the shaders don't change while they run
+    ShaderReloadCreate(&DemoState->ShaderReload);
+#endif
     
-    // NOTE: Upload assets
+    // NOTE: Upload assets, everything big gets requested from the stream and shows up over the next frames. The regression warmup
+    // covers the few frames the built in scene takes
+    AssetStreamCreate(DemoState->AsyncCompute.GraphicsFamilyId, &DemoState->AssetStream);
     vk_commands Commands = RenderState->Commands;
     VkCommandsBegin(RenderState->Device, Commands);
     {
         render_scene* Scene = &DemoState->Scene;
         
-        // NOTE: Push textures
-        vk_image WhiteTexture = {};
+        // NOTE: Placeholder for textures that are still streaming in, tiny enough to go through the transfer manager
         {
-            u32 Texels[] =
-            {
-                0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 
-                0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF,
-                0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 
-                0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF,
-                0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 
-                0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF,
-                0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 
-                0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF,
-            };
+            u32 Texel = 0xFF808080;
+            Scene->PlaceholderTexture = VkImageCreate(RenderState->Device, &RenderState->GpuArena, 1, 1, VK_FORMAT_R8G8B8A8_UNORM,
+                                                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+            u8* GpuMemory = VkTransferPushWriteImage(&RenderState->TransferManager, Scene->PlaceholderTexture.Image, 1, 1, sizeof(u32),
+                                                     VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                     BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+                                                     BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+            Copy(&Texel, GpuMemory, sizeof(u32));
+        }
 
+        // NOTE: Stream textures
+        u32 WhiteTextureTicket = AssetStreamTicketCreate(&DemoState->AssetStream);
+        vk_image WhiteTexture = {};
+        {
             u32 Dim = 8;
-            u32 ImageSize = Dim*Dim*sizeof(u32);
             WhiteTexture = VkImageCreate(RenderState->Device, &RenderState->GpuArena, Dim, Dim, VK_FORMAT_R8G8B8A8_UNORM,
                                          VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+            AssetStreamImageRequest(&DemoState->AssetStream, WhiteTextureTicket, WhiteTexture.Image, VK_IMAGE_ASPECT_COLOR_BIT, 0, Dim, Dim,
+                                    1, sizeof(u32), SceneCheckerLoad, (void*)u64(Dim), 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                    VK_ACCESS_SHADER_READ_BIT);
+        }
 
-            // TODO: Better barrier here pls
-            u8* GpuMemory = VkTransferPushWriteImage(&RenderState->TransferManager, WhiteTexture.Image, Dim, Dim, ImageSize,
-                                                     VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                     BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
-                                                     BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-
-            Copy(Texels, GpuMemory, ImageSize);
+        // NOTE: Push materials
+        {
+            u32 WhiteTextureId = SceneTextureStream(Scene, WhiteTexture, DemoState->PointSampler, WhiteTextureTicket);
+            DemoState->WhiteMaterial = SceneMaterialAdd(Scene, WhiteTextureId, WhiteTextureId);
+#if SHADOW_REGRESSION
+            // NOTE: Golden images don't depend on files next to the exe
+            DemoState->TestMaterial = DemoState->WhiteMaterial;
+#else
+            // NOTE: The test.dds in the repo root is single channel float, it gets rejected as albedo and the sphere stays white
+            // until a color file replaces it
+            DemoState->TestMaterial = SceneMaterialFileAdd(Scene, &DemoState->AssetStream, TEXTURE_TEST_FILE_NAME, 0, DemoState->AnisoSampler,
+                                                           WhiteTextureId);
+            if (DemoState->TestMaterial == 0xFFFFFFFF)
+            {
+                DemoState->TestMaterial = DemoState->WhiteMaterial;
+            }
+#endif
         }
                         
         // NOTE: Push meshes
-        DemoState->Quad = SceneMeshAdd(Scene, WhiteTexture, WhiteTexture, AssetsPushQuad());
-        DemoState->Cube = SceneMeshAdd(Scene, WhiteTexture, WhiteTexture, AssetsPushCube());
-        DemoState->Sphere = SceneMeshAdd(Scene, WhiteTexture, WhiteTexture, AssetsPushSphere(64, 64));
+        {
+            mesh Quad = MeshQuadCreate(&DemoState->Arena);
+            mesh Cube = MeshCubeCreate(&DemoState->Arena);
+            mesh Sphere = MeshSphereCreate(&DemoState->Arena, 64, 64);
+            DemoState->Quad = SceneMeshAdd(Scene, &Quad);
+            DemoState->Cube = SceneMeshAdd(Scene, &Cube);
+            DemoState->Sphere = SceneMeshAdd(Scene, &Sphere);
+            // NOTE: The geometry buffer always has room for these on top of the scene file, and they get the first mesh ids. File
+            // meshes past DRAW_KEY_MAX_MESHES get left out like the ones that don't fit into the geometry buffer
+            Assert(DemoState->Quad != 0xFFFFFFFF && DemoState->Cube != 0xFFFFFFFF && DemoState->Sphere != 0xFFFFFFFF);
+
+            if (DemoState->SceneFile.Loaded)
+            {
+                SceneFileMeshesAdd(&DemoState->Arena, Scene, &DemoState->AssetStream, &DemoState->SceneFile);
+            }
+        }
 
         UiStateCreate(RenderState->Device, &DemoState->Arena, &DemoState->TempArena, RenderState->LocalMemoryId,
                       &RenderState->DescriptorManager, &RenderState->PipelineManager, &RenderState->TransferManager,
@@ -282,6 +1120,18 @@ DEMO_INIT(Init)
 
 DEMO_DESTROY(Destroy)
 {
+    ShaderReloadDestroy(&DemoState->ShaderReload);
+    AssetStreamDestroy(&DemoState->AssetStream);
+    for (u32 StreamedId = 0; StreamedId < DemoState->Scene.NumStreamedTextures; ++StreamedId)
+    {
+        TextureFileClose(&DemoState->Scene.StreamedTextures[StreamedId].File);
+    }
+    VkCheckResult(vkDeviceWaitIdle(RenderState->Device));
+    for (u32 TextureId = 0; TextureId < DemoState->Scene.NumFileTextures; ++TextureId)
+    {
+        TextureFileImageDestroy(DemoState->Scene.FileTextures + TextureId);
+    }
+    SceneFileClose(&DemoState->SceneFile);
 }
 
 DEMO_SWAPCHAIN_CHANGE(SwapChainChange)
@@ -293,9 +1143,12 @@ DEMO_SWAPCHAIN_CHANGE(SwapChainChange)
     DemoState->SwapChainEntry.Height = RenderState->WindowHeight;
 
     DemoState->Scene.Camera.PerspAspectRatio = f32(RenderState->WindowWidth / RenderState->WindowHeight);
-    
-    ForwardSwapChainChange(&DemoState->ForwardState, RenderState->WindowWidth, RenderState->WindowHeight,
-                           DemoState->SwapChainFormat, &DemoState->Scene, &DemoState->CopyToSwapDesc);
+
+#if SHADOW_REGRESSION
+    RegressionResize(&DemoState->Regression, RenderState->WindowWidth, RenderState->WindowHeight);
+#endif
+    ForwardTransientsCreate(&DemoState->ForwardState, RenderState->WindowWidth, RenderState->WindowHeight);
+    ForwardTransientsFit(&DemoState->ForwardState);
 }
 
 DEMO_CODE_RELOAD(CodeReload)
@@ -317,13 +1170,28 @@ DEMO_MAIN_LOOP(MainLoop)
                                         VK_NULL_HANDLE, &ImageIndex));
     DemoState->SwapChainEntry.View = RenderState->SwapChainViews[ImageIndex];
 
+    // NOTE: Last frame copied the GPU shadow map for the reference rasterizer
+    if (DemoState->CpuRaster.ReadbackPending)
+    {
+        CpuRasterDiff(&DemoState->CpuRaster);
+    }
+    
     vk_commands Commands = RenderState->Commands;
     VkCommandsBegin(RenderState->Device, Commands);
+    GrowableFrameBegin(&DemoState->Growable);
+    AssetStreamUpdate(&DemoState->AssetStream, Commands.Buffer);
+    SceneStreamUpdate(&DemoState->Scene, &DemoState->AssetStream);
+    GeometryFrameBegin(&DemoState->Scene.Geometry, &DemoState->Growable, &DemoState->AssetStream);
+    AsyncComputeFrameBegin(&DemoState->AsyncCompute);
+#if SHADOW_REGRESSION
+    RegressionFrameBegin(Commands.Buffer, &DemoState->Regression);
+#endif
 
     // NOTE: Update pipelines
-    VkPipelineUpdateShaders(RenderState->Device, &RenderState->CpuArena, &RenderState->PipelineManager);
+    ShaderReloadUpdate(&DemoState->ShaderReload);
 
-    RenderTargetUpdateEntries(&DemoState->TempArena, &DemoState->CopyToSwapTarget);
+    RenderTargetUpdateEntries(&DemoState->TempArena, &DemoState->ForwardState.ForwardRenderTarget);
+    RenderTargetUpdateEntries(&DemoState->TempArena, &DemoState->ForwardState.ForwardPrepassRenderTarget);
 
     // NOTE: Update Ui State
     {
@@ -365,16 +1233,27 @@ DEMO_MAIN_LOOP(MainLoop)
                 StandardShadowResize(&DemoState->ForwardState.StandardShadow, u32(ResolutionX), u32(ResolutionY));
                 StandardShadowResize(&DemoState->ForwardState.PcfShadow, u32(ResolutionX), u32(ResolutionY));
                 VarianceShadowResize(&DemoState->ForwardState.VarianceShadow, u32(ResolutionX), u32(ResolutionY));
+                ForwardTransientsFit(&DemoState->ForwardState);
             }
             
             DemoState->ShadowResX = u32(ResolutionX);
             DemoState->ShadowResY = u32(ResolutionY);
-            
+
+            local_global f32 VarianceSupersample = 0.0f;
+            local_global u32 VarianceSupersampleLevel = 0;
             UiPanelNextRowIndent(&Panel);
-            UiPanelText(&Panel, "World Dim:");
-            UiPanelHorizontalSlider(&Panel, 0.0f, 32.0f, &DemoState->ShadowWorldDim);
-            UiPanelNumberBox(&Panel, &DemoState->ShadowWorldDim);
+            UiPanelText(&Panel, "Variance Supersampling (1x/4x/8x):");
+            UiPanelHorizontalSlider(&Panel, 0.0f, 2.0f, &VarianceSupersample);
+            UiPanelNumberBox(&Panel, &VarianceSupersample);
             UiPanelNextRow(&Panel);
+            u32 Level = Min(u32(VarianceSupersample + 0.5f), 2u);
+            if (Level != VarianceSupersampleLevel)
+            {
+                u32 LevelSamples[] = { 1, 4, 8 };
+                VarianceShadowSamplesSet(&DemoState->ForwardState.VarianceShadow, LevelSamples[Level]);
+                ForwardTransientsFit(&DemoState->ForwardState);
+                VarianceSupersampleLevel = Level;
+            }
             
             UiPanelNextRowIndent(&Panel);
             UiPanelText(&Panel, "View X:");
@@ -393,6 +1272,304 @@ DEMO_MAIN_LOOP(MainLoop)
             UiPanelHorizontalSlider(&Panel, -1.0f, 1.0f, &DemoState->ShadowView.z);
             UiPanelNumberBox(&Panel, &DemoState->ShadowView.z);
             UiPanelNextRow(&Panel);
+
+            local_global f32 MaskMode = f32(DemoState->ForwardState.ShadowMask.Mode);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Shadow Mask (Off/Full/Half):");
+            UiPanelHorizontalSlider(&Panel, 0.0f, 2.0f, &MaskMode);
+            UiPanelNumberBox(&Panel, &MaskMode);
+            UiPanelNextRow(&Panel);
+            DemoState->ForwardState.ShadowMask.Mode = shadow_mask_mode(Min(u32(MaskMode + 0.5f), u32(ShadowMaskMode_Half)));
+
+            local_global f32 MaskTemporal = f32(DemoState->ForwardState.ShadowMask.Temporal);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Temporal Filter (Off/On):");
+            UiPanelHorizontalSlider(&Panel, 0.0f, 1.0f, &MaskTemporal);
+            UiPanelNumberBox(&Panel, &MaskTemporal);
+            UiPanelNextRow(&Panel);
+            DemoState->ForwardState.ShadowMask.Temporal = MaskTemporal >= 0.5f;
+        }
+
+        {
+            UiPanelText(&Panel, "Depth Prepass:");
+
+            local_global f32 PrepassMode = f32(DemoState->ForwardState.DepthPrepassMode);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Mode (Off/On/Auto):");
+            UiPanelHorizontalSlider(&Panel, 0.0f, 2.0f, &PrepassMode);
+            UiPanelNumberBox(&Panel, &PrepassMode);
+            UiPanelNextRow(&Panel);
+            DemoState->ForwardState.DepthPrepassMode = depth_prepass_mode(Min(u32(PrepassMode + 0.5f), u32(DepthPrepassMode_Auto)));
+
+            occlusion_culling* Occlusion = &DemoState->ForwardState.Occlusion;
+            if (Occlusion->Supported)
+            {
+                local_global f32 OcclusionEnabled = f32(Occlusion->Enabled);
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Occlusion Culling (Off/On):");
+                UiPanelHorizontalSlider(&Panel, 0.0f, 1.0f, &OcclusionEnabled);
+                UiPanelNumberBox(&Panel, &OcclusionEnabled);
+                UiPanelNextRow(&Panel);
+                Occlusion->Enabled = OcclusionEnabled >= 0.5f;
+            }
+            
+            // NOTE: Copies since the number boxes are editable
+            f32 Overdraw = DemoState->Scene.ForwardOverdraw;
+            f32 Active = f32(DemoState->ForwardState.DepthPrepassActive);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Est. Overdraw:");
+            UiPanelNumberBox(&Panel, &Overdraw);
+            UiPanelText(&Panel, "Active:");
+            UiPanelNumberBox(&Panel, &Active);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Device Caps (supported, used):");
+
+            // NOTE: Copies since the number boxes are editable
+            demo_device_caps* Caps = &DemoState->DeviceCaps;
+            f32 AsyncCompute[2] = { f32(Caps->Supported.ComputeFamily && Caps->Supported.TimelineSemaphore), f32(DemoState->AsyncCompute.Dedicated) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Async Compute:");
+            UiPanelNumberBox(&Panel, &AsyncCompute[0]);
+            UiPanelNumberBox(&Panel, &AsyncCompute[1]);
+            UiPanelNextRow(&Panel);
+
+            f32 Transfer[2] = { f32(Caps->Supported.TransferFamily), f32(DemoState->AssetStream.Dedicated) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Transfer Queue:");
+            UiPanelNumberBox(&Panel, &Transfer[0]);
+            UiPanelNumberBox(&Panel, &Transfer[1]);
+            UiPanelNextRow(&Panel);
+
+            geometry_buffer* Geometry = &DemoState->Scene.Geometry;
+            f32 MultiDraw[2] = { f32(Caps->Supported.MultiDrawIndirect), f32(Geometry->MultiDrawIndirect) };
+            f32 FirstInstance[2] = { f32(Caps->Supported.DrawIndirectFirstInstance), f32(Geometry->IndirectFirstInstance) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Multi Draw Indirect:");
+            UiPanelNumberBox(&Panel, &MultiDraw[0]);
+            UiPanelNumberBox(&Panel, &MultiDraw[1]);
+            UiPanelText(&Panel, "First Instance:");
+            UiPanelNumberBox(&Panel, &FirstInstance[0]);
+            UiPanelNumberBox(&Panel, &FirstInstance[1]);
+            UiPanelNextRow(&Panel);
+
+            f32 Bindless[2] = { f32(Caps->Supported.Bindless), f32(DemoState->Scene.MaterialBindless) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Bindless:");
+            UiPanelNumberBox(&Panel, &Bindless[0]);
+            UiPanelNumberBox(&Panel, &Bindless[1]);
+            UiPanelNextRow(&Panel);
+
+            f32 DrawCount[2] = { f32(Caps->Supported.DrawIndirectCount), f32(DemoState->ForwardState.Occlusion.Compact) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Draw Indirect Count:");
+            UiPanelNumberBox(&Panel, &DrawCount[0]);
+            UiPanelNumberBox(&Panel, &DrawCount[1]);
+            UiPanelNextRow(&Panel);
+
+            f32 TextureBC[2] = { f32(Caps->Supported.TextureCompressionBC), f32(Caps->TextureCompressionBC) };
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "BC Textures:");
+            UiPanelNumberBox(&Panel, &TextureBC[0]);
+            UiPanelNumberBox(&Panel, &TextureBC[1]);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Scene Capacity (count, capacity, high water):");
+
+            // NOTE: Copies since the number boxes are editable
+            render_scene* Scene = &DemoState->Scene;
+            f32 Instances[3] = { f32(Scene->NumOpaqueInstances), f32(Scene->GpuMaxNumOpaqueInstances), f32(Scene->HighWaterOpaqueInstances) };
+            f32 Lights[3] = { f32(Scene->NumPointLights), f32(Scene->GpuMaxNumPointLights), f32(Scene->HighWaterPointLights) };
+            f32 Meshes[3] = { f32(Scene->NumRenderMeshes), f32(Scene->MaxNumRenderMeshes), f32(Scene->HighWaterRenderMeshes) };
+            f32 NumGrows = f32(DemoState->Growable.NumGrows);
+            f32 CpuMegaBytes = f32(DemoState->Growable.CpuBytes) / f32(MegaBytes(1));
+            f32 GpuMegaBytes = f32(DemoState->Growable.GpuBytes) / f32(MegaBytes(1));
+            
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Instances:");
+            UiPanelNumberBox(&Panel, &Instances[0]);
+            UiPanelNumberBox(&Panel, &Instances[1]);
+            UiPanelNumberBox(&Panel, &Instances[2]);
+            UiPanelNextRow(&Panel);
+            
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Point Lights:");
+            UiPanelNumberBox(&Panel, &Lights[0]);
+            UiPanelNumberBox(&Panel, &Lights[1]);
+            UiPanelNumberBox(&Panel, &Lights[2]);
+            UiPanelNextRow(&Panel);
+            
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Meshes:");
+            UiPanelNumberBox(&Panel, &Meshes[0]);
+            UiPanelNumberBox(&Panel, &Meshes[1]);
+            UiPanelNumberBox(&Panel, &Meshes[2]);
+            UiPanelNextRow(&Panel);
+
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Grows:");
+            UiPanelNumberBox(&Panel, &NumGrows);
+            UiPanelText(&Panel, "CPU/GPU MB:");
+            UiPanelNumberBox(&Panel, &CpuMegaBytes);
+            UiPanelNumberBox(&Panel, &GpuMegaBytes);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Asset Streaming:");
+
+            // NOTE: Copies since the number boxes are editable
+            asset_stream* Stream = &DemoState->AssetStream;
+            f32 NumPending = f32(u32(Stream->NumRequested) - Stream->NumResident + Stream->NumQueued);
+            f32 StreamedMegaBytes = f32(Stream->NumBytesStreamed) / f32(MegaBytes(1));
+            f32 Dedicated = f32(Stream->Dedicated);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Pending:");
+            UiPanelNumberBox(&Panel, &NumPending);
+            UiPanelText(&Panel, "MB:");
+            UiPanelNumberBox(&Panel, &StreamedMegaBytes);
+            UiPanelText(&Panel, "Transfer Queue:");
+            UiPanelNumberBox(&Panel, &Dedicated);
+            UiPanelNextRow(&Panel);
+
+            // NOTE: From opening the scene file until every mesh is resident and the static instances are in
+            f32 SceneLoadMs = DemoState->SceneFile.LoadMs;
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Scene Load ms:");
+            UiPanelNumberBox(&Panel, &SceneLoadMs);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Render Graph:");
+
+            // NOTE: Copies since the number boxes are editable
+            render_graph* Graph = &DemoState->RenderGraph;
+            f32 NumPassesCulled = f32(Graph->NumPassesCulled);
+            f32 NumBarrierBatches = f32(Graph->NumBarrierBatches);
+            f32 NumImageBarriers = f32(Graph->NumImageBarriers);
+            f32 AllocatedMegaBytes = f32(Graph->TransientHeapSize + Graph->TransientOverflowSize) / f32(MegaBytes(1));
+            f32 HeapMegaBytes = f32(Graph->TransientHeapUsed) / f32(MegaBytes(1));
+            f32 SumMegaBytes = f32(Graph->TransientSizeSum) / f32(MegaBytes(1));
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Culled:");
+            UiPanelNumberBox(&Panel, &NumPassesCulled);
+            UiPanelText(&Panel, "Barriers:");
+            UiPanelNumberBox(&Panel, &NumBarrierBatches);
+            UiPanelNumberBox(&Panel, &NumImageBarriers);
+            UiPanelNextRow(&Panel);
+            
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Transient MB (allocated, aliased, unaliased):");
+            UiPanelNumberBox(&Panel, &AllocatedMegaBytes);
+            UiPanelNumberBox(&Panel, &HeapMegaBytes);
+            UiPanelNumberBox(&Panel, &SumMegaBytes);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Shader Reload:");
+
+            shader_reload* Reload = &DemoState->ShaderReload;
+            f32 Watching = f32(Reload->Active);
+            f32 NumReloads = f32(Reload->NumReloads);
+            f32 NumCompiles = f32(Reload->NumCompiles);
+            f32 NumCompilesFailed = f32(Reload->NumCompilesFailed);
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Watching:");
+            UiPanelNumberBox(&Panel, &Watching);
+            UiPanelText(&Panel, "Reloads:");
+            UiPanelNumberBox(&Panel, &NumReloads);
+            UiPanelText(&Panel, "Compiles:");
+            UiPanelNumberBox(&Panel, &NumCompiles);
+            UiPanelText(&Panel, "Failed:");
+            UiPanelNumberBox(&Panel, &NumCompilesFailed);
+            UiPanelNextRow(&Panel);
+        }
+
+        {
+            UiPanelText(&Panel, "Mesh Cache (ACMR/ATVR, before -> after):");
+
+            for (u32 MeshId = 0; MeshId < DemoState->Scene.NumRenderMeshes; ++MeshId)
+            {
+                render_mesh* CurrMesh = DemoState->Scene.RenderMeshes + MeshId;
+                if (!CurrMesh->Allocated)
+                {
+                    continue;
+                }
+
+                // NOTE: Copies since the number boxes are editable
+                f32 MeshIdValue = f32(MeshId);
+                f32 AcmrBefore = CurrMesh->CacheStatsBefore.Acmr;
+                f32 AcmrAfter = CurrMesh->CacheStatsAfter.Acmr;
+                f32 AtvrBefore = CurrMesh->CacheStatsBefore.Atvr;
+                f32 AtvrAfter = CurrMesh->CacheStatsAfter.Atvr;
+                
+                UiPanelNextRowIndent(&Panel);
+                UiPanelText(&Panel, "Mesh:");
+                UiPanelNumberBox(&Panel, &MeshIdValue);
+                UiPanelText(&Panel, "ACMR:");
+                UiPanelNumberBox(&Panel, &AcmrBefore);
+                UiPanelNumberBox(&Panel, &AcmrAfter);
+                UiPanelText(&Panel, "ATVR:");
+                UiPanelNumberBox(&Panel, &AtvrBefore);
+                UiPanelNumberBox(&Panel, &AtvrAfter);
+                UiPanelNextRow(&Panel);
+            }
+        }
+
+        {
+            UiPanelText(&Panel, "CPU Reference Raster (Standard/PCF):");
+
+            // NOTE: Acts as a button, every request renders and diffs one frame
+            local_global f32 DiffRequest = 0.0f;
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Run Diff:");
+            UiPanelHorizontalSlider(&Panel, 0.0f, 1.0f, &DiffRequest);
+            UiPanelNextRow(&Panel);
+            if (DiffRequest >= 0.5f)
+            {
+                DemoState->CpuRaster.DiffRequested = true;
+                DiffRequest = 0.0f;
+            }
+
+            // NOTE: Copies since the number boxes are editable
+            cpu_raster_stats* Stats = &DemoState->CpuRaster.Stats;
+            cpu_raster_diff* Diff = &DemoState->CpuRaster.Diff;
+            f32 Threads = f32(Stats->NumThreads);
+            f32 Avx2 = f32(Stats->Avx2);
+            f32 MTrisPerSecond = Stats->TrianglesPerSecond / 1000000.0f;
+            f32 TotalMs = Stats->TotalMs;
+            f32 ExactPercent = Diff->Valid ? 100.0f * f32(Diff->NumExact) / f32(Diff->NumTexels) : 0.0f;
+            f32 CoverageMismatches = f32(Diff->NumCoverageMismatches);
+            f32 MaxDepthError = Diff->MaxDepthError;
+
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Threads:");
+            UiPanelNumberBox(&Panel, &Threads);
+            UiPanelText(&Panel, "AVX2:");
+            UiPanelNumberBox(&Panel, &Avx2);
+            UiPanelNextRow(&Panel);
+
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "MTris/s:");
+            UiPanelNumberBox(&Panel, &MTrisPerSecond);
+            UiPanelText(&Panel, "Total ms:");
+            UiPanelNumberBox(&Panel, &TotalMs);
+            UiPanelNextRow(&Panel);
+
+            UiPanelNextRowIndent(&Panel);
+            UiPanelText(&Panel, "Exact %:");
+            UiPanelNumberBox(&Panel, &ExactPercent);
+            UiPanelText(&Panel, "Coverage Diffs:");
+            UiPanelNumberBox(&Panel, &CoverageMismatches);
+            UiPanelText(&Panel, "Max Depth Error:");
+            UiPanelNumberBox(&Panel, &MaxDepthError);
+            UiPanelNextRow(&Panel);
         }
 
         switch (DemoState->ShadowMode)
@@ -420,25 +1597,45 @@ DEMO_MAIN_LOOP(MainLoop)
 
         UiStateEnd(UiState, &RenderState->DescriptorManager);
     }
+
+#if SHADOW_REGRESSION
+    // NOTE: Overrides whatever the UI set
+    RegressionCaseApply(&DemoState->Regression);
+#endif
     
     // NOTE: Upload scene data
     {
         render_scene* Scene = &DemoState->Scene;
-        Scene->NumOpaqueInstances = 0;
+        Scene->NumOpaqueInstances = Scene->NumStaticOpaqueInstances;
+        Scene->NumDynamicOpaqueInstances = 0;
         Scene->NumPointLights = 0;
+#if !SHADOW_REGRESSION
         if (!(DemoState->UiState.MouseTouchingUi || DemoState->UiState.ProcessedInteraction))
         {
             CameraUpdate(&Scene->Camera, CurrInput, PrevInput);
         }
+#endif
         
         // NOTE: Populate scene
         {
-            // NOTE: Add point lights
-            ScenePointLightAdd(Scene, V3(0.0f, 0.0f, -1.0f), V3(1.0f, 0.0f, 0.0f), 1);
-            ScenePointLightAdd(Scene, V3(-1.0f, 0.0f, 0.0f), V3(1.0f, 1.0f, 0.0f), 1);
-            ScenePointLightAdd(Scene, V3(0.0f, 1.0f, 1.0f), V3(1.0f, 0.0f, 1.0f), 1);
-            ScenePointLightAdd(Scene, V3(0.0f, -1.0f, 1.0f), V3(0.0f, 1.0f, 1.0f), 1);
-            ScenePointLightAdd(Scene, V3(-1.0f, 0.0f, -1.0f), V3(0.0f, 0.0f, 1.0f), 1);
+            v3 LightColor = V3(1.0f, 1.0f, 1.0f);
+            v3 AmbientColor = V3(0.15f);
+            if (DemoState->SceneFile.Loaded)
+            {
+                // NOTE: Materials aren't part of the file yet, everything gets the white material
+                SceneFilePopulate(Scene, &DemoState->SceneFile, DemoState->WhiteMaterial);
+                LightColor = DemoState->SceneFile.Header->DirectionalLight.Color;
+                AmbientColor = DemoState->SceneFile.Header->DirectionalLight.AmbientColor;
+            }
+            else
+            {
+                // NOTE: Add point lights
+                ScenePointLightAdd(Scene, V3(0.0f, 0.0f, -1.0f), V3(1.0f, 0.0f, 0.0f), 1);
+                ScenePointLightAdd(Scene, V3(-1.0f, 0.0f, 0.0f), V3(1.0f, 1.0f, 0.0f), 1);
+                ScenePointLightAdd(Scene, V3(0.0f, 1.0f, 1.0f), V3(1.0f, 0.0f, 1.0f), 1);
+                ScenePointLightAdd(Scene, V3(0.0f, -1.0f, 1.0f), V3(0.0f, 1.0f, 1.0f), 1);
+                ScenePointLightAdd(Scene, V3(-1.0f, 0.0f, -1.0f), V3(0.0f, 0.0f, 1.0f), 1);
+            }
 
             local_global f32 T = 0.0f;
             T += 0.001f;
@@ -447,11 +1644,6 @@ DEMO_MAIN_LOOP(MainLoop)
                 T = 0.0f;
             }
 
-            v3 LightDir = Normalize(DemoState->ShadowView);
-            f32 Radius = 0.5f*DemoState->ShadowWorldDim;
-            SceneDirectionalLightSet(Scene, LightDir, V3(1.0f, 1.0f, 1.0f), V3(0.15f),
-                                     V3(-Radius, -Radius, -10.0f), V3(Radius, Radius, 10.0f));
-            
             // NOTE: Add Instances
             {
 #if 0
@@ -465,35 +1657,60 @@ DEMO_MAIN_LOOP(MainLoop)
                         for (i32 X = -NumX; X <= NumX; ++X)
                         {
                             m4 Transform = M4Pos(V3(X, Y, Z)) * M4Scale(V3(0.25f));
-                            SceneOpaqueInstanceAdd(Scene, DemoState->Sphere, Transform);
+                            SceneOpaqueInstanceAdd(Scene, DemoState->Sphere, DemoState->WhiteMaterial, Transform, false);
                         }
                     }
                 }
 #endif
-                m4 Transform = M4Pos(V3(0.0f, 0.0f, 0.0f)) * M4Scale(V3(1.0f));
-                SceneOpaqueInstanceAdd(Scene, DemoState->Sphere, Transform);
-                
-                SceneOpaqueInstanceAdd(Scene, DemoState->Cube, M4Pos(V3(-3, 0, 0)) * M4Scale(V3(1, 10, 10)));
-                SceneOpaqueInstanceAdd(Scene, DemoState->Cube, M4Pos(V3(0, -3, 0)) * M4Scale(V3(10, 1, 10)));
+                if (!DemoState->SceneFile.Loaded)
+                {
+                    if (Scene->NumStaticOpaqueInstances == 0)
+                    {
+                        SceneOpaqueInstanceAdd(Scene, DemoState->Cube, DemoState->WhiteMaterial, M4Pos(V3(-3, 0, 0)) * M4Scale(V3(1, 10, 10)), true);
+                        SceneOpaqueInstanceAdd(Scene, DemoState->Cube, DemoState->WhiteMaterial, M4Pos(V3(0, -3, 0)) * M4Scale(V3(10, 1, 10)), true);
+                        SceneStaticInstancesEnd(Scene);
+                    }
+
+                    m4 Transform = M4Pos(V3(0.0f, 0.0f, 0.0f)) * M4Scale(V3(1.0f));
+                    SceneOpaqueInstanceAdd(Scene, DemoState->Sphere, DemoState->TestMaterial, Transform, false);
+                }
+
+                SceneDirectionalLightFit(Scene, Normalize(DemoState->ShadowView), LightColor, AmbientColor,
+                                         DemoState->ShadowResX, DemoState->ShadowResY);
+
+                // NOTE: Everything sized per instance has to fit the populated scene before we cull or upload
+                SceneCapacitySync(&DemoState->Growable, Commands.Buffer, Scene, &DemoState->ForwardState);
+
+                // NOTE: Cull against the camera and the fitted light volume
+                SceneBvhUpdate(&Scene->Bvh, Scene->OpaqueInstances, Scene->NumOpaqueInstances);
+                Scene->NumForwardVisible = SceneBvhCull(&Scene->Bvh, CameraGetVP(&Scene->Camera), Scene->ForwardVisible);
+                Scene->NumShadowVisible = SceneBvhCull(&Scene->Bvh, Scene->DirectionalLight.GpuData.VPTransform, Scene->ShadowVisible);
+                SceneLodSelect(Scene, f32(RenderState->WindowWidth), f32(RenderState->WindowHeight));
+                SceneDrawListsBuild(Scene);
+
+                // NOTE: Per instance data goes straight into this frames mapped buffers, the staging buffer doesn't scale with the scene
+                u32 FrameSlot = GrowableFrameSlot(&DemoState->Growable);
+                OcclusionUpload(&DemoState->ForwardState.Occlusion, Scene, FrameSlot);
+                ShadowMaskUpload(&DemoState->ForwardState.ShadowMask, Scene, DemoState->ShadowMode);
                 
-                gpu_instance_entry* GpuData = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->OpaqueInstanceBuffer, gpu_instance_entry, Scene->NumOpaqueInstances,
-                                                                       BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
-                                                                       BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+                gpu_instance_entry* GpuData = GrowableMappedArray(&Scene->OpaqueInstanceBuffer, FrameSlot, gpu_instance_entry);
 
+                m4 VPTransform = CameraGetVP(&Scene->Camera);
                 for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
                 {
                     GpuData[InstanceId].WTransform = Scene->OpaqueInstances[InstanceId].WTransform;
-                    GpuData[InstanceId].WVPTransform = Scene->OpaqueInstances[InstanceId].WVPTransform;
+                    GpuData[InstanceId].WVPTransform = VPTransform*Scene->OpaqueInstances[InstanceId].WTransform;
+                    GpuData[InstanceId].MaterialId = Scene->OpaqueInstances[InstanceId].MaterialId;
                 }
             }
         }        
         
         // NOTE: Push Point Lights
         {
-            point_light* PointLights = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->PointLightBuffer, point_light, Scene->MaxNumPointLights,
+            point_light* PointLights = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->PointLightBuffer.Buffer, point_light, Scene->GpuMaxNumPointLights,
                                                                 BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
                                                                 BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
-            m4* Transforms = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->PointLightTransforms, m4, Scene->NumPointLights,
+            m4* Transforms = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->PointLightTransforms.Buffer, m4, Scene->NumPointLights,
                                                       BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
                                                       BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
 
@@ -519,9 +1736,7 @@ DEMO_MAIN_LOOP(MainLoop)
             
             // NOTE: Copy shadow data
             {
-                m4* GpuData = VkTransferPushWriteArray(&RenderState->TransferManager, Scene->DirectionalLight.ShadowTransforms, m4, Scene->NumOpaqueInstances,
-                                                       BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
-                                                       BarrierMask(VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+                m4* GpuData = GrowableMappedArray(&Scene->DirectionalLight.ShadowTransforms, GrowableFrameSlot(&DemoState->Growable), m4);
                 for (u32 InstanceId = 0; InstanceId < Scene->NumOpaqueInstances; ++InstanceId)
                 {
                     GpuData[InstanceId] = Scene->OpaqueInstances[InstanceId].ShadowWVP;
@@ -529,6 +1744,12 @@ DEMO_MAIN_LOOP(MainLoop)
             }
         }
 
+        // NOTE: Clipmap levels follow the camera, this figures out which parts of them need to be re-rendered
+        if (DemoState->ShadowMode == ShadowMode_Clipmap)
+        {
+            ClipmapShadowUpdate(&DemoState->ForwardState.ClipmapShadow, Scene);
+        }
+
         // NOTE: Push Scene Globals
         {
             scene_globals* Data = VkTransferPushWriteStruct(&RenderState->TransferManager, Scene->SceneBuffer, scene_globals,
@@ -543,28 +1764,35 @@ DEMO_MAIN_LOOP(MainLoop)
     }
 
     // NOTE: Render Scene
-    ForwardRender(Commands, &DemoState->ForwardState, &DemoState->Scene, DemoState->ShadowMode);
+    RenderGraphBegin(&DemoState->RenderGraph);
+    ForwardRender(&DemoState->RenderGraph, &DemoState->AsyncCompute, &DemoState->ForwardState, &DemoState->Scene, DemoState->ShadowMode);
+
+    // NOTE: Rasterize the same shadow map on the CPU and grab the GPU one to diff against
+    if (DemoState->CpuRaster.DiffRequested &&
+        (DemoState->ShadowMode == ShadowMode_Standard || DemoState->ShadowMode == ShadowMode_Pcf))
+    {
+        standard_shadow_data* ShadowData = (DemoState->ShadowMode == ShadowMode_Standard ?
+                                            &DemoState->ForwardState.StandardShadow : &DemoState->ForwardState.PcfShadow);
+        CpuRasterRender(&DemoState->CpuRaster, &DemoState->Scene, ShadowData->Width, ShadowData->Height);
+        CpuRasterReadbackAdd(&DemoState->RenderGraph, &DemoState->CpuRaster, ShadowData->ShadowImageId, ShadowData->ShadowImage,
+                             ShadowData->Width, ShadowData->Height);
+        DemoState->CpuRaster.DiffRequested = false;
+    }
+
+    RenderGraphExecute(&DemoState->RenderGraph, &Commands);
+
+#if SHADOW_REGRESSION
+    RegressionFrameEnd(Commands, &DemoState->Regression);
+#endif
 
-    RenderTargetPassBegin(&DemoState->CopyToSwapTarget, Commands, RenderTargetRenderPass_SetViewPort | RenderTargetRenderPass_SetScissor);
-    FullScreenPassRender(Commands, DemoState->CopyToSwapPipeline, 1, &DemoState->CopyToSwapDesc);
-    RenderTargetPassEnd(Commands);
     UiStateRender(&DemoState->UiState, RenderState->Device, Commands, DemoState->SwapChainEntry.View);
         
     VkCheckResult(vkEndCommandBuffer(Commands.Buffer));
                     
     // NOTE: Render to our window surface
-    // NOTE: Tell queue where we render to surface to wait
-    VkPipelineStageFlags WaitDstMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo SubmitInfo = {};
-    SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    SubmitInfo.waitSemaphoreCount = 1;
-    SubmitInfo.pWaitSemaphores = &RenderState->ImageAvailableSemaphore;
-    SubmitInfo.pWaitDstStageMask = &WaitDstMask;
-    SubmitInfo.commandBufferCount = 1;
-    SubmitInfo.pCommandBuffers = &Commands.Buffer;
-    SubmitInfo.signalSemaphoreCount = 1;
-    SubmitInfo.pSignalSemaphores = &RenderState->FinishedRenderingSemaphore;
-    VkCheckResult(vkQueueSubmit(RenderState->GraphicsQueue, 1, &SubmitInfo, Commands.Fence));
+    // NOTE: Tell queue where we render to surface to wait (and on the compute queue if the frame got split)
+    AsyncComputeGraphicsSubmit(&DemoState->AsyncCompute, Commands, RenderState->ImageAvailableSemaphore,
+                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, RenderState->FinishedRenderingSemaphore);
     
     VkPresentInfoKHR PresentInfo = {};
     PresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -2,6 +2,12 @@
 
 #define VALIDATION 1
 
+// NOTE: VkInit's vkCreateDevice call gets our queues and features added in, see device_setup.h
+template <typename physical_device, typename create_info> create_info DemoDeviceCreateInfoGet(physical_device PhysicalDevice,
+                                                                                             create_info CreateInfo);
+#define vkCreateDevice(PhysicalDevice, CreateInfo, Allocator, Device) \
+    vkCreateDevice(PhysicalDevice, DemoDeviceCreateInfoGet(PhysicalDevice, CreateInfo), Allocator, Device)
+
 #include "framework_vulkan\framework_vulkan.h"
 
 /*
@@ -32,11 +38,30 @@ struct directional_light_gpu
     m4 VPTransform;
 };
 
+// NOTE: The texel size of the fitted light volume moves in 1/64th power of 2 steps (see SceneDirectionalLightFit)
+#define SHADOW_FIT_TEXEL_STEPS 64
+
+// NOTE: The snapped light volume. TexelStep is the log2 of the texel size in SHADOW_FIT_TEXEL_STEPS steps, origin and depth range
+// are in whole texels. Integers only, so the shadow caches can hash it and don't see float noise of the transform
+struct shadow_fit
+{
+    v3 LightDir;
+    i32 TexelStepX;
+    i32 TexelStepY;
+    i32 OriginX;
+    i32 OriginY;
+    i32 DepthMin;
+    i32 DepthMax;
+};
+
 struct shadow_directional_light
 {
     directional_light_gpu GpuData;
     VkBuffer Globals;
-    VkBuffer ShadowTransforms;
+    growable_mapped_buffer ShadowTransforms;
+    shadow_fit Fit;
+    // NOTE: World space size of a shadow map texel, used for shadow LOD selection
+    f32 TexelSize;
 };
 
 struct point_light
@@ -56,26 +81,106 @@ struct scene_globals
 struct instance_entry
 {
     u32 MeshId;
+    u32 MaterialId;
+    // NOTE: Static instances get baked into the cached shadow maps
+    b32 Static;
+    // NOTE: World space AABB
+    v3 BoundsMin;
+    v3 BoundsMax;
+    // NOTE: Largest axis scale, converts mesh space LOD errors to world space
+    f32 Scale;
+    u32 ForwardLod;
+    u32 ShadowLod;
     m4 ShadowWVP;
     m4 WTransform;
-    m4 WVPTransform;
 };
 
 struct gpu_instance_entry
 {
     m4 WTransform;
     m4 WVPTransform;
+    u32 MaterialId;
+    u32 Pad[3];
 };
 
+/*
+
+  NOTE: Bindless Materials
+
+    All textures live in one partially bound, update after bind array and materials are entries in a storage buffer that index into
+    it. Instances carry a material id, so the forward pass binds the material set once and never touches descriptors per draw. Adding
+    textures/materials only writes array elements and table entries, no descriptor sets get allocated.
+
+    IMPORTANT: Needs descriptorIndexing (descriptorBindingPartiallyBound, descriptorBindingSampledImageUpdateAfterBind,
+    shaderSampledImageArrayNonUniformIndexing), DemoDeviceCreate enables it where supported (DeviceCaps.Bindless). Without it every
+    material gets one set per frame in flight that holds just its color texture, the forward pass draws one command at a time and
+    rebinds the set whenever the material changes (shader_forward_*_bound_frag.spv). Those sets aren't update after bind, so
+    texture/material changes only mark them dirty and SceneCapacitySync rewrites the sets of a frame slot once the GPU is done with
+    them.
+
+    The texture count is part of the bindless set layout and the non bindless pool holds a set per material and frame slot, so the
+    texture and material tables don't grow. Texture files past MATERIAL_MAX_TEXTURES fall back like files we can't open, and
+    SceneMaterialAdd fails past MATERIAL_MAX_MATERIALS.
+  
+ */
+
+#define MATERIAL_MAX_TEXTURES 1024
+#define MATERIAL_MAX_MATERIALS 1024
+
+struct material_gpu
+{
+    u32 ColorTextureId;
+    u32 NormalTextureId;
+    u32 Pad0;
+    u32 Pad1;
+};
+
+#include "texture_file.h"
+
+struct streamed_texture
+{
+    u32 TextureId;
+    u32 StreamTicket;
+    vk_image Image;
+    VkSampler Sampler;
+    // NOTE: Only loaded for textures that come from a file, closed once the texture is resident
+    texture_file File;
+};
+
+#include "mesh.h"
+
 struct render_mesh
 {
-    vk_image Color;
-    vk_image Normal;
-    VkDescriptorSet MaterialDescriptor;
-    
-    VkBuffer VertexBuffer;
-    VkBuffer IndexBuffer;
+    // NOTE: Suballocated from the scenes geometry buffer, offsets are in vertices/indices
+    b32 Allocated;
+    u32 VertexOffset;
+    u32 NumVertices;
+    u32 IndexOffset;
     u32 NumIndices;
+    // NOTE: 16bit whenever the vertex count allows it
+    VkIndexType IndexType;
+    u32 NumLods;
+    mesh_lod Lods[MESH_MAX_LODS];
+
+    // NOTE: Local space bounds
+    v3 BoundsMin;
+    v3 BoundsMax;
+    v3 SphereCenter;
+    f32 SphereRadius;
+
+    // NOTE: Vertex cache efficiency of LOD 0 before and after optimizing, shown in the UI
+    mesh_cache_stats CacheStatsBefore;
+    mesh_cache_stats CacheStatsAfter;
+
+    // NOTE: Points into the CPU mesh or the mapped scene file for the reference rasterizer, so that memory has to outlive us.
+    // Indices of file meshes have the GPU width, CPU meshes always have 32bit indices
+    u8* CpuPositions;
+    u32 CpuPositionStride;
+    void* CpuIndices;
+    b32 CpuIndices16;
+
+    // NOTE: Streamed meshes don't get drawn until their ticket is resident, 0 for meshes uploaded in place
+    u32 StreamTicket;
 };
 
 struct render_scene;
@@ -84,13 +189,27 @@ struct renderer_create_info
     u32 Width;
     u32 Height;
     VkFormat ColorFormat;
+    render_target_entry* ColorEntry;
 
     VkDescriptorSetLayout MaterialDescLayout;
     VkDescriptorSetLayout SceneDescLayout;
     render_scene* Scene;
 };
 
+#include "device_setup.h"
+#include "growable.h"
+#include "asset_stream.h"
+#include "render_graph.h"
+#include "scene_bvh.h"
+#include "geometry_buffer.h"
+#include "async_compute.h"
+#include "occlusion.h"
+#include "shadow_mask.h"
 #include "forward.h"
+#include "cpu_raster.h"
+#include "regression.h"
+#include "scene_file.h"
+#include "shader_reload.h"
 
 struct render_scene
 {
@@ -99,33 +218,85 @@ struct render_scene
     VkDescriptorSetLayout MaterialDescLayout;
     VkDescriptorSetLayout SceneDescLayout;
     VkBuffer SceneBuffer;
+    // NOTE: SceneDescriptor is the set of the current frame, the others can still be in use
     VkDescriptorSet SceneDescriptor;
+    VkDescriptorSet SceneDescriptors[GROWABLE_FRAMES_IN_FLIGHT];
+    u32 SceneDescriptorsDirty;
 
     shadow_directional_light DirectionalLight;
     
-    // NOTE: Scene Lights
+    // NOTE: Scene Lights, the CPU array grows as lights get added and the GPU buffers catch up in SceneCapacitySync
     u32 MaxNumPointLights;
+    u32 GpuMaxNumPointLights;
+    u32 HighWaterPointLights;
     u32 NumPointLights;
     point_light* PointLights;
-    VkBuffer PointLightBuffer;
-    VkBuffer PointLightTransforms;
+    growable_buffer PointLightBuffer;
+    growable_buffer PointLightTransforms;
+    
+    // NOTE: Bindless materials
+    b32 MaterialBindless;
+    VkDescriptorPool MaterialDescPool;
+    VkDescriptorSet MaterialDescriptor;
+    // NOTE: Without bindless, MaterialDescriptors are the per material sets of the current frame slot
+    VkDescriptorSet* MaterialDescriptors;
+    VkDescriptorSet MaterialSlotDescriptors[GROWABLE_FRAMES_IN_FLIGHT][MATERIAL_MAX_MATERIALS];
+    u32 MaterialDescriptorsDirty;
+    VkDescriptorImageInfo TextureInfos[MATERIAL_MAX_TEXTURES];
+    u32 MaterialColorTextureIds[MATERIAL_MAX_MATERIALS];
+    u32 NumTextures;
+    // NOTE: Textures still streaming in point their slot at the placeholder
+    vk_image PlaceholderTexture;
+    u32 NumStreamedTextures;
+    streamed_texture StreamedTextures[MATERIAL_MAX_TEXTURES];
+    // NOTE: Images we allocated for texture files, freed on destroy
+    u32 NumFileTextures;
+    texture_file_image FileTextures[MATERIAL_MAX_TEXTURES];
+    u32 NumMaterials;
+    VkBuffer MaterialBuffer;
     
     // NOTE: Scene Meshes
     u32 MaxNumRenderMeshes;
     u32 NumRenderMeshes;
+    u32 HighWaterRenderMeshes;
     render_mesh* RenderMeshes;
+    geometry_buffer Geometry;
     
-    // NOTE: Opaque Instances
+    // NOTE: Opaque Instances, same as the lights everything sized per instance follows GpuMaxNumOpaqueInstances
     u32 MaxNumOpaqueInstances;
+    u32 GpuMaxNumOpaqueInstances;
+    u32 HighWaterOpaqueInstances;
     u32 NumOpaqueInstances;
+    u32 NumDynamicOpaqueInstances;
+    // NOTE: The first NumStaticOpaqueInstances instances stay in the scene across frames, only the ones after them get re-added every
+    // frame. StaticGeneration changes whenever the static ones do, so the shadow caches key off it instead of hashing every instance
+    u32 NumStaticOpaqueInstances;
+    u32 StaticGeneration;
     instance_entry* OpaqueInstances;
-    VkBuffer OpaqueInstanceBuffer;
+    growable_mapped_buffer OpaqueInstanceBuffer;
+
+    // NOTE: Culling, the visible lists hold instance ids
+    scene_bvh Bvh;
+    u32 NumForwardVisible;
+    u32* ForwardVisible;
+    u32 NumShadowVisible;
+    u32* ShadowVisible;
+    // NOTE: Estimated depth complexity of the forward pass, decides if the depth prepass pays off
+    f32 ForwardOverdraw;
+
+    // NOTE: Rebuilt every frame from the visible lists
+    geometry_draw_list ForwardDraws;
+    geometry_draw_list ShadowStaticDraws;
+    geometry_draw_list ShadowDynamicDraws;
 };
 
 struct demo_state
 {
     linear_arena Arena;
     linear_arena TempArena;
+
+    demo_device_setup DeviceSetup;
+    demo_device_caps DeviceCaps;
     
     // NOTE: Samplers
     VkSampler PointSampler;
@@ -133,27 +304,32 @@ struct demo_state
     VkSampler AnisoSampler;
     
     // NOTE: Render Target Entries
-    VkFormat SwapChainFormat;
     render_target_entry SwapChainEntry;
-    render_target CopyToSwapTarget;
-    VkDescriptorSet CopyToSwapDesc;
-    vk_pipeline* CopyToSwapPipeline;
 
+    growable_state Growable;
+    asset_stream AssetStream;
     render_scene Scene;
 
     // NOTE: Saved model ids
     u32 Quad;
     u32 Cube;
     u32 Sphere;
+    u32 WhiteMaterial;
+    u32 TestMaterial;
 
+    async_compute AsyncCompute;
+    render_graph RenderGraph;
     forward_state ForwardState;
+    cpu_raster CpuRaster;
+    regression_state Regression;
+    scene_file SceneFile;
+    shader_reload ShaderReload;
     ui_state UiState;
 
     // NOTE: Shadow values
     shadow_mode ShadowMode;
     u32 ShadowResX;
     u32 ShadowResY;
-    f32 ShadowWorldDim;
     v3 ShadowView;
 };
 
@@ -0,0 +1,322 @@
+
+//
+// NOTE: Screen Space Shadow Mask
+//
+
+inline void ShadowMaskHistoryDestroy(shadow_mask* Mask)
+{
+    if (Mask->HistoryMemory != VK_NULL_HANDLE)
+    {
+        for (u32 HistoryId = 0; HistoryId < 2; ++HistoryId)
+        {
+            vkDestroyImageView(RenderState->Device, Mask->HistoryEntries[HistoryId].View, 0);
+            vkDestroyImageView(RenderState->Device, Mask->HistoryDepthEntries[HistoryId].View, 0);
+            vkDestroyImage(RenderState->Device, Mask->HistoryImages[HistoryId], 0);
+            vkDestroyImage(RenderState->Device, Mask->HistoryDepthImages[HistoryId], 0);
+        }
+        vkFreeMemory(RenderState->Device, Mask->HistoryMemory, 0);
+        Mask->HistoryMemory = VK_NULL_HANDLE;
+    }
+}
+
+inline void ShadowMaskHistoryCreate(shadow_mask* Mask, u32 Width, u32 Height)
+{
+    // NOTE: Sized exactly for the window, a fixed arena would have to cover the largest window we might get
+    VkImage* Images[4] = { Mask->HistoryImages + 0, Mask->HistoryImages + 1, Mask->HistoryDepthImages + 0, Mask->HistoryDepthImages + 1 };
+    render_target_entry* Entries[4] = { Mask->HistoryEntries + 0, Mask->HistoryEntries + 1, Mask->HistoryDepthEntries + 0,
+                                        Mask->HistoryDepthEntries + 1 };
+    VkFormat Formats[4] = { VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32_SFLOAT };
+
+    u64 Offsets[4] = {};
+    u64 MemorySize = 0;
+    u32 MemoryTypeBits = 0xFFFFFFFF;
+    for (u32 ImageId = 0; ImageId < 4; ++ImageId)
+    {
+        VkImageCreateInfo ImageCreateInfo = {};
+        ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format = Formats[ImageId];
+        ImageCreateInfo.extent = { Width, Height, 1 };
+        ImageCreateInfo.mipLevels = 1;
+        ImageCreateInfo.arrayLayers = 1;
+        ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+        ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkCheckResult(vkCreateImage(RenderState->Device, &ImageCreateInfo, 0, Images[ImageId]));
+
+        VkMemoryRequirements Requirements;
+        vkGetImageMemoryRequirements(RenderState->Device, *Images[ImageId], &Requirements);
+        Offsets[ImageId] = (MemorySize + Requirements.alignment - 1) / Requirements.alignment * Requirements.alignment;
+        MemorySize = Offsets[ImageId] + Requirements.size;
+        MemoryTypeBits &= Requirements.memoryTypeBits;
+    }
+
+    VkMemoryAllocateInfo AllocateInfo = {};
+    AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    AllocateInfo.allocationSize = MemorySize;
+    AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(MemoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Mask->HistoryMemory));
+
+    for (u32 ImageId = 0; ImageId < 4; ++ImageId)
+    {
+        VkCheckResult(vkBindImageMemory(RenderState->Device, *Images[ImageId], Mask->HistoryMemory, Offsets[ImageId]));
+
+        VkImageViewCreateInfo ViewCreateInfo = {};
+        ViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ViewCreateInfo.image = *Images[ImageId];
+        ViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        ViewCreateInfo.format = Formats[ImageId];
+        ViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        ViewCreateInfo.subresourceRange.baseMipLevel = 0;
+        ViewCreateInfo.subresourceRange.levelCount = 1;
+        ViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        ViewCreateInfo.subresourceRange.layerCount = 1;
+
+        *Entries[ImageId] = RenderTargetSwapChainEntryCreate(Width, Height, Formats[ImageId]);
+        VkCheckResult(vkCreateImageView(RenderState->Device, &ViewCreateInfo, 0, &Entries[ImageId]->View));
+    }
+}
+
+inline void ShadowMaskResize(shadow_mask* Mask, render_graph* Graph, u32 Width, u32 Height, render_target_entry* DepthEntry)
+{
+    Mask->Width = Width;
+    Mask->Height = Height;
+    u32 HalfWidth = (Width + 1) / 2;
+    u32 HalfHeight = (Height + 1) / 2;
+
+    // NOTE: The mask lives until the forward pass, the half res images only within the mask pass. History carries over between frames
+    RenderGraphTransientCreate(Graph, &Mask->FullMaskImageId, Width, Height, VK_FORMAT_R8_UNORM,
+                               VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                               RenderGraphPass_ShadowMask, RenderGraphPass_Forward, &Mask->FullMaskImage, &Mask->FullMaskEntry);
+    RenderGraphTransientCreate(Graph, &Mask->HalfMaskImageId, HalfWidth, HalfHeight, VK_FORMAT_R8_UNORM,
+                               VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                               RenderGraphPass_ShadowMask, RenderGraphPass_ShadowMask, &Mask->HalfMaskImage, &Mask->HalfMaskEntry);
+    RenderGraphTransientCreate(Graph, &Mask->HalfDepthImageId, HalfWidth, HalfHeight, VK_FORMAT_R32_SFLOAT,
+                               VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+                               RenderGraphPass_ShadowMask, RenderGraphPass_ShadowMask, &Mask->HalfDepthImage, &Mask->HalfDepthEntry);
+
+    ShadowMaskHistoryDestroy(Mask);
+    ShadowMaskHistoryCreate(Mask, Width, Height);
+    Mask->HistoryValid = false;
+
+    // NOTE: Full res resolve writes the mask directly, the half depth binding is only written at half res
+    for (u32 HalfRes = 0; HalfRes < 2; ++HalfRes)
+    {
+        render_target_entry* OutputEntry = HalfRes ? &Mask->HalfMaskEntry : &Mask->FullMaskEntry;
+        for (u32 HistoryId = 0; HistoryId < 2; ++HistoryId)
+        {
+            VkDescriptorSet Descriptor = Mask->ResolveDescriptors[HalfRes][HistoryId];
+            u32 PrevHistoryId = 1 - HistoryId;
+            
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   DepthEntry->View, DemoState->PointSampler, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   OutputEntry->View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   Mask->HalfDepthEntry.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   Mask->HistoryEntries[PrevHistoryId].View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   Mask->HistoryDepthEntries[PrevHistoryId].View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 6, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   Mask->HistoryEntries[HistoryId].View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+            VkDescriptorImageWrite(&RenderState->DescriptorManager, Descriptor, 7, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   Mask->HistoryDepthEntries[HistoryId].View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
+
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mask->UpsampleDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           DepthEntry->View, DemoState->PointSampler, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mask->UpsampleDescriptor, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           Mask->HalfDepthEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mask->UpsampleDescriptor, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           Mask->HalfMaskEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mask->UpsampleDescriptor, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                           Mask->FullMaskEntry.View, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+
+    VkDescriptorImageWrite(&RenderState->DescriptorManager, Mask->ForwardDescriptor, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           Mask->FullMaskEntry.View, DemoState->PointSampler, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+inline void ShadowMaskCreate(renderer_create_info CreateInfo, VkDescriptorSetLayout ShadowDescLayout, shadow_mask* Result)
+{
+    *Result = {};
+    // NOTE: Off by default so the forward pass keeps its output, the mask and its prepass are opt in from the UI
+    Result->Mode = ShadowMaskMode_Off;
+
+    Result->GlobalsBuffer = VkBufferCreate(RenderState->Device, &RenderState->GpuArena,
+                                           VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           sizeof(shadow_mask_globals_gpu));
+
+    // NOTE: Resolve
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->ResolveDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            // NOTE: Temporal history
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+        }
+
+        for (u32 HalfRes = 0; HalfRes < 2; ++HalfRes)
+        {
+            for (u32 HistoryId = 0; HistoryId < 2; ++HistoryId)
+            {
+                Result->ResolveDescriptors[HalfRes][HistoryId] = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool,
+                                                                                         Result->ResolveDescLayout);
+                VkDescriptorBufferWrite(&RenderState->DescriptorManager, Result->ResolveDescriptors[HalfRes][HistoryId], 0,
+                                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Result->GlobalsBuffer);
+            }
+        }
+
+        VkDescriptorSetLayout Layouts[] =
+        {
+            CreateInfo.SceneDescLayout,
+            ShadowDescLayout,
+            Result->ResolveDescLayout,
+        };
+
+        char* FileNames[] =
+        {
+            0,
+            "shader_shadow_mask_standard_comp.spv",
+            "shader_shadow_mask_pcf_comp.spv",
+            "shader_shadow_mask_variance_comp.spv",
+            "shader_shadow_mask_clipmap_comp.spv",
+        };
+        for (u32 ModeId = ShadowMode_Standard; ModeId < ArrayCount(FileNames); ++ModeId)
+        {
+            Result->ResolvePipelines[ModeId] = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                                       FileNames[ModeId], "main", Layouts, ArrayCount(Layouts));
+        }
+    }
+
+    // NOTE: Upsample
+    {
+        {
+            vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->UpsampleDescLayout);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+            VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+        }
+
+        Result->UpsampleDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->UpsampleDescLayout);
+
+        VkDescriptorSetLayout Layouts[] =
+        {
+            Result->UpsampleDescLayout,
+        };
+        Result->UpsamplePipeline = VkPipelineComputeCreate(RenderState->Device, &RenderState->PipelineManager, &DemoState->TempArena,
+                                                           "shader_shadow_mask_upsample_comp.spv", "main", Layouts, ArrayCount(Layouts));
+    }
+
+    // NOTE: Forward
+    {
+        vk_descriptor_layout_builder Builder = VkDescriptorLayoutBegin(&Result->ForwardDescLayout);
+        VkDescriptorLayoutAdd(&Builder, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT);
+        VkDescriptorLayoutEnd(RenderState->Device, &Builder);
+
+        Result->ForwardDescriptor = VkDescriptorSetAllocate(RenderState->Device, RenderState->DescriptorPool, Result->ForwardDescLayout);
+    }
+}
+
+inline void ShadowMaskUpload(shadow_mask* Mask, render_scene* Scene, shadow_mode ShadowMode)
+{
+    // NOTE: History from another resolution or shadow technique doesn't describe what we are about to render
+    if (!Mask->Temporal || Mask->Mode != Mask->HistoryMode || u32(ShadowMode) != Mask->HistoryShadowMode)
+    {
+        Mask->HistoryValid = false;
+    }
+    Mask->HistoryMode = Mask->Mode;
+    Mask->HistoryShadowMode = u32(ShadowMode);
+    
+    m4 VPTransform = CameraGetVP(&Scene->Camera);
+    shadow_mask_globals_gpu* Globals = VkTransferPushWriteStruct(&RenderState->TransferManager, Mask->GlobalsBuffer, shadow_mask_globals_gpu,
+                                                                 BarrierMask(VkAccessFlagBits(0), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+                                                                 BarrierMask(VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+    Globals->InvVPTransform = Inverse(VPTransform);
+    Globals->PrevVPTransform = Mask->PrevVPTransform;
+    Globals->FrameIndex = Mask->FrameIndex;
+    Globals->Temporal = Mask->Temporal;
+    Globals->HistoryValid = Mask->HistoryValid;
+
+    Mask->PrevVPTransform = VPTransform;
+    Mask->FrameIndex += 1;
+}
+
+inline void ShadowMaskImageBarrier(VkCommandBuffer CmdBuffer, VkImage Image, VkImageLayout OldLayout, VkPipelineStageFlags SrcStage,
+                                   VkAccessFlags SrcAccess, VkPipelineStageFlags DstStage, VkAccessFlags DstAccess)
+{
+    AsyncComputeImageBarrier(CmdBuffer, Image, VK_IMAGE_ASPECT_COLOR_BIT, OldLayout, VK_IMAGE_LAYOUT_GENERAL, VK_QUEUE_FAMILY_IGNORED,
+                             VK_QUEUE_FAMILY_IGNORED, SrcStage, SrcAccess, DstStage, DstAccess);
+}
+
+inline void ShadowMaskRender(VkCommandBuffer CmdBuffer, shadow_mask* Mask, render_scene* Scene, shadow_mode ShadowMode,
+                             VkDescriptorSet ShadowDescriptor)
+{
+    // NOTE: The graph synchronized the shadow maps and depth with us and discarded the mask images, history is tracked here
+    b32 HalfRes = Mask->Mode == ShadowMaskMode_Half;
+
+    u32 HistoryId = Mask->HistoryId;
+    u32 PrevHistoryId = 1 - HistoryId;
+    if (Mask->Temporal)
+    {
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HistoryImages[HistoryId], VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HistoryDepthImages[HistoryId], VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+        // NOTE: Without valid history the previous images might have never been written, the shader won't read them either way
+        VkImageLayout PrevLayout = Mask->HistoryValid ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HistoryImages[PrevHistoryId], PrevLayout, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HistoryDepthImages[PrevHistoryId], PrevLayout, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    // NOTE: Resolve
+    {
+        vk_pipeline* Pipeline = Mask->ResolvePipelines[ShadowMode];
+        VkDescriptorSet DescriptorSets[] =
+            {
+                Scene->SceneDescriptor,
+                ShadowDescriptor,
+                Mask->ResolveDescriptors[HalfRes ? 1 : 0][HistoryId],
+            };
+        u32 Width = HalfRes ? (Mask->Width + 1) / 2 : Mask->Width;
+        u32 Height = HalfRes ? (Mask->Height + 1) / 2 : Mask->Height;
+
+        vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Handle);
+        vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Layout, 0, ArrayCount(DescriptorSets), DescriptorSets, 0, 0);
+        vkCmdDispatch(CmdBuffer, (Width + 7) / 8, (Height + 7) / 8, 1);
+    }
+
+    // NOTE: Upsample
+    if (HalfRes)
+    {
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HalfMaskImage, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        ShadowMaskImageBarrier(CmdBuffer, Mask->HalfDepthImage, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        vkCmdBindPipeline(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Mask->UpsamplePipeline->Handle);
+        vkCmdBindDescriptorSets(CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Mask->UpsamplePipeline->Layout, 0, 1, &Mask->UpsampleDescriptor, 0, 0);
+        vkCmdDispatch(CmdBuffer, (Mask->Width + 7) / 8, (Mask->Height + 7) / 8, 1);
+    }
+
+    if (Mask->Temporal)
+    {
+        Mask->HistoryId = PrevHistoryId;
+        Mask->HistoryValid = true;
+    }
+}
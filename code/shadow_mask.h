@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+
+  NOTE: Screen Space Shadow Mask
+
+    The forward shaders used to run the directional shadow lookup for every fragment they shaded, so overdraw and expensive filters
+    multiplied. With the mask enabled we resolve the shadow once per pixel in compute after the depth prepass: reconstruct the world
+    position (and a normal for the slope bias) from the forward depth, run the same lookup as the forward shaders did
+    (shader_shadow_lookup.cpp) and write an R8 mask. The forward pass then only samples the mask at its pixel, so the filtering cost
+    depends on the resolution and not on the scene.
+
+    At half resolution each mask texel takes the nearest depth of its 2x2 footprint, and a depth aware bilateral upsample brings it
+    back to full resolution. Weights fall off with the relative depth difference, so edges don't bleed shadow onto the background.
+
+    With temporal accumulation on, the resolve blends each frame into a history that is reprojected with last frame's VP. PCF rotates
+    its 4 tap disk per pixel and per frame, so after a few frames the history approaches a kernel of 16+ taps while we only pay for
+    4 per frame. History gets rejected when the reprojected depth or the normal don't match (disocclusion), and thrown away when the
+    mask resolution or the shadow mode changes.
+
+ */
+
+enum shadow_mask_mode
+{
+    ShadowMaskMode_Off,
+    ShadowMaskMode_Full,
+    ShadowMaskMode_Half,
+};
+
+struct shadow_mask_globals_gpu
+{
+    m4 InvVPTransform;
+    m4 PrevVPTransform;
+    u32 FrameIndex;
+    u32 Temporal;
+    u32 HistoryValid;
+    u32 Pad0;
+};
+
+struct shadow_mask
+{
+    shadow_mask_mode Mode;
+    b32 Temporal;
+
+    u32 Width;
+    u32 Height;
+    // NOTE: Render graph transients
+    u32 FullMaskImageId;
+    VkImage FullMaskImage;
+    render_target_entry FullMaskEntry;
+    u32 HalfMaskImageId;
+    VkImage HalfMaskImage;
+    render_target_entry HalfMaskEntry;
+    u32 HalfDepthImageId;
+    VkImage HalfDepthImage;
+    render_target_entry HalfDepthEntry;
+
+    // NOTE: Ping ponged, sized for full res and half res only uses the top left. All four share HistoryMemory
+    VkDeviceMemory HistoryMemory;
+    VkImage HistoryImages[2];
+    render_target_entry HistoryEntries[2];
+    VkImage HistoryDepthImages[2];
+    render_target_entry HistoryDepthEntries[2];
+    u32 HistoryId;
+    b32 HistoryValid;
+    shadow_mask_mode HistoryMode;
+    u32 HistoryShadowMode;
+    m4 PrevVPTransform;
+    u32 FrameIndex;
+
+    VkBuffer GlobalsBuffer;
+
+    // NOTE: Indexed by [half res][history id that gets written]
+    VkDescriptorSetLayout ResolveDescLayout;
+    VkDescriptorSet ResolveDescriptors[2][2];
+    // NOTE: Indexed by shadow_mode
+    vk_pipeline* ResolvePipelines[5];
+
+    VkDescriptorSetLayout UpsampleDescLayout;
+    VkDescriptorSet UpsampleDescriptor;
+    vk_pipeline* UpsamplePipeline;
+
+    // NOTE: Replaces the shadow set of the forward pipelines, the pipeline itself is created with the other forward pipelines
+    VkDescriptorSetLayout ForwardDescLayout;
+    VkDescriptorSet ForwardDescriptor;
+    vk_pipeline* ForwardPipeline;
+};
@@ -0,0 +1,377 @@
+
+//
+// NOTE: Formats
+//
+
+global texture_format_info TextureFormatTable[] =
+{
+    // NOTE: DXGI_FORMAT values, see dxgiformat.h. BC4/BC5 and the one or two channel formats are masks and normals, float formats
+    // are data, neither gets bound as albedo
+    { 71, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 8, true },
+    { 72, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 8, true },
+    { 74, VK_FORMAT_BC2_UNORM_BLOCK, 4, 16, true },
+    { 75, VK_FORMAT_BC2_SRGB_BLOCK, 4, 16, true },
+    { 77, VK_FORMAT_BC3_UNORM_BLOCK, 4, 16, true },
+    { 78, VK_FORMAT_BC3_SRGB_BLOCK, 4, 16, true },
+    { 80, VK_FORMAT_BC4_UNORM_BLOCK, 4, 8, false },
+    { 81, VK_FORMAT_BC4_SNORM_BLOCK, 4, 8, false },
+    { 83, VK_FORMAT_BC5_UNORM_BLOCK, 4, 16, false },
+    { 84, VK_FORMAT_BC5_SNORM_BLOCK, 4, 16, false },
+    { 95, VK_FORMAT_BC6H_UFLOAT_BLOCK, 4, 16, false },
+    { 96, VK_FORMAT_BC6H_SFLOAT_BLOCK, 4, 16, false },
+    { 98, VK_FORMAT_BC7_UNORM_BLOCK, 4, 16, true },
+    { 99, VK_FORMAT_BC7_SRGB_BLOCK, 4, 16, true },
+
+    { 28, VK_FORMAT_R8G8B8A8_UNORM, 1, 4, true },
+    { 29, VK_FORMAT_R8G8B8A8_SRGB, 1, 4, true },
+    { 87, VK_FORMAT_B8G8R8A8_UNORM, 1, 4, true },
+    { 91, VK_FORMAT_B8G8R8A8_SRGB, 1, 4, true },
+    { 61, VK_FORMAT_R8_UNORM, 1, 1, false },
+    { 49, VK_FORMAT_R8G8_UNORM, 1, 2, false },
+    { 10, VK_FORMAT_R16G16B16A16_SFLOAT, 1, 8, false },
+    { 41, VK_FORMAT_R32_SFLOAT, 1, 4, false },
+    { 2, VK_FORMAT_R32G32B32A32_SFLOAT, 1, 16, false },
+};
+
+inline texture_format_info* TextureFormatFromDxgi(u32 DxgiFormat)
+{
+    texture_format_info* Result = 0;
+    for (u32 FormatId = 0; FormatId < ArrayCount(TextureFormatTable); ++FormatId)
+    {
+        if (TextureFormatTable[FormatId].DxgiFormat == DxgiFormat)
+        {
+            Result = TextureFormatTable + FormatId;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+inline texture_format_info* TextureFormatFromVk(VkFormat Format)
+{
+    texture_format_info* Result = 0;
+    for (u32 FormatId = 0; FormatId < ArrayCount(TextureFormatTable); ++FormatId)
+    {
+        if (TextureFormatTable[FormatId].Format == Format)
+        {
+            Result = TextureFormatTable + FormatId;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+inline u64 TextureMipSizeGet(texture_format_info* FormatInfo, u32 Width, u32 Height, u32 MipLevel, u32* MipWidth, u32* MipHeight)
+{
+    *MipWidth = Max(Width >> MipLevel, 1u);
+    *MipHeight = Max(Height >> MipLevel, 1u);
+    u64 NumBlocksX = (*MipWidth + FormatInfo->BlockDim - 1) / FormatInfo->BlockDim;
+    u64 NumBlocksY = (*MipHeight + FormatInfo->BlockDim - 1) / FormatInfo->BlockDim;
+    u64 Result = NumBlocksX*NumBlocksY*FormatInfo->BlockBytes;
+    return Result;
+}
+
+//
+// NOTE: DDS/KTX2 Parsing
+//
+
+inline b32 TextureFileDdsParse(texture_file* File, u64 FileSize)
+{
+    dds_header* Header = (dds_header*)File->Base;
+    dds_pixel_format* PixelFormat = &Header->PixelFormat;
+    if (Header->Size != sizeof(dds_header) - sizeof(u32) || PixelFormat->Size != sizeof(dds_pixel_format) ||
+        (Header->Caps2 & (DDS_CAPS2_CUBEMAP | DDS_CAPS2_VOLUME)))
+    {
+        return false;
+    }
+
+    u64 DataOffset = sizeof(dds_header);
+    u32 DxgiFormat = 0;
+    if ((PixelFormat->Flags & DDS_PIXEL_FORMAT_FOURCC) && PixelFormat->FourCC == DDS_FOURCC('D', 'X', '1', '0'))
+    {
+        if (FileSize < sizeof(dds_header) + sizeof(dds_header_dx10))
+        {
+            return false;
+        }
+
+        dds_header_dx10* HeaderDx10 = (dds_header_dx10*)(File->Base + sizeof(dds_header));
+        // NOTE: MiscFlag 0x4 marks cube maps
+        if (HeaderDx10->ResourceDimension != DDS_DIMENSION_TEXTURE2D || HeaderDx10->ArraySize > 1 || (HeaderDx10->MiscFlag & 0x4))
+        {
+            return false;
+        }
+        DxgiFormat = HeaderDx10->DxgiFormat;
+        DataOffset += sizeof(dds_header_dx10);
+    }
+    else if (PixelFormat->Flags & DDS_PIXEL_FORMAT_FOURCC)
+    {
+        // NOTE: DXT2/DXT4 are premultiplied DXT3/DXT5, the block layout is the same
+        switch (PixelFormat->FourCC)
+        {
+            case DDS_FOURCC('D', 'X', 'T', '1'): DxgiFormat = 71; break;
+            case DDS_FOURCC('D', 'X', 'T', '2'):
+            case DDS_FOURCC('D', 'X', 'T', '3'): DxgiFormat = 74; break;
+            case DDS_FOURCC('D', 'X', 'T', '4'):
+            case DDS_FOURCC('D', 'X', 'T', '5'): DxgiFormat = 77; break;
+            case DDS_FOURCC('A', 'T', 'I', '1'):
+            case DDS_FOURCC('B', 'C', '4', 'U'): DxgiFormat = 80; break;
+            case DDS_FOURCC('B', 'C', '4', 'S'): DxgiFormat = 81; break;
+            case DDS_FOURCC('A', 'T', 'I', '2'):
+            case DDS_FOURCC('B', 'C', '5', 'U'): DxgiFormat = 83; break;
+            case DDS_FOURCC('B', 'C', '5', 'S'): DxgiFormat = 84; break;
+        }
+    }
+    else if ((PixelFormat->Flags & DDS_PIXEL_FORMAT_RGB) && PixelFormat->RGBBitCount == 32)
+    {
+        if (PixelFormat->RBitMask == 0x000000FF && PixelFormat->GBitMask == 0x0000FF00 && PixelFormat->BBitMask == 0x00FF0000)
+        {
+            DxgiFormat = 28;
+        }
+        else if (PixelFormat->RBitMask == 0x00FF0000 && PixelFormat->GBitMask == 0x0000FF00 && PixelFormat->BBitMask == 0x000000FF)
+        {
+            DxgiFormat = 87;
+        }
+    }
+
+    texture_format_info* FormatInfo = TextureFormatFromDxgi(DxgiFormat);
+    if (!FormatInfo)
+    {
+        return false;
+    }
+
+    // NOTE: The mip count is only valid if its flag is set
+    File->FormatInfo = *FormatInfo;
+    File->Width = Header->Width;
+    File->Height = Header->Height;
+    File->NumMips = (Header->Flags & 0x20000) ? Max(Header->MipMapCount, 1u) : 1;
+    if (File->Width == 0 || File->Height == 0 || File->NumMips > TEXTURE_FILE_MAX_MIPS)
+    {
+        return false;
+    }
+
+    for (u32 MipId = 0; MipId < File->NumMips; ++MipId)
+    {
+        u32 MipWidth, MipHeight;
+        u64 MipSize = TextureMipSizeGet(&File->FormatInfo, File->Width, File->Height, MipId, &MipWidth, &MipHeight);
+        if (DataOffset + MipSize > FileSize)
+        {
+            return false;
+        }
+
+        File->MipOffsets[MipId] = DataOffset;
+        DataOffset += MipSize;
+    }
+
+    return true;
+}
+
+inline b32 TextureFileKtx2Parse(texture_file* File, u64 FileSize)
+{
+    ktx2_header* Header = (ktx2_header*)File->Base;
+    // NOTE: A level count of 0 asks the loader to generate mips, we just use the one level
+    u32 NumLevels = Max(Header->LevelCount, 1u);
+    if (Header->SupercompressionScheme != 0 || Header->PixelDepth > 1 || Header->LayerCount > 1 || Header->FaceCount != 1 ||
+        NumLevels > TEXTURE_FILE_MAX_MIPS || FileSize < sizeof(ktx2_header) + sizeof(ktx2_level)*NumLevels)
+    {
+        return false;
+    }
+
+    texture_format_info* FormatInfo = TextureFormatFromVk(VkFormat(Header->VkFormat));
+    if (!FormatInfo)
+    {
+        return false;
+    }
+
+    File->FormatInfo = *FormatInfo;
+    File->Width = Header->PixelWidth;
+    File->Height = Header->PixelHeight;
+    File->NumMips = NumLevels;
+    if (File->Width == 0 || File->Height == 0)
+    {
+        return false;
+    }
+
+    ktx2_level* Levels = (ktx2_level*)(File->Base + sizeof(ktx2_header));
+    for (u32 MipId = 0; MipId < File->NumMips; ++MipId)
+    {
+        // NOTE: Without supercompression every level has to be exactly the tightly packed size
+        u32 MipWidth, MipHeight;
+        u64 MipSize = TextureMipSizeGet(&File->FormatInfo, File->Width, File->Height, MipId, &MipWidth, &MipHeight);
+        ktx2_level* Level = Levels + MipId;
+        if (Level->ByteLength != MipSize || Level->ByteOffset > FileSize || MipSize > FileSize - Level->ByteOffset)
+        {
+            return false;
+        }
+
+        File->MipOffsets[MipId] = Level->ByteOffset;
+    }
+
+    return true;
+}
+
+//
+// NOTE: Open/Close
+//
+
+inline void TextureFileClose(texture_file* File)
+{
+    if (File->Base)
+    {
+        UnmapViewOfFile(File->Base);
+    }
+    if (File->Mapping)
+    {
+        CloseHandle(File->Mapping);
+    }
+    if (File->File != INVALID_HANDLE_VALUE && File->File)
+    {
+        CloseHandle(File->File);
+    }
+    *File = {};
+}
+
+inline b32 TextureFileOpen(char* FileName, texture_file* Result)
+{
+    *Result = {};
+
+    Result->File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (Result->File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(Result->File, &FileSize) || u64(FileSize.QuadPart) < sizeof(dds_header))
+    {
+        TextureFileClose(Result);
+        return false;
+    }
+
+    Result->Mapping = CreateFileMappingA(Result->File, 0, PAGE_READONLY, 0, 0, 0);
+    if (!Result->Mapping)
+    {
+        TextureFileClose(Result);
+        return false;
+    }
+
+    Result->Base = (u8*)MapViewOfFile(Result->Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Result->Base)
+    {
+        TextureFileClose(Result);
+        return false;
+    }
+
+    // NOTE: Both headers are smaller than the DDS one, which we checked the file size against
+    u8 Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    b32 IsKtx2 = true;
+    for (u32 ByteId = 0; ByteId < ArrayCount(Ktx2Identifier); ++ByteId)
+    {
+        IsKtx2 = IsKtx2 && Result->Base[ByteId] == Ktx2Identifier[ByteId];
+    }
+
+    b32 Valid = false;
+    if (((dds_header*)Result->Base)->Magic == DDS_MAGIC)
+    {
+        Valid = TextureFileDdsParse(Result, u64(FileSize.QuadPart));
+    }
+    else if (IsKtx2)
+    {
+        Valid = TextureFileKtx2Parse(Result, u64(FileSize.QuadPart));
+    }
+
+    // NOTE: Our samplers filter linearly, so that has to be supported too (it isn't for every float format)
+    if (Valid)
+    {
+        VkFormatProperties Properties;
+        vkGetPhysicalDeviceFormatProperties(RenderState->PhysicalDevice, Result->FormatInfo.Format, &Properties);
+        VkFormatFeatureFlags Needed = (VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+                                       VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+        Valid = (Properties.optimalTilingFeatures & Needed) == Needed;
+    }
+
+    // NOTE: Format properties report BC support whether or not the feature was enabled at device creation
+    if (Valid && Result->FormatInfo.BlockDim > 1)
+    {
+        Valid = DemoState->DeviceCaps.TextureCompressionBC;
+    }
+
+    if (!Valid)
+    {
+        TextureFileClose(Result);
+        return false;
+    }
+
+    Result->Loaded = true;
+    return true;
+}
+
+//
+// NOTE: Upload
+//
+
+inline texture_file_image TextureFileStream(asset_stream* Stream, texture_file* File, u32 TicketId)
+{
+    Assert(File->Loaded);
+    texture_file_image Result = {};
+
+    VkImageCreateInfo ImageCreateInfo = {};
+    ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    ImageCreateInfo.format = File->FormatInfo.Format;
+    ImageCreateInfo.extent = { File->Width, File->Height, 1 };
+    ImageCreateInfo.mipLevels = File->NumMips;
+    ImageCreateInfo.arrayLayers = 1;
+    ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    ImageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    ImageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkCheckResult(vkCreateImage(RenderState->Device, &ImageCreateInfo, 0, &Result.Image.Image));
+
+    {
+        VkMemoryRequirements Requirements;
+        vkGetImageMemoryRequirements(RenderState->Device, Result.Image.Image, &Requirements);
+
+        VkMemoryAllocateInfo AllocateInfo = {};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.allocationSize = Requirements.size;
+        AllocateInfo.memoryTypeIndex = DemoMemoryTypeGet(Requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VkCheckResult(vkAllocateMemory(RenderState->Device, &AllocateInfo, 0, &Result.Memory));
+        VkCheckResult(vkBindImageMemory(RenderState->Device, Result.Image.Image, Result.Memory, 0));
+    }
+
+    VkImageViewCreateInfo ViewCreateInfo = {};
+    ViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    ViewCreateInfo.image = Result.Image.Image;
+    ViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ViewCreateInfo.format = File->FormatInfo.Format;
+    ViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    ViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    ViewCreateInfo.subresourceRange.levelCount = File->NumMips;
+    ViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    ViewCreateInfo.subresourceRange.layerCount = 1;
+    VkCheckResult(vkCreateImageView(RenderState->Device, &ViewCreateInfo, 0, &Result.Image.View));
+
+    // NOTE: Blocks go from the mapping into the ring as is, the file has to stay mapped until the ticket is resident
+    for (u32 MipId = 0; MipId < File->NumMips; ++MipId)
+    {
+        u32 MipWidth, MipHeight;
+        TextureMipSizeGet(&File->FormatInfo, File->Width, File->Height, MipId, &MipWidth, &MipHeight);
+        AssetStreamImageRequest(Stream, TicketId, Result.Image.Image, VK_IMAGE_ASPECT_COLOR_BIT, MipId, MipWidth, MipHeight,
+                                File->FormatInfo.BlockDim, File->FormatInfo.BlockBytes, AssetStreamLoadCopy, File->Base,
+                                File->MipOffsets[MipId], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    return Result;
+}
+
+inline void TextureFileImageDestroy(texture_file_image* Image)
+{
+    // NOTE: Only once the device is idle, the image may still be sampled or copied into
+    vkDestroyImageView(RenderState->Device, Image->Image.View, 0);
+    vkDestroyImage(RenderState->Device, Image->Image.Image, 0);
+    vkFreeMemory(RenderState->Device, Image->Memory, 0);
+    *Image = {};
+}
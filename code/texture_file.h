@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+
+  NOTE: Texture Files
+
+    Textures come from DDS or KTX2 files that get memory mapped and streamed (see asset_stream.h) without touching the texels on the
+    CPU. Both formats store every mip in the layout vkCmdCopyBufferToImage wants (rows of 4x4 blocks for BC formats, tightly packed),
+    so each mip is one copy from the mapping into the staging ring and from there into the image:
+
+      - DDS: legacy FourCCs (DXT1-5, ATI1/ATI2, BC4U/BC4S/BC5U/BC5S), 32bit RGBA/BGRA masks, or a DX10 header with a DXGI format.
+        Mips follow the header back to back, largest first
+      - KTX2: the header has the VkFormat and a level index with an offset per mip. Supercompressed files (Basis, zstd) are rejected
+        since those would need transcoding
+
+    Only single 2D images are supported, no arrays, cube maps or volumes. Formats are BC1-BC7 plus a few uncompressed ones (see
+    TextureFormatTable), and we reject anything the device can't sample with linear filtering. The mapping stays open until the
+    texture is resident, the scene closes it then.
+
+    BC formats need textureCompressionBC (DeviceCaps.TextureCompressionBC, DemoDeviceCreate enables it wherever it is supported), we
+    reject BC files without it. Each format also says whether it holds color, the scene only binds those as albedo (single channel and
+    float files would render tinted or black).
+
+    IMPORTANT: The image, view and memory belong to the caller once streamed, TextureFileImageDestroy frees them after the device is
+    idle.
+
+ */
+
+#define TEXTURE_FILE_MAX_MIPS 16
+#define TEXTURE_TEST_FILE_NAME "test.dds"
+
+#define DDS_MAGIC 0x20534444 // NOTE: "DDS "
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_PIXEL_FORMAT_RGB 0x40
+#define DDS_CAPS2_CUBEMAP 0x200
+#define DDS_CAPS2_VOLUME 0x200000
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_FOURCC(A, B, C, D) (u32(A) | (u32(B) << 8) | (u32(C) << 16) | (u32(D) << 24))
+
+struct dds_pixel_format
+{
+    u32 Size;
+    u32 Flags;
+    u32 FourCC;
+    u32 RGBBitCount;
+    u32 RBitMask;
+    u32 GBitMask;
+    u32 BBitMask;
+    u32 ABitMask;
+};
+
+struct dds_header
+{
+    u32 Magic;
+    u32 Size;
+    u32 Flags;
+    u32 Height;
+    u32 Width;
+    u32 PitchOrLinearSize;
+    u32 Depth;
+    u32 MipMapCount;
+    u32 Reserved1[11];
+    dds_pixel_format PixelFormat;
+    u32 Caps;
+    u32 Caps2;
+    u32 Caps3;
+    u32 Caps4;
+    u32 Reserved2;
+};
+
+struct dds_header_dx10
+{
+    u32 DxgiFormat;
+    u32 ResourceDimension;
+    u32 MiscFlag;
+    u32 ArraySize;
+    u32 MiscFlags2;
+};
+
+struct ktx2_level
+{
+    u64 ByteOffset;
+    u64 ByteLength;
+    u64 UncompressedByteLength;
+};
+
+struct ktx2_header
+{
+    u8 Identifier[12];
+    u32 VkFormat;
+    u32 TypeSize;
+    u32 PixelWidth;
+    u32 PixelHeight;
+    u32 PixelDepth;
+    u32 LayerCount;
+    u32 FaceCount;
+    u32 LevelCount;
+    u32 SupercompressionScheme;
+    u32 DfdByteOffset;
+    u32 DfdByteLength;
+    u32 KvdByteOffset;
+    u32 KvdByteLength;
+    u64 SgdByteOffset;
+    u64 SgdByteLength;
+    // NOTE: Followed by LevelCount ktx2_levels
+};
+
+struct texture_format_info
+{
+    u32 DxgiFormat;
+    VkFormat Format;
+    // NOTE: Uncompressed formats are 1x1 blocks
+    u32 BlockDim;
+    u32 BlockBytes;
+    b32 Color;
+};
+
+struct texture_file_image
+{
+    vk_image Image;
+    // NOTE: Textures get their own allocation since the framework image helper has no mip count
+    VkDeviceMemory Memory;
+};
+
+struct texture_file
+{
+    HANDLE File;
+    HANDLE Mapping;
+    u8* Base;
+    b32 Loaded;
+
+    texture_format_info FormatInfo;
+    u32 Width;
+    u32 Height;
+    u32 NumMips;
+    // NOTE: Relative to Base, mip 0 is the largest
+    u64 MipOffsets[TEXTURE_FILE_MAX_MIPS];
+};